@@ -0,0 +1,105 @@
+#ifndef __CPPX_LOG_BINARY_H__
+#define __CPPX_LOG_BINARY_H__
+
+#include <cstdint>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+namespace binary
+{
+
+/*
+ * 二进制日志文件格式(log_binary=true时使用)
+ *
+ * 文件由连续的记录组成，每条记录以RecordHeader开头，uLength为整条记录的字节数(含记录头)，
+ * 记录之间没有填充，整数均为本机字节序
+ *
+ * 1. 每次打开日志文件时先写入一条kSession记录，记录进程号和单调时钟到系统时间的偏移
+ * 2. 每个调用点(文件行号和格式串)在当前文件中首次出现时写入一条kFormat记录，分配格式串ID
+ * 3. 每条Log日志写入一条kLog记录，只包含格式串ID和参数内容，由离线工具cppx_logcat还原为文本
+ * 4. LogFormat日志在记录时已经格式化，写入一条kText记录
+ *
+ * 格式串ID只在同一个文件的同一个会话内有效
+ */
+
+constexpr uint32_t kRecordMagic = 0x474c5043; // "CPLG"
+constexpr uint16_t kVersion = 1;
+
+enum class RecordType : uint16_t
+{
+    kSession = 1, // 会话信息
+    kFormat,      // 格式串注册
+    kLog,         // 参数化日志
+    kText,        // 已格式化的日志
+};
+
+struct RecordHeader
+{
+    uint32_t uMagic;   // kRecordMagic
+    uint16_t uType;    // RecordType
+    uint16_t uVersion; // kVersion
+    uint32_t uLength;  // 整条记录的字节数，含记录头
+    uint32_t uReserved;
+};
+
+struct SessionRecord
+{
+    RecordHeader header;
+    uint32_t uPid;
+    uint32_t uReserved;
+    int64_t iRealtimeOffsetNs; // 系统时间 = 单调时钟时间戳 + 偏移
+};
+
+// 之后依次为模块名、文件行号、函数名、格式串，均不含结尾的'\0'
+struct FormatRecord
+{
+    RecordHeader header;
+    uint32_t uFormatId;
+    uint16_t uModuleLen;
+    uint16_t uFileLineLen;
+    uint16_t uFunctionLen;
+    uint16_t uReserved;
+    uint32_t uFormatLen;
+};
+
+// 之后为uint32_t类型的参数长度数组，然后依次为各参数内容，均不含结尾的'\0'
+struct LogRecord
+{
+    RecordHeader header;
+    uint64_t uTimestampNs; // 单调时钟
+    uint32_t uFormatId;
+    uint32_t uTid;
+    int32_t iErrorNo;
+    uint8_t uLevel;
+    uint8_t uReserved;
+    uint16_t uParamCount;
+};
+
+// 之后为格式化后的日志文本，包含行首的时间等信息和结尾的换行符
+struct TextRecord
+{
+    RecordHeader header;
+    uint64_t uTimestampNs; // 单调时钟
+    uint32_t uTid;
+    uint8_t uLevel;
+    uint8_t uReserved[3];
+    uint32_t uTextLen;
+    uint32_t uReserved2;
+};
+
+static_assert(sizeof(RecordHeader) == 16, "binary log record header size changed");
+static_assert(sizeof(SessionRecord) == 32, "binary log session record size changed");
+static_assert(sizeof(FormatRecord) == 32, "binary log format record size changed");
+static_assert(sizeof(LogRecord) == 40, "binary log record size changed");
+static_assert(sizeof(TextRecord) == 40, "binary log text record size changed");
+
+}
+}
+}
+}
+
+#endif // __CPPX_LOG_BINARY_H__
@@ -0,0 +1,99 @@
+#ifndef __CPPX_LOG_SINK_H__
+#define __CPPX_LOG_SINK_H__
+
+#include <cstdint>
+#include <logger/logger.h>
+#include <utilities/export.h>
+#include <utilities/json.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+// 日志输出目标，通过ILogger::AddSink注册后与日志文件接收同一份格式化后的日志
+class EXPORT ILogSink
+{
+public:
+    enum class SinkType : uint32_t
+    {
+        kUdp = 0,   // UDP采集端，每条日志一个报文
+        kUnix,      // 本地unix域数据报套接字
+        kMemory,    // 内存环形缓冲区，保留最近的日志供管理接口查询
+    };
+
+protected:
+    virtual ~ILogSink() = default;
+
+public:
+    /**
+     * @brief 创建一个内置的ILogSink对象
+     * @param pConfig 配置对象
+     * @return 成功返回ILogSink对象指针，失败返回nullptr
+     * @note 多线程安全
+     */
+    static ILogSink *Create(IJson *pConfig);
+
+    /**
+     * @brief 销毁一个由Create创建的ILogSink对象，需在使用它的日志对象销毁之后调用
+     * @param pSink ILogSink对象指针
+     * @note 多线程安全
+     */
+    static void Destroy(ILogSink *pSink);
+
+    /**
+     * @brief 获取名称，用于统计信息
+     * @return 名称
+     * @note 多线程安全
+     */
+    virtual const char *GetName() const = 0;
+
+    /**
+     * @brief 写入一条格式化后的日志
+     * @param eLevel 日志级别
+     * @param pData 日志内容，包含结尾的换行符，由所有输出目标共享，调用返回后失效
+     * @param uLen 日志长度
+     * @return 成功返回0，无法立即写入时丢弃并返回错误码，不能阻塞
+     * @note 异步模式由日志线程调用，同步模式由日志对象加锁后调用
+     */
+    virtual int32_t Write(ILogger::LogLevel eLevel, const char *pData, uint32_t uLen) = 0;
+
+    /**
+     * @brief 把缓存的日志写出
+     * @note 调用方式同Write
+     */
+    virtual void Flush() = 0;
+
+    /**
+     * @brief 读取最近的日志，只有内存输出目标支持
+     * @param pBuffer 缓冲区
+     * @param uSize 缓冲区大小
+     * @return 拷贝的字节数，只拷贝完整的行，不支持时返回0
+     * @note 多线程安全
+     */
+    virtual uint64_t Read(char *pBuffer, uint64_t uSize) = 0;
+};
+
+namespace config
+{
+constexpr const char *kSinkName = "sink_name"; // 输出目标名称, 类型: string
+constexpr const char *kSinkType = "sink_type"; // 输出目标类型，取值见ILogSink::SinkType, 类型: uint32_t
+constexpr const char *kSinkAddress = "sink_address"; // UDP为"ip:port"，unix为套接字路径, 类型: string
+constexpr const char *kSinkMemoryKB = "sink_memory_kb"; // 内存输出目标的缓冲区大小(KB), 类型: uint32_t
+}
+
+namespace default_value
+{
+constexpr const char *kSinkName = "sink"; // 输出目标名称, 默认: sink
+constexpr const uint32_t kSinkType = (uint32_t)ILogSink::SinkType::kMemory; // 输出目标类型, 默认: 内存
+constexpr const char *kSinkAddress = ""; // 输出目标地址, 默认: 无
+constexpr const uint32_t kSinkMemoryKB = 1024; // 内存输出目标的缓冲区大小(KB), 默认: 1MB
+}
+
+}
+}
+}
+
+#endif // __CPPX_LOG_SINK_H__
@@ -1,10 +1,17 @@
 #ifndef __CPPX_LOG_H__
 #define __CPPX_LOG_H__
 
+#include <atomic>
 #include <cstdint>
 #include <utilities/export.h>
 #include <utilities/json.h>
 
+// 编译期最低日志级别，取值为LogLevel的数值，如-DCPPX_LOG_MIN_LEVEL=2时TRACE和DEBUG日志宏被整体消除，
+// 参数不会被求值，也不会生成调用点的静态数据，设置错误码不受影响
+#ifndef CPPX_LOG_MIN_LEVEL
+#define CPPX_LOG_MIN_LEVEL 0
+#endif
+
 namespace cppx
 {
 namespace base
@@ -12,6 +19,57 @@ namespace base
 namespace logger
 {
 
+// 格式串中两个{}之间的常量片段
+struct LogSegment
+{
+    uint32_t uOffset;
+    uint32_t uLength;
+};
+
+// 调用点的静态信息，由logger_ex3.h中的宏在编译期生成，生命周期与进程相同
+struct LogSite
+{
+    const char *pModule;
+    const char *pFileLine;
+    const char *pFunction;
+    const char *pFormat;
+    uint32_t uFormatLen;
+    uint32_t uArgCount;           // 格式串中{}的数量
+    const LogSegment *pSegments;  // uArgCount + 1个常量片段
+    const char *const *ppKeys {nullptr}; // 结构化日志的事件名和各参数的键，共uArgCount + 1个，普通日志为nullptr
+};
+
+// 按类型保存的日志参数，由日志线程格式化
+struct LogArg
+{
+    enum class Type : uint8_t
+    {
+        kBool,
+        kChar,
+        kInt,
+        kUint,
+        kDouble,
+        kString,
+        kPointer,
+    };
+
+    Type eType;
+    uint32_t uLength; // kString的长度，不要求以'\0'结尾
+    union
+    {
+        bool bValue;
+        char cValue;
+        int64_t iValue;
+        uint64_t uValue;
+        double dValue;
+        const char *pValue;
+        const void *pPointer;
+    };
+};
+
+class ILogSink;
+class LogRateLimiter;
+
 class EXPORT ILogger
 {
 public:
@@ -22,15 +80,27 @@ public:
         kInfo,      // 信息
         kWarn,      // 警告
         kError,     // 错误
-        kFatal,     // 致命错误
+        kFatal,     // 致命错误，异步模式下记录时等待日志线程写入并同步后返回，日志线程未运行时不等待
         kEvent,     // 事件
     };
 
+    // 可单独设置级别的模块数量，模块ID在进程内全局分配，0号为未注册或超出数量的模块，跟随日志级别
+    static constexpr uint32_t kMaxModuleCount = 64;
+
 protected:
     LogLevel m_eLogLevel; // 日志级别
+    LogLevel m_eCaptureLevel; // 需要传入日志对象的最低级别，开启飞行记录器时为kTrace
+    bool m_bCaptureAll {false}; // 是否开启飞行记录器
+    LogLevel m_eSinkLevel {LogLevel::kEvent}; // 各输出目标中最低的级别
+    std::atomic<uint32_t> m_uModuleLevelCount {0}; // 单独设置了级别的模块数量
+    std::atomic<uint8_t> m_auModuleLogLevel[kMaxModuleCount] {}; // 各模块单独设置的日志级别加1，0表示跟随日志级别
+    std::atomic<LogLevel> m_aModuleCaptureLevel[kMaxModuleCount] {}; // 各模块需要传入日志对象的最低级别
 
     virtual ~ILogger() = default;
 
+    // 按模块级别、输出目标级别和飞行记录器重新计算模块需要传入日志对象的最低级别
+    void UpdateCaptureLevel(uint32_t uModuleId);
+
 public:
     /**
      * @brief 创建一个ILogger对象
@@ -55,11 +125,65 @@ public:
     LogLevel GetLogLevel() const { return m_eLogLevel; }
 
     /**
-     * @brief 设置日志级别
+     * @brief 设置日志级别，未单独设置级别的模块跟随该级别
      * @param eLevel 日志级别
      * @note 多线程安全
      */
-    void SetLogLevel(LogLevel eLevel) { m_eLogLevel = eLevel; }
+    void SetLogLevel(LogLevel eLevel);
+
+    /**
+     * @brief 获取需要传入日志对象的最低级别
+     * @return 日志级别和各输出目标级别中的最低值，开启飞行记录器时为kTrace，低于日志级别的日志不写入文件
+     * @note 多线程安全
+     */
+    LogLevel GetCaptureLevel() const { return m_eCaptureLevel; }
+
+    /**
+     * @brief 获取模块需要传入日志对象的最低级别，日志宏按该级别过滤
+     * @param uModuleId 模块ID，由GetModuleId获取
+     * @return 模块级别和各输出目标级别中的最低值，开启飞行记录器时为kTrace
+     * @note 多线程安全，只有一次relaxed读取
+     */
+    LogLevel GetCaptureLevel(uint32_t uModuleId) const
+    {
+        return m_aModuleCaptureLevel[uModuleId].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 单独设置模块的日志级别，写入日志文件时按模块级别代替日志级别过滤
+     * @param pModule 模块名，与日志宏所在作用域的kModuleName相同
+     * @param eLevel 模块的日志级别
+     * @return 成功返回0，模块数量超过kMaxModuleCount返回kInvalidParam
+     * @note 多线程安全，通过LOG_*2宏记录的日志不携带模块信息，配置了输出目标或飞行记录器时按日志级别写入文件
+     */
+    int32_t SetModuleLogLevel(const char *pModule, LogLevel eLevel);
+
+    /**
+     * @brief 取消模块单独设置的日志级别，之后跟随日志级别
+     * @param pModule 模块名
+     * @note 多线程安全
+     */
+    void ResetModuleLogLevel(const char *pModule);
+
+    /**
+     * @brief 获取模块在写入日志文件时使用的级别
+     * @param uModuleId 模块ID
+     * @return 单独设置了级别时返回模块级别，否则返回日志级别
+     * @note 多线程安全，只有一次relaxed读取
+     */
+    LogLevel GetModuleLogLevel(uint32_t uModuleId) const
+    {
+        auto uLevel = m_auModuleLogLevel[uModuleId].load(std::memory_order_relaxed);
+        return uLevel != 0 ? (LogLevel)(uLevel - 1) : m_eLogLevel;
+    }
+
+    /**
+     * @brief 获取模块ID，首次调用时注册，日志宏在调用点缓存结果
+     * @param pModule 模块名，需在进程生命周期内有效
+     * @return 模块ID，pModule为nullptr或模块数量已满时返回0
+     * @note 多线程安全，已注册的模块按指针或名称查找，不加锁
+     */
+    static uint32_t GetModuleId(const char *pModule);
 
     /**
      * @brief 初始化ILogger对象
@@ -116,6 +240,43 @@ public:
      */
     virtual int32_t LogFormat(int32_t iErrorNo, LogLevel eLevel, const char *pFormat, ...) = 0;
 
+    /**
+     * @brief 记录日志，参数按类型传入，格式化在日志线程中进行
+     * @param iErrorNo 错误码
+     * @param eLevel 日志级别
+     * @param pSite 调用点信息，需在进程生命周期内有效
+     * @param pArgs 参数数组，字符串参数的内容会在返回前拷贝
+     * @param uArgCount 参数数量，必须与pSite->uArgCount相同
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程安全，通常通过logger_ex3.h中的宏调用
+     */
+    virtual int32_t LogArgs(int32_t iErrorNo, LogLevel eLevel, const LogSite *pSite,
+                            const LogArg *pArgs, uint32_t uArgCount) = 0;
+
+    /**
+     * @brief 添加一个输出目标，日志只格式化一次，由日志线程分发给日志文件和各输出目标
+     * @param pSink 输出目标，生命周期需长于日志对象
+     * @param eLevel 输出目标的日志级别，与日志文件的级别相互独立
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程不安全，需在Start和记录日志之前调用
+     */
+    virtual int32_t AddSink(ILogSink *pSink, LogLevel eLevel) = 0;
+
+    /**
+     * @brief 注册限流调用点，日志线程每秒输出一次各调用点被抑制的条数，日志对象退出时输出剩余的条数
+     * @param pLimiter 调用点的限流器，生命周期需长于日志对象，通常为调用点的静态变量
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程安全，由logger_ex.h中的限流宏在调用点首次抑制日志时调用
+     */
+    virtual int32_t AddRateLimiter(LogRateLimiter *pLimiter) = 0;
+
+    /**
+     * @brief 导出飞行记录器中所有线程最近的日志到日志目录下的新文件，文件为二进制日志格式
+     * @return 成功返回0，未开启飞行记录器返回kNotSupported，失败返回错误码
+     * @note 多线程安全，记录FATAL日志和收到SIGSEGV/SIGABRT/SIGBUS时自动导出
+     */
+    virtual int32_t DumpFlightRecorder() = 0;
+
     /**
      * @brief 获取统计信息
      * @param pJsonStats 统计信息对象
@@ -126,6 +287,22 @@ public:
     virtual int32_t GetStats(IJson *pJsonStats) const = 0;
 };
 
+// 编译期判断日志级别不低于kMinLevel，日志宏通过CPPX_LOG_ENABLED使用
+template<int32_t kMinLevel>
+constexpr bool LogLevelCompiled(ILogger::LogLevel eLevel)
+{
+    return (int32_t)eLevel >= kMinLevel;
+}
+
+// 日志宏使用，先按编译期最低级别判断，再按调用点所在模块的级别判断，模块ID在调用点首次执行时获取并缓存，
+// 条件不满足时不会对日志参数求值
+#define CPPX_LOG_ENABLED(pLogger, eLevel)                                                         \
+  (::cppx::base::logger::LogLevelCompiled<CPPX_LOG_MIN_LEVEL>(eLevel) && likely(pLogger != nullptr) && \
+   eLevel >= pLogger->GetCaptureLevel([]() {                                                      \
+     static const uint32_t s_uLogModuleId = ::cppx::base::logger::ILogger::GetModuleId(kModuleName); \
+     return s_uLogModuleId;                                                                       \
+   }()))
+
 namespace config
 {
 constexpr const char *kLoggerName = "logger_name"; // 日志名称, 类型: string
@@ -138,7 +315,21 @@ constexpr const char *kLogSuffix = "log_suffix";    // 日志文件后缀名, 
 constexpr const char *kLogFileMaxSizeMB = "log_file_max_size_mb"; // 日志文件最大大小(MB), 类型: uint64_t
 constexpr const char *kLogTotalSizeMB = "log_total_size_mb"; // 日志文件总大小(MB), 类型: uint64_t
 constexpr const char *kLogFormatBufferSize = "log_format_buffer_size"; // 日志格式化缓冲区大小, 类型: uint32_t
-constexpr const char *kLogChannelMaxMemMB = "log_channel_max_mem_mb"; // 日志通道最大内存大小(MB), 类型: uint32_t
+constexpr const char *kLogChannelMaxMemMB = "log_channel_max_mem_mb"; // 异步模式下所有线程日志队列的内存总量上限(MB)，超出后新线程的日志按溢出策略处理, 类型: uint32_t
+constexpr const char *kLogThreadQueueMemKB = "log_thread_queue_mem_kb"; // 异步模式下每个线程的日志队列内存大小(KB), 类型: uint32_t
+constexpr const char *kLogBinary = "log_binary"; // 是否输出二进制日志，需使用cppx_logcat查看, 类型: bool
+constexpr const char *kLogWriteBufferKB = "log_write_buffer_kb"; // 异步模式下文件写缓冲区大小(KB)，为0时每条日志直接写入文件, 类型: uint32_t
+constexpr const char *kLogFlushIntervalMs = "log_flush_interval_ms"; // 异步模式下缓冲区中日志的最长停留时间(ms), 类型: uint32_t
+constexpr const char *kLogSyncPolicy = "log_sync_policy"; // fdatasync策略，0:不同步 1:关闭或切换文件时 2:每次写入文件后, 类型: uint32_t
+constexpr const char *kLogMmap = "log_mmap"; // 是否通过mmap写日志文件，进程崩溃时已写入的日志由内核保留, 类型: bool
+constexpr const char *kLogMmapChunkMB = "log_mmap_chunk_mb"; // mmap模式每次扩展并映射的文件大小(MB), 类型: uint32_t
+constexpr const char *kLogFlightRecorder = "log_flight_recorder"; // 是否开启飞行记录器，在内存中记录所有级别的日志, 类型: bool
+constexpr const char *kLogFlightRecorderKB = "log_flight_recorder_kb"; // 飞行记录器每个线程的缓冲区大小(KB), 类型: uint32_t
+constexpr const char *kLogCompress = "log_compress"; // 是否在后台把切换后的日志文件压缩为gzip格式(.gz)，按压缩后的大小计入总大小, 类型: bool
+constexpr const char *kLogCompressCpuNo = "log_compress_cpu_no"; // 压缩和清理线程绑定的CPU编号, 类型: uint32_t
+constexpr const char *kLogOverflowPolicy = "log_overflow_policy"; // 异步模式下线程日志队列已满时的处理，0:丢弃 1:等待最多log_overflow_block_us后丢弃 2:在当前线程直接写入, 类型: uint32_t
+constexpr const char *kLogOverflowBlockUs = "log_overflow_block_us"; // 溢出策略为等待时的最长等待时间(us), 类型: uint32_t
+constexpr const char *kLogKvFormat = "log_kv_format"; // 结构化日志的文本格式，0:logfmt 1:JSON lines，二进制模式下保持二进制, 类型: uint32_t
 }
 
 namespace default_value
@@ -153,7 +344,21 @@ constexpr const char *kLogSuffix = ".log"; // 日志文件后缀名, 默认: .lo
 constexpr const uint64_t kLogFileMaxSizeMB = 16; // 日志文件最大大小(MB), 默认: 16MB
 constexpr const uint64_t kLogTotalSizeMB = 4 * 1024; // 日志文件总大小(MB), 默认: 4GB
 constexpr const uint32_t kLogFormatBufferSize = 4096; // 日志格式化缓冲区大小, 默认: 4096
-constexpr const uint32_t kLogChannelMaxMemMB = 128; // 日志通道最大内存大小(MB), 默认: 128MB
+constexpr const uint32_t kLogChannelMaxMemMB = 128; // 所有线程日志队列的内存总量上限(MB), 默认: 128MB
+constexpr const uint32_t kLogThreadQueueMemKB = 1024; // 异步模式下每个线程的日志队列内存大小(KB), 默认: 1MB
+constexpr const bool kLogBinary = false; // 是否输出二进制日志, 默认: false
+constexpr const uint32_t kLogWriteBufferKB = 1024; // 异步模式下文件写缓冲区大小(KB), 默认: 1MB
+constexpr const uint32_t kLogFlushIntervalMs = 100; // 异步模式下缓冲区中日志的最长停留时间(ms), 默认: 100ms
+constexpr const uint32_t kLogSyncPolicy = 0; // fdatasync策略, 默认: 不同步
+constexpr const bool kLogMmap = false; // 是否通过mmap写日志文件, 默认: false
+constexpr const uint32_t kLogMmapChunkMB = 64; // mmap模式每次扩展并映射的文件大小(MB), 默认: 64MB
+constexpr const bool kLogFlightRecorder = false; // 是否开启飞行记录器, 默认: false
+constexpr const uint32_t kLogFlightRecorderKB = 256; // 飞行记录器每个线程的缓冲区大小(KB), 默认: 256KB
+constexpr const bool kLogCompress = false; // 是否压缩切换后的日志文件, 默认: false
+constexpr const uint32_t kLogCompressCpuNo = UINT32_MAX; // 压缩和清理线程绑定的CPU编号, 默认: 不绑定
+constexpr const uint32_t kLogOverflowPolicy = 0; // 线程日志队列已满时的处理, 默认: 丢弃
+constexpr const uint32_t kLogOverflowBlockUs = 1000; // 溢出策略为等待时的最长等待时间(us), 默认: 1ms
+constexpr const uint32_t kLogKvFormat = 0; // 结构化日志的文本格式, 默认: logfmt
 }
 
 }
@@ -1,6 +1,7 @@
 #ifndef __CPPX_LOGGER_EX_H__
 #define __CPPX_LOGGER_EX_H__
 
+#include <atomic>
 #include <type_traits>
 #include <cinttypes>
 #include <logger/logger.h>
@@ -92,6 +93,146 @@ using WrapF = Wrap<32, float>;
 using WrapD = Wrap<32, double>;
 using WrapB = Wrap<8, bool>;
 
+// 调用点的令牌桶(GCRA)，每秒最多uRatePerSec条，允许突发uBurst条
+// 由宏定义为调用点的静态变量，构造函数为constexpr，常量初始化，检查时只有一次CAS
+// 首次抑制日志时注册到日志对象，异步模式下由日志线程定期输出被抑制的条数，日志风暴停止后剩余的条数也会输出
+class LogRateLimiter
+{
+public:
+    static constexpr const char *kSuppressedFormat = "suppressed {} logs";
+
+    constexpr LogRateLimiter(uint32_t uRatePerSec, uint32_t uBurst, const char *pModule = nullptr,
+                             const char *pFileLine = nullptr, const char *pFunction = nullptr)
+        : m_uIntervalNs(kSecond / (uRatePerSec != 0 ? uRatePerSec : 1)),
+          m_uBurstNs(m_uIntervalNs * (uBurst != 0 ? uBurst : 1)),
+          m_pModule(pModule), m_pFileLine(pFileLine), m_pFunction(pFunction)
+    {
+    }
+
+    /**
+     * @brief 检查是否允许记录
+     * @param uSuppressed 允许时返回上次允许之后被抑制的条数
+     * @return 允许返回true
+     * @note 多线程安全，无锁
+     */
+    bool Allow(uint64_t &uSuppressed)
+    {
+        uint64_t uNowNs = 0;
+        clock_get_time_nano(uNowNs);
+        auto uTatNs = m_uTatNs.load(std::memory_order_relaxed);
+        while (true)
+        {
+            // 理论到达时间超过当前时间加突发容量时拒绝
+            auto uNewTatNs = (uTatNs > uNowNs ? uTatNs : uNowNs) + m_uIntervalNs;
+            if (uNewTatNs > uNowNs + m_uBurstNs)
+            {
+                m_uSuppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (m_uTatNs.compare_exchange_weak(uTatNs, uNewTatNs, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+
+        uSuppressed = TakeSuppressed();
+        return true;
+    }
+
+    /**
+     * @brief 检查是否允许记录，首次拒绝时注册到pLogger，由日志对象输出之后不再被允许记录的条数
+     * @param pLogger 日志对象，不能为nullptr
+     * @param eLevel 被抑制条数的日志级别
+     * @param iErrorNo 被抑制条数的错误码
+     * @param uSuppressed 允许时返回上次允许之后被抑制的条数
+     * @return 允许返回true
+     * @note 多线程安全，同一调用点被多个日志对象使用时只注册到第一个拒绝记录的日志对象
+     */
+    bool Allow(ILogger *pLogger, ILogger::LogLevel eLevel, int32_t iErrorNo, uint64_t &uSuppressed)
+    {
+        if (likely(Allow(uSuppressed)))
+        {
+            return true;
+        }
+        if (unlikely(!m_bRegistered.load(std::memory_order_relaxed)))
+        {
+            Register(pLogger, eLevel, iErrorNo);
+        }
+        return false;
+    }
+
+    // 取走被抑制的条数，由允许记录的调用方或日志对象输出
+    uint64_t TakeSuppressed()
+    {
+        return m_uSuppressed.load(std::memory_order_relaxed) != 0
+               ? m_uSuppressed.exchange(0, std::memory_order_relaxed) : 0;
+    }
+
+    // 以调用点的信息记录一条被抑制的条数
+    void LogSuppressed(ILogger *pLogger, ILogger::LogLevel eLevel, int32_t iErrorNo, uint64_t uSuppressed) const
+    {
+        WrapU64 suppressed(uSuppressed);
+        const char *ppParams[] = {suppressed};
+        pLogger->Log(iErrorNo, eLevel, m_pModule, m_pFileLine, m_pFunction, kSuppressedFormat, ppParams, 1);
+    }
+
+    // 日志对象退出时调用，之后可以重新注册到其他日志对象
+    void Unregister() { m_bRegistered.store(false, std::memory_order_release); }
+
+    const char *GetModule() const { return m_pModule; }
+    const char *GetFileLine() const { return m_pFileLine; }
+    const char *GetFunction() const { return m_pFunction; }
+    // 注册时的级别和错误码，AddRateLimiter之后对日志对象可见
+    ILogger::LogLevel GetLevel() const { return m_eLevel; }
+    int32_t GetErrorNo() const { return m_iErrorNo; }
+
+private:
+    void Register(ILogger *pLogger, ILogger::LogLevel eLevel, int32_t iErrorNo)
+    {
+        // 注册失败时不再重试，被抑制的条数在下一次允许记录时输出
+        bool bExpected = false;
+        if (m_bRegistered.compare_exchange_strong(bExpected, true, std::memory_order_acq_rel))
+        {
+            m_eLevel = eLevel;
+            m_iErrorNo = iErrorNo;
+            pLogger->AddRateLimiter(this);
+        }
+    }
+
+private:
+    const uint64_t m_uIntervalNs;
+    const uint64_t m_uBurstNs;
+    const char *const m_pModule;
+    const char *const m_pFileLine;
+    const char *const m_pFunction;
+    std::atomic<uint64_t> m_uTatNs {0};
+    std::atomic<uint64_t> m_uSuppressed {0};
+    std::atomic<bool> m_bRegistered {false};
+    ILogger::LogLevel m_eLevel {ILogger::LogLevel::kInfo};
+    int32_t m_iErrorNo {0};
+};
+
+// 调用点的采样计数，每uRate条记录第一条
+class LogSampler
+{
+public:
+    constexpr explicit LogSampler(uint32_t uRate) : m_uRate(uRate != 0 ? uRate : 1) {}
+
+    /**
+     * @brief 检查本次是否记录
+     * @return 记录返回true
+     * @note 多线程安全，无锁
+     */
+    bool Sample()
+    {
+        return m_uCount.fetch_add(1, std::memory_order_relaxed) % m_uRate == 0;
+    }
+
+private:
+    const uint64_t m_uRate;
+    std::atomic<uint64_t> m_uCount {0};
+};
+
 // 自动类型推断宏：根据参数类型自动选择对应的Wrap实现
 // 使用方式：Wrap(a) 会自动推断类型并返回对应的Wrap实例
 #define Wrap(val)                                                              \
@@ -107,13 +248,53 @@ using WrapB = Wrap<8, bool>;
                eLevel < cppx::base::logger::ILogger::LogLevel::kEvent)) {      \
       ::cppx::base::SetLastError(iErrorNo);                                    \
     }                                                                          \
-    if (likely(pLogger != nullptr && eLevel >= pLogger->GetLogLevel())) {      \
+    if (CPPX_LOG_ENABLED(pLogger, eLevel)) {                                   \
       const char *pParams[] = {"", ##__VA_ARGS__};                             \
       pLogger->Log(iErrorNo, eLevel, kModuleName, __POSITION__, fmt,       \
                    &pParams[1], sizeof(pParams) / sizeof(pParams[0]) - 1);     \
     }                                                                          \
   }
 
+// 按调用点限流，被抑制的条数在下一次允许记录时以一条单独的日志输出，
+// 异步模式下日志线程每秒输出一次尚未输出的条数，同步模式在日志对象退出时输出
+#define LOG_RATE_LIMITED_BASE(pLogger, eLevel, uRatePerSec, uBurst, iErrorNo, fmt, ...)           \
+  {                                                                                             \
+    if (likely(eLevel > cppx::base::logger::ILogger::LogLevel::kInfo &&                         \
+               eLevel < cppx::base::logger::ILogger::LogLevel::kEvent)) {                       \
+      ::cppx::base::SetLastError(iErrorNo);                                                    \
+    }                                                                                          \
+    if (CPPX_LOG_ENABLED(pLogger, eLevel)) {                                                   \
+      static ::cppx::base::logger::LogRateLimiter s_logRateLimiter(uRatePerSec, uBurst,        \
+                                                                   kModuleName, __POSITION__); \
+      uint64_t uLogSuppressed = 0;                                                             \
+      if (s_logRateLimiter.Allow(pLogger, eLevel, iErrorNo, uLogSuppressed)) {                 \
+        if (unlikely(uLogSuppressed != 0)) {                                                   \
+          s_logRateLimiter.LogSuppressed(pLogger, eLevel, iErrorNo, uLogSuppressed);           \
+        }                                                                                      \
+        const char *pParams[] = {"", ##__VA_ARGS__};                                           \
+        pLogger->Log(iErrorNo, eLevel, kModuleName, __POSITION__, fmt,                         \
+                     &pParams[1], sizeof(pParams) / sizeof(pParams[0]) - 1);                   \
+      }                                                                                        \
+    }                                                                                          \
+  }
+
+// 按调用点采样，每uRate条记录一条
+#define LOG_SAMPLED_BASE(pLogger, eLevel, uRate, iErrorNo, fmt, ...)                              \
+  {                                                                                             \
+    if (likely(eLevel > cppx::base::logger::ILogger::LogLevel::kInfo &&                         \
+               eLevel < cppx::base::logger::ILogger::LogLevel::kEvent)) {                       \
+      ::cppx::base::SetLastError(iErrorNo);                                                    \
+    }                                                                                          \
+    if (CPPX_LOG_ENABLED(pLogger, eLevel)) {                                                   \
+      static ::cppx::base::logger::LogSampler s_logSampler(uRate);                             \
+      if (s_logSampler.Sample()) {                                                             \
+        const char *pParams[] = {"", ##__VA_ARGS__};                                           \
+        pLogger->Log(iErrorNo, eLevel, kModuleName, __POSITION__, fmt,                         \
+                     &pParams[1], sizeof(pParams) / sizeof(pParams[0]) - 1);                   \
+      }                                                                                        \
+    }                                                                                          \
+  }
+
 #define LOG_TRACE(pLogger, iErrorNo, fmt, ...) LOG_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kTrace, iErrorNo, fmt, ##__VA_ARGS__) // 跟踪
 #define LOG_DEBUG(pLogger, iErrorNo, fmt, ...) LOG_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kDebug, iErrorNo, fmt, ##__VA_ARGS__) // 调试
 #define LOG_INFO(pLogger, iErrorNo, fmt, ...) LOG_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kInfo, iErrorNo, fmt, ##__VA_ARGS__)   // 信息
@@ -122,6 +303,11 @@ using WrapB = Wrap<8, bool>;
 #define LOG_FATAL(pLogger, iErrorNo, fmt, ...) LOG_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kFatal, iErrorNo, fmt, ##__VA_ARGS__) // 致命
 #define LOG_EVENT(pLogger, iErrorNo, fmt, ...) LOG_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kEvent, iErrorNo, fmt, ##__VA_ARGS__) // 事件
 
+#define LOG_WARN_RATE_LIMITED(pLogger, uRatePerSec, iErrorNo, fmt, ...) LOG_RATE_LIMITED_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kWarn, uRatePerSec, uRatePerSec, iErrorNo, fmt, ##__VA_ARGS__)   // 警告，每秒最多uRatePerSec条
+#define LOG_ERROR_RATE_LIMITED(pLogger, uRatePerSec, iErrorNo, fmt, ...) LOG_RATE_LIMITED_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kError, uRatePerSec, uRatePerSec, iErrorNo, fmt, ##__VA_ARGS__) // 错误，每秒最多uRatePerSec条
+#define LOG_WARN_SAMPLED(pLogger, uRate, iErrorNo, fmt, ...) LOG_SAMPLED_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kWarn, uRate, iErrorNo, fmt, ##__VA_ARGS__)   // 警告，每uRate条记录一条
+#define LOG_ERROR_SAMPLED(pLogger, uRate, iErrorNo, fmt, ...) LOG_SAMPLED_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kError, uRate, iErrorNo, fmt, ##__VA_ARGS__) // 错误，每uRate条记录一条
+
 }
 }
 }
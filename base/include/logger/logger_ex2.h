@@ -11,7 +11,7 @@
                eLevel < cppx::base::logger::ILogger::LogLevel::kEvent)) {      \
       ::cppx::base::SetLastError(iErrorNo);                                    \
     }                                                                          \
-    if (likely(pLogger != nullptr && eLevel >= pLogger->GetLogLevel())) {      \
+    if (CPPX_LOG_ENABLED(pLogger, eLevel)) {                                   \
       pLogger->LogFormat(iErrorNo, eLevel, "[%s] " fmt "(%s,%s)", kModuleName, \
                          ##__VA_ARGS__, __POSITION__);                         \
     }                                                                          \
@@ -0,0 +1,302 @@
+#ifndef __CPPX_LOGGER_EX3_H__
+#define __CPPX_LOGGER_EX3_H__
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <logger/logger.h>
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+namespace typed_detail
+{
+
+/* ============================== 编译期解析格式串 ============================== */
+// 与日志线程的替换规则一致：从左到右匹配"{}"
+constexpr uint32_t CountPlaceholders(const char *pFormat)
+{
+    uint32_t uCount = 0;
+    for (uint32_t i = 0; pFormat[i] != '\0'; ++i)
+    {
+        if (pFormat[i] == '{' && pFormat[i + 1] == '}')
+        {
+            ++uCount;
+            ++i;
+        }
+    }
+    return uCount;
+}
+
+constexpr uint32_t FormatLength(const char *pFormat)
+{
+    uint32_t uLength = 0;
+    while (pFormat[uLength] != '\0')
+    {
+        ++uLength;
+    }
+    return uLength;
+}
+
+template<uint32_t N>
+constexpr std::array<LogSegment, N + 1> ParseSegments(const char *pFormat)
+{
+    std::array<LogSegment, N + 1> arrSegments {};
+    uint32_t uSegment = 0;
+    uint32_t uStart = 0;
+    uint32_t i = 0;
+    for (; pFormat[i] != '\0'; ++i)
+    {
+        if (pFormat[i] == '{' && pFormat[i + 1] == '}')
+        {
+            arrSegments[uSegment].uOffset = uStart;
+            arrSegments[uSegment].uLength = i - uStart;
+            ++uSegment;
+            ++i;
+            uStart = i + 1;
+        }
+    }
+    arrSegments[uSegment].uOffset = uStart;
+    arrSegments[uSegment].uLength = i - uStart;
+    return arrSegments;
+}
+
+/* ============================== 按类型捕获参数 ============================== */
+inline LogArg MakeLogArg(bool bValue)
+{
+    LogArg arg;
+    arg.eType = LogArg::Type::kBool;
+    arg.uLength = 0;
+    arg.bValue = bValue;
+    return arg;
+}
+
+inline LogArg MakeLogArg(char cValue)
+{
+    LogArg arg;
+    arg.eType = LogArg::Type::kChar;
+    arg.uLength = 0;
+    arg.cValue = cValue;
+    return arg;
+}
+
+inline LogArg MakeLogArg(std::string_view strValue)
+{
+    LogArg arg;
+    arg.eType = LogArg::Type::kString;
+    arg.uLength = (uint32_t)strValue.size();
+    arg.pValue = strValue.data();
+    return arg;
+}
+
+inline LogArg MakeLogArg(const char *pValue)
+{
+    return MakeLogArg(pValue != nullptr ? std::string_view(pValue) : std::string_view("(null)"));
+}
+
+inline LogArg MakeLogArg(const std::string &strValue)
+{
+    return MakeLogArg(std::string_view(strValue));
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value
+                               && !std::is_same<T, char>::value, LogArg>::type
+MakeLogArg(T value)
+{
+    LogArg arg;
+    arg.eType = LogArg::Type::kInt;
+    arg.uLength = 0;
+    arg.iValue = (int64_t)value;
+    return arg;
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value
+                               && !std::is_same<T, bool>::value && !std::is_same<T, char>::value, LogArg>::type
+MakeLogArg(T value)
+{
+    LogArg arg;
+    arg.eType = LogArg::Type::kUint;
+    arg.uLength = 0;
+    arg.uValue = (uint64_t)value;
+    return arg;
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, LogArg>::type
+MakeLogArg(T value)
+{
+    LogArg arg;
+    arg.eType = LogArg::Type::kDouble;
+    arg.uLength = 0;
+    arg.dValue = (double)value;
+    return arg;
+}
+
+// 枚举按底层整数类型输出
+template<typename T>
+inline typename std::enable_if<std::is_enum<T>::value, LogArg>::type
+MakeLogArg(T value)
+{
+    return MakeLogArg((typename std::underlying_type<T>::type)value);
+}
+
+template<typename T>
+inline typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value, LogArg>::type
+MakeLogArg(const T *pValue)
+{
+    LogArg arg;
+    arg.eType = LogArg::Type::kPointer;
+    arg.uLength = 0;
+    arg.pPointer = pValue;
+    return arg;
+}
+
+}
+
+/**
+ * @brief 按类型记录日志，参数个数在编译期与格式串中{}的数量比较
+ * @param pLogger 日志对象
+ * @param iErrorNo 错误码
+ * @param eLevel 日志级别
+ * @param pSite 调用点信息
+ * @param args 参数，支持整数、浮点数、bool、char、枚举、字符串和指针
+ * @return 成功返回0，失败返回错误码
+ * @note 多线程安全
+ */
+template<uint32_t N, typename... Args>
+inline int32_t LogTyped(ILogger *pLogger, int32_t iErrorNo, ILogger::LogLevel eLevel,
+                        const LogSite *pSite, const Args &...args)
+{
+    static_assert(N == sizeof...(Args), "the number of {} in the log format does not match the number of arguments");
+    if constexpr (sizeof...(Args) == 0)
+    {
+        return pLogger->LogArgs(iErrorNo, eLevel, pSite, nullptr, 0);
+    }
+    else
+    {
+        const LogArg arrArgs[] = {typed_detail::MakeLogArg(args)...};
+        return pLogger->LogArgs(iErrorNo, eLevel, pSite, arrArgs, sizeof...(Args));
+    }
+}
+
+}
+}
+}
+
+/* ============================== 键值对展开 ============================== */
+// 参数为事件名和键值对，按键值对数量分派，键值对不完整时展开为未定义的标识符，编译失败
+#define CPPX_KV_CAT(a, b) CPPX_KV_CAT_IMPL(a, b)
+#define CPPX_KV_CAT_IMPL(a, b) a##b
+#define CPPX_KV_COUNT(...) CPPX_KV_COUNT_IMPL(__VA_ARGS__, 8, kv_odd, 7, kv_odd, 6, kv_odd, 5, kv_odd, \
+                                              4, kv_odd, 3, kv_odd, 2, kv_odd, 1, kv_odd, 0)
+#define CPPX_KV_COUNT_IMPL(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, N, ...) N
+#define CPPX_KV_EVENT(...) CPPX_KV_EVENT_IMPL(__VA_ARGS__, _)
+#define CPPX_KV_EVENT_IMPL(e, ...) e
+
+// 格式串中的" key={}"片段
+#define CPPX_KV_FORMAT(...) CPPX_KV_CAT(CPPX_KV_FORMAT_, CPPX_KV_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define CPPX_KV_FORMAT_0(e)
+#define CPPX_KV_FORMAT_1(e, k, v) " " k "={}"
+#define CPPX_KV_FORMAT_2(e, k, v, ...) " " k "={}" CPPX_KV_FORMAT_1(e, __VA_ARGS__)
+#define CPPX_KV_FORMAT_3(e, k, v, ...) " " k "={}" CPPX_KV_FORMAT_2(e, __VA_ARGS__)
+#define CPPX_KV_FORMAT_4(e, k, v, ...) " " k "={}" CPPX_KV_FORMAT_3(e, __VA_ARGS__)
+#define CPPX_KV_FORMAT_5(e, k, v, ...) " " k "={}" CPPX_KV_FORMAT_4(e, __VA_ARGS__)
+#define CPPX_KV_FORMAT_6(e, k, v, ...) " " k "={}" CPPX_KV_FORMAT_5(e, __VA_ARGS__)
+#define CPPX_KV_FORMAT_7(e, k, v, ...) " " k "={}" CPPX_KV_FORMAT_6(e, __VA_ARGS__)
+#define CPPX_KV_FORMAT_8(e, k, v, ...) " " k "={}" CPPX_KV_FORMAT_7(e, __VA_ARGS__)
+
+// 键列表，每个键前带逗号
+#define CPPX_KV_KEYS(...) CPPX_KV_CAT(CPPX_KV_KEYS_, CPPX_KV_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define CPPX_KV_KEYS_0(e)
+#define CPPX_KV_KEYS_1(e, k, v) , k
+#define CPPX_KV_KEYS_2(e, k, v, ...) , k CPPX_KV_KEYS_1(e, __VA_ARGS__)
+#define CPPX_KV_KEYS_3(e, k, v, ...) , k CPPX_KV_KEYS_2(e, __VA_ARGS__)
+#define CPPX_KV_KEYS_4(e, k, v, ...) , k CPPX_KV_KEYS_3(e, __VA_ARGS__)
+#define CPPX_KV_KEYS_5(e, k, v, ...) , k CPPX_KV_KEYS_4(e, __VA_ARGS__)
+#define CPPX_KV_KEYS_6(e, k, v, ...) , k CPPX_KV_KEYS_5(e, __VA_ARGS__)
+#define CPPX_KV_KEYS_7(e, k, v, ...) , k CPPX_KV_KEYS_6(e, __VA_ARGS__)
+#define CPPX_KV_KEYS_8(e, k, v, ...) , k CPPX_KV_KEYS_7(e, __VA_ARGS__)
+
+// 值列表，每个值前带逗号
+#define CPPX_KV_VALUES(...) CPPX_KV_CAT(CPPX_KV_VALUES_, CPPX_KV_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define CPPX_KV_VALUES_0(e)
+#define CPPX_KV_VALUES_1(e, k, v) , v
+#define CPPX_KV_VALUES_2(e, k, v, ...) , v CPPX_KV_VALUES_1(e, __VA_ARGS__)
+#define CPPX_KV_VALUES_3(e, k, v, ...) , v CPPX_KV_VALUES_2(e, __VA_ARGS__)
+#define CPPX_KV_VALUES_4(e, k, v, ...) , v CPPX_KV_VALUES_3(e, __VA_ARGS__)
+#define CPPX_KV_VALUES_5(e, k, v, ...) , v CPPX_KV_VALUES_4(e, __VA_ARGS__)
+#define CPPX_KV_VALUES_6(e, k, v, ...) , v CPPX_KV_VALUES_5(e, __VA_ARGS__)
+#define CPPX_KV_VALUES_7(e, k, v, ...) , v CPPX_KV_VALUES_6(e, __VA_ARGS__)
+#define CPPX_KV_VALUES_8(e, k, v, ...) , v CPPX_KV_VALUES_7(e, __VA_ARGS__)
+
+/* ============================== 日志宏 ============================== */
+// 格式串必须是字符串字面量，调用点信息和常量片段在编译期生成
+#define LOG_BASE3(pLogger, eLevel, iErrorNo, fmt, ...)                                                    \
+  {                                                                                                       \
+    if (likely(eLevel > cppx::base::logger::ILogger::LogLevel::kInfo &&                                   \
+               eLevel < cppx::base::logger::ILogger::LogLevel::kEvent)) {                                 \
+      ::cppx::base::SetLastError(iErrorNo);                                                               \
+    }                                                                                                     \
+    if (CPPX_LOG_ENABLED(pLogger, eLevel)) {                                                              \
+      static constexpr uint32_t kLogArgCount = ::cppx::base::logger::typed_detail::CountPlaceholders(fmt); \
+      static constexpr auto kLogSegments =                                                                \
+          ::cppx::base::logger::typed_detail::ParseSegments<kLogArgCount>(fmt);                           \
+      static constexpr ::cppx::base::logger::LogSite kLogSite {                                           \
+          kModuleName, __POSITION__, fmt, ::cppx::base::logger::typed_detail::FormatLength(fmt),          \
+          kLogArgCount, kLogSegments.data()};                                                             \
+      ::cppx::base::logger::LogTyped<kLogArgCount>(pLogger, iErrorNo, eLevel, &kLogSite, ##__VA_ARGS__);  \
+    }                                                                                                     \
+  }
+
+#define LOG_TRACE3(pLogger, iErrorNo, fmt, ...) LOG_BASE3(pLogger, cppx::base::logger::ILogger::LogLevel::kTrace, iErrorNo, fmt, ##__VA_ARGS__) // 跟踪
+#define LOG_DEBUG3(pLogger, iErrorNo, fmt, ...) LOG_BASE3(pLogger, cppx::base::logger::ILogger::LogLevel::kDebug, iErrorNo, fmt, ##__VA_ARGS__) // 调试
+#define LOG_INFO3(pLogger, iErrorNo, fmt, ...) LOG_BASE3(pLogger, cppx::base::logger::ILogger::LogLevel::kInfo, iErrorNo, fmt, ##__VA_ARGS__)   // 信息
+#define LOG_WARN3(pLogger, iErrorNo, fmt, ...) LOG_BASE3(pLogger, cppx::base::logger::ILogger::LogLevel::kWarn, iErrorNo, fmt, ##__VA_ARGS__)   // 警告
+#define LOG_ERROR3(pLogger, iErrorNo, fmt, ...) LOG_BASE3(pLogger, cppx::base::logger::ILogger::LogLevel::kError, iErrorNo, fmt, ##__VA_ARGS__) // 错误
+#define LOG_FATAL3(pLogger, iErrorNo, fmt, ...) LOG_BASE3(pLogger, cppx::base::logger::ILogger::LogLevel::kFatal, iErrorNo, fmt, ##__VA_ARGS__) // 致命错误
+#define LOG_EVENT3(pLogger, iErrorNo, fmt, ...) LOG_BASE3(pLogger, cppx::base::logger::ILogger::LogLevel::kEvent, iErrorNo, fmt, ##__VA_ARGS__) // 事件
+
+/* ============================== 结构化日志宏 ============================== */
+// 可变参数为事件名和若干键值对，事件名和键必须是字符串字面量，最多8对，例如：
+// LOG_KV(pLogger, ILogger::LogLevel::kInfo, "conn_open", "conn_id", uConnId, "bytes", uBytes)
+// 调用方只按类型捕获值，日志线程按log_kv_format输出为logfmt或JSON lines，二进制模式下保持二进制，
+// cppx_logcat显示为event=conn_open conn_id=1 bytes=2
+#define LOG_KV_BASE(pLogger, eLevel, iErrorNo, ...)                                                         \
+  {                                                                                                       \
+    if (likely(eLevel > cppx::base::logger::ILogger::LogLevel::kInfo &&                                   \
+               eLevel < cppx::base::logger::ILogger::LogLevel::kEvent)) {                                 \
+      ::cppx::base::SetLastError(iErrorNo);                                                               \
+    }                                                                                                     \
+    if (CPPX_LOG_ENABLED(pLogger, eLevel)) {                                                              \
+      static constexpr const char *kLogFormat = "event=" CPPX_KV_EVENT(__VA_ARGS__) CPPX_KV_FORMAT(__VA_ARGS__); \
+      static constexpr uint32_t kLogArgCount = CPPX_KV_COUNT(__VA_ARGS__);                                \
+      static constexpr auto kLogSegments =                                                                \
+          ::cppx::base::logger::typed_detail::ParseSegments<kLogArgCount>(kLogFormat);                    \
+      static constexpr const char *kLogKeys[] = {CPPX_KV_EVENT(__VA_ARGS__) CPPX_KV_KEYS(__VA_ARGS__)};     \
+      static constexpr ::cppx::base::logger::LogSite kLogSite {                                           \
+          kModuleName, __POSITION__, kLogFormat, ::cppx::base::logger::typed_detail::FormatLength(kLogFormat), \
+          kLogArgCount, kLogSegments.data(), kLogKeys};                                                   \
+      ::cppx::base::logger::LogTyped<kLogArgCount>(pLogger, iErrorNo, eLevel, &kLogSite CPPX_KV_VALUES(__VA_ARGS__)); \
+    }                                                                                                     \
+  }
+
+#define LOG_KV(pLogger, eLevel, ...) LOG_KV_BASE(pLogger, eLevel, ::cppx::base::ErrorCode::kSuccess, __VA_ARGS__)
+#define LOG_TRACE_KV(pLogger, iErrorNo, ...) LOG_KV_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kTrace, iErrorNo, __VA_ARGS__) // 跟踪
+#define LOG_DEBUG_KV(pLogger, iErrorNo, ...) LOG_KV_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kDebug, iErrorNo, __VA_ARGS__) // 调试
+#define LOG_INFO_KV(pLogger, iErrorNo, ...) LOG_KV_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kInfo, iErrorNo, __VA_ARGS__)   // 信息
+#define LOG_WARN_KV(pLogger, iErrorNo, ...) LOG_KV_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kWarn, iErrorNo, __VA_ARGS__)   // 警告
+#define LOG_ERROR_KV(pLogger, iErrorNo, ...) LOG_KV_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kError, iErrorNo, __VA_ARGS__) // 错误
+#define LOG_FATAL_KV(pLogger, iErrorNo, ...) LOG_KV_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kFatal, iErrorNo, __VA_ARGS__) // 致命错误
+#define LOG_EVENT_KV(pLogger, iErrorNo, ...) LOG_KV_BASE(pLogger, cppx::base::logger::ILogger::LogLevel::kEvent, iErrorNo, __VA_ARGS__) // 事件
+
+#endif // __CPPX_LOGGER_EX3_H__
@@ -59,6 +59,15 @@ public:
      */
     virtual void *Malloc(uint64_t uSize) = 0;
     
+    /**
+     * @brief 分配对齐的内存
+     * @param uSize 内存大小(字节)
+     * @param uAlign 对齐大小(字节)，必须是2的幂且是sizeof(void *)的倍数
+     * @return 成功返回内存指针，失败返回nullptr
+     * @note 多线程安全，返回的内存使用Free释放
+     */
+    virtual void *MallocAligned(uint64_t uSize, uint64_t uAlign) = 0;
+
     /**
      * @brief 释放内存
      * @param pMem 内存指针
@@ -66,25 +75,73 @@ public:
      */
     virtual void Free(const void *pMem) = 0;
 
+    /**
+     * @brief 释放已知大小的内存
+     * @param pMem 内存指针
+     * @param uSize 分配时的内存大小(字节)
+     * @note 多线程安全，uSize必须与分配时一致
+     */
+    virtual void Free(const void *pMem, uint64_t uSize) = 0;
+
+    /**
+     * @brief 重新分配内存，优先原地扩展，否则分配新内存并拷贝原有数据
+     * @param pMem 内存指针，为nullptr时等同于Malloc
+     * @param uSize 新的内存大小(字节)
+     * @return 成功返回内存指针，失败返回nullptr，此时原内存不变
+     * @note 多线程安全，不保留MallocAligned的对齐
+     */
+    virtual void *Realloc(void *pMem, uint64_t uSize) = 0;
+
+    /**
+     * @brief 尝试原地扩展内存，不会移动内存
+     * @param pMem 内存指针
+     * @param uSize 新的内存大小(字节)
+     * @return 原地可用返回true，否则返回false，此时原内存不变
+     * @note 多线程安全
+     */
+    virtual bool TryExpand(void *pMem, uint64_t uSize) = 0;
+
     /**
      * @brief 获取统计信息
-     * @param pJson 统计信息对象
+     * @param pJson 统计信息对象，开启伙伴系统时包含buddy对象(使用量、最大空闲块、碎片率和各阶空闲块数)
      * @return 成功返回0，失败返回错误码
      * @note 多线程安全
      */
     virtual int32_t GetStats(IJson *pJson) const = 0;
+
+    /**
+     * @brief 将当前存活的采样对象dump为heap profile文件
+     * @param pFilePath 文件路径
+     * @return 成功返回0，失败返回错误码，未开启采样返回kInvalidCall
+     * @note 多线程安全，输出格式兼容pprof(gperftools heap_v2)
+     */
+    virtual int32_t DumpHeapProfile(const char *pFilePath) const = 0;
 };
 
 namespace config
 {
 constexpr const char *kAllocatorName = "allocator_name"; // 分配器名称，类型: string
 constexpr const char *kAllocatorMaxMemoryMB = "allocator_max_memory_mb"; // 最大内存大小(MB)，类型: uint64_t
+constexpr const char *kAllocatorSampleIntervalBytes = "allocator_sample_interval_bytes"; // 堆采样平均间隔(字节)，0表示关闭，类型: uint64_t
+constexpr const char *kAllocatorSampleMaxCount = "allocator_sample_max_count"; // 最多记录的存活采样数，类型: uint32_t
+constexpr const char *kAllocatorProfileSignal = "allocator_profile_signal"; // 触发dump heap profile的信号，0表示不注册，类型: int32_t
+constexpr const char *kAllocatorProfilePath = "allocator_profile_path"; // 信号触发dump的文件路径，类型: string
+constexpr const char *kAllocatorTraceFile = "allocator_trace_file"; // 记录分配trace的文件路径，空表示不记录，类型: string
+constexpr const char *kAllocatorBuddyRegionMB = "allocator_buddy_region_mb"; // 伙伴系统预分配区域大小(MB)，0表示不使用，类型: uint64_t
+constexpr const char *kAllocatorBuddyMinBytes = "allocator_buddy_min_bytes"; // 不小于该大小的分配使用伙伴系统，类型: uint64_t
 }
 
 namespace default_value
 {
 constexpr const char *kAllocatorName = ""; // 分配器名称，默认: ""
 constexpr const uint64_t kAllocatorMaxMemoryMB = 0; // 最大内存大小(MB)，默认: 不限制
+constexpr const uint64_t kAllocatorSampleIntervalBytes = 0; // 堆采样平均间隔(字节)，默认: 关闭
+constexpr const uint32_t kAllocatorSampleMaxCount = 65536; // 最多记录的存活采样数，默认: 65536
+constexpr const int32_t kAllocatorProfileSignal = 0; // 触发dump heap profile的信号，默认: 不注册
+constexpr const char *kAllocatorProfilePath = "./cppx_heap.prof"; // 信号触发dump的文件路径，默认: ./cppx_heap.prof
+constexpr const char *kAllocatorTraceFile = ""; // 记录分配trace的文件路径，默认: 不记录
+constexpr const uint64_t kAllocatorBuddyRegionMB = 0; // 伙伴系统预分配区域大小(MB)，默认: 不使用
+constexpr const uint64_t kAllocatorBuddyMinBytes = 4096; // 不小于该大小的分配使用伙伴系统，默认: 4096
 }
 
 }
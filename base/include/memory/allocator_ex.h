@@ -3,6 +3,7 @@
 
 #include "utilities/common.h"
 #include <memory/allocator.h>
+#include <cstddef>
 #include <utility>
 
 namespace cppx
@@ -36,7 +37,16 @@ public:
     template<typename T, typename... Args>
     T *New(Args&&... args)
     {
-        auto pMem = Malloc(sizeof(T));
+        void *pMem = nullptr;
+        if constexpr (alignof(T) > alignof(std::max_align_t))
+        {
+            pMem = MallocAligned(sizeof(T), alignof(T));
+        }
+        else
+        {
+            pMem = Malloc(sizeof(T));
+        }
+
         if (likely(pMem != nullptr))
         {
             try
@@ -45,7 +55,7 @@ public:
             }
             catch (std::exception &e)
             {
-                Free(pMem);
+                Free(pMem, sizeof(T));
                 return nullptr;
             }
         }
@@ -58,7 +68,7 @@ public:
         if (likely(pMem != nullptr))
         {
             pMem->~T();
-            Free(pMem);
+            Free(pMem, sizeof(T));
         }
     }
 };
@@ -0,0 +1,52 @@
+#ifndef __CPPX_ALLOCATOR_TRACE_H__
+#define __CPPX_ALLOCATOR_TRACE_H__
+
+#include <cstdint>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+/**
+ * 分配器trace文件格式
+ * 文件由一个AllocTraceHeader和若干个AllocTraceRecord组成，均为本机字节序，
+ * 由开启了allocator_trace_file配置的IAllocator写出，用于离线回放真实的分配序列。
+ */
+constexpr uint32_t kAllocTraceMagic = 0x43415452; // "CATR"
+constexpr uint32_t kAllocTraceVersion = 1;
+
+enum AllocTraceOp : uint8_t
+{
+    kAllocTraceMalloc = 1,        // uAddr = 返回地址, uSize = 申请大小
+    kAllocTraceMallocAligned = 2, // uAddr = 返回地址, uSize = 申请大小, uArg = 对齐大小
+    kAllocTraceFree = 3,          // uAddr = 释放地址, uSize = 已知大小或0
+    kAllocTraceRealloc = 4,       // uAddr = 返回地址, uSize = 新大小, uArg = 原地址
+};
+
+struct AllocTraceHeader
+{
+    uint32_t uMagic;
+    uint32_t uVersion;
+    uint64_t uStartTimeNs; // 开始记录时的单调时钟时间
+};
+
+struct AllocTraceRecord
+{
+    uint64_t uTimeNs; // 相对uStartTimeNs的时间
+    uint64_t uAddr;
+    uint64_t uSize;
+    uint64_t uArg;
+    uint32_t uThreadId;
+    uint8_t uOp;
+    uint8_t aReserved[3];
+};
+
+static_assert(sizeof(AllocTraceRecord) == 40, "AllocTraceRecord layout changed");
+
+}
+}
+}
+#endif // __CPPX_ALLOCATOR_TRACE_H__
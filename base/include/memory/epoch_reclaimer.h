@@ -0,0 +1,148 @@
+#ifndef __CPPX_EPOCH_RECLAIMER_H__
+#define __CPPX_EPOCH_RECLAIMER_H__
+
+#include <utilities/common.h>
+#include <utilities/export.h>
+#include <utilities/json.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+/**
+ * 基于epoch的延迟内存回收
+ * 读线程在访问无锁结构前后调用Enter/Leave，写线程摘除节点后调用Retire，
+ * 节点被放入本线程的待回收列表，等所有可能引用它的读线程都离开后再批量释放。
+ * 线程首次使用时在回收器中注册线程记录，任意方式创建的线程退出时，其待回收节点
+ * 转交给回收器统一释放，线程记录留给之后的线程复用。
+ */
+class EXPORT IEpochReclaimer
+{
+public:
+    /**
+     * @brief 释放函数
+     * @param pMem 待释放的内存
+     * @param pUserParam 用户参数
+     */
+    using RetireFunc = void (*) (void *pMem, void *pUserParam);
+
+protected:
+    virtual ~IEpochReclaimer() = default;
+
+public:
+    /**
+     * @brief 获取全局单例对象
+     * @return 成功返回IEpochReclaimer对象指针，失败返回nullptr
+     * @note 多线程安全
+     */
+    static IEpochReclaimer *GetInstance();
+
+    /**
+     * @brief 创建一个IEpochReclaimer对象
+     * @return 成功返回IEpochReclaimer对象指针，失败返回nullptr
+     * @note 多线程安全
+     */
+    static IEpochReclaimer *Create();
+
+    /**
+     * @brief 销毁一个IEpochReclaimer对象，会释放所有待回收的内存
+     * @param pReclaimer IEpochReclaimer对象指针
+     * @note 多线程不安全，调用时不能有线程处于临界区内
+     */
+    static void Destroy(IEpochReclaimer *pReclaimer);
+
+    /**
+     * @brief 初始化IEpochReclaimer对象
+     * @param pConfig 配置对象，允许为nullptr
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程不安全
+     */
+    virtual int32_t Init(const IJson *pConfig) = 0;
+
+    /**
+     * @brief 清理IEpochReclaimer对象资源，释放所有待回收的内存
+     * @note 多线程不安全，调用时不能有线程处于临界区内
+     */
+    virtual void Exit() = 0;
+
+    /**
+     * @brief 进入临界区，临界区内读到的节点在Leave之前不会被释放
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程安全，可以嵌套调用，必须与Leave配对
+     */
+    virtual int32_t Enter() = 0;
+
+    /**
+     * @brief 离开临界区
+     * @note 多线程安全
+     */
+    virtual void Leave() = 0;
+
+    /**
+     * @brief 延迟释放内存，pMem必须已经从共享结构中摘除
+     * @param pMem 待释放的内存
+     * @param pRetireFunc 释放函数，为nullptr时使用IAllocator::Free释放
+     * @param pUserParam 释放函数的用户参数
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程安全，可以在临界区内或临界区外调用，待回收数达到批量阈值时尝试推进epoch并批量释放
+     */
+    virtual int32_t Retire(void *pMem, RetireFunc pRetireFunc, void *pUserParam) = 0;
+
+    /**
+     * @brief 尝试推进epoch并释放本线程和已退出线程中可以安全释放的内存
+     * @note 多线程安全，不保证释放全部待回收内存
+     */
+    virtual void Flush() = 0;
+
+    /**
+     * @brief 获取统计信息
+     * @param pJson 统计信息对象
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程安全
+     */
+    virtual int32_t GetStats(IJson *pJson) const = 0;
+};
+
+class EpochGuard
+{
+public:
+    EpochGuard(IEpochReclaimer *pReclaimer) : m_pReclaimer(pReclaimer)
+    {
+        if (unlikely(m_pReclaimer != nullptr && m_pReclaimer->Enter() != 0))
+        {
+            m_pReclaimer = nullptr;
+        }
+    }
+
+    ~EpochGuard()
+    {
+        if (likely(m_pReclaimer != nullptr))
+        {
+            m_pReclaimer->Leave();
+        }
+    }
+
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+
+private:
+    IEpochReclaimer *m_pReclaimer {nullptr};
+};
+
+namespace config
+{
+constexpr const char *kEpochReclaimBatchSize = "epoch_reclaim_batch_size"; // 每个线程累计多少待回收节点后尝试批量释放，类型: uint32_t
+}
+
+namespace default_value
+{
+constexpr const uint32_t kEpochReclaimBatchSize = 64; // 每个线程累计多少待回收节点后尝试批量释放，默认: 64
+}
+
+}
+}
+}
+#endif // __CPPX_EPOCH_RECLAIMER_H__
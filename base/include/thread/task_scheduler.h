@@ -40,6 +40,18 @@ public:
         kRunPeriodic
     };
 
+    enum class TimerType : uint32_t
+    {
+        kMap = 0,   // 按到期时间排序的红黑树，插入和删除O(log n)，不损失精度
+        kWheel = 1  // 分层时间轮，插入、删除和推进O(1)，到期时间按刻度向上取整，适合大量超时任务
+    };
+
+    enum class SleepType : uint32_t
+    {
+        kCond = 0,   // 条件变量，每次最多休眠空闲间隔时间后重新检查，间隔小时接近忙等，间隔大时会错过到期时间
+        kTimerfd = 1 // timerfd按绝对时间定到下一个到期时间，只在提交更早到期的任务或停止时提前唤醒
+    };
+
     struct Task
     {
         const char *pTaskName;
@@ -62,6 +74,15 @@ public:
     */
     static ITaskScheduler *Create(const char *pSchedulerName, uint32_t uPrecisionUs = 10);
 
+    /**
+     * @brief 按配置创建一个任务调度器实例
+     * @param[in] pSchedulerName 任务调度器的名字
+     * @param[in] pConfig 配置对象，配置项见config::kTaskScheduler*
+     * @return 成功返回调度器实例指针，失败返回 nullptr
+     * @note 多线程安全
+    */
+    static ITaskScheduler *Create(const char *pSchedulerName, IJson *pConfig);
+
     /**
      * @brief 释放任务调度器实例
      * @param[in] 调用Create接口创建的 pScheduler
@@ -85,7 +106,8 @@ public:
      * @brief 投递一个任务到调度器执行
      * @param[in] pTask 任务
      * @return 成功返回 TaskID，否则返回 kInvalidTaskID
-     * @note 多线程安全
+     * @note 多线程安全，TaskID由任务节点的下标和代数组成，任务结束或取消后失效，不会误操作复用该节点的新任务；
+     *       无锁提交，任务由调度线程在下一轮插入定时器，只有比调度线程的休眠时间更早到期时才唤醒调度线程
     */
     virtual int64_t PostTask(Task *pTask) = 0;
     virtual int64_t PostOnceTask(const char* pTaskName, TaskFunc pFunc, void* pCtx, 
@@ -96,10 +118,21 @@ public:
     /**
      * @brief 根据TaskID取消一个任务
      * @param[in] PostTask 返回的有效 TaskID
-     * @return 成功返回 0，否则失败
+     * @return 成功返回 0，任务已结束或TaskID无效返回kInvalidParam
+     * @note 多线程安全，无锁O(1)，任务节点由调度线程稍后回收；正在执行的任务会执行完本次，之后不再执行
     */
     virtual int32_t CancleTask(int64_t iTaskID) = 0;
 
+    /**
+     * @brief 把任务的下一次执行时间改为当前时间之后uDelayUs，用于刷新超时
+     * @param[in] iTaskID PostTask 返回的有效 TaskID
+     * @param[in] uDelayUs 距离下一次执行的延迟时间
+     * @return 成功返回 0，任务已结束、已取消或TaskID无效返回kInvalidParam
+     * @note 多线程安全，无锁O(1)，任务节点原地修改，TaskID不变；周期任务之后仍按原间隔执行；
+     *       一次性或固定次数的任务在最后一次执行期间被重新调度时返回成功，并按新的时间再执行一次
+    */
+    virtual int32_t RescheduleTask(int64_t iTaskID, uint32_t uDelayUs) = 0;
+
     /**
      * @brief 获取调度器统计信息
      * @param pJson 统计信息对象
@@ -109,6 +142,24 @@ public:
     virtual int32_t GetStats(IJson *pJson) const = 0;
 };
 
+namespace config
+{
+constexpr const char *kTaskSchedulerPrecisionUs = "task_scheduler_precision_us"; // 调度线程空闲休眠间隔时间(us)，类型: uint32_t
+constexpr const char *kTaskSchedulerTimer = "task_scheduler_timer"; // 定时器类型，0:红黑树 1:分层时间轮，见ITaskScheduler::TimerType，类型: uint32_t
+constexpr const char *kTaskSchedulerTickUs = "task_scheduler_tick_us"; // 时间轮的刻度(us)，类型: uint32_t
+constexpr const char *kTaskSchedulerSleep = "task_scheduler_sleep"; // 休眠方式，0:条件变量 1:timerfd，见ITaskScheduler::SleepType，类型: uint32_t
+constexpr const char *kTaskSchedulerSpinUs = "task_scheduler_spin_us"; // 到期前最后一段时间忙等而不休眠(us)，0表示不忙等，类型: uint32_t
+}
+
+namespace default_value
+{
+constexpr const uint32_t kTaskSchedulerPrecisionUs = 10; // 调度线程空闲休眠间隔时间(us)，默认: 10us
+constexpr const uint32_t kTaskSchedulerTimer = 0; // 定时器类型，默认: 红黑树
+constexpr const uint32_t kTaskSchedulerTickUs = 100; // 时间轮的刻度(us)，默认: 100us
+constexpr const uint32_t kTaskSchedulerSleep = 0; // 休眠方式，默认: 条件变量
+constexpr const uint32_t kTaskSchedulerSpinUs = 0; // 到期前忙等的时间，默认: 不忙等
+}
+
 }
 }
 
@@ -14,7 +14,7 @@ CMPSCVariableBoundedChannel::~CMPSCVariableBoundedChannel()
 {
     if (m_pDatap != nullptr)
     {
-        memory::IAllocator::GetInstance()->Free(m_pDatap);
+        memory::IAllocator::GetInstance()->Free(m_pDatap, m_uSizep);
         m_pDatap = nullptr;
         m_pDatac = nullptr;
     }
@@ -29,7 +29,7 @@ int32_t CMPSCVariableBoundedChannel::Init(uint64_t uMaxMemorySizeKB)
     m_Statsp.Reset();
     m_Statsc.Reset();
 
-    auto pData = reinterpret_cast<uint8_t *>(memory::IAllocator::GetInstance()->Malloc(m_uSizep));
+    auto pData = reinterpret_cast<uint8_t *>(memory::IAllocator::GetInstance()->MallocAligned(m_uSizep, CACHE_LINE));
     if (pData == nullptr)
     {
         return ErrorCode::kOutOfMemory;
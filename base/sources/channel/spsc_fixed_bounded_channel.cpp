@@ -15,7 +15,7 @@ CSPSCFixedBoundedChannel::~CSPSCFixedBoundedChannel()
 {
     if (likely(m_pDatap != nullptr))
     {
-        memory::IAllocator::GetInstance()->Free(m_pDatap);
+        memory::IAllocator::GetInstance()->Free(m_pDatap, m_uSizep * m_uElemSizep);
         m_pDatap = nullptr;
         m_pDatac = nullptr;
     }
@@ -40,7 +40,7 @@ int32_t CSPSCFixedBoundedChannel::Init(uint64_t uElemSize, uint64_t uSize)
     m_Statsp.Reset();
     m_Statsc.Reset();
 
-    auto pData = reinterpret_cast<uint8_t *>(memory::IAllocator::GetInstance()->Malloc(m_uSizep * m_uElemSizep));
+    auto pData = reinterpret_cast<uint8_t *>(memory::IAllocator::GetInstance()->MallocAligned(m_uSizep * m_uElemSizep, CACHE_LINE));
     if (unlikely(pData == nullptr))
     {
         SetLastError(ErrorCode::kOutOfMemory);
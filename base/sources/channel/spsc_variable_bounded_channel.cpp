@@ -15,7 +15,7 @@ CSPSCVariableBoundedChannel::~CSPSCVariableBoundedChannel()
 {
     if (m_pDatap != nullptr)
     {
-        memory::IAllocator::GetInstance()->Free(m_pDatap);
+        memory::IAllocator::GetInstance()->Free(m_pDatap, m_uSizep);
         m_pDatap = nullptr;
         m_pDatac = nullptr;
     }
@@ -36,7 +36,7 @@ int32_t CSPSCVariableBoundedChannel::Init(uint64_t uMaxMemorySizeKB)
     m_Statsp.Reset();
     m_Statsc.Reset();
 
-    auto pData = reinterpret_cast<uint8_t *>(memory::IAllocator::GetInstance()->Malloc(m_uSizep));
+    auto pData = reinterpret_cast<uint8_t *>(memory::IAllocator::GetInstance()->MallocAligned(m_uSizep, CACHE_LINE));
     if (unlikely(pData == nullptr))
     {
         SetLastError(ErrorCode::kOutOfMemory);
@@ -0,0 +1,408 @@
+#include "log_file_writer.h"
+#include <memory/allocator.h>
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+static constexpr uint32_t kBufferAlign = 4096;
+
+CLogFileWriter::~CLogFileWriter()
+{
+    Close();
+    if (m_pBuffer != nullptr)
+    {
+        memory::IAllocator::GetInstance()->Free(m_pBuffer);
+        m_pBuffer = nullptr;
+    }
+}
+
+int32_t CLogFileWriter::Init(uint32_t uBufferSize, SyncPolicy ePolicy, uint64_t uMmapChunkSize, bool bBinaryData)
+{
+    m_ePolicy = ePolicy;
+    m_bBinaryData = bBinaryData;
+    if (uMmapChunkSize != 0)
+    {
+        // 直接写入映射窗口，不需要缓冲区；uBufferSize为0时与非mmap模式一致，每次Write之后按策略同步
+        uint64_t uPageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+        m_bMmap = true;
+        m_bFlushEachWrite = uBufferSize == 0;
+        m_uChunkSize = (uMmapChunkSize + uPageSize - 1) / uPageSize * uPageSize;
+        return ErrorCode::kSuccess;
+    }
+
+    if (uBufferSize == 0)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    m_uBufferSize = (uBufferSize + kBufferAlign - 1) & ~(kBufferAlign - 1);
+    m_pBuffer = reinterpret_cast<char *>(memory::IAllocator::GetInstance()->MallocAligned(m_uBufferSize, kBufferAlign));
+    if (m_pBuffer == nullptr)
+    {
+        m_uBufferSize = 0;
+        PRINT_ERROR("init log file writer failed, out of memory, buffer size: %u", uBufferSize);
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+    return ErrorCode::kSuccess;
+}
+
+int32_t CLogFileWriter::Open(const char *pFileName)
+{
+    Close();
+
+    // 以追加方式打开，文件不存在时创建，mmap模式需要读写权限并自行维护写入位置
+    auto iFlags = m_bMmap ? (O_RDWR | O_CREAT | O_CLOEXEC) : (O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC);
+    m_iFd = open(pFileName, iFlags, 0644);
+    if (m_iFd < 0)
+    {
+        PRINT_ERROR("open log file %s failed: %s", pFileName, strerror(errno));
+        SetLastError(ErrorCode::kSystemError);
+        return ErrorCode::kSystemError;
+    }
+
+    if (m_bMmap && OpenMmap() != ErrorCode::kSuccess)
+    {
+        close(m_iFd);
+        m_iFd = -1;
+        SetLastError(ErrorCode::kSystemError);
+        return ErrorCode::kSystemError;
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CLogFileWriter::Close()
+{
+    if (m_iFd < 0)
+    {
+        return;
+    }
+
+    if (m_bMmap)
+    {
+        CloseMmap();
+    }
+    else
+    {
+        Flush();
+    }
+    if (m_ePolicy != SyncPolicy::kNone)
+    {
+        DataSync();
+    }
+    close(m_iFd);
+    m_iFd = -1;
+}
+
+int32_t CLogFileWriter::Write(const void *pData, uint32_t uLen)
+{
+    if (unlikely(m_iFd < 0))
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    if (unlikely(uLen == 0))
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    if (m_bMmap)
+    {
+        auto iErrorNo = WriteMmap(reinterpret_cast<const char *>(pData), uLen);
+        return iErrorNo == ErrorCode::kSuccess && m_bFlushEachWrite ? Flush() : iErrorNo;
+    }
+
+    if (likely(uLen <= m_uBufferSize - m_uBufferUsed))
+    {
+        if (m_uBufferUsed == 0)
+        {
+            clock_get_time_nano(m_uPendingSinceNs);
+        }
+        memcpy(m_pBuffer + m_uBufferUsed, pData, uLen);
+        m_uBufferUsed += uLen;
+        return ErrorCode::kSuccess;
+    }
+
+    struct iovec arrIov[2];
+    int32_t iIovCount = 0;
+    if (m_uBufferUsed != 0)
+    {
+        arrIov[iIovCount].iov_base = m_pBuffer;
+        arrIov[iIovCount].iov_len = m_uBufferUsed;
+        ++iIovCount;
+    }
+    arrIov[iIovCount].iov_base = const_cast<void *>(pData);
+    arrIov[iIovCount].iov_len = uLen;
+    ++iIovCount;
+
+    m_uBufferUsed = 0;
+    auto iErrorNo = WriteAll(arrIov, iIovCount);
+    if (iErrorNo == ErrorCode::kSuccess && m_ePolicy == SyncPolicy::kOnFlush)
+    {
+        iErrorNo = DataSync();
+    }
+    return iErrorNo;
+}
+
+int32_t CLogFileWriter::Flush()
+{
+    // mmap模式写入窗口后数据已经在页缓存中，只需按策略同步
+    if (m_bMmap)
+    {
+        if (m_iFd < 0 || !m_bMmapDirty)
+        {
+            return ErrorCode::kSuccess;
+        }
+        m_bMmapDirty = false;
+        return m_ePolicy == SyncPolicy::kOnFlush ? DataSync() : ErrorCode::kSuccess;
+    }
+
+    if (m_iFd < 0 || m_uBufferUsed == 0)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    struct iovec iov;
+    iov.iov_base = m_pBuffer;
+    iov.iov_len = m_uBufferUsed;
+    m_uBufferUsed = 0;
+    auto iErrorNo = WriteAll(&iov, 1);
+    if (iErrorNo == ErrorCode::kSuccess && m_ePolicy == SyncPolicy::kOnFlush)
+    {
+        iErrorNo = DataSync();
+    }
+    return iErrorNo;
+}
+
+int32_t CLogFileWriter::Sync()
+{
+    if (m_iFd < 0)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    auto ePolicy = m_ePolicy;
+    m_ePolicy = SyncPolicy::kNone;
+    auto iErrorNo = Flush();
+    m_ePolicy = ePolicy;
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        return iErrorNo;
+    }
+    return DataSync();
+}
+
+int32_t CLogFileWriter::GetStats(IJson *pJson) const
+{
+    if (pJson == nullptr)
+    {
+        return ErrorCode::kInvalidParam;
+    }
+
+    pJson->SetUint64("write_calls", m_uWriteCalls.load(std::memory_order_relaxed));
+    pJson->SetUint64("write_bytes", m_uWriteBytes.load(std::memory_order_relaxed));
+    pJson->SetUint64("sync_calls", m_uSyncCalls.load(std::memory_order_relaxed));
+    pJson->SetUint64("write_errors", m_uWriteErrors.load(std::memory_order_relaxed));
+    pJson->SetUint32("write_buffer_size", m_uBufferSize);
+    if (m_bMmap)
+    {
+        pJson->SetUint64("mmap_chunk_size", m_uChunkSize);
+        pJson->SetUint64("mmap_remap_count", m_uRemapCount.load(std::memory_order_relaxed));
+    }
+    return ErrorCode::kSuccess;
+}
+
+int32_t CLogFileWriter::WriteAll(iovec *pIov, int32_t iIovCount)
+{
+    // 处理被信号中断和部分写入的情况
+    while (iIovCount > 0)
+    {
+        auto iRet = writev(m_iFd, pIov, iIovCount);
+        m_uWriteCalls.fetch_add(1, std::memory_order_relaxed);
+        if (unlikely(iRet < 0))
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            m_uWriteErrors.fetch_add(1, std::memory_order_relaxed);
+            PRINT_ERROR("write log file failed: %s", strerror(errno));
+            SetLastError(ErrorCode::kSystemError);
+            return ErrorCode::kSystemError;
+        }
+
+        m_uWriteBytes.fetch_add((uint64_t)iRet, std::memory_order_relaxed);
+        auto uWritten = (uint64_t)iRet;
+        while (iIovCount > 0 && uWritten >= pIov->iov_len)
+        {
+            uWritten -= pIov->iov_len;
+            ++pIov;
+            --iIovCount;
+        }
+        if (iIovCount > 0)
+        {
+            pIov->iov_base = reinterpret_cast<char *>(pIov->iov_base) + uWritten;
+            pIov->iov_len -= uWritten;
+        }
+    }
+    return ErrorCode::kSuccess;
+}
+
+int32_t CLogFileWriter::OpenMmap()
+{
+    struct stat st;
+    if (fstat(m_iFd, &st) != 0)
+    {
+        PRINT_ERROR("stat log file failed: %s", strerror(errno));
+        return ErrorCode::kSystemError;
+    }
+
+    // 正常关闭时文件已截断到实际大小，从文件末尾继续写
+    // 进程异常退出时文件大小停在映射窗口的末尾，按页对齐，末尾是未写入的0：
+    // 文本日志从最后一个非0字节之后继续写；二进制记录可能以0结尾，保留这段0，cppx_logcat按记录头跳过
+    uint64_t uPageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t uDataEnd = (uint64_t)st.st_size;
+    if (!m_bBinaryData && uDataEnd % uPageSize == 0)
+    {
+        uDataEnd = FindDataEnd(uDataEnd);
+    }
+    uint64_t uWindowOffset = uDataEnd / uPageSize * uPageSize;
+    if (MapWindow(uWindowOffset) != ErrorCode::kSuccess)
+    {
+        return ErrorCode::kSystemError;
+    }
+    m_uWindowPos = uDataEnd - uWindowOffset;
+    return ErrorCode::kSuccess;
+}
+
+int32_t CLogFileWriter::MapWindow(uint64_t uOffset)
+{
+    // 先扩展文件，再映射，写入映射区域之外会触发SIGBUS
+    if (ftruncate(m_iFd, (off_t)(uOffset + m_uChunkSize)) != 0)
+    {
+        PRINT_ERROR("extend log file failed: %s", strerror(errno));
+        return ErrorCode::kSystemError;
+    }
+
+    auto pWindow = mmap(nullptr, m_uChunkSize, PROT_WRITE, MAP_SHARED, m_iFd, (off_t)uOffset);
+    if (pWindow == MAP_FAILED)
+    {
+        PRINT_ERROR("mmap log file failed: %s", strerror(errno));
+        return ErrorCode::kSystemError;
+    }
+
+    m_pWindow = reinterpret_cast<char *>(pWindow);
+    m_uWindowOffset = uOffset;
+    m_uWindowPos = 0;
+    m_uRemapCount.fetch_add(1, std::memory_order_relaxed);
+    return ErrorCode::kSuccess;
+}
+
+void CLogFileWriter::UnmapWindow()
+{
+    if (m_pWindow != nullptr)
+    {
+        munmap(m_pWindow, m_uChunkSize);
+        m_pWindow = nullptr;
+    }
+}
+
+int32_t CLogFileWriter::WriteMmap(const char *pData, uint64_t uLen)
+{
+    if (!m_bMmapDirty)
+    {
+        clock_get_time_nano(m_uPendingSinceNs);
+        m_bMmapDirty = true;
+    }
+
+    while (uLen > 0)
+    {
+        if (unlikely(m_uWindowPos == m_uChunkSize))
+        {
+            auto uNextOffset = m_uWindowOffset + m_uChunkSize;
+            UnmapWindow();
+            if (MapWindow(uNextOffset) != ErrorCode::kSuccess)
+            {
+                m_uWriteErrors.fetch_add(1, std::memory_order_relaxed);
+                SetLastError(ErrorCode::kSystemError);
+                return ErrorCode::kSystemError;
+            }
+        }
+
+        auto uCopyLen = std::min(uLen, m_uChunkSize - m_uWindowPos);
+        memcpy(m_pWindow + m_uWindowPos, pData, uCopyLen);
+        m_uWindowPos += uCopyLen;
+        pData += uCopyLen;
+        uLen -= uCopyLen;
+        m_uWriteBytes.fetch_add(uCopyLen, std::memory_order_relaxed);
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CLogFileWriter::CloseMmap()
+{
+    uint64_t uFileSize = m_uWindowOffset + m_uWindowPos;
+    UnmapWindow();
+    m_bMmapDirty = false;
+    if (ftruncate(m_iFd, (off_t)uFileSize) != 0)
+    {
+        PRINT_ERROR("truncate log file failed: %s", strerror(errno));
+    }
+}
+
+uint64_t CLogFileWriter::FindDataEnd(uint64_t uFileSize)
+{
+    // 只需检查最后一个映射块
+    uint64_t uLowerBound = uFileSize > m_uChunkSize ? uFileSize - m_uChunkSize : 0;
+    char szBuffer[64 * 1024];
+    uint64_t uEnd = uFileSize;
+    while (uEnd > uLowerBound)
+    {
+        auto uReadLen = std::min((uint64_t)sizeof(szBuffer), uEnd - uLowerBound);
+        auto iRet = pread(m_iFd, szBuffer, uReadLen, (off_t)(uEnd - uReadLen));
+        if (iRet != (ssize_t)uReadLen)
+        {
+            return uEnd;
+        }
+
+        for (auto i = uReadLen; i > 0; --i)
+        {
+            if (szBuffer[i - 1] != '\0')
+            {
+                return uEnd - uReadLen + i;
+            }
+        }
+        uEnd -= uReadLen;
+    }
+    return uEnd;
+}
+
+int32_t CLogFileWriter::DataSync()
+{
+    m_uSyncCalls.fetch_add(1, std::memory_order_relaxed);
+    if (unlikely(fdatasync(m_iFd) != 0))
+    {
+        PRINT_ERROR("sync log file failed: %s", strerror(errno));
+        SetLastError(ErrorCode::kSystemError);
+        return ErrorCode::kSystemError;
+    }
+    return ErrorCode::kSuccess;
+}
+
+}
+}
+}
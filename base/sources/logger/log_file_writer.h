@@ -0,0 +1,108 @@
+#ifndef __CPPX_LOG_FILE_WRITER_H__
+#define __CPPX_LOG_FILE_WRITER_H__
+
+#include <utilities/json.h>
+#include <atomic>
+#include <cstdint>
+#include <sys/uio.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+// 日志文件写入器，日志先追加到对齐的大缓冲区，缓冲区满或调用Flush时用一次write/writev写入文件
+// mmap模式下按块扩展文件并映射，日志直接拷贝到映射窗口中，写满后映射下一块，关闭时截断到实际大小
+// 多线程不安全，由调用方保证同一时刻只有一个线程访问
+class CLogFileWriter
+{
+public:
+    enum class SyncPolicy : uint32_t
+    {
+        kNone = 0,   // 不主动同步，由操作系统回写
+        kOnClose,    // 关闭或切换文件时fdatasync
+        kOnFlush,    // 每次写入文件后fdatasync
+    };
+
+public:
+    CLogFileWriter() = default;
+    CLogFileWriter(const CLogFileWriter &) = delete;
+    CLogFileWriter &operator=(const CLogFileWriter &) = delete;
+    CLogFileWriter(CLogFileWriter &&) = delete;
+    CLogFileWriter &operator=(CLogFileWriter &&) = delete;
+
+    ~CLogFileWriter();
+
+    /**
+     * @brief 初始化写入器
+     * @param uBufferSize 缓冲区大小，向上对齐到4KB，为0时每次Write直接写入文件
+     * @param ePolicy 同步策略
+     * @param uMmapChunkSize mmap模式每次映射的大小，向上对齐到页大小，为0时不使用mmap
+     * @param bBinaryData 写入的数据可能以0结尾，mmap模式异常退出后重新打开时不截掉末尾的0
+     * @return 成功返回0，失败返回错误码
+     */
+    int32_t Init(uint32_t uBufferSize, SyncPolicy ePolicy, uint64_t uMmapChunkSize = 0, bool bBinaryData = false);
+
+    int32_t Open(const char *pFileName);
+    void Close();
+    bool IsOpen() const { return m_iFd >= 0; }
+
+    // 缓冲区放不下时把缓冲区和本次数据用一次writev写入
+    int32_t Write(const void *pData, uint32_t uLen);
+
+    // 写入缓冲区中的数据，按同步策略决定是否fdatasync
+    int32_t Flush();
+
+    // 写入缓冲区中的数据并立即fdatasync，用于FATAL日志
+    int32_t Sync();
+
+    // mmap模式下写入映射窗口但还没有调用Flush的数据也算作待写入，由Flush按同步策略同步
+    bool HasPendingData() const { return m_uBufferUsed != 0 || m_bMmapDirty; }
+    uint64_t GetPendingSinceNs() const { return m_uPendingSinceNs; }
+
+    int32_t GetStats(IJson *pJson) const;
+
+private:
+    int32_t WriteAll(iovec *pIov, int32_t iIovCount);
+    int32_t DataSync();
+
+    // mmap模式
+    int32_t OpenMmap();
+    int32_t MapWindow(uint64_t uOffset);
+    void UnmapWindow();
+    int32_t WriteMmap(const char *pData, uint64_t uLen);
+    void CloseMmap();
+    uint64_t FindDataEnd(uint64_t uFileSize);
+
+private:
+    int32_t m_iFd {-1};
+    SyncPolicy m_ePolicy {SyncPolicy::kNone};
+
+    char *m_pBuffer {nullptr};
+    uint32_t m_uBufferSize {0};
+    uint32_t m_uBufferUsed {0};
+    uint64_t m_uPendingSinceNs {0}; // 缓冲区中最早一条数据的写入时间
+
+    bool m_bMmap {false};
+    bool m_bMmapDirty {false};
+    bool m_bFlushEachWrite {false};
+    bool m_bBinaryData {false};
+    uint64_t m_uChunkSize {0};
+    char *m_pWindow {nullptr};
+    uint64_t m_uWindowOffset {0}; // 映射窗口在文件中的偏移
+    uint64_t m_uWindowPos {0};    // 窗口内已写入的位置
+
+    std::atomic<uint64_t> m_uWriteCalls {0};
+    std::atomic<uint64_t> m_uWriteBytes {0};
+    std::atomic<uint64_t> m_uSyncCalls {0};
+    std::atomic<uint64_t> m_uWriteErrors {0};
+    std::atomic<uint64_t> m_uRemapCount {0};
+};
+
+}
+}
+}
+
+#endif // __CPPX_LOG_FILE_WRITER_H__
@@ -0,0 +1,718 @@
+#include "log_flight_recorder.h"
+#include "log_time_formatter.h"
+#include <logger/log_binary.h>
+#include <memory/allocator.h>
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+enum class EntryType : uint8_t
+{
+    kPad = 0, // 缓冲区末尾放不下一条记录时的填充
+    kLog,
+    kText,
+};
+
+// 缓冲区中的一条记录，之后为参数长度数组和参数内容，或已格式化的文本，整体按8字节对齐
+struct Entry
+{
+    uint32_t uLength; // 整条记录的字节数，含填充
+    uint8_t uType;
+    uint8_t uLevel;
+    uint16_t uParamCount;
+    uint32_t uTid;
+    int32_t iErrorNo;
+    uint32_t uDataLen;
+    uint32_t uReserved;
+    uint64_t uTimestampNs;
+    const char *pModule;
+    const char *pFileLine;
+    const char *pFunction;
+    const char *pFormat;
+};
+
+// 位置均为累计写入的字节数，对缓冲区大小取模得到偏移
+// 写入前先推进uTail淘汰最旧的记录，再写入内容，最后发布uHead
+struct CLogFlightRecorder::Ring
+{
+    Ring *pNext;
+    std::atomic<uint32_t> uOwnerTid; // 正在使用的线程
+    std::atomic<uint64_t> uHead;
+    std::atomic<uint64_t> uTail;
+    uint64_t uDumpPos;  // 导出游标
+    uint64_t uDumpEnd;  // 导出开始时的uHead
+    char *pData;
+};
+
+struct CLogFlightRecorder::FormatSlot
+{
+    const char *pFileLine;
+    const char *pFormat;
+    uint32_t uFormatId;
+};
+
+static constexpr uint32_t kEntryAlign = 8;
+static constexpr uint32_t kFormatSlotCount = 4096;
+static constexpr uint32_t kFormatProbeCount = 16;
+static constexpr uint32_t kDumpBufferSize = 64 * 1024;
+
+// 最近一次使用的记录器和本线程的缓冲区
+struct FlightCache
+{
+    uint64_t uRecorderId;
+    void *pRing;
+};
+static thread_local FlightCache tls_flightCache {0, nullptr};
+
+static std::atomic<uint64_t> s_uNextRecorderId {1};
+
+// 信号处理函数中遍历的记录器，注册和注销只修改指针
+static constexpr uint32_t kMaxRecorderCount = 8;
+static std::atomic<CLogFlightRecorder *> s_apRecorders[kMaxRecorderCount];
+static constexpr int32_t kDumpSignals[] = {SIGSEGV, SIGABRT, SIGBUS};
+static struct sigaction s_aOldActions[sizeof(kDumpSignals) / sizeof(kDumpSignals[0])];
+static std::once_flag s_signalOnce;
+
+static uint32_t AlignEntry(uint64_t uLength)
+{
+    return (uint32_t)((uLength + kEntryAlign - 1) / kEntryAlign * kEntryAlign);
+}
+
+CLogFlightRecorder::~CLogFlightRecorder()
+{
+    Exit();
+}
+
+int32_t CLogFlightRecorder::Init(const char *pDumpPrefix, uint32_t uRingSize)
+{
+    // 一条记录最多占缓冲区的四分之一，保证写入时总能淘汰出足够的空间
+    m_uRingSize = uRingSize / kEntryAlign * kEntryAlign;
+    m_uMaxEntrySize = m_uRingSize / 4 / kEntryAlign * kEntryAlign;
+    if (pDumpPrefix == nullptr || m_uMaxEntrySize < sizeof(Entry) + kEntryAlign)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    try
+    {
+        m_strDumpPrefix = pDumpPrefix;
+    }
+    catch (std::exception &e)
+    {
+        PRINT_ERROR("init flight recorder failed, throw exception: %s", e.what());
+        SetLastError(ErrorCode::kThrowException);
+        return ErrorCode::kThrowException;
+    }
+
+    // 导出时不能申请内存，提前分配
+    auto pAllocator = memory::IAllocator::GetInstance();
+    m_pEntryBuffer = reinterpret_cast<char *>(pAllocator->Malloc(m_uMaxEntrySize));
+    m_pDumpBuffer = reinterpret_cast<char *>(pAllocator->Malloc(kDumpBufferSize));
+    m_pFormatSlots = reinterpret_cast<FormatSlot *>(pAllocator->Malloc(sizeof(FormatSlot) * kFormatSlotCount));
+    if (m_pEntryBuffer == nullptr || m_pDumpBuffer == nullptr || m_pFormatSlots == nullptr)
+    {
+        Exit();
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    m_uRecorderId = s_uNextRecorderId.fetch_add(1, std::memory_order_relaxed);
+    m_uPid = getpid();
+
+    InstallSignalHandler();
+    for (auto &pRecorder : s_apRecorders)
+    {
+        CLogFlightRecorder *pExpected = nullptr;
+        if (pRecorder.compare_exchange_strong(pExpected, this))
+        {
+            m_bRegistered = true;
+            break;
+        }
+    }
+    if (!m_bRegistered)
+    {
+        PRINT_ERROR("flight recorder count exceeds %u, not dumped on signal", kMaxRecorderCount);
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CLogFlightRecorder::Exit()
+{
+    if (m_bRegistered)
+    {
+        for (auto &pRecorder : s_apRecorders)
+        {
+            CLogFlightRecorder *pExpected = this;
+            pRecorder.compare_exchange_strong(pExpected, nullptr);
+        }
+        m_bRegistered = false;
+    }
+
+    auto pAllocator = memory::IAllocator::GetInstance();
+    auto pRing = m_pRings.exchange(nullptr);
+    while (pRing != nullptr)
+    {
+        auto pNext = pRing->pNext;
+        pAllocator->Free(pRing);
+        pRing = pNext;
+    }
+    m_uRingCount.store(0, std::memory_order_relaxed);
+
+    if (m_pEntryBuffer != nullptr)
+    {
+        pAllocator->Free(m_pEntryBuffer);
+        m_pEntryBuffer = nullptr;
+    }
+    if (m_pDumpBuffer != nullptr)
+    {
+        pAllocator->Free(m_pDumpBuffer);
+        m_pDumpBuffer = nullptr;
+    }
+    if (m_pFormatSlots != nullptr)
+    {
+        pAllocator->Free(m_pFormatSlots);
+        m_pFormatSlots = nullptr;
+    }
+}
+
+void CLogFlightRecorder::Record(uint64_t uTimestampNs, uint32_t uTid, int32_t iErrorNo, ILogger::LogLevel eLevel,
+                                const char *pModule, const char *pFileLine, const char *pFunction,
+                                const char *pFormat, const char *const *ppParams, uint32_t uParamCount)
+{
+    auto pRing = GetRing(uTid);
+    if (unlikely(pRing == nullptr))
+    {
+        return;
+    }
+
+    // 超长的参数截断，保证整条记录不超过上限
+    uParamCount = std::min(uParamCount, (uint32_t)UINT16_MAX);
+    uint64_t uMaxDataLen = m_uMaxEntrySize - sizeof(Entry);
+    if (unlikely(uParamCount * sizeof(uint32_t) > uMaxDataLen))
+    {
+        uParamCount = (uint32_t)(uMaxDataLen / sizeof(uint32_t));
+    }
+    uint64_t uDataLen = uParamCount * sizeof(uint32_t);
+    for (uint32_t i = 0; i < uParamCount; ++i)
+    {
+        uDataLen += strlen(ppParams[i]);
+    }
+    uint64_t uParamLimit = UINT64_MAX;
+    if (unlikely(uDataLen > uMaxDataLen))
+    {
+        uParamLimit = (uMaxDataLen - uParamCount * sizeof(uint32_t)) / uParamCount;
+        uDataLen = uMaxDataLen;
+    }
+
+    auto uLength = AlignEntry(sizeof(Entry) + uDataLen);
+    uint64_t uNewHead = 0;
+    auto pEntry = reinterpret_cast<Entry *>(Reserve(pRing, uLength, uNewHead));
+    pEntry->uLength = uLength;
+    pEntry->uType = (uint8_t)EntryType::kLog;
+    pEntry->uLevel = (uint8_t)eLevel;
+    pEntry->uParamCount = (uint16_t)uParamCount;
+    pEntry->uTid = uTid;
+    pEntry->iErrorNo = iErrorNo;
+    pEntry->uReserved = 0;
+    pEntry->uTimestampNs = uTimestampNs;
+    pEntry->pModule = pModule;
+    pEntry->pFileLine = pFileLine;
+    pEntry->pFunction = pFunction;
+    pEntry->pFormat = pFormat;
+
+    auto puParamLen = reinterpret_cast<uint32_t *>(pEntry + 1);
+    auto pParam = reinterpret_cast<char *>(puParamLen + uParamCount);
+    for (uint32_t i = 0; i < uParamCount; ++i)
+    {
+        auto uParamLen = (uint32_t)std::min((uint64_t)strlen(ppParams[i]), uParamLimit);
+        memcpy(pParam, ppParams[i], uParamLen);
+        puParamLen[i] = uParamLen;
+        pParam += uParamLen;
+    }
+    pEntry->uDataLen = (uint32_t)(pParam - reinterpret_cast<char *>(puParamLen));
+
+    pRing->uHead.store(uNewHead, std::memory_order_release);
+}
+
+void CLogFlightRecorder::RecordText(uint64_t uTimestampNs, uint32_t uTid, ILogger::LogLevel eLevel,
+                                    const char *pText, uint32_t uTextLen)
+{
+    auto pRing = GetRing(uTid);
+    if (unlikely(pRing == nullptr))
+    {
+        return;
+    }
+
+    uTextLen = std::min(uTextLen, (uint32_t)(m_uMaxEntrySize - sizeof(Entry)));
+    auto uLength = AlignEntry(sizeof(Entry) + uTextLen);
+    uint64_t uNewHead = 0;
+    auto pEntry = reinterpret_cast<Entry *>(Reserve(pRing, uLength, uNewHead));
+    memset(pEntry, 0, sizeof(Entry));
+    pEntry->uLength = uLength;
+    pEntry->uType = (uint8_t)EntryType::kText;
+    pEntry->uLevel = (uint8_t)eLevel;
+    pEntry->uTid = uTid;
+    pEntry->uDataLen = uTextLen;
+    pEntry->uTimestampNs = uTimestampNs;
+    memcpy(pEntry + 1, pText, uTextLen);
+
+    pRing->uHead.store(uNewHead, std::memory_order_release);
+}
+
+int32_t CLogFlightRecorder::Dump()
+{
+    if (m_pDumpBuffer == nullptr || m_bDumping.exchange(true, std::memory_order_acquire))
+    {
+        return ErrorCode::kInvalidState;
+    }
+
+    // 只使用异步信号安全的函数拼接文件名：前缀 + 序号 + 后缀
+    char szFileName[512];
+    auto uPrefixLen = std::min(m_strDumpPrefix.size(), sizeof(szFileName) - 16);
+    memcpy(szFileName, m_strDumpPrefix.c_str(), uPrefixLen);
+    auto uLen = uPrefixLen + FormatUint32(szFileName + uPrefixLen, m_uDumpSeq.fetch_add(1) + 1);
+    memcpy(szFileName + uLen, ".bin", 5);
+
+    int32_t iErrorNo = ErrorCode::kSystemError;
+    auto iFd = open(szFileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (iFd >= 0)
+    {
+        iErrorNo = DumpRings(iFd);
+        close(iFd);
+    }
+
+    m_bDumping.store(false, std::memory_order_release);
+    return iErrorNo;
+}
+
+int32_t CLogFlightRecorder::GetStats(IJson *pJson) const
+{
+    if (pJson != nullptr)
+    {
+        pJson->SetUint32("flight_recorder_rings", m_uRingCount.load(std::memory_order_relaxed));
+        pJson->SetUint32("flight_recorder_dumps", m_uDumpSeq.load(std::memory_order_relaxed));
+    }
+    return ErrorCode::kSuccess;
+}
+
+CLogFlightRecorder::Ring *CLogFlightRecorder::GetRing(uint32_t uTid)
+{
+    auto &flightCache = tls_flightCache;
+    if (likely(flightCache.uRecorderId == m_uRecorderId))
+    {
+        return reinterpret_cast<Ring *>(flightCache.pRing);
+    }
+
+    // 优先使用本线程之前的缓冲区，其次复用已退出线程的缓冲区，保留其中的日志
+    Ring *pFound = nullptr;
+    for (auto pRing = m_pRings.load(std::memory_order_acquire); pRing != nullptr && pFound == nullptr; pRing = pRing->pNext)
+    {
+        if (pRing->uOwnerTid.load(std::memory_order_relaxed) == uTid)
+        {
+            pFound = pRing;
+        }
+    }
+    for (auto pRing = m_pRings.load(std::memory_order_acquire); pRing != nullptr && pFound == nullptr; pRing = pRing->pNext)
+    {
+        auto uOwnerTid = pRing->uOwnerTid.load(std::memory_order_relaxed);
+        if (syscall(SYS_tgkill, m_uPid, uOwnerTid, 0) != 0 && errno == ESRCH
+            && pRing->uOwnerTid.compare_exchange_strong(uOwnerTid, uTid, std::memory_order_acquire))
+        {
+            pFound = pRing;
+        }
+    }
+    if (pFound == nullptr)
+    {
+        pFound = CreateRing(uTid);
+        if (unlikely(pFound == nullptr))
+        {
+            return nullptr;
+        }
+    }
+
+    flightCache.uRecorderId = m_uRecorderId;
+    flightCache.pRing = pFound;
+    return pFound;
+}
+
+CLogFlightRecorder::Ring *CLogFlightRecorder::CreateRing(uint32_t uTid)
+{
+    auto pRing = reinterpret_cast<Ring *>(memory::IAllocator::GetInstance()->Malloc(sizeof(Ring) + m_uRingSize));
+    if (unlikely(pRing == nullptr))
+    {
+        return nullptr;
+    }
+
+    pRing->pNext = nullptr;
+    new (&pRing->uOwnerTid) std::atomic<uint32_t>(uTid);
+    new (&pRing->uHead) std::atomic<uint64_t>(0);
+    new (&pRing->uTail) std::atomic<uint64_t>(0);
+    pRing->uDumpPos = 0;
+    pRing->uDumpEnd = 0;
+    pRing->pData = reinterpret_cast<char *>(pRing + 1);
+
+    auto pHead = m_pRings.load(std::memory_order_relaxed);
+    do
+    {
+        pRing->pNext = pHead;
+    } while (!m_pRings.compare_exchange_weak(pHead, pRing, std::memory_order_release, std::memory_order_relaxed));
+    m_uRingCount.fetch_add(1, std::memory_order_relaxed);
+    return pRing;
+}
+
+char *CLogFlightRecorder::Reserve(Ring *pRing, uint32_t uLength, uint64_t &uNewHead)
+{
+    // 记录不跨越缓冲区末尾，剩余空间不足时填充后从头开始
+    auto uHead = pRing->uHead.load(std::memory_order_relaxed);
+    auto uOffset = uHead % m_uRingSize;
+    uint64_t uPadLen = uOffset + uLength > m_uRingSize ? m_uRingSize - uOffset : 0;
+    uNewHead = uHead + uPadLen + uLength;
+
+    auto uTail = pRing->uTail.load(std::memory_order_relaxed);
+    if (uNewHead - uTail > m_uRingSize)
+    {
+        while (uNewHead - uTail > m_uRingSize)
+        {
+            uTail += reinterpret_cast<Entry *>(pRing->pData + uTail % m_uRingSize)->uLength;
+        }
+        // 导出时读取内容后检查uTail，读到被覆盖的内容时一定能看到推进后的uTail
+        pRing->uTail.store(uTail, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    if (uPadLen != 0)
+    {
+        auto pPad = reinterpret_cast<Entry *>(pRing->pData + uOffset);
+        pPad->uLength = (uint32_t)uPadLen;
+        pPad->uType = (uint8_t)EntryType::kPad;
+    }
+    return pRing->pData + (uHead + uPadLen) % m_uRingSize;
+}
+
+bool CLogFlightRecorder::ReadEntry(Ring *pRing, bool bConsume)
+{
+    // 读取导出游标处的记录到m_pEntryBuffer，bConsume为false时只读取记录头且不移动游标
+    while (pRing->uDumpPos < pRing->uDumpEnd)
+    {
+        auto uTail = pRing->uTail.load(std::memory_order_acquire);
+        if (uTail > pRing->uDumpPos)
+        {
+            pRing->uDumpPos = uTail;
+            continue;
+        }
+
+        auto uOffset = pRing->uDumpPos % m_uRingSize;
+        auto pEntry = reinterpret_cast<Entry *>(m_pEntryBuffer);
+        memcpy(pEntry, pRing->pData + uOffset, kEntryAlign);
+        uint32_t uLength = pEntry->uLength;
+        uint8_t uType = pEntry->uType;
+        bool bValid = uLength >= kEntryAlign && uLength % kEntryAlign == 0 && uOffset + uLength <= m_uRingSize;
+        if (bValid && uType != (uint8_t)EntryType::kPad)
+        {
+            bValid = uLength >= sizeof(Entry) && uLength <= m_uMaxEntrySize;
+            if (bValid)
+            {
+                memcpy(pEntry, pRing->pData + uOffset, bConsume ? uLength : sizeof(Entry));
+            }
+        }
+
+        // 读取期间被覆盖时从新的尾部重新读取
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (pRing->uTail.load(std::memory_order_relaxed) > pRing->uDumpPos)
+        {
+            continue;
+        }
+
+        if (unlikely(!bValid))
+        {
+            pRing->uDumpPos = pRing->uDumpEnd;
+            return false;
+        }
+        if (uType == (uint8_t)EntryType::kPad)
+        {
+            pRing->uDumpPos += uLength;
+            continue;
+        }
+
+        pEntry->uLength = uLength;
+        if (bConsume)
+        {
+            pRing->uDumpPos += uLength;
+        }
+        return true;
+    }
+    return false;
+}
+
+int32_t CLogFlightRecorder::DumpRings(int32_t iFd)
+{
+    m_uDumpBufferUsed = 0;
+    m_uNextFormatId = 0;
+    memset(m_pFormatSlots, 0, sizeof(FormatSlot) * kFormatSlotCount);
+
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t uMonotonicNs = 0;
+    clock_get_time_nano(uMonotonicNs);
+
+    binary::SessionRecord session;
+    memset(&session, 0, sizeof(session));
+    session.header.uMagic = binary::kRecordMagic;
+    session.header.uType = (uint16_t)binary::RecordType::kSession;
+    session.header.uVersion = binary::kVersion;
+    session.header.uLength = sizeof(session);
+    session.uPid = m_uPid;
+    session.iRealtimeOffsetNs = (int64_t)(ts.tv_sec * kSecond + ts.tv_nsec) - (int64_t)uMonotonicNs;
+    if (DumpWrite(iFd, &session, sizeof(session)) != ErrorCode::kSuccess)
+    {
+        return ErrorCode::kSystemError;
+    }
+
+    // 只导出开始时已写入的日志，之后写入的日志不影响本次导出
+    for (auto pRing = m_pRings.load(std::memory_order_acquire); pRing != nullptr; pRing = pRing->pNext)
+    {
+        pRing->uDumpEnd = pRing->uHead.load(std::memory_order_acquire);
+        pRing->uDumpPos = pRing->uTail.load(std::memory_order_acquire);
+    }
+
+    // 各线程内部有序，每次取时间戳最小的一条
+    while (true)
+    {
+        Ring *pMinRing = nullptr;
+        uint64_t uMinTimestampNs = UINT64_MAX;
+        for (auto pRing = m_pRings.load(std::memory_order_acquire); pRing != nullptr; pRing = pRing->pNext)
+        {
+            if (ReadEntry(pRing, false))
+            {
+                auto uTimestampNs = reinterpret_cast<Entry *>(m_pEntryBuffer)->uTimestampNs;
+                if (pMinRing == nullptr || uTimestampNs < uMinTimestampNs)
+                {
+                    pMinRing = pRing;
+                    uMinTimestampNs = uTimestampNs;
+                }
+            }
+        }
+
+        if (pMinRing == nullptr)
+        {
+            break;
+        }
+        if (ReadEntry(pMinRing, true) && DumpEntry(iFd) != ErrorCode::kSuccess)
+        {
+            return ErrorCode::kSystemError;
+        }
+    }
+    return DumpFlush(iFd);
+}
+
+int32_t CLogFlightRecorder::DumpEntry(int32_t iFd)
+{
+    auto pEntry = reinterpret_cast<Entry *>(m_pEntryBuffer);
+    if (unlikely(sizeof(Entry) + pEntry->uDataLen > pEntry->uLength))
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    if (pEntry->uType == (uint8_t)EntryType::kText)
+    {
+        binary::TextRecord record;
+        memset(&record, 0, sizeof(record));
+        record.header.uMagic = binary::kRecordMagic;
+        record.header.uType = (uint16_t)binary::RecordType::kText;
+        record.header.uVersion = binary::kVersion;
+        record.header.uLength = sizeof(record) + pEntry->uDataLen;
+        record.uTimestampNs = pEntry->uTimestampNs;
+        record.uTid = pEntry->uTid;
+        record.uLevel = pEntry->uLevel;
+        record.uTextLen = pEntry->uDataLen;
+        if (DumpWrite(iFd, &record, sizeof(record)) != ErrorCode::kSuccess)
+        {
+            return ErrorCode::kSystemError;
+        }
+        return DumpWrite(iFd, pEntry + 1, pEntry->uDataLen);
+    }
+
+    if (unlikely(pEntry->uParamCount * sizeof(uint32_t) > pEntry->uDataLen))
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    auto uFormatId = DumpFormat(iFd, pEntry->pModule, pEntry->pFileLine, pEntry->pFunction, pEntry->pFormat);
+    if (unlikely(uFormatId == 0))
+    {
+        return ErrorCode::kSystemError;
+    }
+
+    binary::LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.header.uMagic = binary::kRecordMagic;
+    record.header.uType = (uint16_t)binary::RecordType::kLog;
+    record.header.uVersion = binary::kVersion;
+    record.header.uLength = sizeof(record) + pEntry->uDataLen;
+    record.uTimestampNs = pEntry->uTimestampNs;
+    record.uFormatId = uFormatId;
+    record.uTid = pEntry->uTid;
+    record.iErrorNo = pEntry->iErrorNo;
+    record.uLevel = pEntry->uLevel;
+    record.uParamCount = pEntry->uParamCount;
+    if (DumpWrite(iFd, &record, sizeof(record)) != ErrorCode::kSuccess)
+    {
+        return ErrorCode::kSystemError;
+    }
+    // 记录中的参数长度数组和参数内容与二进制日志的布局相同
+    return DumpWrite(iFd, pEntry + 1, pEntry->uDataLen);
+}
+
+uint32_t CLogFlightRecorder::DumpFormat(int32_t iFd, const char *pModule, const char *pFileLine,
+                                        const char *pFunction, const char *pFormat)
+{
+    // 按调用点去重，表满时每次重新注册
+    auto uHash = (uint64_t)(uintptr_t)pFileLine * 31 + (uint64_t)(uintptr_t)pFormat;
+    FormatSlot *pEmptySlot = nullptr;
+    for (uint32_t i = 0; i < kFormatProbeCount; ++i)
+    {
+        auto &slot = m_pFormatSlots[(uHash + i) % kFormatSlotCount];
+        if (slot.uFormatId == 0)
+        {
+            pEmptySlot = &slot;
+            break;
+        }
+        if (slot.pFileLine == pFileLine && slot.pFormat == pFormat)
+        {
+            return slot.uFormatId;
+        }
+    }
+
+    pModule = pModule != nullptr ? pModule : "";
+    pFileLine = pFileLine != nullptr ? pFileLine : "";
+    pFunction = pFunction != nullptr ? pFunction : "";
+    pFormat = pFormat != nullptr ? pFormat : "";
+
+    binary::FormatRecord record;
+    memset(&record, 0, sizeof(record));
+    record.uFormatId = ++m_uNextFormatId;
+    record.uModuleLen = (uint16_t)std::min(strlen(pModule), (size_t)UINT16_MAX);
+    record.uFileLineLen = (uint16_t)std::min(strlen(pFileLine), (size_t)UINT16_MAX);
+    record.uFunctionLen = (uint16_t)std::min(strlen(pFunction), (size_t)UINT16_MAX);
+    record.uFormatLen = (uint32_t)strlen(pFormat);
+    record.header.uMagic = binary::kRecordMagic;
+    record.header.uType = (uint16_t)binary::RecordType::kFormat;
+    record.header.uVersion = binary::kVersion;
+    record.header.uLength = sizeof(record) + record.uModuleLen + record.uFileLineLen + record.uFunctionLen + record.uFormatLen;
+    if (DumpWrite(iFd, &record, sizeof(record)) != ErrorCode::kSuccess
+        || DumpWrite(iFd, pModule, record.uModuleLen) != ErrorCode::kSuccess
+        || DumpWrite(iFd, pFileLine, record.uFileLineLen) != ErrorCode::kSuccess
+        || DumpWrite(iFd, pFunction, record.uFunctionLen) != ErrorCode::kSuccess
+        || DumpWrite(iFd, pFormat, record.uFormatLen) != ErrorCode::kSuccess)
+    {
+        return 0;
+    }
+
+    if (pEmptySlot != nullptr)
+    {
+        pEmptySlot->pFileLine = pFileLine;
+        pEmptySlot->pFormat = pFormat;
+        pEmptySlot->uFormatId = record.uFormatId;
+    }
+    return record.uFormatId;
+}
+
+int32_t CLogFlightRecorder::DumpWrite(int32_t iFd, const void *pData, uint32_t uLen)
+{
+    auto pCursor = reinterpret_cast<const char *>(pData);
+    while (uLen > 0)
+    {
+        if (m_uDumpBufferUsed == kDumpBufferSize && DumpFlush(iFd) != ErrorCode::kSuccess)
+        {
+            return ErrorCode::kSystemError;
+        }
+        auto uCopyLen = std::min(uLen, kDumpBufferSize - m_uDumpBufferUsed);
+        memcpy(m_pDumpBuffer + m_uDumpBufferUsed, pCursor, uCopyLen);
+        m_uDumpBufferUsed += uCopyLen;
+        pCursor += uCopyLen;
+        uLen -= uCopyLen;
+    }
+    return ErrorCode::kSuccess;
+}
+
+int32_t CLogFlightRecorder::DumpFlush(int32_t iFd)
+{
+    uint32_t uWritten = 0;
+    while (uWritten < m_uDumpBufferUsed)
+    {
+        auto iRet = write(iFd, m_pDumpBuffer + uWritten, m_uDumpBufferUsed - uWritten);
+        if (iRet < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return ErrorCode::kSystemError;
+        }
+        uWritten += (uint32_t)iRet;
+    }
+    m_uDumpBufferUsed = 0;
+    return ErrorCode::kSuccess;
+}
+
+void CLogFlightRecorder::InstallSignalHandler()
+{
+    // 进程内只注册一次，没有记录器时信号直接交给原来的处理函数
+    std::call_once(s_signalOnce, []() {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = &CLogFlightRecorder::SignalHandler;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        for (uint32_t i = 0; i < sizeof(kDumpSignals) / sizeof(kDumpSignals[0]); ++i)
+        {
+            sigaction(kDumpSignals[i], &action, &s_aOldActions[i]);
+        }
+    });
+}
+
+void CLogFlightRecorder::SignalHandler(int32_t iSignal, siginfo_t *pInfo, void *pContext)
+{
+    UNSED(pInfo);
+    UNSED(pContext);
+    auto iSavedErrno = errno;
+    for (auto &pRecorder : s_apRecorders)
+    {
+        auto pCurrent = pRecorder.load(std::memory_order_acquire);
+        if (pCurrent != nullptr)
+        {
+            pCurrent->Dump();
+        }
+    }
+
+    // 恢复原来的处理方式后重新发送信号，返回后由原来的处理函数或默认行为处理
+    for (uint32_t i = 0; i < sizeof(kDumpSignals) / sizeof(kDumpSignals[0]); ++i)
+    {
+        if (kDumpSignals[i] == iSignal)
+        {
+            sigaction(iSignal, &s_aOldActions[i], nullptr);
+            break;
+        }
+    }
+    raise(iSignal);
+    errno = iSavedErrno;
+}
+
+}
+}
+}
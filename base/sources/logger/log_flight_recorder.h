@@ -0,0 +1,116 @@
+#ifndef __CPPX_LOG_FLIGHT_RECORDER_H__
+#define __CPPX_LOG_FLIGHT_RECORDER_H__
+
+#include <logger/logger.h>
+#include <utilities/json.h>
+#include <atomic>
+#include <cstdint>
+#include <signal.h>
+#include <string>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+// 飞行记录器，每个线程一个内存环形缓冲区，不论日志级别记录所有日志，写满后覆盖最旧的日志
+// 收到SIGSEGV/SIGABRT/SIGBUS、记录FATAL日志或显式调用Dump时，按时间归并所有线程的日志，
+// 以二进制日志格式导出到文件，可使用cppx_logcat查看
+// 记录只由所属线程写入，导出时通过尾部位置校验读取到的日志是否已被覆盖，不需要加锁
+class CLogFlightRecorder
+{
+public:
+    CLogFlightRecorder() = default;
+    CLogFlightRecorder(const CLogFlightRecorder &) = delete;
+    CLogFlightRecorder &operator=(const CLogFlightRecorder &) = delete;
+    CLogFlightRecorder(CLogFlightRecorder &&) = delete;
+    CLogFlightRecorder &operator=(CLogFlightRecorder &&) = delete;
+
+    ~CLogFlightRecorder();
+
+    /**
+     * @brief 初始化飞行记录器并注册信号处理函数
+     * @param pDumpPrefix 导出文件的路径前缀，导出时追加序号和后缀
+     * @param uRingSize 每个线程环形缓冲区的大小，向下对齐到8字节
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程不安全
+     */
+    int32_t Init(const char *pDumpPrefix, uint32_t uRingSize);
+
+    /**
+     * @brief 注销信号处理并释放所有线程的缓冲区
+     * @note 多线程不安全，调用方需保证此时没有线程再记录日志
+     */
+    void Exit();
+
+    /**
+     * @brief 记录一条参数化日志
+     * @note 多线程安全，模块名、文件行号、函数名和格式串只保存指针，在导出时读取，需为静态字符串
+     */
+    void Record(uint64_t uTimestampNs, uint32_t uTid, int32_t iErrorNo, ILogger::LogLevel eLevel,
+                const char *pModule, const char *pFileLine, const char *pFunction,
+                const char *pFormat, const char *const *ppParams, uint32_t uParamCount);
+
+    /**
+     * @brief 记录一条已格式化的日志
+     * @note 多线程安全
+     */
+    void RecordText(uint64_t uTimestampNs, uint32_t uTid, ILogger::LogLevel eLevel,
+                    const char *pText, uint32_t uTextLen);
+
+    /**
+     * @brief 导出所有线程缓冲区中的日志到新文件
+     * @return 成功返回0，失败返回错误码，正在导出时返回kInvalidState
+     * @note 多线程安全，只使用预先分配的内存，可在信号处理函数中调用
+     */
+    int32_t Dump();
+
+    int32_t GetStats(IJson *pJson) const;
+
+private:
+    struct Ring;
+
+    Ring *GetRing(uint32_t uTid);
+    Ring *CreateRing(uint32_t uTid);
+    // 返回写入位置，写完后发布uNewHead
+    char *Reserve(Ring *pRing, uint32_t uLength, uint64_t &uNewHead);
+
+    bool ReadEntry(Ring *pRing, bool bConsume);
+    int32_t DumpRings(int32_t iFd);
+    int32_t DumpEntry(int32_t iFd);
+    uint32_t DumpFormat(int32_t iFd, const char *pModule, const char *pFileLine,
+                        const char *pFunction, const char *pFormat);
+    int32_t DumpWrite(int32_t iFd, const void *pData, uint32_t uLen);
+    int32_t DumpFlush(int32_t iFd);
+
+    static void InstallSignalHandler();
+    static void SignalHandler(int32_t iSignal, siginfo_t *pInfo, void *pContext);
+
+private:
+    uint64_t m_uRecorderId {0};
+    uint32_t m_uPid {0};
+    uint32_t m_uRingSize {0};
+    uint32_t m_uMaxEntrySize {0};
+    std::atomic<Ring *> m_pRings {nullptr}; // 只增加不删除，线程退出后缓冲区由新线程复用
+    std::atomic<uint32_t> m_uRingCount {0};
+    bool m_bRegistered {false};
+
+    // 导出时使用，Init时分配，同一时刻只有一次导出
+    std::atomic<bool> m_bDumping {false};
+    std::string m_strDumpPrefix;
+    std::atomic<uint32_t> m_uDumpSeq {0};
+    char *m_pEntryBuffer {nullptr}; // 当前导出的一条记录
+    char *m_pDumpBuffer {nullptr};  // 合并小块写入
+    uint32_t m_uDumpBufferUsed {0};
+    struct FormatSlot;
+    FormatSlot *m_pFormatSlots {nullptr};
+    uint32_t m_uNextFormatId {0};
+};
+
+}
+}
+}
+
+#endif // __CPPX_LOG_FLIGHT_RECORDER_H__
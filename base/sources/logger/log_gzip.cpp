@@ -0,0 +1,471 @@
+#include "log_gzip.h"
+#include <memory/allocator.h>
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+namespace
+{
+
+constexpr uint32_t kWindowSize = 32768;
+constexpr uint32_t kWindowMask = kWindowSize - 1;
+constexpr uint32_t kBufferSize = kWindowSize * 4; // 32KB字典+96KB待压缩数据
+constexpr uint32_t kOutputSize = 64 * 1024;
+constexpr uint32_t kHashBits = 15;
+constexpr uint32_t kHashSize = 1u << kHashBits;
+constexpr uint32_t kMinMatch = 3;
+constexpr uint32_t kMaxMatch = 258;
+constexpr uint32_t kMaxChain = 32;   // 每个位置最多比较的候选数
+constexpr uint32_t kNiceMatch = 128; // 匹配长度达到后不再继续查找
+
+constexpr uint16_t kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+                                        4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// 固定哈夫曼编码表和CRC32表，哈夫曼码按高位在前定义，写入时需按位反转
+struct CodeTables
+{
+    uint16_t aLiteralCode[288];
+    uint8_t aLiteralBits[288];
+    uint8_t aDistanceCode[30];
+    uint8_t aLengthIndex[kMaxMatch + 1];
+    uint8_t aDistanceIndex[kWindowSize + 1];
+    uint32_t aCrc[256];
+
+    static uint32_t Reverse(uint32_t uCode, uint32_t uBits)
+    {
+        uint32_t uResult = 0;
+        for (uint32_t i = 0; i < uBits; ++i)
+        {
+            uResult = (uResult << 1) | ((uCode >> i) & 1);
+        }
+        return uResult;
+    }
+
+    CodeTables()
+    {
+        for (uint32_t i = 0; i < 288; ++i)
+        {
+            if (i < 144)
+            {
+                aLiteralBits[i] = 8;
+                aLiteralCode[i] = Reverse(0x30 + i, 8);
+            }
+            else if (i < 256)
+            {
+                aLiteralBits[i] = 9;
+                aLiteralCode[i] = Reverse(0x190 + i - 144, 9);
+            }
+            else if (i < 280)
+            {
+                aLiteralBits[i] = 7;
+                aLiteralCode[i] = Reverse(i - 256, 7);
+            }
+            else
+            {
+                aLiteralBits[i] = 8;
+                aLiteralCode[i] = Reverse(0xC0 + i - 280, 8);
+            }
+        }
+        for (uint32_t i = 0; i < 30; ++i)
+        {
+            aDistanceCode[i] = Reverse(i, 5);
+        }
+        for (uint32_t i = 0, uLength = kMinMatch; uLength <= kMaxMatch; ++uLength)
+        {
+            while (i + 1 < 29 && kLengthBase[i + 1] <= uLength)
+            {
+                ++i;
+            }
+            aLengthIndex[uLength] = i;
+        }
+        for (uint32_t i = 0, uDistance = 1; uDistance <= kWindowSize; ++uDistance)
+        {
+            while (i + 1 < 30 && kDistanceBase[i + 1] <= uDistance)
+            {
+                ++i;
+            }
+            aDistanceIndex[uDistance] = i;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t uCrc = i;
+            for (uint32_t j = 0; j < 8; ++j)
+            {
+                uCrc = (uCrc & 1) ? (0xEDB88320u ^ (uCrc >> 1)) : (uCrc >> 1);
+            }
+            aCrc[i] = uCrc;
+        }
+    }
+};
+
+const CodeTables &GetCodeTables()
+{
+    static const CodeTables s_tables;
+    return s_tables;
+}
+
+inline uint32_t Hash(const uint8_t *pData)
+{
+    uint32_t uValue = pData[0] | (uint32_t(pData[1]) << 8) | (uint32_t(pData[2]) << 16);
+    return (uValue * 2654435761u) >> (32 - kHashBits);
+}
+
+}
+
+CLogGzipCompressor::~CLogGzipCompressor()
+{
+    auto pAllocator = memory::IAllocator::GetInstance();
+    if (m_pWindow != nullptr)
+    {
+        pAllocator->Free(m_pWindow);
+        m_pWindow = nullptr;
+    }
+    if (m_pHashHead != nullptr)
+    {
+        pAllocator->Free(m_pHashHead);
+        m_pHashHead = nullptr;
+    }
+    if (m_pHashPrev != nullptr)
+    {
+        pAllocator->Free(m_pHashPrev);
+        m_pHashPrev = nullptr;
+    }
+    if (m_pOutput != nullptr)
+    {
+        pAllocator->Free(m_pOutput);
+        m_pOutput = nullptr;
+    }
+}
+
+int32_t CLogGzipCompressor::Init()
+{
+    auto pAllocator = memory::IAllocator::GetInstance();
+    m_pWindow = reinterpret_cast<uint8_t *>(pAllocator->Malloc(kBufferSize));
+    m_pHashHead = reinterpret_cast<uint32_t *>(pAllocator->Malloc(sizeof(uint32_t) * kHashSize));
+    m_pHashPrev = reinterpret_cast<uint32_t *>(pAllocator->Malloc(sizeof(uint32_t) * kWindowSize));
+    m_pOutput = reinterpret_cast<uint8_t *>(pAllocator->Malloc(kOutputSize));
+    if (m_pWindow == nullptr || m_pHashHead == nullptr || m_pHashPrev == nullptr || m_pOutput == nullptr)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+    GetCodeTables();
+    return ErrorCode::kSuccess;
+}
+
+int32_t CLogGzipCompressor::Compress(const char *pSrcPath, const char *pDstPath, uint64_t &uDstSize,
+                                     const std::atomic<bool> *pStop)
+{
+    if (unlikely(m_pWindow == nullptr))
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    int32_t iSrcFd = open(pSrcPath, O_RDONLY | O_CLOEXEC);
+    if (iSrcFd < 0)
+    {
+        SetLastError(ErrorCode::kSysCallFailed);
+        return ErrorCode::kSysCallFailed;
+    }
+    m_iDstFd = open(pDstPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_iDstFd < 0)
+    {
+        close(iSrcFd);
+        SetLastError(ErrorCode::kSysCallFailed);
+        return ErrorCode::kSysCallFailed;
+    }
+
+    m_uOutputUsed = 0;
+    m_uOutputSize = 0;
+    m_uBitBuffer = 0;
+    m_uBitCount = 0;
+    m_bWriteError = false;
+
+    // gzip头：魔数、deflate、无标志、无修改时间、无额外标志、unix
+    const uint8_t aHeader[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+    auto iErrorNo = PutBytes(aHeader, sizeof(aHeader));
+    if (iErrorNo == ErrorCode::kSuccess)
+    {
+        iErrorNo = Deflate(iSrcFd, pStop);
+    }
+    if (iErrorNo == ErrorCode::kSuccess)
+    {
+        // 原始数据的CRC32和长度，小端
+        uint32_t uInputSize = (uint32_t)m_uInputSize;
+        uint8_t aTrailer[8];
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            aTrailer[i] = uint8_t(m_uCrc >> (8 * i));
+            aTrailer[4 + i] = uint8_t(uInputSize >> (8 * i));
+        }
+        iErrorNo = PutBytes(aTrailer, sizeof(aTrailer));
+    }
+    if (iErrorNo == ErrorCode::kSuccess)
+    {
+        iErrorNo = FlushOutput();
+    }
+    // 压缩完成后会删除原文件，先保证压缩文件落盘
+    if (iErrorNo == ErrorCode::kSuccess && fdatasync(m_iDstFd) != 0)
+    {
+        iErrorNo = ErrorCode::kSysCallFailed;
+    }
+
+    close(iSrcFd);
+    close(m_iDstFd);
+    m_iDstFd = -1;
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        unlink(pDstPath);
+        SetLastError((ErrorCode)iErrorNo);
+        return iErrorNo;
+    }
+    uDstSize = m_uOutputSize;
+    return ErrorCode::kSuccess;
+}
+
+int32_t CLogGzipCompressor::Deflate(int32_t iSrcFd, const std::atomic<bool> *pStop)
+{
+    auto &tables = GetCodeTables();
+    memset(m_pHashHead, 0, sizeof(uint32_t) * kHashSize);
+    memset(m_pHashPrev, 0, sizeof(uint32_t) * kWindowSize);
+    m_uWindowBase = 0;
+    m_uCrc = 0xFFFFFFFFu;
+
+    uint64_t uPos = 0;
+    uint64_t uEnd = 0;
+    bool bEof = false;
+
+    // 整个文件放在一个固定哈夫曼块中，结束后追加一个空的最后块
+    PutBits(1u << 1, 3);
+    while (true)
+    {
+        if (!bEof && uEnd - uPos < kMaxMatch)
+        {
+            // 大文件压缩耗时较长，每读取一块输入检查一次是否需要中止
+            if (pStop != nullptr && pStop->load(std::memory_order_relaxed))
+            {
+                return ErrorCode::kInvalidState;
+            }
+            // 只保留当前位置前32KB作为字典，其余空间读取新数据
+            if (uPos - m_uWindowBase > kWindowSize)
+            {
+                uint64_t uShift = uPos - kWindowSize - m_uWindowBase;
+                memmove(m_pWindow, m_pWindow + uShift, uEnd - m_uWindowBase - uShift);
+                m_uWindowBase += uShift;
+            }
+            while (!bEof && uEnd - m_uWindowBase < kBufferSize)
+            {
+                auto pRead = m_pWindow + (uEnd - m_uWindowBase);
+                auto iRead = read(iSrcFd, pRead, kBufferSize - (uEnd - m_uWindowBase));
+                if (iRead < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return ErrorCode::kSysCallFailed;
+                }
+                if (iRead == 0)
+                {
+                    bEof = true;
+                    break;
+                }
+                for (ssize_t i = 0; i < iRead; ++i)
+                {
+                    m_uCrc = tables.aCrc[(m_uCrc ^ pRead[i]) & 0xFF] ^ (m_uCrc >> 8);
+                }
+                uEnd += iRead;
+            }
+        }
+        if (uPos >= uEnd)
+        {
+            break;
+        }
+
+        uint32_t uDistance = 0;
+        uint32_t uLength = FindMatch(uPos, uEnd, uDistance);
+        if (uLength >= kMinMatch)
+        {
+            PutMatch(uLength, uDistance);
+            for (uint32_t i = 0; i < uLength && uPos + i + kMinMatch <= uEnd; ++i)
+            {
+                InsertHash(uPos + i);
+            }
+            uPos += uLength;
+        }
+        else
+        {
+            PutLiteral(m_pWindow[uPos - m_uWindowBase]);
+            if (uPos + kMinMatch <= uEnd)
+            {
+                InsertHash(uPos);
+            }
+            ++uPos;
+        }
+        if (unlikely(m_bWriteError))
+        {
+            return ErrorCode::kSysCallFailed;
+        }
+    }
+
+    PutLiteral(256);
+    PutBits(1 | (1u << 1), 3);
+    PutLiteral(256);
+    if (m_uBitCount > 0)
+    {
+        PutBits(0, 8 - m_uBitCount);
+    }
+
+    m_uCrc ^= 0xFFFFFFFFu;
+    m_uInputSize = uEnd;
+    return m_bWriteError ? ErrorCode::kSysCallFailed : ErrorCode::kSuccess;
+}
+
+uint32_t CLogGzipCompressor::FindMatch(uint64_t uPos, uint64_t uEnd, uint32_t &uDistance) const
+{
+    if (uEnd - uPos < kMinMatch)
+    {
+        return 0;
+    }
+
+    // 位置以uint32保存，候选只用于定位，最终以实际内容比较为准，超过4GB回绕也不会产生错误匹配
+    uint32_t uMaxLength = (uint32_t)std::min<uint64_t>(kMaxMatch, uEnd - uPos);
+    uint64_t uMaxDistance = std::min<uint64_t>(kWindowSize, uPos - m_uWindowBase);
+    const uint8_t *pCurrent = m_pWindow + (uPos - m_uWindowBase);
+    uint32_t uCurrent = (uint32_t)uPos + 1;
+    uint32_t uCandidate = m_pHashHead[Hash(pCurrent)];
+    uint32_t uLastDistance = 0;
+    uint32_t uBestLength = 0;
+    for (uint32_t uChain = 0; uCandidate != 0 && uChain < kMaxChain; ++uChain)
+    {
+        uint32_t uCandidateDistance = uCurrent - uCandidate;
+        if (uCandidateDistance <= uLastDistance || uCandidateDistance > uMaxDistance)
+        {
+            break;
+        }
+        uLastDistance = uCandidateDistance;
+
+        const uint8_t *pMatch = pCurrent - uCandidateDistance;
+        if (pMatch[uBestLength] == pCurrent[uBestLength])
+        {
+            uint32_t uLength = 0;
+            while (uLength < uMaxLength && pMatch[uLength] == pCurrent[uLength])
+            {
+                ++uLength;
+            }
+            if (uLength > uBestLength)
+            {
+                uBestLength = uLength;
+                uDistance = uCandidateDistance;
+                if (uLength >= kNiceMatch || uLength == uMaxLength)
+                {
+                    break;
+                }
+            }
+        }
+        uCandidate = m_pHashPrev[(uCandidate - 1) & kWindowMask];
+    }
+    return uBestLength;
+}
+
+void CLogGzipCompressor::InsertHash(uint64_t uPos)
+{
+    uint32_t uHash = Hash(m_pWindow + (uPos - m_uWindowBase));
+    m_pHashPrev[uPos & kWindowMask] = m_pHashHead[uHash];
+    m_pHashHead[uHash] = (uint32_t)uPos + 1;
+}
+
+void CLogGzipCompressor::PutBits(uint32_t uBits, uint32_t uCount)
+{
+    m_uBitBuffer |= (uint64_t)uBits << m_uBitCount;
+    m_uBitCount += uCount;
+    while (m_uBitCount >= 8)
+    {
+        if (unlikely(m_uOutputUsed == kOutputSize) && FlushOutput() != ErrorCode::kSuccess)
+        {
+            m_bWriteError = true;
+            m_uOutputUsed = 0;
+        }
+        m_pOutput[m_uOutputUsed++] = uint8_t(m_uBitBuffer);
+        m_uBitBuffer >>= 8;
+        m_uBitCount -= 8;
+    }
+}
+
+void CLogGzipCompressor::PutLiteral(uint32_t uLiteral)
+{
+    auto &tables = GetCodeTables();
+    PutBits(tables.aLiteralCode[uLiteral], tables.aLiteralBits[uLiteral]);
+}
+
+void CLogGzipCompressor::PutMatch(uint32_t uLength, uint32_t uDistance)
+{
+    auto &tables = GetCodeTables();
+    uint32_t uLengthIndex = tables.aLengthIndex[uLength];
+    PutLiteral(257 + uLengthIndex);
+    if (kLengthExtra[uLengthIndex] != 0)
+    {
+        PutBits(uLength - kLengthBase[uLengthIndex], kLengthExtra[uLengthIndex]);
+    }
+
+    uint32_t uDistanceIndex = tables.aDistanceIndex[uDistance];
+    PutBits(tables.aDistanceCode[uDistanceIndex], 5);
+    if (kDistanceExtra[uDistanceIndex] != 0)
+    {
+        PutBits(uDistance - kDistanceBase[uDistanceIndex], kDistanceExtra[uDistanceIndex]);
+    }
+}
+
+int32_t CLogGzipCompressor::PutBytes(const void *pData, uint32_t uLen)
+{
+    auto pBytes = reinterpret_cast<const uint8_t *>(pData);
+    for (uint32_t i = 0; i < uLen; ++i)
+    {
+        PutBits(pBytes[i], 8);
+    }
+    return m_bWriteError ? ErrorCode::kSysCallFailed : ErrorCode::kSuccess;
+}
+
+int32_t CLogGzipCompressor::FlushOutput()
+{
+    uint32_t uWritten = 0;
+    while (uWritten < m_uOutputUsed)
+    {
+        auto iWrite = write(m_iDstFd, m_pOutput + uWritten, m_uOutputUsed - uWritten);
+        if (iWrite < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return ErrorCode::kSysCallFailed;
+        }
+        uWritten += iWrite;
+    }
+    m_uOutputSize += m_uOutputUsed;
+    m_uOutputUsed = 0;
+    return ErrorCode::kSuccess;
+}
+
+}
+}
+}
@@ -0,0 +1,78 @@
+#ifndef __CPPX_LOG_GZIP_H__
+#define __CPPX_LOG_GZIP_H__
+
+#include <atomic>
+#include <cstdint>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+// 日志文件压缩器，输出gzip格式(RFC 1952)，可直接用zcat/gzip -d读取
+// 使用32KB滑动窗口的哈希链LZ77匹配加固定哈夫曼编码(RFC 1951 BTYPE=01)，不依赖外部库
+// 日志文本重复度高，固定编码即可获得较好的压缩率，且实现简单、内存固定
+// 多线程不安全，由调用方保证同一时刻只有一个线程访问
+class CLogGzipCompressor
+{
+public:
+    CLogGzipCompressor() = default;
+    CLogGzipCompressor(const CLogGzipCompressor &) = delete;
+    CLogGzipCompressor &operator=(const CLogGzipCompressor &) = delete;
+    CLogGzipCompressor(CLogGzipCompressor &&) = delete;
+    CLogGzipCompressor &operator=(CLogGzipCompressor &&) = delete;
+
+    ~CLogGzipCompressor();
+
+    /**
+     * @brief 分配窗口、哈希表和输出缓冲区
+     * @return 成功返回0，失败返回错误码
+     */
+    int32_t Init();
+
+    /**
+     * @brief 压缩一个文件
+     * @param pSrcPath 源文件路径
+     * @param pDstPath 输出文件路径，已存在时覆盖
+     * @param uDstSize 输出文件大小
+     * @param pStop 不为nullptr时每读取一块输入检查一次，置为true后中止压缩并返回kInvalidState
+     * @return 成功返回0，失败返回错误码，失败或中止时删除输出文件
+     */
+    int32_t Compress(const char *pSrcPath, const char *pDstPath, uint64_t &uDstSize,
+                     const std::atomic<bool> *pStop = nullptr);
+
+private:
+    int32_t Deflate(int32_t iSrcFd, const std::atomic<bool> *pStop);
+    uint32_t FindMatch(uint64_t uPos, uint64_t uEnd, uint32_t &uDistance) const;
+    void InsertHash(uint64_t uPos);
+
+    void PutBits(uint32_t uBits, uint32_t uCount);
+    void PutLiteral(uint32_t uLiteral);
+    void PutMatch(uint32_t uLength, uint32_t uDistance);
+    int32_t PutBytes(const void *pData, uint32_t uLen);
+    int32_t FlushOutput();
+
+private:
+    uint8_t *m_pWindow {nullptr};   // 保留最近32KB作为字典，后面是待压缩的数据
+    uint64_t m_uWindowBase {0};     // m_pWindow[0]在文件中的偏移
+    uint32_t *m_pHashHead {nullptr}; // 哈希值对应的最近位置+1，0表示没有
+    uint32_t *m_pHashPrev {nullptr}; // 按位置对32KB取模，指向同一哈希值的上一个位置+1
+    uint32_t m_uCrc {0};
+    uint64_t m_uInputSize {0};
+
+    int32_t m_iDstFd {-1};
+    uint8_t *m_pOutput {nullptr};
+    uint32_t m_uOutputUsed {0};
+    uint64_t m_uOutputSize {0};
+    uint64_t m_uBitBuffer {0};
+    uint32_t m_uBitCount {0};
+    bool m_bWriteError {false};
+};
+
+}
+}
+}
+
+#endif // __CPPX_LOG_GZIP_H__
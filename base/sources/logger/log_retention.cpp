@@ -0,0 +1,319 @@
+#include "log_retention.h"
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+#include <filesystem> // use c++17 feature
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+constexpr const char *kGzipSuffix = ".gz";
+constexpr size_t kGzipSuffixLen = 3;
+constexpr const char *kTempSuffix = ".tmp";
+constexpr size_t kTempSuffixLen = 4;
+
+CLogRetention::~CLogRetention()
+{
+    Exit();
+}
+
+int32_t CLogRetention::Init(const std::string &strLogPath, const std::string &strLoggerName,
+                            const std::string &strLogSuffix, uint64_t uTotalSizeLimit,
+                            bool bCompress, uint32_t uCpuNo)
+{
+    m_strLogPath = strLogPath;
+    m_strFilePrefix = strLoggerName + "-";
+    m_strLogSuffix = strLogSuffix;
+    m_uTotalSizeLimit = uTotalSizeLimit;
+    m_bCompress = bCompress;
+    if (m_bCompress)
+    {
+        auto iErrorNo = m_compressor.Init();
+        if (iErrorNo != ErrorCode::kSuccess)
+        {
+            PRINT_ERROR("init log retention failed, init compressor failed %d", iErrorNo);
+            return iErrorNo;
+        }
+    }
+
+    // 只在启动时遍历一次目录，之后由AddFile维护
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(m_strLogPath, ec))
+    {
+        auto strFileName = entry.path().filename().string();
+        if (!IsRotatedFile(strFileName))
+        {
+            // 上次压缩中途崩溃或退出时留下的临时文件，不计入总大小，直接删除
+            if (strFileName.size() > kTempSuffixLen
+                && strFileName.compare(strFileName.size() - kTempSuffixLen, kTempSuffixLen, kTempSuffix) == 0)
+            {
+                auto strTempTarget = strFileName.substr(0, strFileName.size() - kTempSuffixLen);
+                if (IsRotatedFile(strTempTarget)
+                    && strTempTarget.compare(strTempTarget.size() - kGzipSuffixLen, kGzipSuffixLen, kGzipSuffix) == 0)
+                {
+                    std::filesystem::remove(entry.path(), ec);
+                }
+            }
+            continue;
+        }
+        auto uFileSize = entry.file_size(ec);
+        if (!ec)
+        {
+            InsertFile(std::move(strFileName), uFileSize);
+        }
+    }
+    if (m_bCompress)
+    {
+        // 上次退出时未来得及压缩的文件，按时间顺序压缩
+        for (const auto &file : m_mapFiles)
+        {
+            if (file.first.compare(file.first.size() - m_strLogSuffix.size(), m_strLogSuffix.size(), m_strLogSuffix) == 0)
+            {
+                m_dequeCompressFiles.push_back(file.first);
+            }
+        }
+    }
+
+    m_pThread = IThread::Create("log_retention", &CLogRetention::RunWrapper, this);
+    if (m_pThread == nullptr)
+    {
+        PRINT_ERROR("init log retention failed, create thread failed %s", "");
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+    if (uCpuNo != UINT32_MAX && m_pThread->BindCpu(uCpuNo) != ErrorCode::kSuccess)
+    {
+        PRINT_ERROR("init log retention failed, bind cpu %u failed", uCpuNo);
+        SetLastError(ErrorCode::kSystemError);
+        return ErrorCode::kSystemError;
+    }
+    if (m_pThread->Start() != ErrorCode::kSuccess)
+    {
+        PRINT_ERROR("init log retention failed, start thread failed %s", "");
+        SetLastError(ErrorCode::kSystemError);
+        return ErrorCode::kSystemError;
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CLogRetention::Exit()
+{
+    if (m_pThread != nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_bStopping = true;
+        }
+        m_condition.notify_one();
+        IThread::Destroy(m_pThread);
+        m_pThread = nullptr;
+    }
+}
+
+void CLogRetention::AddFile(const char *pFilePath)
+{
+    std::filesystem::path filePath(pFilePath);
+    std::error_code ec;
+    auto uFileSize = std::filesystem::file_size(filePath, ec);
+    if (ec)
+    {
+        return;
+    }
+
+    bool bNotify = false;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto strFileName = filePath.filename().string();
+        if (m_bCompress)
+        {
+            m_dequeCompressFiles.push_back(strFileName);
+        }
+        InsertFile(std::move(strFileName), uFileSize);
+        bNotify = m_bCompress || m_uTotalSize > m_uTotalSizeLimit;
+    }
+    if (bNotify)
+    {
+        m_condition.notify_one();
+    }
+}
+
+int32_t CLogRetention::GetStats(IJson *pJson) const
+{
+    if (pJson == nullptr)
+    {
+        return ErrorCode::kInvalidParam;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        pJson->SetUint64("rotated_file_count", m_mapFiles.size());
+        pJson->SetUint64("rotated_total_size", m_uTotalSize);
+    }
+    pJson->SetUint64("retention_remove_count", m_uRemoveCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("retention_remove_errors", m_uRemoveErrors.load(std::memory_order_relaxed));
+    if (m_bCompress)
+    {
+        pJson->SetUint64("compress_count", m_uCompressCount.load(std::memory_order_relaxed));
+        pJson->SetUint64("compress_errors", m_uCompressErrors.load(std::memory_order_relaxed));
+        pJson->SetUint64("compress_input_bytes", m_uCompressInputBytes.load(std::memory_order_relaxed));
+        pJson->SetUint64("compress_output_bytes", m_uCompressOutputBytes.load(std::memory_order_relaxed));
+    }
+    return ErrorCode::kSuccess;
+}
+
+bool CLogRetention::IsRotatedFile(const std::string &strFileName) const
+{
+    if (strFileName.size() <= m_strFilePrefix.size() + m_strLogSuffix.size()
+        || strFileName.compare(0, m_strFilePrefix.size(), m_strFilePrefix) != 0)
+    {
+        return false;
+    }
+
+    // 压缩后的文件名为原文件名加.gz
+    auto uSuffixEnd = strFileName.size();
+    if (strFileName.compare(uSuffixEnd - kGzipSuffixLen, kGzipSuffixLen, kGzipSuffix) == 0)
+    {
+        uSuffixEnd -= kGzipSuffixLen;
+    }
+    return uSuffixEnd >= m_strFilePrefix.size() + m_strLogSuffix.size()
+        && strFileName.compare(uSuffixEnd - m_strLogSuffix.size(), m_strLogSuffix.size(), m_strLogSuffix) == 0;
+}
+
+void CLogRetention::InsertFile(std::string strFileName, uint64_t uFileSize)
+{
+    // 同一秒内切换多次时新文件覆盖了旧文件
+    auto result = m_mapFiles.emplace(std::move(strFileName), uFileSize);
+    if (!result.second)
+    {
+        m_uTotalSize -= result.first->second;
+        result.first->second = uFileSize;
+    }
+    m_uTotalSize += uFileSize;
+}
+
+bool CLogRetention::RunWrapper(void *pArg)
+{
+    auto pRetention = reinterpret_cast<CLogRetention *>(pArg);
+    pRetention->Run();
+    return true;
+}
+
+void CLogRetention::Run()
+{
+    if (unlikely(!m_bLowPriority))
+    {
+        // 压缩和删除文件可能占用较多CPU和IO，只在CPU空闲时运行
+        sched_param param {};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+        m_bLowPriority = true;
+    }
+
+    std::string strCompressFile;
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_condition.wait(lock, [this] () {
+            return m_bStopping || !m_dequeCompressFiles.empty() || m_uTotalSize > m_uTotalSizeLimit;
+        });
+        if (m_bStopping)
+        {
+            return;
+        }
+        if (!m_dequeCompressFiles.empty())
+        {
+            strCompressFile = std::move(m_dequeCompressFiles.front());
+            m_dequeCompressFiles.pop_front();
+        }
+    }
+
+    // 每次只压缩一个文件，压缩后的大小计入总大小后再检查是否需要删除
+    if (!strCompressFile.empty())
+    {
+        CompressFile(strCompressFile);
+    }
+    RemoveFiles();
+}
+
+void CLogRetention::CompressFile(const std::string &strFileName)
+{
+    {
+        // 等待压缩时已超出总大小被删除
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_mapFiles.find(strFileName) == m_mapFiles.end())
+        {
+            return;
+        }
+    }
+
+    auto strSrcPath = m_strLogPath + "/" + strFileName;
+    auto strDstPath = strSrcPath + kGzipSuffix;
+    // 先写临时文件，压缩完成后重命名，中途退出时不会留下不完整的.gz文件
+    auto strTempPath = strDstPath + kTempSuffix;
+    uint64_t uDstSize = 0;
+    std::error_code ec;
+    // 退出时中止压缩，原文件保留，下次启动时重新压缩
+    auto iErrorNo = m_compressor.Compress(strSrcPath.c_str(), strTempPath.c_str(), uDstSize, &m_bStopping);
+    if (iErrorNo != ErrorCode::kSuccess || (std::filesystem::rename(strTempPath, strDstPath, ec), ec))
+    {
+        std::filesystem::remove(strTempPath, ec);
+        // 压缩失败保留原文件，仍按原大小参与保留清理
+        if (iErrorNo != ErrorCode::kInvalidState)
+        {
+            m_uCompressErrors.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_mapFiles.find(strFileName);
+        if (it != m_mapFiles.end())
+        {
+            m_uCompressInputBytes.fetch_add(it->second, std::memory_order_relaxed);
+            m_uTotalSize -= it->second;
+            m_mapFiles.erase(it);
+        }
+        InsertFile(strFileName + kGzipSuffix, uDstSize);
+    }
+    std::filesystem::remove(strSrcPath, ec);
+    m_uCompressCount.fetch_add(1, std::memory_order_relaxed);
+    m_uCompressOutputBytes.fetch_add(uDstSize, std::memory_order_relaxed);
+}
+
+void CLogRetention::RemoveFiles()
+{
+    std::vector<std::string> vecRemoveFiles;
+    {
+        // 先从索引中摘除，删除文件时不持有锁
+        std::lock_guard<std::mutex> lock(m_lock);
+        while (m_uTotalSize > m_uTotalSizeLimit && !m_mapFiles.empty())
+        {
+            auto it = m_mapFiles.begin();
+            m_uTotalSize -= it->second;
+            vecRemoveFiles.emplace_back(m_strLogPath + "/" + it->first);
+            m_mapFiles.erase(it);
+        }
+    }
+
+    for (const auto &strFilePath : vecRemoveFiles)
+    {
+        std::error_code ec;
+        if (std::filesystem::remove(strFilePath, ec))
+        {
+            m_uRemoveCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            m_uRemoveErrors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+}
+}
+}
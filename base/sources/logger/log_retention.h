@@ -0,0 +1,106 @@
+#ifndef __CPPX_LOG_RETENTION_H__
+#define __CPPX_LOG_RETENTION_H__
+
+#include "log_gzip.h"
+#include <thread/thread.h>
+#include <utilities/json.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+// 已切换日志文件的索引、压缩和保留清理
+// 索引在初始化时扫描一次日志目录建立，之后每次切换文件时追加，不再遍历目录
+// 开启压缩时由低优先级的后台线程把切换后的文件压缩为.gz并删除原文件，索引中按压缩后的大小计算
+// 总大小超过限制时由同一线程按时间从早到晚删除文件，写日志的线程不会被压缩和删除文件阻塞
+class CLogRetention
+{
+public:
+    CLogRetention() = default;
+    CLogRetention(const CLogRetention &) = delete;
+    CLogRetention &operator=(const CLogRetention &) = delete;
+    CLogRetention(CLogRetention &&) = delete;
+    CLogRetention &operator=(CLogRetention &&) = delete;
+
+    ~CLogRetention();
+
+    /**
+     * @brief 扫描日志目录建立索引并启动后台线程
+     * @param strLogPath 日志目录
+     * @param strLoggerName 日志名称，切换后的文件名为"名称-日期-时间后缀"
+     * @param strLogSuffix 日志文件后缀
+     * @param uTotalSizeLimit 切换后的文件总大小上限(字节)
+     * @param bCompress 是否压缩切换后的文件，启动时目录中未压缩的文件也会被压缩
+     * @param uCpuNo 后台线程绑定的CPU编号，UINT32_MAX表示不绑定
+     * @return 成功返回0，失败返回错误码
+     * @note 多线程不安全
+     */
+    int32_t Init(const std::string &strLogPath, const std::string &strLoggerName,
+                 const std::string &strLogSuffix, uint64_t uTotalSizeLimit,
+                 bool bCompress, uint32_t uCpuNo);
+
+    /**
+     * @brief 停止后台线程，未压缩的文件在下次启动时继续压缩
+     * @note 多线程不安全
+     */
+    void Exit();
+
+    /**
+     * @brief 记录一个刚切换完成的文件，需要压缩或总大小超过限制时唤醒后台线程
+     * @param pFilePath 切换后的文件路径
+     * @note 多线程安全
+     */
+    void AddFile(const char *pFilePath);
+
+    int32_t GetStats(IJson *pJson) const;
+
+private:
+    bool IsRotatedFile(const std::string &strFileName) const;
+    void InsertFile(std::string strFileName, uint64_t uFileSize);
+    void CompressFile(const std::string &strFileName);
+    void RemoveFiles();
+
+    static bool RunWrapper(void *pArg);
+    void Run();
+
+private:
+    std::string m_strLogPath;
+    std::string m_strFilePrefix;
+    std::string m_strLogSuffix;
+    uint64_t m_uTotalSizeLimit {0};
+
+    mutable std::mutex m_lock;
+    std::condition_variable m_condition;
+    std::map<std::string, uint64_t> m_mapFiles; // 文件名中带时间，按名称排序即按时间排序
+    uint64_t m_uTotalSize {0};
+    std::deque<std::string> m_dequeCompressFiles; // 等待压缩的文件名
+    std::atomic<bool> m_bStopping {false}; // 在m_lock内修改，压缩过程中不加锁读取
+
+    bool m_bCompress {false};
+    CLogGzipCompressor m_compressor; // 只由后台线程使用
+
+    IThread *m_pThread {nullptr};
+    bool m_bLowPriority {false};
+    std::atomic<uint64_t> m_uRemoveCount {0};
+    std::atomic<uint64_t> m_uRemoveErrors {0};
+    std::atomic<uint64_t> m_uCompressCount {0};
+    std::atomic<uint64_t> m_uCompressErrors {0};
+    std::atomic<uint64_t> m_uCompressInputBytes {0};
+    std::atomic<uint64_t> m_uCompressOutputBytes {0};
+};
+
+}
+}
+}
+
+#endif // __CPPX_LOG_RETENTION_H__
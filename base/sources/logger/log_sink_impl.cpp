@@ -0,0 +1,256 @@
+#include "log_sink_impl.h"
+#include <memory/allocator_ex.h>
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+ILogSink *ILogSink::Create(IJson *pConfig)
+{
+    if (pConfig == nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return nullptr;
+    }
+
+    auto eType = (SinkType)pConfig->GetUint32(config::kSinkType, default_value::kSinkType);
+    auto pAllocator = memory::IAllocatorEx::GetInstance();
+    if (eType == SinkType::kUdp || eType == SinkType::kUnix)
+    {
+        auto pSink = pAllocator->New<CSocketLogSink>();
+        if (pSink == nullptr)
+        {
+            SetLastError(ErrorCode::kOutOfMemory);
+            return nullptr;
+        }
+        auto iErrorNo = pSink->Init(pConfig, eType);
+        if (iErrorNo != ErrorCode::kSuccess)
+        {
+            pAllocator->Delete(pSink);
+            SetLastError((ErrorCode)iErrorNo);
+            return nullptr;
+        }
+        return pSink;
+    }
+    else if (eType == SinkType::kMemory)
+    {
+        auto pSink = pAllocator->New<CMemoryLogSink>();
+        if (pSink == nullptr)
+        {
+            SetLastError(ErrorCode::kOutOfMemory);
+            return nullptr;
+        }
+        auto iErrorNo = pSink->Init(pConfig);
+        if (iErrorNo != ErrorCode::kSuccess)
+        {
+            pAllocator->Delete(pSink);
+            SetLastError((ErrorCode)iErrorNo);
+            return nullptr;
+        }
+        return pSink;
+    }
+
+    PRINT_ERROR("create log sink failed, invalid sink type %u", (uint32_t)eType);
+    SetLastError(ErrorCode::kInvalidParam);
+    return nullptr;
+}
+
+void ILogSink::Destroy(ILogSink *pSink)
+{
+    auto pAllocator = memory::IAllocatorEx::GetInstance();
+    if (auto pSocketSink = dynamic_cast<CSocketLogSink *>(pSink))
+    {
+        pAllocator->Delete(pSocketSink);
+    }
+    else if (auto pMemorySink = dynamic_cast<CMemoryLogSink *>(pSink))
+    {
+        pAllocator->Delete(pMemorySink);
+    }
+}
+
+CSocketLogSink::~CSocketLogSink()
+{
+    if (m_iFd >= 0)
+    {
+        close(m_iFd);
+        m_iFd = -1;
+    }
+}
+
+int32_t CSocketLogSink::Init(IJson *pConfig, SinkType eType)
+{
+    std::string strAddress;
+    try
+    {
+        m_strName = pConfig->GetString(config::kSinkName, default_value::kSinkName);
+        strAddress = pConfig->GetString(config::kSinkAddress, default_value::kSinkAddress);
+    }
+    catch (std::exception &e)
+    {
+        PRINT_ERROR("init log sink failed, throw exception: %s", e.what());
+        return ErrorCode::kThrowException;
+    }
+
+    sockaddr_storage stAddr;
+    socklen_t uAddrLen = 0;
+    memset(&stAddr, 0, sizeof(stAddr));
+    if (eType == SinkType::kUdp)
+    {
+        // ip:port
+        auto uColon = strAddress.rfind(':');
+        auto pAddr = reinterpret_cast<sockaddr_in *>(&stAddr);
+        pAddr->sin_family = AF_INET;
+        if (uColon == std::string::npos
+            || inet_pton(AF_INET, strAddress.substr(0, uColon).c_str(), &pAddr->sin_addr) != 1)
+        {
+            PRINT_ERROR("init log sink failed, invalid udp address: %s", strAddress.c_str());
+            return ErrorCode::kInvalidParam;
+        }
+        pAddr->sin_port = htons((uint16_t)atoi(strAddress.c_str() + uColon + 1));
+        uAddrLen = sizeof(sockaddr_in);
+    }
+    else
+    {
+        auto pAddr = reinterpret_cast<sockaddr_un *>(&stAddr);
+        if (strAddress.empty() || strAddress.size() >= sizeof(pAddr->sun_path))
+        {
+            PRINT_ERROR("init log sink failed, invalid unix address: %s", strAddress.c_str());
+            return ErrorCode::kInvalidParam;
+        }
+        pAddr->sun_family = AF_UNIX;
+        memcpy(pAddr->sun_path, strAddress.c_str(), strAddress.size());
+        uAddrLen = sizeof(sockaddr_un);
+    }
+
+    // 连接后用send发送，采集端未启动时unix套接字连接失败，UDP发送失败计入丢弃
+    m_iFd = socket(stAddr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_iFd < 0 || connect(m_iFd, reinterpret_cast<sockaddr *>(&stAddr), uAddrLen) != 0)
+    {
+        PRINT_ERROR("init log sink failed, connect %s failed: %s", strAddress.c_str(), strerror(errno));
+        return ErrorCode::kSysCallFailed;
+    }
+    return ErrorCode::kSuccess;
+}
+
+int32_t CSocketLogSink::Write(ILogger::LogLevel eLevel, const char *pData, uint32_t uLen)
+{
+    UNSED(eLevel);
+    auto iRet = send(m_iFd, pData, uLen, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (unlikely(iRet < 0))
+    {
+        return ErrorCode::kSysCallFailed;
+    }
+    return ErrorCode::kSuccess;
+}
+
+uint64_t CSocketLogSink::Read(char *pBuffer, uint64_t uSize)
+{
+    UNSED(pBuffer);
+    UNSED(uSize);
+    return 0;
+}
+
+CMemoryLogSink::~CMemoryLogSink()
+{
+    if (m_pBuffer != nullptr)
+    {
+        memory::IAllocator::GetInstance()->Free(m_pBuffer);
+        m_pBuffer = nullptr;
+    }
+}
+
+int32_t CMemoryLogSink::Init(IJson *pConfig)
+{
+    try
+    {
+        m_strName = pConfig->GetString(config::kSinkName, default_value::kSinkName);
+    }
+    catch (std::exception &e)
+    {
+        PRINT_ERROR("init log sink failed, throw exception: %s", e.what());
+        return ErrorCode::kThrowException;
+    }
+
+    m_uSize = (uint64_t)pConfig->GetUint32(config::kSinkMemoryKB, default_value::kSinkMemoryKB) * 1024;
+    m_pBuffer = m_uSize != 0 ? reinterpret_cast<char *>(memory::IAllocator::GetInstance()->Malloc(m_uSize)) : nullptr;
+    if (m_pBuffer == nullptr)
+    {
+        return ErrorCode::kOutOfMemory;
+    }
+    return ErrorCode::kSuccess;
+}
+
+int32_t CMemoryLogSink::Write(ILogger::LogLevel eLevel, const char *pData, uint32_t uLen)
+{
+    UNSED(eLevel);
+    // 超过缓冲区大小时只保留末尾部分
+    if (unlikely(uLen > m_uSize))
+    {
+        pData += uLen - m_uSize;
+        uLen = (uint32_t)m_uSize;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto uOffset = m_uWritten % m_uSize;
+    auto uFirstLen = std::min((uint64_t)uLen, m_uSize - uOffset);
+    memcpy(m_pBuffer + uOffset, pData, uFirstLen);
+    memcpy(m_pBuffer, pData + uFirstLen, uLen - uFirstLen);
+    m_uWritten += uLen;
+    return ErrorCode::kSuccess;
+}
+
+uint64_t CMemoryLogSink::Read(char *pBuffer, uint64_t uSize)
+{
+    if (pBuffer == nullptr || uSize == 0)
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto uOldest = m_uWritten > m_uSize ? m_uWritten - m_uSize : 0;
+    auto uStart = m_uWritten - std::min(m_uWritten - uOldest, uSize);
+
+    // 起点不在行首时跳过不完整的一行，最旧的数据之前的字节已被覆盖，无法判断时同样跳过
+    if (uStart > 0)
+    {
+        bool bLineStart = false;
+        if (uStart > uOldest)
+        {
+            CopyOut(pBuffer, uStart - 1, 1);
+            bLineStart = pBuffer[0] == '\n';
+        }
+        while (!bLineStart && uStart < m_uWritten)
+        {
+            CopyOut(pBuffer, uStart++, 1);
+            bLineStart = pBuffer[0] == '\n';
+        }
+    }
+
+    CopyOut(pBuffer, uStart, m_uWritten - uStart);
+    return m_uWritten - uStart;
+}
+
+void CMemoryLogSink::CopyOut(char *pBuffer, uint64_t uPos, uint64_t uLen) const
+{
+    auto uOffset = uPos % m_uSize;
+    auto uFirstLen = std::min(uLen, m_uSize - uOffset);
+    memcpy(pBuffer, m_pBuffer + uOffset, uFirstLen);
+    memcpy(pBuffer + uFirstLen, m_pBuffer, uLen - uFirstLen);
+}
+
+}
+}
+}
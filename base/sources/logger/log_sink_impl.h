@@ -0,0 +1,75 @@
+#ifndef __CPPX_LOG_SINK_IMPL_H__
+#define __CPPX_LOG_SINK_IMPL_H__
+
+#include <logger/log_sink.h>
+#include <mutex>
+#include <string>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+// UDP或unix域数据报套接字，每条日志一个报文，发送缓冲区满时丢弃
+class CSocketLogSink final : public ILogSink
+{
+public:
+    CSocketLogSink() = default;
+    CSocketLogSink(const CSocketLogSink &) = delete;
+    CSocketLogSink &operator=(const CSocketLogSink &) = delete;
+    CSocketLogSink(CSocketLogSink &&) = delete;
+    CSocketLogSink &operator=(CSocketLogSink &&) = delete;
+
+    ~CSocketLogSink() override;
+
+    int32_t Init(IJson *pConfig, SinkType eType);
+
+    const char *GetName() const override { return m_strName.c_str(); }
+    int32_t Write(ILogger::LogLevel eLevel, const char *pData, uint32_t uLen) override;
+    void Flush() override {}
+    uint64_t Read(char *pBuffer, uint64_t uSize) override;
+
+private:
+    std::string m_strName;
+    int32_t m_iFd {-1};
+};
+
+// 内存环形缓冲区，写满后覆盖最旧的日志
+class CMemoryLogSink final : public ILogSink
+{
+public:
+    CMemoryLogSink() = default;
+    CMemoryLogSink(const CMemoryLogSink &) = delete;
+    CMemoryLogSink &operator=(const CMemoryLogSink &) = delete;
+    CMemoryLogSink(CMemoryLogSink &&) = delete;
+    CMemoryLogSink &operator=(CMemoryLogSink &&) = delete;
+
+    ~CMemoryLogSink() override;
+
+    int32_t Init(IJson *pConfig);
+
+    const char *GetName() const override { return m_strName.c_str(); }
+    int32_t Write(ILogger::LogLevel eLevel, const char *pData, uint32_t uLen) override;
+    void Flush() override {}
+    uint64_t Read(char *pBuffer, uint64_t uSize) override;
+
+private:
+    // 从环形缓冲区的累计位置uPos处拷贝uLen字节
+    void CopyOut(char *pBuffer, uint64_t uPos, uint64_t uLen) const;
+
+private:
+    std::string m_strName;
+    // 写入方是日志线程，读取方是管理接口，写入很短，直接加锁
+    mutable std::mutex m_lock;
+    char *m_pBuffer {nullptr};
+    uint64_t m_uSize {0};
+    uint64_t m_uWritten {0}; // 累计写入的字节数
+};
+
+}
+}
+}
+
+#endif // __CPPX_LOG_SINK_IMPL_H__
@@ -0,0 +1,68 @@
+#include "log_time_formatter.h"
+#include <utilities/common.h>
+#include <ctime>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+uint32_t CLogTimeFormatter::Format(char *pBuffer, uint64_t uMonotonicNs)
+{
+    auto iRealtimeNs = (int64_t)uMonotonicNs + m_iRealtimeOffsetNs;
+    auto iSecond = iRealtimeNs / (int64_t)kSecond;
+    if (unlikely(iSecond != m_iCachedSecond))
+    {
+        // 系统时间可能被调整，秒变化时重新计算偏移，跨秒交替的时间戳每次都会重新计算
+        RefreshOffset();
+        iRealtimeNs = (int64_t)uMonotonicNs + m_iRealtimeOffsetNs;
+        iSecond = iRealtimeNs / (int64_t)kSecond;
+        if (iSecond != m_iCachedSecond)
+        {
+            RebuildSecond(iSecond);
+        }
+    }
+
+    memcpy(pBuffer, m_szCachedSecond, sizeof(m_szCachedSecond));
+    pBuffer[17] = '.';
+    uint32_t uMicro = uint32_t((iRealtimeNs % (int64_t)kSecond) / 1000);
+    FormatFixed2(pBuffer + 18, uMicro / 10000);
+    FormatFixed2(pBuffer + 20, uMicro / 100 % 100);
+    FormatFixed2(pBuffer + 22, uMicro % 100);
+    return kTimeLen;
+}
+
+void CLogTimeFormatter::RefreshOffset()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t uMonotonicNs = 0;
+    clock_get_time_nano(uMonotonicNs);
+    m_iRealtimeOffsetNs = (int64_t)(ts.tv_sec * kSecond + ts.tv_nsec) - (int64_t)uMonotonicNs;
+}
+
+void CLogTimeFormatter::RebuildSecond(int64_t iSecond)
+{
+    time_t tSecond = (time_t)iSecond;
+    struct tm tmTime;
+    localtime_r(&tSecond, &tmTime);
+
+    auto uYear = uint32_t(tmTime.tm_year + 1900);
+    FormatFixed2(m_szCachedSecond, uYear / 100 % 100);
+    FormatFixed2(m_szCachedSecond + 2, uYear % 100);
+    FormatFixed2(m_szCachedSecond + 4, uint32_t(tmTime.tm_mon + 1));
+    FormatFixed2(m_szCachedSecond + 6, uint32_t(tmTime.tm_mday));
+    m_szCachedSecond[8] = '-';
+    FormatFixed2(m_szCachedSecond + 9, uint32_t(tmTime.tm_hour));
+    m_szCachedSecond[11] = ':';
+    FormatFixed2(m_szCachedSecond + 12, uint32_t(tmTime.tm_min));
+    m_szCachedSecond[14] = ':';
+    FormatFixed2(m_szCachedSecond + 15, uint32_t(tmTime.tm_sec));
+    m_iCachedSecond = iSecond;
+}
+
+}
+}
+}
@@ -0,0 +1,99 @@
+#ifndef __CPPX_LOG_TIME_FORMATTER_H__
+#define __CPPX_LOG_TIME_FORMATTER_H__
+
+#include <cstdint>
+#include <cstring>
+
+namespace cppx
+{
+namespace base
+{
+namespace logger
+{
+
+inline constexpr char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// 写入固定2位的十进制数，uValue < 100
+inline void FormatFixed2(char *pBuffer, uint32_t uValue)
+{
+    memcpy(pBuffer, kDigitPairs + uValue * 2, 2);
+}
+
+// 写入十进制数，不补零，返回写入的长度，最多10个字符
+inline uint32_t FormatUint32(char *pBuffer, uint32_t uValue)
+{
+    char szTemp[10];
+    char *pCursor = szTemp + sizeof(szTemp);
+    while (uValue >= 100)
+    {
+        pCursor -= 2;
+        FormatFixed2(pCursor, uValue % 100);
+        uValue /= 100;
+    }
+    if (uValue >= 10)
+    {
+        pCursor -= 2;
+        FormatFixed2(pCursor, uValue);
+    }
+    else
+    {
+        *--pCursor = char('0' + uValue);
+    }
+
+    uint32_t uLen = uint32_t(szTemp + sizeof(szTemp) - pCursor);
+    memcpy(pBuffer, pCursor, uLen);
+    return uLen;
+}
+
+// 最多11个字符
+inline uint32_t FormatInt32(char *pBuffer, int32_t iValue)
+{
+    if (iValue < 0)
+    {
+        pBuffer[0] = '-';
+        return 1 + FormatUint32(pBuffer + 1, 0u - (uint32_t)iValue);
+    }
+    return FormatUint32(pBuffer, (uint32_t)iValue);
+}
+
+// 将单调时钟时间戳格式化为本地时间YYYYMMDD-HH:MM:SS.uuuuuu
+// 同一秒内复用已格式化的YYYYMMDD-HH:MM:SS部分，秒变化时重新计算单调时钟到系统时间的偏移
+// 多线程不安全，每个线程使用自己的对象
+class CLogTimeFormatter
+{
+public:
+    static constexpr uint32_t kTimeLen = 24;
+
+    /**
+     * @brief 格式化时间
+     * @param pBuffer 输出缓冲区，至少kTimeLen字节，不写入结尾的'\0'
+     * @param uMonotonicNs 单调时钟时间戳(ns)
+     * @return 写入的长度
+     */
+    uint32_t Format(char *pBuffer, uint64_t uMonotonicNs);
+
+private:
+    void RefreshOffset();
+    void RebuildSecond(int64_t iSecond);
+
+private:
+    int64_t m_iRealtimeOffsetNs {0};
+    int64_t m_iCachedSecond {-1};
+    char m_szCachedSecond[17]; // YYYYMMDD-HH:MM:SS
+};
+
+}
+}
+}
+
+#endif // __CPPX_LOG_TIME_FORMATTER_H__
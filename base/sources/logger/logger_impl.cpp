@@ -1,12 +1,18 @@
 #include "logger_impl.h"
-#include "thread/spin_lock.h"
+#include "log_time_formatter.h"
+#include <logger/logger_ex.h>
 #include <algorithm>
+#include <charconv>
+#include <cmath>
 #include <cstring>
 #include <filesystem> // use c++17 feature
+#include <functional>
 #include <cstdint>
 #include <cstdio>
 #include <cstdarg>
+#include <ctime>
 #include <map>
+#include <thread>
 #include <utilities/common.h>
 #include <utilities/error_code.h>
 #include <utilities/time.h>
@@ -20,6 +26,294 @@ namespace logger
 
 thread_local uint32_t CLoggerImpl::m_uTid = UINT32_MAX;
 
+static std::atomic<uint64_t> s_uNextLoggerId {1};
+
+// 最近一次使用的日志对象和本线程的队列，进程内通常只有一个日志对象，命中时无需查找
+// bExited在本线程的队列已交还后置位，线程退出过程中再记录日志时不再创建队列
+struct ProducerCache
+{
+    uint64_t uLoggerId;
+    void *pQueue;
+    bool bExited;
+};
+static thread_local ProducerCache tls_producerCache {0, nullptr, false};
+
+// 存活的异步日志对象，线程退出时据此判断队列所属的日志对象是否已经销毁
+struct LoggerRegistry
+{
+    std::mutex lock;
+    std::vector<uint64_t> vecLoggerIds;
+};
+
+static LoggerRegistry &GetLoggerRegistry()
+{
+    static LoggerRegistry s_registry;
+    return s_registry;
+}
+
+/**
+ * 线程本地对象，记录当前线程在各个日志对象中的队列
+ * 线程退出时析构，把仍然存活的日志对象中的队列标记为关闭，由日志线程取完后回收，不依赖线程由谁创建
+ */
+class CProducerQueueHolder
+{
+public:
+    using ProducerQueue = CLoggerImpl::ProducerQueue;
+
+    struct Entry
+    {
+        uint64_t uLoggerId;
+        ProducerQueue *pQueue;
+    };
+
+    CProducerQueueHolder() = default;
+    CProducerQueueHolder(const CProducerQueueHolder &) = delete;
+    CProducerQueueHolder &operator=(const CProducerQueueHolder &) = delete;
+
+    ~CProducerQueueHolder()
+    {
+        auto &producerCache = tls_producerCache;
+        producerCache.uLoggerId = 0;
+        producerCache.pQueue = nullptr;
+        producerCache.bExited = true;
+
+        auto &registry = GetLoggerRegistry();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        for (auto &entry : m_vecEntries)
+        {
+            if (IsAlive(registry, entry.uLoggerId))
+            {
+                entry.pQueue->bClosed.store(true, std::memory_order_release);
+            }
+        }
+    }
+
+    ProducerQueue *Find(uint64_t uLoggerId) const
+    {
+        for (auto &entry : m_vecEntries)
+        {
+            if (entry.uLoggerId == uLoggerId)
+            {
+                return entry.pQueue;
+            }
+        }
+        return nullptr;
+    }
+
+    // 需持有registry.lock，顺便清理已经销毁的日志对象的队列
+    void Add(const LoggerRegistry &registry, const Entry &entry)
+    {
+        size_t uKeep = 0;
+        for (auto &oldEntry : m_vecEntries)
+        {
+            if (IsAlive(registry, oldEntry.uLoggerId))
+            {
+                m_vecEntries[uKeep++] = oldEntry;
+            }
+        }
+        m_vecEntries.resize(uKeep);
+        m_vecEntries.push_back(entry);
+    }
+
+private:
+    // 日志对象ID在进程内不会复用
+    static bool IsAlive(const LoggerRegistry &registry, uint64_t uLoggerId)
+    {
+        return std::find(registry.vecLoggerIds.begin(), registry.vecLoggerIds.end(), uLoggerId)
+               != registry.vecLoggerIds.end();
+    }
+
+private:
+    std::vector<Entry> m_vecEntries;
+};
+
+static thread_local CProducerQueueHolder tls_queueHolder;
+
+// 线程私有的缓冲区，用于格式化和组装记录，按需扩大并一直复用，线程退出时释放
+class CFormatBuffer
+{
+public:
+    ~CFormatBuffer()
+    {
+        if (m_pBuffer != nullptr)
+        {
+            memory::IAllocator::GetInstance()->Free(m_pBuffer);
+        }
+    }
+
+    char *Reserve(uint64_t uSize)
+    {
+        if (unlikely(uSize > m_uSize))
+        {
+            auto pBuffer = reinterpret_cast<char *>(memory::IAllocator::GetInstance()->Realloc(m_pBuffer, uSize));
+            if (unlikely(pBuffer == nullptr))
+            {
+                return nullptr;
+            }
+            m_pBuffer = pBuffer;
+            m_uSize = uSize;
+        }
+        return m_pBuffer;
+    }
+
+private:
+    char *m_pBuffer {nullptr};
+    uint64_t m_uSize {0};
+};
+static thread_local CFormatBuffer tls_formatBuffer;
+static thread_local CFormatBuffer tls_recordBuffer; // 二进制模式下组装记录
+static thread_local CFormatBuffer tls_argBuffer; // 二进制模式和飞行记录器转换按类型保存的参数
+static thread_local CLogTimeFormatter tls_timeFormatter;
+
+// 日志行前缀除模块名之外的最大长度：时间、进程号、线程号、错误码、级别及分隔符
+static constexpr uint32_t kLogPrefixMaxLen = CLogTimeFormatter::kTimeLen + 1 + 10 + 1 + 10 + 1 + 11 + 1 + 5 + 1 + 3;
+
+// 非字符串类型的参数格式化后的最大长度
+static constexpr uint32_t kLogArgTextSize = 32;
+
+// 与logger_ex.h中Wrap的输出保持一致，浮点数保留6位小数
+static uint32_t FormatLogArg(const LogArg &arg, char *pBuffer)
+{
+    auto pEnd = pBuffer + kLogArgTextSize;
+    switch (arg.eType)
+    {
+    case LogArg::Type::kBool:
+        return arg.bValue ? (memcpy(pBuffer, "true", 4), 4) : (memcpy(pBuffer, "false", 5), 5);
+    case LogArg::Type::kChar:
+        pBuffer[0] = arg.cValue;
+        return 1;
+    case LogArg::Type::kInt:
+        return uint32_t(std::to_chars(pBuffer, pEnd, arg.iValue).ptr - pBuffer);
+    case LogArg::Type::kUint:
+        return uint32_t(std::to_chars(pBuffer, pEnd, arg.uValue).ptr - pBuffer);
+    case LogArg::Type::kDouble:
+    {
+        auto result = std::to_chars(pBuffer, pEnd, arg.dValue, std::chars_format::fixed, 6);
+        if (unlikely(result.ec != std::errc()))
+        {
+            result = std::to_chars(pBuffer, pEnd, arg.dValue);
+        }
+        return uint32_t(result.ptr - pBuffer);
+    }
+    case LogArg::Type::kString:
+        memcpy(pBuffer, arg.pValue, arg.uLength);
+        return arg.uLength;
+    case LogArg::Type::kPointer:
+        pBuffer[0] = '0';
+        pBuffer[1] = 'x';
+        return uint32_t(std::to_chars(pBuffer + 2, pEnd, (uintptr_t)arg.pPointer, 16).ptr - pBuffer);
+    default:
+        return 0;
+    }
+}
+
+static uint64_t LogArgTextSize(const LogArg &arg)
+{
+    return arg.eType == LogArg::Type::kString ? arg.uLength : kLogArgTextSize;
+}
+
+// 把按类型保存的参数转换为以'\0'结尾的字符串数组，结果位于线程私有的缓冲区，下次调用前有效
+static char **ConvertLogArgs(const LogArg *pArgs, uint32_t uArgCount)
+{
+    uint64_t uBufferSize = uArgCount * sizeof(char *);
+    for (uint32_t i = 0; i < uArgCount; ++i)
+    {
+        uBufferSize += LogArgTextSize(pArgs[i]) + 1;
+    }
+
+    auto pBuffer = tls_argBuffer.Reserve(std::max(uBufferSize, (uint64_t)1));
+    if (unlikely(pBuffer == nullptr))
+    {
+        return nullptr;
+    }
+
+    auto ppParams = reinterpret_cast<char **>(pBuffer);
+    auto pParam = reinterpret_cast<char *>(ppParams + uArgCount);
+    for (uint32_t i = 0; i < uArgCount; ++i)
+    {
+        auto uLen = FormatLogArg(pArgs[i], pParam);
+        pParam[uLen] = '\0';
+        ppParams[i] = pParam;
+        pParam += uLen + 1;
+    }
+    return ppParams;
+}
+
+// 结构化日志中的字符串转义，JSON总是加引号，logfmt只在为空或包含空格、'='、'"'和控制字符时加引号，
+// 缓冲区至少为字符串长度的6倍加2
+static uint32_t FormatKvString(const char *pValue, uint32_t uLength, bool bJson, char *pBuffer)
+{
+    bool bQuote = bJson || uLength == 0;
+    for (uint32_t i = 0; i < uLength && !bQuote; ++i)
+    {
+        auto c = (unsigned char)pValue[i];
+        bQuote = c <= ' ' || c == '=' || c == '"' || c == '\\';
+    }
+    if (likely(!bQuote))
+    {
+        memcpy(pBuffer, pValue, uLength);
+        return uLength;
+    }
+
+    static const char szHex[] = "0123456789abcdef";
+    auto pCursor = pBuffer;
+    *pCursor++ = '"';
+    for (uint32_t i = 0; i < uLength; ++i)
+    {
+        auto c = (unsigned char)pValue[i];
+        if (c == '"' || c == '\\')
+        {
+            *pCursor++ = '\\';
+            *pCursor++ = (char)c;
+        }
+        else if (c == '\n')
+        {
+            *pCursor++ = '\\';
+            *pCursor++ = 'n';
+        }
+        else if (c == '\t')
+        {
+            *pCursor++ = '\\';
+            *pCursor++ = 't';
+        }
+        else if (c < ' ')
+        {
+            memcpy(pCursor, "\\u00", 4);
+            pCursor[4] = szHex[c >> 4];
+            pCursor[5] = szHex[c & 0xf];
+            pCursor += 6;
+        }
+        else
+        {
+            *pCursor++ = (char)c;
+        }
+    }
+    *pCursor++ = '"';
+    return uint32_t(pCursor - pBuffer);
+}
+
+// 结构化日志的值，数值和bool原样输出，其余类型和非有限的浮点数按字符串输出
+static uint32_t FormatKvValue(const LogArg &arg, bool bJson, char *pBuffer)
+{
+    if (arg.eType == LogArg::Type::kString)
+    {
+        return FormatKvString(arg.pValue, arg.uLength, bJson, pBuffer);
+    }
+
+    char szValue[kLogArgTextSize];
+    auto uLen = FormatLogArg(arg, szValue);
+    if (arg.eType == LogArg::Type::kBool || arg.eType == LogArg::Type::kInt || arg.eType == LogArg::Type::kUint
+        || (arg.eType == LogArg::Type::kDouble && std::isfinite(arg.dValue)))
+    {
+        memcpy(pBuffer, szValue, uLen);
+        return uLen;
+    }
+    return FormatKvString(szValue, uLen, bJson, pBuffer);
+}
+
+// 参数长度缓存在栈上，避免序列化时再次计算，超出的参数重新计算长度
+static constexpr uint32_t kParamLenCacheCount = 32;
+
 static const char *LogLevelToString(ILogger::LogLevel eLevel)
 {
     static const char *szLogLevel[] = {
@@ -34,7 +328,7 @@ static const char *LogLevelToString(ILogger::LogLevel eLevel)
     };
 
     uint32_t uIndex = 0;
-    if (eLevel >= ILogger::LogLevel::kTrace && eLevel < ILogger::LogLevel::kEvent)
+    if (eLevel >= ILogger::LogLevel::kTrace && eLevel <= ILogger::LogLevel::kEvent)
     {
         uIndex = (uint32_t)eLevel;
     }
@@ -46,6 +340,136 @@ static const char *LogLevelToString(ILogger::LogLevel eLevel)
     return szLogLevel[uIndex];
 }
 
+// 进程内全局的模块表，只追加不删除，发布后名称不再修改，查找时不加锁
+struct ModuleEntry
+{
+    std::atomic<const char *> pModule; // 调用点传入的静态字符串，用于按指针快速匹配
+    std::string strName;
+};
+
+struct ModuleRegistry
+{
+    std::mutex lock;
+    std::atomic<uint32_t> uCount {1};
+    ModuleEntry aModules[ILogger::kMaxModuleCount] {};
+};
+
+static ModuleRegistry &GetModuleRegistry()
+{
+    static ModuleRegistry registry;
+    return registry;
+}
+
+static uint32_t FindModuleId(ModuleRegistry &registry, const char *pModule)
+{
+    auto uCount = registry.uCount.load(std::memory_order_acquire);
+    for (uint32_t i = 1; i < uCount; ++i)
+    {
+        if (registry.aModules[i].pModule.load(std::memory_order_relaxed) == pModule)
+        {
+            return i;
+        }
+    }
+    for (uint32_t i = 1; i < uCount; ++i)
+    {
+        if (registry.aModules[i].strName == pModule)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// bStatic为true时pModule在进程生命周期内有效，记录指针用于快速匹配
+static uint32_t RegisterModule(const char *pModule, bool bStatic)
+{
+    if (pModule == nullptr)
+    {
+        return 0;
+    }
+
+    auto &registry = GetModuleRegistry();
+    auto uModuleId = FindModuleId(registry, pModule);
+    if (likely(uModuleId != 0))
+    {
+        return uModuleId;
+    }
+
+    std::lock_guard<std::mutex> lock(registry.lock);
+    auto uCount = registry.uCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 1; i < uCount; ++i)
+    {
+        if (registry.aModules[i].strName == pModule)
+        {
+            if (bStatic && registry.aModules[i].pModule.load(std::memory_order_relaxed) == nullptr)
+            {
+                registry.aModules[i].pModule.store(pModule, std::memory_order_relaxed);
+            }
+            return i;
+        }
+    }
+    if (uCount >= ILogger::kMaxModuleCount)
+    {
+        return 0;
+    }
+
+    auto &entry = registry.aModules[uCount];
+    entry.strName = pModule;
+    entry.pModule.store(bStatic ? pModule : nullptr, std::memory_order_relaxed);
+    registry.uCount.store(uCount + 1, std::memory_order_release);
+    return uCount;
+}
+
+uint32_t ILogger::GetModuleId(const char *pModule)
+{
+    return RegisterModule(pModule, true);
+}
+
+void ILogger::SetLogLevel(LogLevel eLevel)
+{
+    m_eLogLevel = eLevel;
+    m_eCaptureLevel = m_bCaptureAll ? LogLevel::kTrace : std::min(eLevel, m_eSinkLevel);
+    for (uint32_t i = 0; i < kMaxModuleCount; ++i)
+    {
+        UpdateCaptureLevel(i);
+    }
+}
+
+int32_t ILogger::SetModuleLogLevel(const char *pModule, LogLevel eLevel)
+{
+    auto uModuleId = eLevel <= LogLevel::kEvent ? RegisterModule(pModule, false) : 0;
+    if (uModuleId == 0)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    if (m_auModuleLogLevel[uModuleId].exchange((uint8_t)eLevel + 1, std::memory_order_relaxed) == 0)
+    {
+        m_uModuleLevelCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    UpdateCaptureLevel(uModuleId);
+    return ErrorCode::kSuccess;
+}
+
+void ILogger::ResetModuleLogLevel(const char *pModule)
+{
+    auto uModuleId = pModule != nullptr ? FindModuleId(GetModuleRegistry(), pModule) : 0;
+    if (uModuleId == 0 || m_auModuleLogLevel[uModuleId].exchange(0, std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    m_uModuleLevelCount.fetch_sub(1, std::memory_order_relaxed);
+    UpdateCaptureLevel(uModuleId);
+}
+
+void ILogger::UpdateCaptureLevel(uint32_t uModuleId)
+{
+    auto eLevel = m_bCaptureAll ? LogLevel::kTrace : std::min(GetModuleLogLevel(uModuleId), m_eSinkLevel);
+    m_aModuleCaptureLevel[uModuleId].store(eLevel, std::memory_order_relaxed);
+}
+
 ILogger *ILogger::Create(IJson *pConfig)
 {
     auto pLogger = memory::IAllocatorEx::GetInstance()->New<CLoggerImpl>();
@@ -95,14 +519,28 @@ int32_t CLoggerImpl::Init(IJson *pConfig)
     {
         uLogLevel = default_value::kLogLevel;
     }
-    m_eLogLevel = (LogLevel)uLogLevel;
+    m_bCaptureAll = pConfig->GetBool(config::kLogFlightRecorder, default_value::kLogFlightRecorder);
+    SetLogLevel((LogLevel)uLogLevel);
     m_uPid = getpid();
     m_bAsync = pConfig->GetBool(config::kLogAsync, default_value::kLogAsync);
     m_uBindCpuNo = pConfig->GetUint32(config::kBindCpuNo, default_value::kBindCpuNo);
     m_uLogFileMaxSizeMB = pConfig->GetUint64(config::kLogFileMaxSizeMB, default_value::kLogFileMaxSizeMB);
     m_uLogTotalSizeMB = pConfig->GetUint64(config::kLogTotalSizeMB, default_value::kLogTotalSizeMB);
     m_uLogFormatBufferSize = pConfig->GetUint32(config::kLogFormatBufferSize, default_value::kLogFormatBufferSize);
+    m_uLogFormatBufferSize = std::max(m_uLogFormatBufferSize, kLogPrefixMaxLen + 1);
     m_uLogChannelMaxMemMB = pConfig->GetUint32(config::kLogChannelMaxMemMB, default_value::kLogChannelMaxMemMB);
+    m_uThreadQueueMemKB = pConfig->GetUint32(config::kLogThreadQueueMemKB, default_value::kLogThreadQueueMemKB);
+    m_bBinary = pConfig->GetBool(config::kLogBinary, default_value::kLogBinary);
+    m_uFlushIntervalNs = pConfig->GetUint32(config::kLogFlushIntervalMs, default_value::kLogFlushIntervalMs) * kMill;
+    auto uOverflowPolicy = pConfig->GetUint32(config::kLogOverflowPolicy, default_value::kLogOverflowPolicy);
+    m_eOverflowPolicy = uOverflowPolicy <= (uint32_t)OverflowPolicy::kInline
+                        ? (OverflowPolicy)uOverflowPolicy : (OverflowPolicy)default_value::kLogOverflowPolicy;
+    m_uOverflowBlockNs = (uint64_t)pConfig->GetUint32(config::kLogOverflowBlockUs, default_value::kLogOverflowBlockUs) * 1000;
+    m_bWriteLock = !m_bAsync || m_eOverflowPolicy == OverflowPolicy::kInline;
+    m_bKvJson = pConfig->GetUint32(config::kLogKvFormat, default_value::kLogKvFormat) == 1;
+    uint64_t uStartNs = 0;
+    clock_get_time_nano(uStartNs);
+    m_uLastStatsNs.store(uStartNs, std::memory_order_relaxed);
     m_pAllocator = memory::IAllocator::GetInstance();
 
     try
@@ -119,27 +557,55 @@ int32_t CLoggerImpl::Init(IJson *pConfig)
         return ErrorCode::kThrowException;
     }
 
-    if (m_bAsync)
+    // 同步模式没有后台线程按时刷新，每条日志直接写入文件
+    auto uWriteBufferKB = pConfig->GetUint32(config::kLogWriteBufferKB, default_value::kLogWriteBufferKB);
+    auto uSyncPolicy = pConfig->GetUint32(config::kLogSyncPolicy, default_value::kLogSyncPolicy);
+    if (uSyncPolicy > (uint32_t)CLogFileWriter::SyncPolicy::kOnFlush)
+    {
+        uSyncPolicy = default_value::kLogSyncPolicy;
+    }
+    uint64_t uMmapChunkSize = 0;
+    if (pConfig->GetBool(config::kLogMmap, default_value::kLogMmap))
     {
-        channel::ChannelConfig stConfig;
-        stConfig.uElementSize = sizeof(LogItemHeader *);
-        stConfig.uMaxElementCount = 4096;
-        m_pChannel = LogChannel::Create(&stConfig);
-        if (m_pChannel == nullptr)
+        uMmapChunkSize = (uint64_t)pConfig->GetUint32(config::kLogMmapChunkMB, default_value::kLogMmapChunkMB) * 1024 * 1024;
+        if (uMmapChunkSize == 0)
         {
-            PRINT_ERROR("init logger failed, create channel failed %s", "");
-            SetLastError(ErrorCode::kOutOfMemory);
-            return ErrorCode::kOutOfMemory;
+            uMmapChunkSize = (uint64_t)default_value::kLogMmapChunkMB * 1024 * 1024;
         }
+    }
+    auto iErrorNo = m_fileWriter.Init(m_bAsync ? uWriteBufferKB * 1024 : 0, (CLogFileWriter::SyncPolicy)uSyncPolicy,
+                                      uMmapChunkSize, m_bBinary);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        return iErrorNo;
+    }
+
+    iErrorNo = m_retention.Init(m_strLogPath, m_strLoggerName, m_strLogSuffix, m_uLogTotalSizeMB * 1024 * 1024,
+                                pConfig->GetBool(config::kLogCompress, default_value::kLogCompress),
+                                pConfig->GetUint32(config::kLogCompressCpuNo, default_value::kLogCompressCpuNo));
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        PRINT_ERROR("init logger failed, init log retention failed %d", iErrorNo);
+        return iErrorNo;
+    }
 
-        m_pSpinLock = SpinLock::Create();
-        if (m_pSpinLock == nullptr)
+    if (m_bCaptureAll)
+    {
+        // 导出文件名: 日志目录/日志名称.flight.进程号.序号.bin
+        char szDumpPrefix[256];
+        snprintf(szDumpPrefix, sizeof(szDumpPrefix), "%s/%s.flight.%u.", 
+                 m_strLogPath.c_str(), m_strLoggerName.c_str(), m_uPid);
+        auto uRingKB = pConfig->GetUint32(config::kLogFlightRecorderKB, default_value::kLogFlightRecorderKB);
+        iErrorNo = m_flightRecorder.Init(szDumpPrefix, uRingKB * 1024);
+        if (iErrorNo != ErrorCode::kSuccess)
         {
-            PRINT_ERROR("init logger failed, create spin lock failed %s", "");
-            SetLastError(ErrorCode::kOutOfMemory);
-            return ErrorCode::kOutOfMemory;
+            PRINT_ERROR("init logger failed, init flight recorder failed %d", iErrorNo);
+            return iErrorNo;
         }
+    }
 
+    if (m_bAsync)
+    {
         m_pThreadManager = IThreadManager::GetInstance();
         if (m_pThreadManager == nullptr)
         {
@@ -148,6 +614,25 @@ int32_t CLoggerImpl::Init(IJson *pConfig)
             return ErrorCode::kOutOfMemory;
         }
 
+        // 每个线程的队列在首次记录日志时创建，所有队列的内存总量至少能容纳一个队列
+        m_uLogChannelMaxMemMB = std::max<uint32_t>(m_uLogChannelMaxMemMB, (m_uThreadQueueMemKB + 1023) / 1024);
+        m_uLoggerId = s_uNextLoggerId.fetch_add(1, std::memory_order_relaxed);
+        {
+            auto &registry = GetLoggerRegistry();
+            std::lock_guard<std::mutex> lock(registry.lock);
+            try
+            {
+                registry.vecLoggerIds.push_back(m_uLoggerId);
+            }
+            catch (std::exception &e)
+            {
+                m_uLoggerId = 0;
+                PRINT_ERROR("init logger failed, throw exception: %s", e.what());
+                SetLastError(ErrorCode::kOutOfMemory);
+                return ErrorCode::kOutOfMemory;
+            }
+        }
+
         char szThreadName[16];
         snprintf(szThreadName, sizeof(szThreadName), "logger_%s", m_strLoggerName.c_str());
         m_pThread = m_pThreadManager->CreateThread();
@@ -179,31 +664,51 @@ void CLoggerImpl::Exit()
 
     if (m_bAsync)
     {
-        if (m_pChannel != nullptr)
+        if (m_pThreadManager != nullptr && m_pThread != nullptr)
         {
-            LogChannel::Destroy(m_pChannel);
-            m_pChannel = nullptr;
+            m_pThreadManager->DestroyThread(m_pThread);
+            m_pThread = nullptr;
         }
-    
-        if (m_pSpinLock != nullptr)
+
+        // 先注销，之后退出的线程不会再访问本日志对象的队列
+        if (m_uLoggerId != 0)
         {
-            SpinLock::Destroy(m_pSpinLock);
-            m_pSpinLock = nullptr;
+            auto &registry = GetLoggerRegistry();
+            std::lock_guard<std::mutex> lock(registry.lock);
+            auto &vecLoggerIds = registry.vecLoggerIds;
+            vecLoggerIds.erase(std::remove(vecLoggerIds.begin(), vecLoggerIds.end(), m_uLoggerId), vecLoggerIds.end());
         }
 
-        if (m_pThreadManager != nullptr && m_pThread != nullptr)
+        // 日志线程已退出，写完剩余的日志，调用方需保证此时没有线程再记录日志
+        DrainQueues(UINT32_MAX);
         {
-            m_pThreadManager->DestroyThread(m_pThread);
-            m_pThread = nullptr;
+            std::lock_guard<std::mutex> lock(m_queueLock);
+            for (auto pQueue : m_vecQueues)
+            {
+                DestroyProducerQueue(pQueue);
+            }
+            m_vecQueues.clear();
+            m_uQueueVersion.fetch_add(1, std::memory_order_release);
         }
+        m_vecMergeQueues.clear();
         m_pThreadManager = nullptr;
     }
 
-    if (m_pLogFile != nullptr)
+    // 输出剩余的被抑制条数，之后调用点可以注册到其他日志对象
+    FlushRateLimiters();
     {
-        fclose(m_pLogFile);
-        m_pLogFile = nullptr;
+        std::lock_guard<std::mutex> lock(m_limiterLock);
+        for (auto pLimiter : m_vecRateLimiters)
+        {
+            pLimiter->Unregister();
+        }
+        m_vecRateLimiters.clear();
     }
+
+    FlushSinks();
+    m_fileWriter.Close();
+    m_retention.Exit();
+    m_flightRecorder.Exit();
 }
 
 int32_t CLoggerImpl::Start()
@@ -241,36 +746,6 @@ void CLoggerImpl::Stop()
     }
 }
 
-void CLoggerImpl::LogItem::CopyParams(memory::IAllocator *pAllocator, const char **ppParams, uint32_t uParamCount)
-{
-    this->ppParams = nullptr;
-    this->uParamCount = 0;
-    if ((pAllocator == nullptr || ppParams == nullptr || uParamCount == 0))
-    {
-        return;
-    }
-
-    this->ppParams = reinterpret_cast<char **>(pAllocator->Malloc(uParamCount * sizeof(char *)));
-    if (unlikely(this->ppParams == nullptr))
-    {
-        return;
-    }
-
-    for (uint32_t i = 0; i < uParamCount; ++i)
-    {
-        auto iParamLen = strlen(ppParams[i]);
-        this->ppParams[i] = reinterpret_cast<char *>(pAllocator->Malloc(iParamLen + 1));
-        if (unlikely(this->ppParams[i] == nullptr))
-        {
-            return;
-        }
-        memcpy(this->ppParams[i], ppParams[i], iParamLen);
-        this->ppParams[i][iParamLen] = '\0';
-
-        this->uParamCount = i + 1;
-    }
-}
-
 int32_t CLoggerImpl::Log(int32_t iErrorNo, LogLevel eLevel, const char *pModule,
                         const char *pFileLine, const char *pFunction,
                         const char *pFormat, const char **ppParams, uint32_t uParamCount)
@@ -279,64 +754,116 @@ int32_t CLoggerImpl::Log(int32_t iErrorNo, LogLevel eLevel, const char *pModule,
     {
         m_uTid = gettid();
     }
+    auto bFile = FileAccepts(eLevel, pModule);
+    if (unlikely(m_bCaptureAll))
+    {
+        uint64_t uTimestampNs = 0;
+        clock_get_time_nano(uTimestampNs);
+        m_flightRecorder.Record(uTimestampNs, m_uTid, iErrorNo, eLevel, pModule, pFileLine, pFunction,
+                                pFormat, ppParams, ppParams != nullptr ? uParamCount : 0);
+        if (FlightRecordOnly(eLevel, bFile))
+        {
+            return ErrorCode::kSuccess;
+        }
+    }
     if (likely(m_bAsync))
     {
-        auto pLogItem = reinterpret_cast<LogItem *>(m_pAllocator->Malloc(sizeof(LogItem)));
-        if (unlikely(pLogItem == nullptr))
+        auto pQueue = GetProducerQueue();
+        if (unlikely(pQueue == nullptr))
         {
+            if (OverflowInline())
+            {
+                return LogInline(iErrorNo, eLevel, pModule, pFileLine, pFunction, pFormat, ppParams, uParamCount);
+            }
             SetLastError(ErrorCode::kOutOfMemory);
             return ErrorCode::kOutOfMemory;
         }
-        pLogItem->header.eType = LogItemType::kLog;
-        pLogItem->iErrorNo = iErrorNo;
-        pLogItem->eLevel = eLevel;
-        pLogItem->uTid = m_uTid;
-        pLogItem->uParamCount = uParamCount;
-        clock_get_time_nano(pLogItem->uTimestampNs);
-        pLogItem->pModule = pModule;
-        pLogItem->pFileLine = pFileLine;
-        pLogItem->pFunction = pFunction;
-        pLogItem->pFormat = pFormat;
-        pLogItem->CopyParams(m_pAllocator, ppParams, uParamCount);
+
+        if (ppParams == nullptr)
+        {
+            uParamCount = 0;
+        }
+        uint32_t auParamLen[kParamLenCacheCount];
+        uint64_t uItemSize = sizeof(LogItem) + uParamCount * sizeof(char *);
+        for (uint32_t i = 0; i < uParamCount; ++i)
         {
-            SpinLockGuard guard(m_pSpinLock);
-            auto ppLogItem = reinterpret_cast<LogItem **>(m_pChannel->New());
-            if (likely(ppLogItem != nullptr))
+            auto uParamLen = strlen(ppParams[i]) + 1;
+            if (i < kParamLenCacheCount)
             {
-                *ppLogItem = pLogItem;
-                m_pChannel->Post(ppLogItem);
-                if (m_pChannel->GetSize() == 1)
-                {
-                    m_condition.notify_one();
-                }
+                auParamLen[i] = (uint32_t)uParamLen;
             }
-            else
+            uItemSize += uParamLen;
+        }
+
+        auto pLogItem = uItemSize <= UINT32_MAX 
+                        ? reinterpret_cast<LogItem *>(NewLogItem(pQueue, (uint32_t)uItemSize)) : nullptr;
+        if (unlikely(pLogItem == nullptr))
+        {
+            if (OverflowInline())
             {
-                m_pAllocator->Free(pLogItem);
-                SetLastError(ErrorCode::kOutOfMemory);
-                return ErrorCode::kOutOfMemory;
+                return LogInline(iErrorNo, eLevel, pModule, pFileLine, pFunction, pFormat, ppParams, uParamCount);
             }
+            SetLastError(ErrorCode::kOutOfMemory);
+            return ErrorCode::kOutOfMemory;
+        }
+        pLogItem->header.eType = LogItemType::kLog;
+        clock_get_time_nano(pLogItem->header.uTimestampNs);
+        pLogItem->iErrorNo = iErrorNo;
+        pLogItem->eLevel = eLevel;
+        pLogItem->bFile = bFile;
+        pLogItem->uTid = m_uTid;
+        pLogItem->uParamCount = uParamCount;
+        pLogItem->pModule = pModule;
+        pLogItem->pFileLine = pFileLine;
+        pLogItem->pFunction = pFunction;
+        pLogItem->pFormat = pFormat;
+        pLogItem->ppParams = reinterpret_cast<char **>(pLogItem + 1);
+
+        auto pParam = reinterpret_cast<char *>(pLogItem->ppParams + uParamCount);
+        for (uint32_t i = 0; i < uParamCount; ++i)
+        {
+            auto uParamLen = i < kParamLenCacheCount ? auParamLen[i] : strlen(ppParams[i]) + 1;
+            memcpy(pParam, ppParams[i], uParamLen);
+            pLogItem->ppParams[i] = pParam;
+            pParam += uParamLen;
+        }
+
+        PostLogItem(pQueue, &pLogItem->header);
+        if (unlikely(eLevel == LogLevel::kFatal))
+        {
+            WaitFatalWritten(pQueue);
         }
         return ErrorCode::kSuccess;
     }
     else
     {
-        LogItem logItem;
-        logItem.header.eType = LogItemType::kLog;
-        logItem.iErrorNo = iErrorNo;
-        logItem.eLevel = eLevel;
-        logItem.uTid = m_uTid;
-        logItem.uParamCount = uParamCount;
-        clock_get_time_nano(logItem.uTimestampNs);
-        logItem.pModule = pModule;
-        logItem.pFileLine = pFileLine;
-        logItem.pFunction = pFunction;
-        logItem.pFormat = pFormat;
-        logItem.ppParams = const_cast<char **>(ppParams);
-        return WriteLog(logItem);
+        return LogInline(iErrorNo, eLevel, pModule, pFileLine, pFunction, pFormat, ppParams, uParamCount);
     }
 }
 
+int32_t CLoggerImpl::LogInline(int32_t iErrorNo, LogLevel eLevel, const char *pModule,
+                               const char *pFileLine, const char *pFunction,
+                               const char *pFormat, const char **ppParams, uint32_t uParamCount)
+{
+    LogItem logItem;
+    logItem.header.eType = LogItemType::kLog;
+    clock_get_time_nano(logItem.header.uTimestampNs);
+    logItem.iErrorNo = iErrorNo;
+    logItem.eLevel = eLevel;
+    logItem.bFile = FileAccepts(eLevel, pModule);
+    logItem.uTid = m_uTid;
+    logItem.uParamCount = ppParams != nullptr ? uParamCount : 0;
+    logItem.pModule = pModule;
+    logItem.pFileLine = pFileLine;
+    logItem.pFunction = pFunction;
+    logItem.pFormat = pFormat;
+    logItem.ppParams = const_cast<char **>(ppParams);
+    auto iResult = m_bBinary ? WriteBinaryLog(logItem) : WriteLog(logItem);
+    SyncFatalLog(eLevel);
+    m_uWriteLines.fetch_add(1, std::memory_order_relaxed);
+    return iResult;
+}
+
 int32_t CLoggerImpl::LogFormat(int32_t iErrorNo, LogLevel eLevel, const char *pFormat, ...)
 {
     if (unlikely(m_uTid == UINT32_MAX))
@@ -344,82 +871,361 @@ int32_t CLoggerImpl::LogFormat(int32_t iErrorNo, LogLevel eLevel, const char *pF
         m_uTid = gettid();
     }
 
-    auto pLogForamtItem = reinterpret_cast<LogForamtItem *>(sizeof(LogForamtItem) + m_uLogFormatBufferSize);
-    if (unlikely(pLogForamtItem == nullptr))
+    auto pLogBuffer = tls_formatBuffer.Reserve(m_uLogFormatBufferSize);
+    if (unlikely(pLogBuffer == nullptr))
     {
         SetLastError(ErrorCode::kOutOfMemory);
         return ErrorCode::kOutOfMemory;
     }
-    
-    auto pLogBuffer = reinterpret_cast<char *>(pLogForamtItem + 1);
-    auto time = ITime::GetLocalTime();
-    // YYYYMMDD-HHMMSS.uuuuuu PID TID ERROR_CODE LEVEL 
-    auto iLen = snprintf((char *)pLogBuffer, m_uLogFormatBufferSize, 
-             "%04d%02d%02d-%02d:%02d:%02d.%06d %u %u %d %s ",
-             time.uYear, time.uMonth, time.uDay, time.uHour, time.uMinute, time.uSecond, time.uMicro, 
-             m_uPid, m_uTid, iErrorNo, LogLevelToString(eLevel));
-    if (unlikely(iLen < 0))
-    {
-        m_pAllocator->Free(pLogBuffer);
-        SetLastError(ErrorCode::kSystemError);
-        return ErrorCode::kSystemError;
-    }
+
+    uint64_t uTimestampNs = 0;
+    clock_get_time_nano(uTimestampNs);
+    // YYYYMMDD-HH:MM:SS.uuuuuu PID TID ERROR_CODE LEVEL 
+    auto iLen = (int32_t)FormatPrefix(pLogBuffer, uTimestampNs, m_uTid, iErrorNo, eLevel, nullptr);
 
     va_list args;
     va_start(args, pFormat);
     // FORMAT
-    auto iLen2 = vsnprintf((char *)pLogBuffer + iLen, m_uLogFormatBufferSize - iLen, pFormat, args);
+    auto iLen2 = vsnprintf(pLogBuffer + iLen, m_uLogFormatBufferSize - iLen, pFormat, args);
     va_end(args);
     if (unlikely(iLen2 < 0))
     {
-        m_pAllocator->Free(pLogBuffer);
         SetLastError(ErrorCode::kSystemError);
         return ErrorCode::kSystemError;
     }
 
+    // 截断时保留换行符的位置
     uint32_t uWriteLen = std::min((uint32_t)iLen + iLen2, m_uLogFormatBufferSize - 1);
-    pLogBuffer[uWriteLen - 1] = '\n';
+    pLogBuffer[uWriteLen] = '\n';
     uWriteLen++;
 
+    if (unlikely(m_bCaptureAll))
+    {
+        m_flightRecorder.RecordText(uTimestampNs, m_uTid, eLevel, pLogBuffer, uWriteLen);
+        if (FlightRecordOnly(eLevel, FileAccepts(eLevel, nullptr)))
+        {
+            return ErrorCode::kSuccess;
+        }
+    }
+
     if (likely(m_bAsync))
     {
+        // 按实际长度在通道中申请，避免每条日志都占用整个格式化缓冲区
+        auto pQueue = GetProducerQueue();
+        auto pLogForamtItem = pQueue != nullptr 
+                              ? reinterpret_cast<LogForamtItem *>(NewLogItem(pQueue, sizeof(LogForamtItem) + uWriteLen)) : nullptr;
+        if (unlikely(pLogForamtItem == nullptr))
+        {
+            if (OverflowInline())
+            {
+                return LogFormatInline(eLevel, uTimestampNs, pLogBuffer, uWriteLen);
+            }
+            SetLastError(ErrorCode::kOutOfMemory);
+            return ErrorCode::kOutOfMemory;
+        }
         pLogForamtItem->header.eType = LogItemType::kLogFormat;
+        pLogForamtItem->header.uTimestampNs = uTimestampNs;
+        pLogForamtItem->eLevel = eLevel;
+        pLogForamtItem->bFile = FileAccepts(eLevel, nullptr);
+        pLogForamtItem->uTid = m_uTid;
         pLogForamtItem->uWriteLen = uWriteLen;
-        pLogForamtItem->pLogBuffer = pLogBuffer;
+        pLogForamtItem->pLogBuffer = reinterpret_cast<char *>(pLogForamtItem + 1);
+        memcpy(pLogForamtItem + 1, pLogBuffer, uWriteLen);
+        PostLogItem(pQueue, &pLogForamtItem->header);
+        if (unlikely(eLevel == LogLevel::kFatal))
         {
-            SpinLockGuard guard(m_pSpinLock);
-            auto ppLogForamtItem = reinterpret_cast<LogForamtItem **>(m_pChannel->New());
-            if (likely(ppLogForamtItem != nullptr))
+            WaitFatalWritten(pQueue);
+        }
+        return ErrorCode::kSuccess;
+    }
+    else
+    {
+        return LogFormatInline(eLevel, uTimestampNs, pLogBuffer, uWriteLen);
+    }
+}
+
+int32_t CLoggerImpl::LogFormatInline(LogLevel eLevel, uint64_t uTimestampNs, const char *pLogBuffer, uint32_t uWriteLen)
+{
+    auto bFile = FileAccepts(eLevel, nullptr);
+    auto iErrorNo = m_bBinary ? WriteBinaryText(eLevel, bFile, m_uTid, uTimestampNs, pLogBuffer, uWriteLen)
+                              : OutputLog(eLevel, bFile, pLogBuffer, uWriteLen);
+    SyncFatalLog(eLevel);
+    m_uWriteLines.fetch_add(1, std::memory_order_relaxed);
+    return iErrorNo;
+}
+
+int32_t CLoggerImpl::LogArgs(int32_t iErrorNo, LogLevel eLevel, const LogSite *pSite,
+                             const LogArg *pArgs, uint32_t uArgCount)
+{
+    if (unlikely(pSite == nullptr || (pArgs == nullptr && uArgCount != 0) || pSite->uArgCount != uArgCount))
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    if (unlikely(m_uTid == UINT32_MAX))
+    {
+        m_uTid = gettid();
+    }
+    auto bFile = FileAccepts(eLevel, pSite->pModule);
+    if (unlikely(m_bCaptureAll))
+    {
+        uint64_t uTimestampNs = 0;
+        clock_get_time_nano(uTimestampNs);
+        auto ppParams = ConvertLogArgs(pArgs, uArgCount);
+        if (likely(ppParams != nullptr))
+        {
+            m_flightRecorder.Record(uTimestampNs, m_uTid, iErrorNo, eLevel, pSite->pModule, pSite->pFileLine,
+                                    pSite->pFunction, pSite->pFormat, ppParams, uArgCount);
+        }
+        if (FlightRecordOnly(eLevel, bFile))
+        {
+            return ErrorCode::kSuccess;
+        }
+    }
+    if (likely(m_bAsync))
+    {
+        auto pQueue = GetProducerQueue();
+        if (unlikely(pQueue == nullptr))
+        {
+            if (OverflowInline())
             {
-                *ppLogForamtItem = pLogForamtItem;
-                m_pChannel->Post(ppLogForamtItem);
-                if (m_pChannel->GetSize() == 1)
-                {
-                    m_condition.notify_one();
-                }
+                return LogArgsInline(iErrorNo, eLevel, pSite, pArgs, uArgCount);
             }
-            else
+            SetLastError(ErrorCode::kOutOfMemory);
+            return ErrorCode::kOutOfMemory;
+        }
+
+        uint64_t uItemSize = sizeof(LogArgsItem) + uArgCount * sizeof(LogArg);
+        for (uint32_t i = 0; i < uArgCount; ++i)
+        {
+            if (pArgs[i].eType == LogArg::Type::kString)
             {
-                m_pAllocator->Free(pLogForamtItem);
-                SetLastError(ErrorCode::kOutOfMemory);
-                return ErrorCode::kOutOfMemory;
+                uItemSize += pArgs[i].uLength + 1;
             }
         }
+
+        auto pLogArgsItem = uItemSize <= UINT32_MAX 
+                            ? reinterpret_cast<LogArgsItem *>(NewLogItem(pQueue, (uint32_t)uItemSize)) : nullptr;
+        if (unlikely(pLogArgsItem == nullptr))
+        {
+            if (OverflowInline())
+            {
+                return LogArgsInline(iErrorNo, eLevel, pSite, pArgs, uArgCount);
+            }
+            SetLastError(ErrorCode::kOutOfMemory);
+            return ErrorCode::kOutOfMemory;
+        }
+        pLogArgsItem->header.eType = LogItemType::kLogArgs;
+        clock_get_time_nano(pLogArgsItem->header.uTimestampNs);
+        pLogArgsItem->iErrorNo = iErrorNo;
+        pLogArgsItem->eLevel = eLevel;
+        pLogArgsItem->bFile = bFile;
+        pLogArgsItem->uTid = m_uTid;
+        pLogArgsItem->uArgCount = uArgCount;
+        pLogArgsItem->pSite = pSite;
+        pLogArgsItem->pArgs = reinterpret_cast<LogArg *>(pLogArgsItem + 1);
+        if (uArgCount != 0)
+        {
+            memcpy(pLogArgsItem->pArgs, pArgs, uArgCount * sizeof(LogArg));
+        }
+
+        // 只有字符串参数需要拷贝内容，其余参数按值保存
+        auto pString = reinterpret_cast<char *>(pLogArgsItem->pArgs + uArgCount);
+        for (uint32_t i = 0; i < uArgCount; ++i)
+        {
+            auto &arg = pLogArgsItem->pArgs[i];
+            if (arg.eType == LogArg::Type::kString)
+            {
+                memcpy(pString, arg.pValue, arg.uLength);
+                pString[arg.uLength] = '\0';
+                arg.pValue = pString;
+                pString += arg.uLength + 1;
+            }
+        }
+
+        PostLogItem(pQueue, &pLogArgsItem->header);
+        if (unlikely(eLevel == LogLevel::kFatal))
+        {
+            WaitFatalWritten(pQueue);
+        }
         return ErrorCode::kSuccess;
     }
     else
     {
-        auto iErrorNo = WriteLog((char *)pLogBuffer, uWriteLen);
-        m_pAllocator->Free(pLogBuffer);
-        return iErrorNo;
+        return LogArgsInline(iErrorNo, eLevel, pSite, pArgs, uArgCount);
     }
 }
 
+int32_t CLoggerImpl::LogArgsInline(int32_t iErrorNo, LogLevel eLevel, const LogSite *pSite,
+                                   const LogArg *pArgs, uint32_t uArgCount)
+{
+    LogArgsItem logArgsItem;
+    logArgsItem.header.eType = LogItemType::kLogArgs;
+    clock_get_time_nano(logArgsItem.header.uTimestampNs);
+    logArgsItem.iErrorNo = iErrorNo;
+    logArgsItem.eLevel = eLevel;
+    logArgsItem.bFile = FileAccepts(eLevel, pSite->pModule);
+    logArgsItem.uTid = m_uTid;
+    logArgsItem.uArgCount = uArgCount;
+    logArgsItem.pSite = pSite;
+    logArgsItem.pArgs = const_cast<LogArg *>(pArgs);
+    auto iResult = m_bBinary ? WriteBinaryLog(logArgsItem) : WriteLog(logArgsItem);
+    SyncFatalLog(eLevel);
+    m_uWriteLines.fetch_add(1, std::memory_order_relaxed);
+    return iResult;
+}
+
+int32_t CLoggerImpl::AddSink(ILogSink *pSink, LogLevel eLevel)
+{
+    if (pSink == nullptr || eLevel > LogLevel::kEvent || m_uSinkCount >= kMaxSinkCount)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+    if (m_bRunning)
+    {
+        SetLastError(ErrorCode::kInvalidState);
+        return ErrorCode::kInvalidState;
+    }
+
+    auto &sink = m_aSinks[m_uSinkCount];
+    sink.pSink = pSink;
+    sink.eLevel = eLevel;
+    sink.uWriteCount.store(0, std::memory_order_relaxed);
+    sink.uWriteBytes.store(0, std::memory_order_relaxed);
+    sink.uDropCount.store(0, std::memory_order_relaxed);
+    ++m_uSinkCount;
+
+    // 宏按日志级别和各输出目标级别中的最低值过滤
+    m_eSinkLevel = std::min(m_eSinkLevel, eLevel);
+    SetLogLevel(m_eLogLevel);
+    return ErrorCode::kSuccess;
+}
+
+int32_t CLoggerImpl::AddRateLimiter(LogRateLimiter *pLimiter)
+{
+    if (pLimiter == nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(m_limiterLock);
+        m_vecRateLimiters.push_back(pLimiter);
+    }
+    catch (std::exception &e)
+    {
+        PRINT_ERROR("add rate limiter failed, throw exception: %s", e.what());
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CLoggerImpl::FlushRateLimiters()
+{
+    if (unlikely(m_uTid == UINT32_MAX))
+    {
+        m_uTid = gettid();
+    }
+
+    // 直接写入，不经过本线程的队列，日志线程和Exit调用时不会等待自己取出
+    std::lock_guard<std::mutex> lock(m_limiterLock);
+    for (auto pLimiter : m_vecRateLimiters)
+    {
+        auto uSuppressed = pLimiter->TakeSuppressed();
+        if (uSuppressed != 0)
+        {
+            WrapU64 suppressed(uSuppressed);
+            const char *ppParams[] = {suppressed};
+            LogInline(pLimiter->GetErrorNo(), pLimiter->GetLevel(), pLimiter->GetModule(), pLimiter->GetFileLine(),
+                      pLimiter->GetFunction(), LogRateLimiter::kSuppressedFormat, ppParams, 1);
+        }
+    }
+}
+
+int32_t CLoggerImpl::DumpFlightRecorder()
+{
+    if (!m_bCaptureAll)
+    {
+        SetLastError(ErrorCode::kNotSupported);
+        return ErrorCode::kNotSupported;
+    }
+    return m_flightRecorder.Dump();
+}
+
 int32_t CLoggerImpl::GetStats(IJson *pJson) const
 {
     if (pJson != nullptr)
     {
         pJson->Clear();
+        if (m_bAsync)
+        {
+            QueueStats stats;
+            uint64_t uQueueDepth = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_queueLock);
+                pJson->SetUint32("thread_queue_count", uint32_t(m_vecQueues.size()));
+                pJson->SetUint64("thread_queue_mem_kb", m_uQueueMemKB.load(std::memory_order_relaxed));
+                pJson->SetUint64("thread_queue_reject_count", m_uQueueRejectCount.load(std::memory_order_relaxed));
+                AddQueueStats(stats, m_retiredStats);
+                for (auto pQueue : m_vecQueues)
+                {
+                    AddQueueStats(stats, pQueue->stats);
+                    uQueueDepth += pQueue->pChannel->GetSize();
+                }
+            }
+            auto uSamples = stats.uLatencySamples.load(std::memory_order_relaxed);
+            auto uWriteCount = m_uWriteLatencyCount.load(std::memory_order_relaxed);
+            pJson->SetUint64("queue_depth", uQueueDepth);
+            pJson->SetUint64("enqueue_count", stats.uPostCount.load(std::memory_order_relaxed));
+            pJson->SetUint64("enqueue_latency_avg_ns", uSamples != 0 ? stats.uLatencyTotalNs.load(std::memory_order_relaxed) / uSamples : 0);
+            pJson->SetUint64("enqueue_latency_max_ns", stats.uLatencyMaxNs.load(std::memory_order_relaxed));
+            pJson->SetUint64("drop_count", stats.uDropCount.load(std::memory_order_relaxed));
+            pJson->SetUint64("overflow_block_count", stats.uBlockCount.load(std::memory_order_relaxed));
+            pJson->SetUint64("overflow_inline_count", stats.uInlineCount.load(std::memory_order_relaxed));
+            pJson->SetUint64("write_latency_avg_ns", uWriteCount != 0 ? m_uWriteLatencyTotalNs.load(std::memory_order_relaxed) / uWriteCount : 0);
+            pJson->SetUint64("write_latency_max_ns", m_uWriteLatencyMaxNs.load(std::memory_order_relaxed));
+        }
+
+        // 速率按与上一次调用GetStats之间的增量计算
+        uint64_t uCurrentTimeNs = 0;
+        clock_get_time_nano(uCurrentTimeNs);
+        auto uLines = m_uWriteLines.load(std::memory_order_relaxed);
+        auto uBytes = m_uWriteBytes.load(std::memory_order_relaxed);
+        auto uElapsedNs = uCurrentTimeNs - m_uLastStatsNs.exchange(uCurrentTimeNs, std::memory_order_relaxed);
+        auto uElapsedLines = uLines - m_uLastStatsLines.exchange(uLines, std::memory_order_relaxed);
+        auto uElapsedBytes = uBytes - m_uLastStatsBytes.exchange(uBytes, std::memory_order_relaxed);
+        pJson->SetUint64("log_lines", uLines);
+        pJson->SetUint64("log_bytes", uBytes);
+        pJson->SetUint64("lines_per_sec", uElapsedNs != 0 ? uint64_t(uElapsedLines * 1e9 / uElapsedNs) : 0);
+        pJson->SetUint64("bytes_per_sec", uElapsedNs != 0 ? uint64_t(uElapsedBytes * 1e9 / uElapsedNs) : 0);
+        m_fileWriter.GetStats(pJson);
+        m_retention.GetStats(pJson);
+        if (m_bCaptureAll)
+        {
+            m_flightRecorder.GetStats(pJson);
+        }
+        if (m_uSinkCount != 0)
+        {
+            auto pSinks = pJson->SetArray("sinks");
+            for (uint32_t i = 0; pSinks != nullptr && i < m_uSinkCount; ++i)
+            {
+                auto &sink = m_aSinks[i];
+                auto pSink = pSinks->AppendObject();
+                if (pSink != nullptr)
+                {
+                    pSink->SetString("name", sink.pSink->GetName());
+                    pSink->SetUint32("level", (uint32_t)sink.eLevel);
+                    pSink->SetUint64("write_count", sink.uWriteCount.load(std::memory_order_relaxed));
+                    pSink->SetUint64("write_bytes", sink.uWriteBytes.load(std::memory_order_relaxed));
+                    pSink->SetUint64("drop_count", sink.uDropCount.load(std::memory_order_relaxed));
+                }
+            }
+        }
     }
     return ErrorCode::kSuccess;
 }
@@ -431,43 +1237,436 @@ bool CLoggerImpl::RunWrapper(void *pArg)
     return true;
 }
 
-void CLoggerImpl::Run()
+void CLoggerImpl::Run()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_condition.wait_for(lock, std::chrono::microseconds(10), 
+                             [this] () { return HasPendingLogs(); });
+    }
+
+    auto uCount = DrainQueues(1024);
+    ReapClosedQueues();
+
+    // 限流调用点被抑制的条数每秒输出一次，日志风暴停止后不会再有允许记录的调用来输出
+    uint64_t uNowNs = 0;
+    clock_get_time_nano(uNowNs);
+    if (uNowNs - m_uLimiterFlushNs >= kRateLimiterFlushNs)
+    {
+        m_uLimiterFlushNs = uNowNs;
+        FlushRateLimiters();
+    }
+
+    // 允许生产者直接写入时，文件和输出目标可能被其他线程同时访问
+    std::unique_lock<std::mutex> lock(m_writeLock, std::defer_lock);
+    if (m_bWriteLock)
+    {
+        lock.lock();
+    }
+
+    // 通道已取空或缓冲区中的日志停留超过最长时间时写入文件
+    if (m_fileWriter.HasPendingData())
+    {
+        uint64_t uCurrentTimeNs = 0;
+        clock_get_time_nano(uCurrentTimeNs);
+        if (uCount < 1024 || uCurrentTimeNs - m_fileWriter.GetPendingSinceNs() >= m_uFlushIntervalNs)
+        {
+            m_fileWriter.Flush();
+        }
+    }
+    if (uCount != 0)
+    {
+        FlushSinks();
+    }
+
+    CheckFileSwitch();
+}
+
+CLoggerImpl::ProducerQueue *CLoggerImpl::GetProducerQueue()
+{
+    auto &producerCache = tls_producerCache;
+    if (likely(producerCache.uLoggerId == m_uLoggerId))
+    {
+        return reinterpret_cast<ProducerQueue *>(producerCache.pQueue);
+    }
+    if (unlikely(producerCache.bExited))
+    {
+        return nullptr;
+    }
+
+    auto &holder = tls_queueHolder;
+    auto pQueue = holder.Find(m_uLoggerId);
+    if (pQueue == nullptr)
+    {
+        pQueue = CreateProducerQueue();
+        if (unlikely(pQueue == nullptr))
+        {
+            return nullptr;
+        }
+
+        auto &registry = GetLoggerRegistry();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        try
+        {
+            holder.Add(registry, CProducerQueueHolder::Entry{m_uLoggerId, pQueue});
+        }
+        catch (std::exception &e)
+        {
+            // 队列已经注册，交给日志线程回收
+            pQueue->bClosed.store(true, std::memory_order_release);
+            return nullptr;
+        }
+    }
+
+    producerCache.uLoggerId = m_uLoggerId;
+    producerCache.pQueue = pQueue;
+    return pQueue;
+}
+
+CLoggerImpl::ProducerQueue *CLoggerImpl::CreateProducerQueue()
+{
+    // 所有线程队列的内存总量不超过m_uLogChannelMaxMemMB，超出后本线程的日志按溢出策略处理，
+    // 已退出线程的队列回收后可以再次创建
+    auto uLimitKB = (uint64_t)m_uLogChannelMaxMemMB * 1024;
+    auto uMemKB = m_uQueueMemKB.load(std::memory_order_relaxed);
+    do
+    {
+        if (uMemKB + m_uThreadQueueMemKB > uLimitKB)
+        {
+            m_uQueueRejectCount.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    } while (!m_uQueueMemKB.compare_exchange_weak(uMemKB, uMemKB + m_uThreadQueueMemKB, std::memory_order_relaxed));
+
+    auto pQueue = reinterpret_cast<ProducerQueue *>(m_pAllocator->Malloc(sizeof(ProducerQueue)));
+    if (unlikely(pQueue == nullptr))
+    {
+        m_uQueueMemKB.fetch_sub(m_uThreadQueueMemKB, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    channel::ChannelConfig stConfig;
+    stConfig.uElementSize = 0;
+    stConfig.uMaxElementCount = 0;
+    stConfig.uTotalMemorySizeKB = m_uThreadQueueMemKB;
+    pQueue->pChannel = LogChannel::Create(&stConfig);
+    if (unlikely(pQueue->pChannel == nullptr))
+    {
+        m_pAllocator->Free(pQueue);
+        m_uQueueMemKB.fetch_sub(m_uThreadQueueMemKB, std::memory_order_relaxed);
+        return nullptr;
+    }
+    pQueue->uTid = m_uTid;
+    new (&pQueue->bClosed) std::atomic<bool>(false);
+    new (&pQueue->stats) QueueStats();
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_vecQueues.push_back(pQueue);
+        m_uQueueVersion.fetch_add(1, std::memory_order_release);
+    }
+    catch (std::exception &e)
+    {
+        LogChannel::Destroy(pQueue->pChannel);
+        m_pAllocator->Free(pQueue);
+        m_uQueueMemKB.fetch_sub(m_uThreadQueueMemKB, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    return pQueue;
+}
+
+void CLoggerImpl::DestroyProducerQueue(ProducerQueue *pQueue)
+{
+    // 写出通道中剩余的日志
+    LogItemHeader *pHeader = nullptr;
+    while ((pHeader = reinterpret_cast<LogItemHeader *>(pQueue->pChannel->Get())) != nullptr)
+    {
+        WriteLogItem(pHeader);
+        pQueue->pChannel->Delete(pHeader);
+    }
+    AddQueueStats(m_retiredStats, pQueue->stats);
+    LogChannel::Destroy(pQueue->pChannel);
+    m_pAllocator->Free(pQueue);
+    m_uQueueMemKB.fetch_sub(m_uThreadQueueMemKB, std::memory_order_relaxed);
+}
+
+void CLoggerImpl::PostLogItem(ProducerQueue *pQueue, LogItemHeader *pHeader)
+{
+    // 只有本线程更新，不需要原子的读改写；入队耗时按条采样，避免每条日志多一次取时间
+    auto &stats = pQueue->stats;
+    auto uPostCount = stats.uPostCount.load(std::memory_order_relaxed);
+    stats.uPostCount.store(uPostCount + 1, std::memory_order_relaxed);
+    if ((uPostCount & kEnqueueSampleMask) == 0)
+    {
+        uint64_t uCurrentTimeNs = 0;
+        clock_get_time_nano(uCurrentTimeNs);
+        auto uLatencyNs = uCurrentTimeNs - pHeader->uTimestampNs;
+        stats.uLatencySamples.store(stats.uLatencySamples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        stats.uLatencyTotalNs.store(stats.uLatencyTotalNs.load(std::memory_order_relaxed) + uLatencyNs, std::memory_order_relaxed);
+        if (uLatencyNs > stats.uLatencyMaxNs.load(std::memory_order_relaxed))
+        {
+            stats.uLatencyMaxNs.store(uLatencyNs, std::memory_order_relaxed);
+        }
+    }
+
+    pQueue->pChannel->Post(pHeader);
+    if (pQueue->pChannel->GetSize() == 1)
+    {
+        m_condition.notify_one();
+    }
+}
+
+void CLoggerImpl::WaitFatalWritten(ProducerQueue *pQueue)
+{
+    // FATAL日志之后进程通常马上退出，日志线程写入并同步一条日志之后才从通道中删除，
+    // 通道为空即本线程的全部日志已经落盘；日志线程未运行或在日志线程内调用时无法等待
+    if (!m_bRunning.load(std::memory_order_acquire)
+        || (m_pThread != nullptr && m_pThread->GetThreadId() == (int32_t)m_uTid))
+    {
+        return;
+    }
+
+    m_condition.notify_one();
+    uint64_t uStartNs = 0;
+    clock_get_time_nano(uStartNs);
+    while (!pQueue->pChannel->IsEmpty() && m_bRunning.load(std::memory_order_acquire))
+    {
+        uint64_t uNowNs = 0;
+        clock_get_time_nano(uNowNs);
+        if (uNowNs - uStartNs >= kFatalWaitNs)
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+}
+
+void *CLoggerImpl::NewLogItem(ProducerQueue *pQueue, uint32_t uSize)
+{
+    auto pItem = pQueue->pChannel->New(uSize);
+    if (likely(pItem != nullptr))
+    {
+        return pItem;
+    }
+    return NewLogItemSlow(pQueue, uSize);
+}
+
+void *CLoggerImpl::NewLogItemSlow(ProducerQueue *pQueue, uint32_t uSize)
+{
+    auto &stats = pQueue->stats;
+    if (m_eOverflowPolicy == OverflowPolicy::kInline)
+    {
+        stats.uInlineCount.store(stats.uInlineCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    if (m_eOverflowPolicy == OverflowPolicy::kBlock)
+    {
+        // 唤醒日志线程取出日志，让出CPU等待通道空出位置
+        uint64_t uStartNs = 0;
+        uint64_t uCurrentNs = 0;
+        clock_get_time_nano(uStartNs);
+        m_condition.notify_one();
+        do
+        {
+            std::this_thread::yield();
+            auto pItem = pQueue->pChannel->New(uSize);
+            if (pItem != nullptr)
+            {
+                stats.uBlockCount.store(stats.uBlockCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return pItem;
+            }
+            clock_get_time_nano(uCurrentNs);
+        } while (uCurrentNs - uStartNs < m_uOverflowBlockNs);
+    }
+
+    stats.uDropCount.store(stats.uDropCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void CLoggerImpl::AddQueueStats(QueueStats &total, const QueueStats &stats)
+{
+    total.uPostCount.fetch_add(stats.uPostCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    total.uLatencySamples.fetch_add(stats.uLatencySamples.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    total.uLatencyTotalNs.fetch_add(stats.uLatencyTotalNs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    auto uMaxNs = stats.uLatencyMaxNs.load(std::memory_order_relaxed);
+    if (uMaxNs > total.uLatencyMaxNs.load(std::memory_order_relaxed))
+    {
+        total.uLatencyMaxNs.store(uMaxNs, std::memory_order_relaxed);
+    }
+    total.uDropCount.fetch_add(stats.uDropCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    total.uBlockCount.fetch_add(stats.uBlockCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    total.uInlineCount.fetch_add(stats.uInlineCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void CLoggerImpl::RefreshQueues()
+{
+    auto uVersion = m_uQueueVersion.load(std::memory_order_acquire);
+    if (likely(uVersion == m_uMergeVersion))
+    {
+        return;
+    }
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_vecMergeHeap.reserve(m_vecQueues.size());
+        m_vecMergeQueues = m_vecQueues;
+        m_uMergeVersion = m_uQueueVersion.load(std::memory_order_relaxed);
+    }
+    catch (std::exception &e)
+    {
+        PRINT_ERROR("refresh log queues failed, throw exception: %s", e.what());
+    }
+}
+
+bool CLoggerImpl::HasPendingLogs()
+{
+    RefreshQueues();
+    for (auto pQueue : m_vecMergeQueues)
+    {
+        if (!pQueue->pChannel->IsEmpty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t CLoggerImpl::DrainQueues(uint32_t uMaxCount)
+{
+    RefreshQueues();
+
+    // 各队头按时间戳组成小根堆，每次写出堆顶并补入同一队列的下一条，每条日志只需O(log n)次比较
+    // 各线程内部有序，因此输出整体按时间有序；本轮开始时为空的队列留到下一轮，只会与已写出的日志有很小的乱序
+    auto &vecHeap = m_vecMergeHeap;
+    vecHeap.clear();
+    for (auto pQueue : m_vecMergeQueues)
+    {
+        auto pHeader = reinterpret_cast<LogItemHeader *>(pQueue->pChannel->Get());
+        if (pHeader != nullptr)
+        {
+            vecHeap.push_back(MergeHead{pHeader->uTimestampNs, pQueue, pHeader});
+        }
+    }
+    std::make_heap(vecHeap.begin(), vecHeap.end(), std::greater<MergeHead>());
+
+    uint32_t uCount = 0;
+    while (uCount < uMaxCount && !vecHeap.empty())
+    {
+        std::pop_heap(vecHeap.begin(), vecHeap.end(), std::greater<MergeHead>());
+        auto &head = vecHeap.back();
+        WriteLogItem(head.pHeader);
+        head.pQueue->pChannel->Delete(head.pHeader);
+        ++uCount;
+
+        head.pHeader = reinterpret_cast<LogItemHeader *>(head.pQueue->pChannel->Get());
+        if (head.pHeader != nullptr)
+        {
+            head.uTimestampNs = head.pHeader->uTimestampNs;
+            std::push_heap(vecHeap.begin(), vecHeap.end(), std::greater<MergeHead>());
+        }
+        else
+        {
+            vecHeap.pop_back();
+        }
+    }
+    return uCount;
+}
+
+void CLoggerImpl::WriteLogItem(LogItemHeader *pHeader)
+{
+    // 只有日志线程更新，记录从生产者取时间戳到开始写入的延迟
+    uint64_t uCurrentTimeNs = 0;
+    clock_get_time_nano(uCurrentTimeNs);
+    auto uLatencyNs = uCurrentTimeNs > pHeader->uTimestampNs ? uCurrentTimeNs - pHeader->uTimestampNs : 0;
+    m_uWriteLatencyCount.store(m_uWriteLatencyCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_uWriteLatencyTotalNs.store(m_uWriteLatencyTotalNs.load(std::memory_order_relaxed) + uLatencyNs, std::memory_order_relaxed);
+    if (uLatencyNs > m_uWriteLatencyMaxNs.load(std::memory_order_relaxed))
+    {
+        m_uWriteLatencyMaxNs.store(uLatencyNs, std::memory_order_relaxed);
+    }
+    m_uWriteLines.fetch_add(1, std::memory_order_relaxed);
+
+    if (pHeader->eType == LogItemType::kLog)
+    {
+        auto pLogItem = reinterpret_cast<LogItem *>(pHeader);
+        m_bBinary ? WriteBinaryLog(*pLogItem) : WriteLog(*pLogItem);
+        SyncFatalLog(pLogItem->eLevel);
+    }
+    else if (pHeader->eType == LogItemType::kLogArgs)
+    {
+        auto pLogArgsItem = reinterpret_cast<LogArgsItem *>(pHeader);
+        m_bBinary ? WriteBinaryLog(*pLogArgsItem) : WriteLog(*pLogArgsItem);
+        SyncFatalLog(pLogArgsItem->eLevel);
+    }
+    else if (pHeader->eType == LogItemType::kLogFormat)
+    {
+        auto pLogForamtItem = reinterpret_cast<LogForamtItem *>(pHeader);
+        if (m_bBinary)
+        {
+            WriteBinaryText(pLogForamtItem->eLevel, pLogForamtItem->bFile, pLogForamtItem->uTid, pHeader->uTimestampNs,
+                            pLogForamtItem->pLogBuffer, pLogForamtItem->uWriteLen);
+        }
+        else
+        {
+            OutputLog(pLogForamtItem->eLevel, pLogForamtItem->bFile, pLogForamtItem->pLogBuffer, pLogForamtItem->uWriteLen);
+        }
+        SyncFatalLog(pLogForamtItem->eLevel);
+    }
+}
+
+void CLoggerImpl::ReapClosedQueues()
+{
+    // 只有日志线程会删除队列，线程已退出且队列已空时不会再有新的日志
+    bool bReaped = false;
+    for (auto pQueue : m_vecMergeQueues)
+    {
+        if (pQueue->bClosed.load(std::memory_order_acquire) && pQueue->pChannel->IsEmpty())
+        {
+            std::lock_guard<std::mutex> lock(m_queueLock);
+            m_vecQueues.erase(std::find(m_vecQueues.begin(), m_vecQueues.end(), pQueue));
+            m_uQueueVersion.fetch_add(1, std::memory_order_release);
+            DestroyProducerQueue(pQueue);
+            bReaped = true;
+        }
+    }
+
+    if (bReaped)
+    {
+        RefreshQueues();
+    }
+}
+
+int32_t CLoggerImpl::WriteLog(LogItem &logItem)
 {
+    uint32_t uWriteLen = 0;
+    auto pLogBuffer = FormatLog(logItem, uWriteLen);
+    if (unlikely(pLogBuffer == nullptr))
     {
-        std::unique_lock<std::mutex> lock(m_lock);
-        m_condition.wait_for(lock, std::chrono::microseconds(10), 
-                             [this] () { return m_pChannel->GetSize() > 0; });
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
     }
+    return OutputLog(logItem.eLevel, logItem.bFile, pLogBuffer, uWriteLen);
+}
 
-    auto pHeader = reinterpret_cast<LogItemHeader *>(m_pChannel->Get());
-    if (unlikely(pHeader != nullptr))
+int32_t CLoggerImpl::WriteLog(LogArgsItem &logArgsItem)
+{
+    uint32_t uWriteLen = 0;
+    auto pLogBuffer = FormatLog(logArgsItem, uWriteLen);
+    if (unlikely(pLogBuffer == nullptr))
     {
-        if (pHeader->eType == LogItemType::kLog)
-        {
-            auto pLogItem = reinterpret_cast<LogItem *>(pHeader);
-            WriteLog(*pLogItem);
-            for (uint32_t i = 0; i < pLogItem->uParamCount; ++i)
-            {
-                m_pAllocator->Free(pLogItem->ppParams[i]);
-            }
-            m_pAllocator->Free(pLogItem->ppParams);
-        }
-        else if (pHeader->eType == LogItemType::kLogFormat)
-        {
-            auto pLogForamtItem = reinterpret_cast<LogForamtItem *>(pHeader);
-            WriteLog(pLogForamtItem->pLogBuffer, pLogForamtItem->uWriteLen);
-            m_pAllocator->Free(pLogForamtItem->pLogBuffer);
-        }
-        m_pAllocator->Free(pHeader);
-        m_pChannel->Delete(pHeader);
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
     }
-
-    CheckFileSwitch();
+    return OutputLog(logArgsItem.eLevel, logArgsItem.bFile, pLogBuffer, uWriteLen);
 }
 
-int32_t CLoggerImpl::WriteLog(LogItem &logItem)
+char *CLoggerImpl::FormatLog(const LogItem &logItem, uint32_t &uLen)
 {
-    uint64_t uLogFormatBufferSize = 64; //YYYYMMDD-HHMMSS.uuuuuu PID TID ERROR_CODE LEVEL 
+    uint64_t uLogFormatBufferSize = 128 + logItem.uParamCount; //YYYYMMDD-HHMMSS.uuuuuu PID TID ERROR_CODE LEVEL [MODULE] (,)\n 
     uLogFormatBufferSize += strlen(logItem.pModule);
     uLogFormatBufferSize += strlen(logItem.pFileLine);
     uLogFormatBufferSize += strlen(logItem.pFunction);
@@ -477,33 +1676,18 @@ int32_t CLoggerImpl::WriteLog(LogItem &logItem)
         uLogFormatBufferSize += strlen(logItem.ppParams[i]);
     }
 
-    auto pLogBuffer = (char *)m_pAllocator->Malloc(uLogFormatBufferSize);
+    auto pLogBuffer = tls_formatBuffer.Reserve(uLogFormatBufferSize);
     if (unlikely(pLogBuffer == nullptr))
     {
-        SetLastError(ErrorCode::kOutOfMemory);
-        return ErrorCode::kOutOfMemory;
-    }
-
-    uint64_t uCurrentTimeNs = 0;
-    clock_get_time_nano(uCurrentTimeNs);
-    auto time = ITime::GetLocalTime();
-    time -= (uCurrentTimeNs - logItem.uTimestampNs) / kSecond; // 计算时间差，转换成秒，会不会不准？影响不大
-    auto iLen = snprintf(pLogBuffer, uLogFormatBufferSize, 
-                         "%04d%02d%02d-%02d:%02d:%02d.%06d %u %u %d %s [%s] ",
-                         time.uYear, time.uMonth, time.uDay, time.uHour, time.uMinute, time.uSecond, time.uMicro, 
-                         m_uPid, m_uTid, logItem.iErrorNo, LogLevelToString(logItem.eLevel), logItem.pModule);
-    if (unlikely(iLen < 0))
-    {
-        m_pAllocator->Free(pLogBuffer);
-        SetLastError(ErrorCode::kSystemError);
-        return ErrorCode::kSystemError;
+        return nullptr;
     }
 
-    uint32_t uLogBufferIndex = iLen;
+    uint32_t uLogBufferIndex = FormatPrefix(pLogBuffer, logItem.header.uTimestampNs, logItem.uTid,
+                                            logItem.iErrorNo, logItem.eLevel, logItem.pModule);
     uint32_t uParamIndex = 0;
     for (uint32_t i = 0; logItem.pFormat[i] != '\0'; ++i)
     {
-        if (logItem.pFormat[i] == '{' && logItem.pFormat[i+1] == '}')
+        if (logItem.pFormat[i] == '{' && logItem.pFormat[i+1] == '}' && uParamIndex < logItem.uParamCount)
         {
             auto iParamLen = snprintf(pLogBuffer + uLogBufferIndex, uLogFormatBufferSize - uLogBufferIndex, 
                                            "%s", logItem.ppParams[uParamIndex]);
@@ -542,13 +1726,447 @@ int32_t CLoggerImpl::WriteLog(LogItem &logItem)
     pLogBuffer[uLogBufferIndex] = '\n';
     uLogBufferIndex++;
 
-    return WriteLog(pLogBuffer, uLogBufferIndex);
+    uLen = uLogBufferIndex;
+    return pLogBuffer;
+}
+
+char *CLoggerImpl::FormatLog(const LogArgsItem &logArgsItem, uint32_t &uLen)
+{
+    auto pSite = logArgsItem.pSite;
+    if (pSite->ppKeys != nullptr)
+    {
+        return FormatKvLog(logArgsItem, uLen);
+    }
+    uint64_t uLogFormatBufferSize = 128; //YYYYMMDD-HHMMSS.uuuuuu PID TID ERROR_CODE LEVEL [MODULE] (,)\n 
+    uLogFormatBufferSize += strlen(pSite->pModule);
+    uLogFormatBufferSize += strlen(pSite->pFileLine);
+    uLogFormatBufferSize += strlen(pSite->pFunction);
+    uLogFormatBufferSize += pSite->uFormatLen;
+    for (uint32_t i = 0; i < logArgsItem.uArgCount; ++i)
+    {
+        uLogFormatBufferSize += LogArgTextSize(logArgsItem.pArgs[i]);
+    }
+
+    auto pLogBuffer = tls_formatBuffer.Reserve(uLogFormatBufferSize);
+    if (unlikely(pLogBuffer == nullptr))
+    {
+        return nullptr;
+    }
+
+    uint32_t uLogBufferIndex = FormatPrefix(pLogBuffer, logArgsItem.header.uTimestampNs, logArgsItem.uTid,
+                                            logArgsItem.iErrorNo, logArgsItem.eLevel, pSite->pModule);
+
+    // 常量片段在编译期已经切分好，不再扫描格式串
+    for (uint32_t i = 0; i <= logArgsItem.uArgCount; ++i)
+    {
+        auto &segment = pSite->pSegments[i];
+        memcpy(pLogBuffer + uLogBufferIndex, pSite->pFormat + segment.uOffset, segment.uLength);
+        uLogBufferIndex += segment.uLength;
+        if (i < logArgsItem.uArgCount)
+        {
+            uLogBufferIndex += FormatLogArg(logArgsItem.pArgs[i], pLogBuffer + uLogBufferIndex);
+        }
+    }
+
+    auto iFileLineLen = snprintf(pLogBuffer + uLogBufferIndex, uLogFormatBufferSize - uLogBufferIndex, "(%s,%s)", pSite->pFileLine, pSite->pFunction);
+    if (likely(iFileLineLen > 0))
+    {
+        uLogBufferIndex += (uint32_t)iFileLineLen;
+    }
+
+    pLogBuffer[uLogBufferIndex] = '\n';
+    uLogBufferIndex++;
+
+    uLen = uLogBufferIndex;
+    return pLogBuffer;
+}
+
+char *CLoggerImpl::FormatKvLog(const LogArgsItem &logArgsItem, uint32_t &uLen)
+{
+    // 每个字段都以"键=值"或"键":值输出，不需要正则即可解析
+    auto pSite = logArgsItem.pSite;
+    uint64_t uLogFormatBufferSize = 192 + 2 * kLogArgTextSize + strlen(pSite->pFileLine) + strlen(pSite->pFunction);
+    uLogFormatBufferSize += 6 * (strlen(pSite->pModule) + strlen(pSite->ppKeys[0]));
+    for (uint32_t i = 0; i < logArgsItem.uArgCount; ++i)
+    {
+        uLogFormatBufferSize += 6 * (strlen(pSite->ppKeys[i + 1]) + LogArgTextSize(logArgsItem.pArgs[i])) + 8;
+    }
+
+    auto pLogBuffer = tls_formatBuffer.Reserve(uLogFormatBufferSize);
+    if (unlikely(pLogBuffer == nullptr))
+    {
+        return nullptr;
+    }
+
+    auto bJson = m_bKvJson;
+    auto pCursor = pLogBuffer;
+    auto appendKey = [&pCursor, bJson](const char *pKey, bool bFirst) {
+        if (!bFirst)
+        {
+            *pCursor++ = bJson ? ',' : ' ';
+        }
+        pCursor += bJson ? FormatKvString(pKey, (uint32_t)strlen(pKey), true, pCursor)
+                         : (uint32_t)(stpcpy(pCursor, pKey) - pCursor);
+        *pCursor++ = bJson ? ':' : '=';
+    };
+    auto appendString = [&pCursor, bJson](const char *pValue, uint32_t uLength) {
+        pCursor += FormatKvString(pValue, uLength, bJson, pCursor);
+    };
+
+    if (bJson)
+    {
+        *pCursor++ = '{';
+    }
+    char szTime[CLogTimeFormatter::kTimeLen];
+    appendKey("time", true);
+    appendString(szTime, tls_timeFormatter.Format(szTime, logArgsItem.header.uTimestampNs));
+    appendKey("pid", false);
+    pCursor += FormatUint32(pCursor, m_uPid);
+    appendKey("tid", false);
+    pCursor += FormatUint32(pCursor, logArgsItem.uTid);
+    appendKey("errno", false);
+    pCursor += FormatInt32(pCursor, logArgsItem.iErrorNo);
+    appendKey("level", false);
+    auto pLevel = LogLevelToString(logArgsItem.eLevel);
+    while (*pLevel == ' ')
+    {
+        ++pLevel;
+    }
+    appendString(pLevel, (uint32_t)strlen(pLevel));
+    appendKey("module", false);
+    appendString(pSite->pModule, (uint32_t)strlen(pSite->pModule));
+    appendKey("event", false);
+    appendString(pSite->ppKeys[0], (uint32_t)strlen(pSite->ppKeys[0]));
+    for (uint32_t i = 0; i < logArgsItem.uArgCount; ++i)
+    {
+        appendKey(pSite->ppKeys[i + 1], false);
+        pCursor += FormatKvValue(logArgsItem.pArgs[i], bJson, pCursor);
+    }
+    appendKey("pos", false);
+    appendString(pSite->pFileLine, (uint32_t)strlen(pSite->pFileLine));
+    appendKey("func", false);
+    appendString(pSite->pFunction, (uint32_t)strlen(pSite->pFunction));
+    if (bJson)
+    {
+        *pCursor++ = '}';
+    }
+    *pCursor++ = '\n';
+
+    uLen = uint32_t(pCursor - pLogBuffer);
+    return pLogBuffer;
+}
+
+uint32_t CLoggerImpl::FormatPrefix(char *pLogBuffer, uint64_t uTimestampNs, uint32_t uTid,
+                                   int32_t iErrorNo, LogLevel eLevel, const char *pModule)
+{
+    // 按日志记录时的时间戳格式化，而不是写入文件时的时间
+    auto pCursor = pLogBuffer;
+    pCursor += tls_timeFormatter.Format(pCursor, uTimestampNs);
+    *pCursor++ = ' ';
+    pCursor += FormatUint32(pCursor, m_uPid);
+    *pCursor++ = ' ';
+    pCursor += FormatUint32(pCursor, uTid);
+    *pCursor++ = ' ';
+    pCursor += FormatInt32(pCursor, iErrorNo);
+    *pCursor++ = ' ';
+    memcpy(pCursor, LogLevelToString(eLevel), 5);
+    pCursor += 5;
+    *pCursor++ = ' ';
+    if (pModule != nullptr)
+    {
+        auto uModuleLen = strlen(pModule);
+        *pCursor++ = '[';
+        memcpy(pCursor, pModule, uModuleLen);
+        pCursor += uModuleLen;
+        *pCursor++ = ']';
+        *pCursor++ = ' ';
+    }
+    return uint32_t(pCursor - pLogBuffer);
+}
+
+int32_t CLoggerImpl::OutputLog(LogLevel eLevel, bool bFile, const char *pLogBuffer, uint32_t uWriteLen)
+{
+    // 所有输出目标共享同一份格式化结果
+    WriteSinks(eLevel, pLogBuffer, uWriteLen);
+    if (!bFile)
+    {
+        return ErrorCode::kSuccess;
+    }
+    return WriteLog(pLogBuffer, uWriteLen);
+}
+
+void CLoggerImpl::WriteSinks(LogLevel eLevel, const char *pLogBuffer, uint32_t uWriteLen)
+{
+    if (likely(!SinkAccepts(eLevel)))
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_writeLock, std::defer_lock);
+    if (m_bWriteLock)
+    {
+        lock.lock();
+    }
+    for (uint32_t i = 0; i < m_uSinkCount; ++i)
+    {
+        auto &sink = m_aSinks[i];
+        if (eLevel < sink.eLevel)
+        {
+            continue;
+        }
+        if (likely(sink.pSink->Write(eLevel, pLogBuffer, uWriteLen) == ErrorCode::kSuccess))
+        {
+            sink.uWriteCount.fetch_add(1, std::memory_order_relaxed);
+            sink.uWriteBytes.fetch_add(uWriteLen, std::memory_order_relaxed);
+        }
+        else
+        {
+            sink.uDropCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void CLoggerImpl::FlushSinks()
+{
+    for (uint32_t i = 0; i < m_uSinkCount; ++i)
+    {
+        m_aSinks[i].pSink->Flush();
+    }
 }
 
 int32_t CLoggerImpl::WriteLog(const char *pLogBuffer, uint32_t uWriteLen)
+{
+    std::unique_lock<std::mutex> lock(m_writeLock, std::defer_lock);
+    if (m_bWriteLock)
+    {
+        lock.lock();
+    }
+
+    auto iErrorNo = PrepareLogFile();
+    if (unlikely(iErrorNo != ErrorCode::kSuccess))
+    {
+        return iErrorNo;
+    }
+    return AppendLogFile(pLogBuffer, uWriteLen);
+}
+
+static void FillRecordHeader(binary::RecordHeader &header, binary::RecordType eType, uint32_t uLength)
+{
+    header.uMagic = binary::kRecordMagic;
+    header.uType = (uint16_t)eType;
+    header.uVersion = binary::kVersion;
+    header.uLength = uLength;
+    header.uReserved = 0;
+}
+
+int32_t CLoggerImpl::WriteBinaryLog(LogItem &logItem)
+{
+    // 输出目标接收文本，只有需要时才格式化
+    if (SinkAccepts(logItem.eLevel))
+    {
+        uint32_t uWriteLen = 0;
+        auto pLogBuffer = FormatLog(logItem, uWriteLen);
+        if (likely(pLogBuffer != nullptr))
+        {
+            WriteSinks(logItem.eLevel, pLogBuffer, uWriteLen);
+        }
+    }
+    if (!logItem.bFile)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    std::unique_lock<std::mutex> lock(m_writeLock, std::defer_lock);
+    if (m_bWriteLock)
+    {
+        lock.lock();
+    }
+
+    // 先切换文件，保证格式串记录和日志记录写入同一个文件
+    auto iErrorNo = PrepareLogFile();
+    if (unlikely(iErrorNo != ErrorCode::kSuccess))
+    {
+        return iErrorNo;
+    }
+
+    auto uFormatId = RegisterFormat(logItem);
+    if (unlikely(uFormatId == 0))
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    uint32_t uParamCount = std::min(logItem.uParamCount, (uint32_t)UINT16_MAX);
+    uint64_t uRecordLen = sizeof(binary::LogRecord) + uParamCount * sizeof(uint32_t);
+    for (uint32_t i = 0; i < uParamCount; ++i)
+    {
+        uRecordLen += strlen(logItem.ppParams[i]);
+    }
+
+    auto pRecordBuffer = uRecordLen <= UINT32_MAX ? tls_recordBuffer.Reserve(uRecordLen) : nullptr;
+    if (unlikely(pRecordBuffer == nullptr))
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    auto pRecord = reinterpret_cast<binary::LogRecord *>(pRecordBuffer);
+    FillRecordHeader(pRecord->header, binary::RecordType::kLog, (uint32_t)uRecordLen);
+    pRecord->uTimestampNs = logItem.header.uTimestampNs;
+    pRecord->uFormatId = uFormatId;
+    pRecord->uTid = logItem.uTid;
+    pRecord->iErrorNo = logItem.iErrorNo;
+    pRecord->uLevel = (uint8_t)logItem.eLevel;
+    pRecord->uReserved = 0;
+    pRecord->uParamCount = (uint16_t)uParamCount;
+
+    auto puParamLen = reinterpret_cast<uint32_t *>(pRecord + 1);
+    auto pParam = reinterpret_cast<char *>(puParamLen + uParamCount);
+    for (uint32_t i = 0; i < uParamCount; ++i)
+    {
+        uint32_t uParamLen = (uint32_t)strlen(logItem.ppParams[i]);
+        memcpy(pParam, logItem.ppParams[i], uParamLen);
+        puParamLen[i] = uParamLen;
+        pParam += uParamLen;
+    }
+
+    return AppendLogFile(pRecordBuffer, (uint32_t)uRecordLen);
+}
+
+int32_t CLoggerImpl::WriteBinaryLog(LogArgsItem &logArgsItem)
+{
+    // 二进制记录只保存参数内容，在日志线程把参数转换为字符串，格式串仍由cppx_logcat替换
+    auto uArgCount = logArgsItem.uArgCount;
+    auto ppParams = ConvertLogArgs(logArgsItem.pArgs, uArgCount);
+    if (unlikely(ppParams == nullptr))
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    auto pSite = logArgsItem.pSite;
+    LogItem logItem;
+    logItem.header = logArgsItem.header;
+    logItem.iErrorNo = logArgsItem.iErrorNo;
+    logItem.eLevel = logArgsItem.eLevel;
+    logItem.bFile = logArgsItem.bFile;
+    logItem.uTid = logArgsItem.uTid;
+    logItem.uParamCount = uArgCount;
+    logItem.pModule = pSite->pModule;
+    logItem.pFileLine = pSite->pFileLine;
+    logItem.pFunction = pSite->pFunction;
+    logItem.pFormat = pSite->pFormat;
+    logItem.ppParams = ppParams;
+    return WriteBinaryLog(logItem);
+}
+
+int32_t CLoggerImpl::WriteBinaryText(LogLevel eLevel, bool bFile, uint32_t uTid, uint64_t uTimestampNs,
+                                     const char *pLogBuffer, uint32_t uWriteLen)
+{
+    WriteSinks(eLevel, pLogBuffer, uWriteLen);
+    if (!bFile)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    uint64_t uRecordLen = sizeof(binary::TextRecord) + uWriteLen;
+    auto pRecordBuffer = tls_recordBuffer.Reserve(uRecordLen);
+    if (unlikely(pRecordBuffer == nullptr))
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    auto pRecord = reinterpret_cast<binary::TextRecord *>(pRecordBuffer);
+    memset(pRecord, 0, sizeof(binary::TextRecord));
+    FillRecordHeader(pRecord->header, binary::RecordType::kText, (uint32_t)uRecordLen);
+    pRecord->uTimestampNs = uTimestampNs;
+    pRecord->uTid = uTid;
+    pRecord->uLevel = (uint8_t)eLevel;
+    pRecord->uTextLen = uWriteLen;
+    memcpy(pRecord + 1, pLogBuffer, uWriteLen);
+
+    return WriteLog(pRecordBuffer, (uint32_t)uRecordLen);
+}
+
+uint32_t CLoggerImpl::RegisterFormat(const LogItem &logItem)
+{
+    FormatKey key {logItem.pFileLine, logItem.pFormat};
+    auto it = m_mapFormatIds.find(key);
+    if (likely(it != m_mapFormatIds.end()))
+    {
+        return it->second;
+    }
+
+    uint16_t uModuleLen = (uint16_t)std::min(strlen(logItem.pModule), (size_t)UINT16_MAX);
+    uint16_t uFileLineLen = (uint16_t)std::min(strlen(logItem.pFileLine), (size_t)UINT16_MAX);
+    uint16_t uFunctionLen = (uint16_t)std::min(strlen(logItem.pFunction), (size_t)UINT16_MAX);
+    uint32_t uFormatLen = (uint32_t)strlen(logItem.pFormat);
+    uint64_t uRecordLen = sizeof(binary::FormatRecord) + uModuleLen + uFileLineLen + uFunctionLen + uFormatLen;
+
+    // 和日志记录共用缓冲区，此时日志记录还未序列化
+    auto pRecordBuffer = tls_recordBuffer.Reserve(uRecordLen);
+    if (unlikely(pRecordBuffer == nullptr))
+    {
+        return 0;
+    }
+
+    uint32_t uFormatId = (uint32_t)m_mapFormatIds.size() + 1;
+    auto pRecord = reinterpret_cast<binary::FormatRecord *>(pRecordBuffer);
+    FillRecordHeader(pRecord->header, binary::RecordType::kFormat, (uint32_t)uRecordLen);
+    pRecord->uFormatId = uFormatId;
+    pRecord->uModuleLen = uModuleLen;
+    pRecord->uFileLineLen = uFileLineLen;
+    pRecord->uFunctionLen = uFunctionLen;
+    pRecord->uReserved = 0;
+    pRecord->uFormatLen = uFormatLen;
+
+    auto pCursor = reinterpret_cast<char *>(pRecord + 1);
+    memcpy(pCursor, logItem.pModule, uModuleLen);
+    pCursor += uModuleLen;
+    memcpy(pCursor, logItem.pFileLine, uFileLineLen);
+    pCursor += uFileLineLen;
+    memcpy(pCursor, logItem.pFunction, uFunctionLen);
+    pCursor += uFunctionLen;
+    memcpy(pCursor, logItem.pFormat, uFormatLen);
+
+    try
+    {
+        m_mapFormatIds.emplace(key, uFormatId);
+    }
+    catch (std::exception &e)
+    {
+        PRINT_ERROR("register log format failed, throw exception: %s", e.what());
+        return 0;
+    }
+
+    if (unlikely(AppendLogFile(pRecordBuffer, (uint32_t)uRecordLen) != ErrorCode::kSuccess))
+    {
+        m_mapFormatIds.erase(key);
+        return 0;
+    }
+    return uFormatId;
+}
+
+int32_t CLoggerImpl::WriteSessionRecord()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t uMonotonicNs = 0;
+    clock_get_time_nano(uMonotonicNs);
+
+    binary::SessionRecord record;
+    memset(&record, 0, sizeof(record));
+    FillRecordHeader(record.header, binary::RecordType::kSession, sizeof(record));
+    record.uPid = m_uPid;
+    record.iRealtimeOffsetNs = (int64_t)(ts.tv_sec * kSecond + ts.tv_nsec) - (int64_t)uMonotonicNs;
+    return AppendLogFile(&record, sizeof(record));
+}
+
+int32_t CLoggerImpl::PrepareLogFile()
 {
     // 如果文件为空或者文件大小超过限制，则打开新文件
-    if (unlikely(m_pLogFile == nullptr || m_uLogFileSize >= m_uLogFileMaxSizeMB * 1024 * 1024))
+    if (unlikely(!m_fileWriter.IsOpen() || m_uLogFileSize >= m_uLogFileMaxSizeMB * 1024 * 1024))
     {
         if (unlikely(OpenLogFile() != ErrorCode::kSuccess))
         {
@@ -556,25 +2174,39 @@ int32_t CLoggerImpl::WriteLog(const char *pLogBuffer, uint32_t uWriteLen)
             return ErrorCode::kSystemError;
         }
     }
+    return ErrorCode::kSuccess;
+}
 
-    auto iRet = fwrite(pLogBuffer, 1, uWriteLen, m_pLogFile);
-    if (unlikely(iRet == size_t(-1)))
+int32_t CLoggerImpl::AppendLogFile(const void *pData, uint32_t uLen)
+{
+    auto iErrorNo = m_fileWriter.Write(pData, uLen);
+    if (unlikely(iErrorNo != ErrorCode::kSuccess))
     {
-        PRINT_ERROR("write log failed, write log file failed %s", "");
-        SetLastError(ErrorCode::kSystemError);
-        return ErrorCode::kSystemError;
+        return iErrorNo;
     }
-    fflush(m_pLogFile);
-    m_uLogFileSize += (uint64_t)iRet;
+    m_uLogFileSize += uLen;
+    m_uWriteBytes.fetch_add(uLen, std::memory_order_relaxed);
     return ErrorCode::kSuccess;
 }
 
+void CLoggerImpl::SyncFatalLog(LogLevel eLevel)
+{
+    if (unlikely(eLevel == LogLevel::kFatal))
+    {
+        std::unique_lock<std::mutex> lock(m_writeLock, std::defer_lock);
+        if (m_bWriteLock)
+        {
+            lock.lock();
+        }
+        m_fileWriter.Sync();
+    }
+}
+
 int32_t CLoggerImpl::OpenLogFile()
 {
-    if (m_pLogFile != nullptr)
+    if (m_fileWriter.IsOpen())
     {
-        fclose(m_pLogFile);
-        m_pLogFile = nullptr;
+        m_fileWriter.Close();
         m_uLogFileSize = 0;
 
         // 重命名文件
@@ -588,76 +2220,63 @@ int32_t CLoggerImpl::OpenLogFile()
         if (std::filesystem::exists(m_szLogFileName))
         {
             std::filesystem::rename(m_szLogFileName, szLogFileName);
+            m_retention.AddFile(szLogFileName);
         }
     }
 
     snprintf(m_szLogFileName, sizeof(m_szLogFileName), "%s/%s%s", 
              m_strLogPath.c_str(), m_strLoggerName.c_str(), m_strLogSuffix.c_str());
     // 如果文件存在，则以追加方式打开，否则创建文件
-    m_pLogFile = fopen(m_szLogFileName, "a");
-    if (unlikely(m_pLogFile == nullptr))
+    if (unlikely(m_fileWriter.Open(m_szLogFileName) != ErrorCode::kSuccess))
     {
-        PRINT_ERROR("open log file failed, open log file failed: %s", strerror(errno));
+        PRINT_ERROR("open log file failed, open log file failed: %s", m_szLogFileName);
         SetLastError(ErrorCode::kSystemError);
         return ErrorCode::kSystemError;
     }
 
+    // 格式串ID只在当前文件内有效，新文件需要重新注册
+    if (m_bBinary)
+    {
+        m_mapFormatIds.clear();
+        return WriteSessionRecord();
+    }
+
     return ErrorCode::kSuccess;
 }
 
-void CLoggerImpl::CheckFileSwitch()
+bool CLoggerImpl::FileAccepts(LogLevel eLevel, const char *pModule) const
 {
-    if (m_uLogFileSize >= m_uLogFileMaxSizeMB * 1024 * 1024)
+    if (likely(m_uSinkCount == 0 && !m_bCaptureAll))
     {
-        fclose(m_pLogFile);
-        m_pLogFile = nullptr;
-        m_uLogFileSize = 0;
-        if (unlikely(OpenLogFile() != ErrorCode::kSuccess))
-        {
-            PRINT_ERROR("check file switch failed, open log file failed %s", "");
-            return;
-        }
+        return true;
     }
-
-    uint64_t uCurrentTimeNs = 0;
-    clock_get_time_nano(uCurrentTimeNs);
-    if (uCurrentTimeNs - m_uLastCheckTimeNs < kSecond * 60 * 10) // 10分钟检查一次
+    if (likely(m_uModuleLevelCount.load(std::memory_order_relaxed) == 0 || pModule == nullptr))
     {
-        return;
+        return eLevel >= m_eLogLevel;
     }
-    m_uLastCheckTimeNs = uCurrentTimeNs;
-    std::map<std::string, uint64_t> mapFileNames;
-    uint64_t uTotalSize = 0;
-    for (const auto &entry : std::filesystem::directory_iterator(m_strLogPath))
-    {
-        auto strFileName = entry.path().filename().string();
-        if (strFileName == m_szLogFileName 
-            || strFileName.find_first_of(m_strLogPrefix) != 0 
-            || strFileName.find_last_of(m_strLogSuffix) != strFileName.size() - m_strLogSuffix.size())
-        {
-            continue;
-        }
+    // 通过Log接口传入的模块名可能是临时缓冲区，只查找不注册，未注册的模块按日志级别判断
+    return eLevel >= GetModuleLogLevel(FindModuleId(GetModuleRegistry(), pModule));
+}
 
-        auto uFileSize = std::filesystem::file_size(entry.path());
-        uTotalSize += uFileSize;
-        mapFileNames.emplace(std::move(strFileName), uFileSize);
+bool CLoggerImpl::FlightRecordOnly(LogLevel eLevel, bool bFile)
+{
+    if (unlikely(eLevel == LogLevel::kFatal))
+    {
+        m_flightRecorder.Dump();
     }
+    return !bFile && !SinkAccepts(eLevel);
+}
 
-    // 如果总大小超过限制，则删除最早的文件
-    while (uTotalSize > m_uLogTotalSizeMB * 1024 * 1024)
+void CLoggerImpl::CheckFileSwitch()
+{
+    // 切换时关闭、重命名当前文件并记录到保留索引，超出总大小的文件由清理线程删除
+    if (m_uLogFileSize >= m_uLogFileMaxSizeMB * 1024 * 1024)
     {
-        // map会将文件按名称排序，因此时间越早的文件在前面
-        auto it = mapFileNames.begin();
-        if (it == mapFileNames.end())
+        if (unlikely(OpenLogFile() != ErrorCode::kSuccess))
         {
-            break;
+            PRINT_ERROR("check file switch failed, open log file failed %s", "");
+            return;
         }
-        auto &strFileName = it->first;
-        auto &uFileSize = it->second;
-        uTotalSize -= uFileSize;
-        mapFileNames.erase(it);
-        auto strFilePath = m_strLogPath + "/" + strFileName;
-        std::filesystem::remove(strFilePath);
     }
 }
 
@@ -2,12 +2,21 @@
 #define __CPPX_LOGGER_IMPL_H__
 
 #include <logger/logger.h>
+#include <logger/log_binary.h>
+#include <logger/log_sink.h>
+#include "log_file_writer.h"
+#include "log_flight_recorder.h"
+#include "log_retention.h"
 #include <thread/thread_manager.h>
 #include <channel/channel.h>
 #include <memory/allocator_ex.h>
-#include <thread/spin_lock.h>
+#include <utilities/common.h>
+#include <atomic>
 #include <condition_variable>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace cppx
 {
@@ -18,41 +27,131 @@ namespace logger
 
 class CLoggerImpl final : public ILogger
 {
-    using LogChannel = channel::SPSCFixedBoundedChannel;
+    using LogChannel = channel::SPSCVariableBoundedChannel;
 public:
     enum class LogItemType : uint8_t
     {
         kLog,
         kLogFormat,
+        kLogArgs,
     };
 
     struct LogItemHeader
     {
         LogItemType eType;
+        uint64_t uTimestampNs; // 日志线程按该时间戳归并各线程的日志
     };
 
+    // 异步模式下格式化后的日志内容紧跟在结构体之后，和结构体位于同一个通道元素中
     struct LogForamtItem
     {
         LogItemHeader header;
+        LogLevel eLevel;
+        bool bFile; // 是否写入日志文件，由生产者按模块级别判断
+        uint32_t uTid;
         uint32_t uWriteLen;
         const char *pLogBuffer;
     };
 
+    // 异步模式下一条日志序列化为通道中的一段连续内存：LogItem、参数指针数组、各参数内容，
+    // 参数指针指向同一段内存，因此日志线程可以直接使用，写出后随通道元素一起释放
     struct LogItem
     {
         LogItemHeader header;
         int32_t iErrorNo;
         LogLevel eLevel;
+        bool bFile;
         uint32_t uTid;
         uint32_t uParamCount;
-        uint64_t uTimestampNs;
         const char *pModule;
         const char *pFileLine;
         const char *pFunction;
         const char *pFormat;
         char **ppParams;
+    };
 
-        void CopyParams(memory::IAllocator *pAllocator, const char **ppParams, uint32_t uParamCount);
+    // 异步模式下参数数组和字符串参数的内容紧跟在结构体之后，字符串参数指向同一段内存并以'\0'结尾
+    struct LogArgsItem
+    {
+        LogItemHeader header;
+        int32_t iErrorNo;
+        LogLevel eLevel;
+        bool bFile;
+        uint32_t uTid;
+        uint32_t uArgCount;
+        const LogSite *pSite;
+        LogArg *pArgs;
+    };
+
+    // 通道已满时的处理方式，取值见config::kLogOverflowPolicy
+    enum class OverflowPolicy : uint32_t
+    {
+        kDrop = 0,   // 丢弃并计数
+        kBlock,      // 等待日志线程取出，超时后丢弃
+        kInline,     // 在当前线程直接写入文件
+    };
+
+    // 生产者侧统计，只由所属线程更新，队列销毁时累加到m_retiredStats
+    struct QueueStats
+    {
+        std::atomic<uint64_t> uPostCount {0};
+        std::atomic<uint64_t> uLatencySamples {0}; // 每kEnqueueSampleMask+1条采样一次入队耗时
+        std::atomic<uint64_t> uLatencyTotalNs {0};
+        std::atomic<uint64_t> uLatencyMaxNs {0};
+        std::atomic<uint64_t> uDropCount {0};
+        std::atomic<uint64_t> uBlockCount {0};
+        std::atomic<uint64_t> uInlineCount {0};
+    };
+    static constexpr uint64_t kEnqueueSampleMask = 15;
+
+    // 每个生产者线程一个SPSC通道，首次记录日志时创建并注册，日志线程取出时无需加锁
+    struct ProducerQueue
+    {
+        LogChannel *pChannel;
+        uint32_t uTid;
+        std::atomic<bool> bClosed; // 线程已退出，日志线程取完剩余日志后销毁
+        QueueStats stats;
+    };
+
+    // 归并时各队列的队头，按时间戳组成小根堆
+    struct MergeHead
+    {
+        uint64_t uTimestampNs;
+        ProducerQueue *pQueue;
+        LogItemHeader *pHeader;
+
+        bool operator>(const MergeHead &other) const { return uTimestampNs > other.uTimestampNs; }
+    };
+
+    // 二进制模式下以调用点的文件行号和格式串地址区分格式串，要求二者均为静态字符串
+    struct FormatKey
+    {
+        const char *pFileLine;
+        const char *pFormat;
+
+        bool operator==(const FormatKey &other) const
+        {
+            return pFileLine == other.pFileLine && pFormat == other.pFormat;
+        }
+    };
+
+    // 输出目标及其反压统计，写入失败的日志直接丢弃
+    struct SinkEntry
+    {
+        ILogSink *pSink;
+        LogLevel eLevel;
+        std::atomic<uint64_t> uWriteCount;
+        std::atomic<uint64_t> uWriteBytes;
+        std::atomic<uint64_t> uDropCount;
+    };
+    static constexpr uint32_t kMaxSinkCount = 8;
+
+    struct FormatKeyHash
+    {
+        size_t operator()(const FormatKey &key) const
+        {
+            return std::hash<const void *>()(key.pFileLine) * 31 + std::hash<const void *>()(key.pFormat);
+        }
     };
 
 public:
@@ -76,15 +175,88 @@ public:
 
     int32_t LogFormat(int32_t iErrorNo, LogLevel eLevel, const char *pFormat, ...) override;
 
+    int32_t LogArgs(int32_t iErrorNo, LogLevel eLevel, const LogSite *pSite,
+                    const LogArg *pArgs, uint32_t uArgCount) override;
+
+    int32_t AddSink(ILogSink *pSink, LogLevel eLevel) override;
+
+    int32_t AddRateLimiter(LogRateLimiter *pLimiter) override;
+
+    int32_t DumpFlightRecorder() override;
+
     int32_t GetStats(IJson *pJson) const override;
 
 private:
     static bool RunWrapper(void *pArg);
     void Run();
 
+    ProducerQueue *GetProducerQueue();
+    ProducerQueue *CreateProducerQueue();
+    void DestroyProducerQueue(ProducerQueue *pQueue);
+    void PostLogItem(ProducerQueue *pQueue, LogItemHeader *pHeader);
+    // 异步模式下FATAL日志入队后调用，等待日志线程写入并同步本线程队列中的全部日志，最多等待kFatalWaitNs
+    void WaitFatalWritten(ProducerQueue *pQueue);
+    // 在通道中申请一条日志，通道已满时按溢出策略处理，返回nullptr时调用方丢弃或直接写入
+    void *NewLogItem(ProducerQueue *pQueue, uint32_t uSize);
+    void *NewLogItemSlow(ProducerQueue *pQueue, uint32_t uSize);
+    bool OverflowInline() const { return m_eOverflowPolicy == OverflowPolicy::kInline; }
+    static void AddQueueStats(QueueStats &total, const QueueStats &stats);
+
+    // 日志线程调用，按时间戳归并各线程通道的队头，最多写入uMaxCount条
+    uint32_t DrainQueues(uint32_t uMaxCount);
+    bool HasPendingLogs();
+    void RefreshQueues();
+    void ReapClosedQueues();
+    void WriteLogItem(LogItemHeader *pHeader);
+
+    // 输出各限流调用点被抑制的条数，日志线程每kRateLimiterFlushNs调用一次，退出时再调用一次
+    void FlushRateLimiters();
+
+    // 同步写入，同步模式和异步模式通道已满且溢出策略为kInline时调用
+    int32_t LogInline(int32_t iErrorNo, LogLevel eLevel, const char *pModule,
+                      const char *pFileLine, const char *pFunction,
+                      const char *pFormat, const char **ppParams, uint32_t uParamCount);
+    int32_t LogFormatInline(LogLevel eLevel, uint64_t uTimestampNs, const char *pLogBuffer, uint32_t uWriteLen);
+    int32_t LogArgsInline(int32_t iErrorNo, LogLevel eLevel, const LogSite *pSite,
+                          const LogArg *pArgs, uint32_t uArgCount);
+
     int32_t WriteLog(LogItem &logItem);
+    int32_t WriteLog(LogArgsItem &logArgsItem);
+    // 格式化到线程私有的缓冲区，失败返回nullptr
+    char *FormatLog(const LogItem &logItem, uint32_t &uLen);
+    char *FormatLog(const LogArgsItem &logArgsItem, uint32_t &uLen);
+    // 结构化日志按m_bKvJson输出为logfmt或JSON lines
+    char *FormatKvLog(const LogArgsItem &logArgsItem, uint32_t &uLen);
+    // 把格式化后的日志分发给日志文件和各输出目标
+    int32_t OutputLog(LogLevel eLevel, bool bFile, const char *pLogBuffer, uint32_t uWriteLen);
+    void WriteSinks(LogLevel eLevel, const char *pLogBuffer, uint32_t uWriteLen);
+    void FlushSinks();
+    // 生产者调用，没有输出目标和飞行记录器时日志宏已按模块级别过滤，pModule为nullptr时按日志级别判断
+    bool FileAccepts(LogLevel eLevel, const char *pModule) const;
+    bool SinkAccepts(LogLevel eLevel) const { return m_uSinkCount != 0 && eLevel >= m_eSinkLevel; }
+    // 缓冲区至少kLogPrefixMaxLen加模块名长度，pModule为nullptr时不输出模块名
+    uint32_t FormatPrefix(char *pLogBuffer, uint64_t uTimestampNs, uint32_t uTid,
+                          int32_t iErrorNo, LogLevel eLevel, const char *pModule);
     int32_t WriteLog(const char *pLogBuffer, uint32_t uWriteLen);
 
+    // 二进制模式，m_bWriteLock为true时需要持有m_writeLock
+    int32_t WriteBinaryLog(LogItem &logItem);
+    int32_t WriteBinaryLog(LogArgsItem &logArgsItem);
+    int32_t WriteBinaryText(LogLevel eLevel, bool bFile, uint32_t uTid, uint64_t uTimestampNs,
+                            const char *pLogBuffer, uint32_t uWriteLen);
+    uint32_t RegisterFormat(const LogItem &logItem);
+    int32_t WriteSessionRecord();
+
+    // 检查并切换日志文件，之后的AppendLogFile写入同一个文件
+    int32_t PrepareLogFile();
+    int32_t AppendLogFile(const void *pData, uint32_t uLen);
+
+    // FATAL日志立即写入文件并同步
+    void SyncFatalLog(LogLevel eLevel);
+
+    // 写入飞行记录器之后调用，FATAL日志导出飞行记录器，返回true表示不写入文件和输出目标
+    bool FlightRecordOnly(LogLevel eLevel, bool bFile);
+
     void CheckFileSwitch();
     int32_t OpenLogFile();
 
@@ -97,23 +269,70 @@ private:
 
     std::mutex m_lock;
     std::condition_variable m_condition;
-    LogChannel *m_pChannel {nullptr};
-    SpinLock *m_pSpinLock {nullptr};
     uint32_t m_uLogChannelMaxMemMB {default_value::kLogChannelMaxMemMB};
+    uint32_t m_uThreadQueueMemKB {default_value::kLogThreadQueueMemKB};
+    // 所有线程队列占用的内存，创建队列前预留，超过m_uLogChannelMaxMemMB时不再创建
+    std::atomic<uint64_t> m_uQueueMemKB {0};
+    std::atomic<uint64_t> m_uQueueRejectCount {0};
+
+    // 非0的日志对象ID，用于线程缓存区分不同的日志对象，线程退出时据此判断日志对象是否已经销毁
+    uint64_t m_uLoggerId {0};
 
-    bool m_bRunning {false};
+    // 生产者注册时加锁追加，日志线程在版本变化时拷贝到m_vecMergeQueues
+    mutable std::mutex m_queueLock;
+    std::vector<ProducerQueue *> m_vecQueues;
+    std::atomic<uint64_t> m_uQueueVersion {0};
+    std::vector<ProducerQueue *> m_vecMergeQueues;
+    std::vector<MergeHead> m_vecMergeHeap; // 容量不小于m_vecMergeQueues的大小，归并时不再分配内存
+    uint64_t m_uMergeVersion {0};
+
+    std::atomic<bool> m_bRunning {false}; // 生产者等待FATAL日志写入时读取
     IThreadManager *m_pThreadManager {nullptr};
     IThread *m_pThread {nullptr};
     uint32_t m_uBindCpuNo {UINT32_MAX};
 
 
-    FILE *m_pLogFile {nullptr};
+    OverflowPolicy m_eOverflowPolicy {OverflowPolicy::kDrop};
+    uint64_t m_uOverflowBlockNs {0};
+    // 同步模式或允许生产者直接写入时，写文件和输出目标需要加锁
+    bool m_bWriteLock {true};
+
+    // 吞吐和延迟统计，写入数由写文件的线程更新，速率按两次GetStats之间的增量计算
+    QueueStats m_retiredStats;
+    std::atomic<uint64_t> m_uWriteLines {0};
+    std::atomic<uint64_t> m_uWriteBytes {0};
+    std::atomic<uint64_t> m_uWriteLatencyCount {0};
+    std::atomic<uint64_t> m_uWriteLatencyTotalNs {0};
+    std::atomic<uint64_t> m_uWriteLatencyMaxNs {0};
+    mutable std::atomic<uint64_t> m_uLastStatsNs {0};
+    mutable std::atomic<uint64_t> m_uLastStatsLines {0};
+    mutable std::atomic<uint64_t> m_uLastStatsBytes {0};
+
+    CLogFileWriter m_fileWriter;
+    uint64_t m_uFlushIntervalNs {default_value::kLogFlushIntervalMs * kMill};
+    // 同步模式下多个线程同时写文件，异步模式只有日志线程写文件，不加锁
+    std::mutex m_writeLock;
     char m_szLogFileName[256];
     uint64_t m_uLogFileSize {0};
     uint64_t m_uLogFileMaxSizeMB {default_value::kLogFileMaxSizeMB};
     uint64_t m_uLogTotalSizeMB {default_value::kLogTotalSizeMB};
 
-    uint64_t m_uLastCheckTimeNs {0};
+    CLogRetention m_retention;
+
+    CLogFlightRecorder m_flightRecorder;
+
+    SinkEntry m_aSinks[kMaxSinkCount];
+    uint32_t m_uSinkCount {0};
+
+    static constexpr uint64_t kRateLimiterFlushNs = kSecond;
+    static constexpr uint64_t kFatalWaitNs = kSecond;
+    std::mutex m_limiterLock;
+    std::vector<LogRateLimiter *> m_vecRateLimiters;
+    uint64_t m_uLimiterFlushNs {0}; // 只有日志线程访问
+
+    bool m_bBinary {false};
+    bool m_bKvJson {false}; // 结构化日志输出为JSON lines，否则为logfmt
+    std::unordered_map<FormatKey, uint32_t, FormatKeyHash> m_mapFormatIds;
 
     std::string m_strLoggerName;
     std::string m_strLogPath;
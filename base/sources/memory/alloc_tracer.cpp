@@ -0,0 +1,143 @@
+#include "alloc_tracer.h"
+#include <utilities/error_code.h>
+#include <fcntl.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+namespace
+{
+
+thread_local uint32_t tls_uTraceThreadId = 0;
+thread_local uintptr_t tls_uReallocOldAddr = 0;
+
+bool WriteAll(int32_t iFd, const void *pData, uint64_t uLength)
+{
+    auto pBegin = reinterpret_cast<const uint8_t *>(pData);
+    while (uLength > 0)
+    {
+        auto iWritten = write(iFd, pBegin, uLength);
+        if (iWritten < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        pBegin += iWritten;
+        uLength -= iWritten;
+    }
+    return true;
+}
+
+}
+
+CAllocTracer::~CAllocTracer()
+{
+    if (m_iFd >= 0)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        FlushLocked();
+        close(m_iFd);
+        m_iFd = -1;
+    }
+
+    if (m_pBuffer != nullptr)
+    {
+        std::free(m_pBuffer);
+        m_pBuffer = nullptr;
+    }
+}
+
+int32_t CAllocTracer::Init(const char *pFilePath)
+{
+    if (pFilePath == nullptr || pFilePath[0] == '\0')
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    m_pBuffer = reinterpret_cast<AllocTraceRecord *>(std::malloc(kBufferRecordCount * sizeof(AllocTraceRecord)));
+    if (m_pBuffer == nullptr)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    m_iFd = open(pFilePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_iFd < 0)
+    {
+        PRINT_ERROR("failed to open allocator trace file %s: %s", pFilePath, strerror(errno));
+        SetLastError(ErrorCode::kSysCallFailed);
+        return ErrorCode::kSysCallFailed;
+    }
+
+    clock_get_time_nano(m_uStartTimeNs);
+    AllocTraceHeader header{kAllocTraceMagic, kAllocTraceVersion, m_uStartTimeNs};
+    if (!WriteAll(m_iFd, &header, sizeof(header)))
+    {
+        SetLastError(ErrorCode::kSysCallFailed);
+        return ErrorCode::kSysCallFailed;
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CAllocTracer::BeginRealloc(const void *pOldAddr)
+{
+    tls_uReallocOldAddr = reinterpret_cast<uintptr_t>(pOldAddr);
+}
+
+void CAllocTracer::Record(AllocTraceOp eOp, const void *pAddr, uint64_t uSize, uint64_t uArg)
+{
+    if (unlikely(tls_uTraceThreadId == 0))
+    {
+        tls_uTraceThreadId = uint32_t(gettid());
+    }
+
+    if (eOp == kAllocTraceRealloc)
+    {
+        uArg = tls_uReallocOldAddr;
+        tls_uReallocOldAddr = 0;
+    }
+
+    uint64_t uNowNs = 0;
+    clock_get_time_nano(uNowNs);
+
+    // 在锁内取序号，保证文件中的顺序与地址复用的先后一致
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto &record = m_pBuffer[m_uBufferCount++];
+    record.uTimeNs = uNowNs - m_uStartTimeNs;
+    record.uAddr = reinterpret_cast<uintptr_t>(pAddr);
+    record.uSize = uSize;
+    record.uArg = uArg;
+    record.uThreadId = tls_uTraceThreadId;
+    record.uOp = eOp;
+    memset(record.aReserved, 0, sizeof(record.aReserved));
+    m_uRecordCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (unlikely(m_uBufferCount == kBufferRecordCount))
+    {
+        FlushLocked();
+    }
+}
+
+void CAllocTracer::FlushLocked()
+{
+    if (m_uBufferCount != 0)
+    {
+        if (!WriteAll(m_iFd, m_pBuffer, m_uBufferCount * sizeof(AllocTraceRecord)))
+        {
+            PRINT_ERROR("failed to write allocator trace: %s", strerror(errno));
+        }
+        m_uBufferCount = 0;
+    }
+}
+
+}
+}
+}
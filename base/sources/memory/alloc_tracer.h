@@ -0,0 +1,65 @@
+#ifndef __CPPX_ALLOC_TRACER_H__
+#define __CPPX_ALLOC_TRACER_H__
+
+#include <memory/allocator_trace.h>
+#include <utilities/common.h>
+#include <atomic>
+#include <mutex>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+/**
+ * 分配器trace记录器
+ * 将每次分配和释放按allocator_trace.h定义的格式追加写入文件，
+ * 缓冲区和文件写入都不经过IAllocator，避免递归记录。
+ */
+class CAllocTracer
+{
+public:
+    CAllocTracer() = default;
+    CAllocTracer(const CAllocTracer &) = delete;
+    CAllocTracer &operator=(const CAllocTracer &) = delete;
+    CAllocTracer(CAllocTracer &&) = delete;
+    CAllocTracer &operator=(CAllocTracer &&) = delete;
+
+    ~CAllocTracer();
+
+    int32_t Init(const char *pFilePath);
+
+    /**
+     * @brief 记录realloc前的原地址，随后的kAllocTraceRealloc记录以它作为uArg
+     * @note 原地址在realloc之后不能再使用，所以需要提前保存
+     */
+    void BeginRealloc(const void *pOldAddr);
+
+    void Record(AllocTraceOp eOp, const void *pAddr, uint64_t uSize, uint64_t uArg);
+
+    uint64_t GetRecordCount() const
+    {
+        return m_uRecordCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    void FlushLocked();
+
+private:
+    static constexpr uint32_t kBufferRecordCount = 4096;
+
+    std::mutex m_lock;
+    int32_t m_iFd {-1};
+    uint64_t m_uStartTimeNs {0};
+    AllocTraceRecord *m_pBuffer {nullptr};
+    uint32_t m_uBufferCount {0};
+    std::atomic<uint64_t> m_uRecordCount {0};
+};
+
+}
+}
+}
+
+#endif // __CPPX_ALLOC_TRACER_H__
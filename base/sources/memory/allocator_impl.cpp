@@ -3,6 +3,8 @@
 #include <utilities/common.h>
 #include <utilities/error_code.h>
 #include <cstdlib>
+#include <cstring>
+#include <malloc.h>
 #include <mutex>
 
 namespace cppx
@@ -59,39 +61,427 @@ void IAllocator::Destroy(IAllocator *pAllocator)
     }
 }
 
+CAllocatorImpl::~CAllocatorImpl()
+{
+    Exit();
+}
+
 int32_t CAllocatorImpl::Init(const IJson *pConfig)
 {
     // 允许pConfig为nullptr，使用默认配置
-    (void)pConfig;
+    if (pConfig == nullptr)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    std::lock_guard<std::mutex> lock(m_initLock);
+    auto iErrorNo = InitHeapProfiler(pConfig);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        return iErrorNo;
+    }
+
+    iErrorNo = InitTracer(pConfig);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        return iErrorNo;
+    }
+
+    return InitBuddy(pConfig);
+}
+
+int32_t CAllocatorImpl::InitHeapProfiler(const IJson *pConfig)
+{
+    auto uSampleIntervalBytes = pConfig->GetUint64(config::kAllocatorSampleIntervalBytes, 
+                                                   default_value::kAllocatorSampleIntervalBytes);
+    if (uSampleIntervalBytes == 0)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    // 全局单例已经在GetInstance中初始化过，允许再次调用Init开启采样，但只能开启一次
+    if (m_pHeapProfiler.load(std::memory_order_relaxed) != nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    auto pHeapProfiler = NEW CHeapProfiler();
+    if (pHeapProfiler == nullptr)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    auto uSampleMaxCount = pConfig->GetUint32(config::kAllocatorSampleMaxCount, default_value::kAllocatorSampleMaxCount);
+    auto iErrorNo = pHeapProfiler->Init(uSampleIntervalBytes, uSampleMaxCount);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        delete pHeapProfiler;
+        return iErrorNo;
+    }
+
+    auto iSignal = pConfig->GetInt32(config::kAllocatorProfileSignal, default_value::kAllocatorProfileSignal);
+    if (iSignal != 0)
+    {
+        auto pFilePath = pConfig->GetString(config::kAllocatorProfilePath, default_value::kAllocatorProfilePath);
+        iErrorNo = pHeapProfiler->InstallSignal(iSignal, pFilePath);
+        if (iErrorNo != ErrorCode::kSuccess)
+        {
+            delete pHeapProfiler;
+            return iErrorNo;
+        }
+    }
+
+    m_pHeapProfiler.store(pHeapProfiler, std::memory_order_release);
+    return ErrorCode::kSuccess;
+}
+
+int32_t CAllocatorImpl::InitTracer(const IJson *pConfig)
+{
+    auto pFilePath = pConfig->GetString(config::kAllocatorTraceFile, default_value::kAllocatorTraceFile);
+    if (pFilePath == nullptr || pFilePath[0] == '\0')
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    if (m_pTracer.load(std::memory_order_relaxed) != nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    auto pTracer = NEW CAllocTracer();
+    if (pTracer == nullptr)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    auto iErrorNo = pTracer->Init(pFilePath);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        delete pTracer;
+        return iErrorNo;
+    }
+
+    m_pTracer.store(pTracer, std::memory_order_release);
+    return ErrorCode::kSuccess;
+}
+
+int32_t CAllocatorImpl::InitBuddy(const IJson *pConfig)
+{
+    auto uRegionMB = pConfig->GetUint64(config::kAllocatorBuddyRegionMB, default_value::kAllocatorBuddyRegionMB);
+    if (uRegionMB == 0)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    if (m_pBuddy.load(std::memory_order_relaxed) != nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    auto pBuddy = NEW CBuddyAllocator();
+    if (pBuddy == nullptr)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    auto iErrorNo = pBuddy->Init(uRegionMB << 20);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        delete pBuddy;
+        return iErrorNo;
+    }
+
+    // 小于4KB的分配放进伙伴系统会浪费整页，最小阈值为一页
+    m_uBuddyMinBytes = pConfig->GetUint64(config::kAllocatorBuddyMinBytes, default_value::kAllocatorBuddyMinBytes);
+    if (m_uBuddyMinBytes < CBuddyAllocator::kMinBlockSize)
+    {
+        m_uBuddyMinBytes = CBuddyAllocator::kMinBlockSize;
+    }
+    m_pBuddy.store(pBuddy, std::memory_order_release);
     return ErrorCode::kSuccess;
 }
 
 void CAllocatorImpl::Exit()
 {
+    // 调用方需保证此时没有其他线程在使用该分配器
+    std::lock_guard<std::mutex> lock(m_initLock);
+    auto pHeapProfiler = m_pHeapProfiler.exchange(nullptr, std::memory_order_acq_rel);
+    if (pHeapProfiler != nullptr)
+    {
+        delete pHeapProfiler;
+    }
+
+    auto pTracer = m_pTracer.exchange(nullptr, std::memory_order_acq_rel);
+    if (pTracer != nullptr)
+    {
+        delete pTracer;
+    }
+
+    // 伙伴系统中的内存随区域一起归还，调用方需保证已经全部释放
+    auto pBuddy = m_pBuddy.exchange(nullptr, std::memory_order_acq_rel);
+    if (pBuddy != nullptr)
+    {
+        delete pBuddy;
+    }
+}
+
+void CAllocatorImpl::OnMalloc(AllocTraceOp eOp, void *pMem, uint64_t uSize, uint64_t uArg)
+{
+    auto pHeapProfiler = m_pHeapProfiler.load(std::memory_order_acquire);
+    auto pTracer = m_pTracer.load(std::memory_order_acquire);
+    if (pHeapProfiler != nullptr)
+    {
+        pHeapProfiler->OnMalloc(pMem, uSize);
+    }
+    if (pTracer != nullptr && pMem != nullptr)
+    {
+        pTracer->Record(eOp, pMem, uSize, uArg);
+    }
+}
+
+void CAllocatorImpl::OnFree(const void *pMem, uint64_t uSize)
+{
+    // 必须在真正释放之前调用，否则地址可能已被其他线程重新分配
+    auto pHeapProfiler = m_pHeapProfiler.load(std::memory_order_acquire);
+    auto pTracer = m_pTracer.load(std::memory_order_acquire);
+    if (pHeapProfiler != nullptr)
+    {
+        pHeapProfiler->OnFree(pMem);
+    }
+    if (pTracer != nullptr)
+    {
+        pTracer->Record(kAllocTraceFree, pMem, uSize, 0);
+    }
+}
+
+void *CAllocatorImpl::MallocFromBuddy(CBuddyAllocator *pBuddy, uint64_t uSize)
+{
+    auto pMem = pBuddy->Malloc(uSize);
+    if (pMem == nullptr)
+    {
+        m_uBuddyFallbackCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return pMem;
+}
+
+void *CAllocatorImpl::ReallocFromBuddy(CBuddyAllocator *pBuddy, void *pMem, uint64_t uSize)
+{
+    // 右侧伙伴空闲时原地合并，无需拷贝
+    if (pBuddy->TryExpand(pMem, uSize))
+    {
+        return pMem;
+    }
+
+    void *pNewMem = nullptr;
+    if (uSize >= m_uBuddyMinBytes)
+    {
+        pNewMem = MallocFromBuddy(pBuddy, uSize);
+    }
+    if (pNewMem == nullptr)
+    {
+        pNewMem = std::malloc(uSize);
+        if (pNewMem == nullptr)
+        {
+            return nullptr;
+        }
+    }
+
+    auto uBlockSize = pBuddy->GetBlockSize(pMem);
+    memcpy(pNewMem, pMem, uBlockSize < uSize ? uBlockSize : uSize);
+    pBuddy->Free(pMem);
+    return pNewMem;
 }
 
 void *CAllocatorImpl::Malloc(uint64_t uSize)
 {
-    return std::malloc(uSize);
+    auto pBuddy = m_pBuddy.load(std::memory_order_acquire);
+    void *pMem = nullptr;
+    if (unlikely(pBuddy != nullptr && uSize >= m_uBuddyMinBytes))
+    {
+        pMem = MallocFromBuddy(pBuddy, uSize);
+    }
+    if (pMem == nullptr)
+    {
+        pMem = std::malloc(uSize);
+    }
+
+    if (unlikely(IsHooked()))
+    {
+        OnMalloc(kAllocTraceMalloc, pMem, uSize, 0);
+    }
+    return pMem;
 }
 
 void CAllocatorImpl::Free(const void *pMem)
+{
+    Free(pMem, 0);
+}
+
+void *CAllocatorImpl::MallocAligned(uint64_t uSize, uint64_t uAlign)
+{
+    auto pBuddy = m_pBuddy.load(std::memory_order_acquire);
+    void *pMem = nullptr;
+    // 伙伴系统的块按自身大小对齐，块不小于uAlign即满足对齐
+    if (unlikely(pBuddy != nullptr && uSize >= m_uBuddyMinBytes && uAlign <= pBuddy->GetMaxBlockSize()))
+    {
+        pMem = MallocFromBuddy(pBuddy, uSize > uAlign ? uSize : uAlign);
+    }
+    if (pMem == nullptr && unlikely(posix_memalign(&pMem, uAlign, uSize) != 0))
+    {
+        return nullptr;
+    }
+
+    if (unlikely(IsHooked()))
+    {
+        OnMalloc(kAllocTraceMallocAligned, pMem, uSize, uAlign);
+    }
+    return pMem;
+}
+
+void CAllocatorImpl::Free(const void *pMem, uint64_t uSize)
 {
     if (pMem != nullptr)
     {
+        if (unlikely(IsHooked()))
+        {
+            OnFree(pMem, uSize);
+        }
+        auto pBuddy = m_pBuddy.load(std::memory_order_acquire);
+        if (unlikely(pBuddy != nullptr && pBuddy->Contains(pMem)))
+        {
+            pBuddy->Free(pMem);
+            return;
+        }
+        // glibc没有sized free，大小仅用于接口约定，后端可据此免去查找块大小
         std::free(const_cast<void *>(pMem));
     }
 }
 
+void *CAllocatorImpl::Realloc(void *pMem, uint64_t uSize)
+{
+    if (pMem == nullptr)
+    {
+        return Malloc(uSize);
+    }
+
+    // 必须在realloc之前移除采样，否则旧地址可能已被其他线程重新分配
+    auto pHeapProfiler = m_pHeapProfiler.load(std::memory_order_acquire);
+    uint64_t uSampledSize = 0;
+    if (unlikely(pHeapProfiler != nullptr))
+    {
+        uSampledSize = pHeapProfiler->OnFree(pMem);
+    }
+
+    auto pTracer = m_pTracer.load(std::memory_order_acquire);
+    if (unlikely(pTracer != nullptr))
+    {
+        pTracer->BeginRealloc(pMem);
+    }
+
+    void *pNewMem = nullptr;
+    auto pBuddy = m_pBuddy.load(std::memory_order_acquire);
+    if (unlikely(pBuddy != nullptr && pBuddy->Contains(pMem)))
+    {
+        pNewMem = ReallocFromBuddy(pBuddy, pMem, uSize);
+    }
+    else
+    {
+        pNewMem = std::realloc(pMem, uSize);
+    }
+    if (unlikely(pNewMem == nullptr))
+    {
+        // 失败时原内存仍然有效，恢复采样
+        if (pHeapProfiler != nullptr)
+        {
+            pHeapProfiler->OnRestore(pMem, uSampledSize);
+        }
+        return nullptr;
+    }
+    if (unlikely(IsHooked()))
+    {
+        OnMalloc(kAllocTraceRealloc, pNewMem, uSize, 0);
+    }
+    return pNewMem;
+}
+
+bool CAllocatorImpl::TryExpand(void *pMem, uint64_t uSize)
+{
+    if (pMem == nullptr)
+    {
+        return false;
+    }
+
+    bool bExpanded = false;
+    auto pBuddy = m_pBuddy.load(std::memory_order_acquire);
+    if (unlikely(pBuddy != nullptr && pBuddy->Contains(pMem)))
+    {
+        bExpanded = pBuddy->TryExpand(pMem, uSize);
+    }
+    else
+    {
+        // malloc实际分配的块通常大于申请的大小，块内的剩余空间可以直接使用
+        bExpanded = malloc_usable_size(pMem) >= uSize;
+    }
+
+    auto pHeapProfiler = m_pHeapProfiler.load(std::memory_order_acquire);
+    if (unlikely(bExpanded && pHeapProfiler != nullptr))
+    {
+        pHeapProfiler->OnResize(pMem, uSize);
+    }
+    return bExpanded;
+}
+
 int32_t CAllocatorImpl::GetStats(IJson *pJson) const
 {
+    auto pHeapProfiler = m_pHeapProfiler.load(std::memory_order_acquire);
+    auto pTracer = m_pTracer.load(std::memory_order_acquire);
+    auto pBuddy = m_pBuddy.load(std::memory_order_acquire);
     if (pJson != nullptr)
     {
         pJson->Clear();
+        if (pHeapProfiler != nullptr)
+        {
+            auto pProfilerJson = pJson->SetObject("heap_profiler");
+            if (pProfilerJson != nullptr)
+            {
+                pHeapProfiler->GetStats(pProfilerJson);
+            }
+        }
+        if (pTracer != nullptr)
+        {
+            pJson->SetUint64("trace_record_count", pTracer->GetRecordCount());
+        }
+        if (pBuddy != nullptr)
+        {
+            auto pBuddyJson = pJson->SetObject("buddy");
+            if (pBuddyJson != nullptr)
+            {
+                pBuddy->GetStats(pBuddyJson);
+                pBuddyJson->SetUint64("fallback_count", m_uBuddyFallbackCount.load(std::memory_order_relaxed));
+            }
+        }
     }
     return ErrorCode::kSuccess;
 }
 
+int32_t CAllocatorImpl::DumpHeapProfile(const char *pFilePath) const
+{
+    auto pHeapProfiler = m_pHeapProfiler.load(std::memory_order_acquire);
+    if (pHeapProfiler == nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    return pHeapProfiler->Dump(pFilePath);
+}
+
 }
 }
 }
@@ -2,6 +2,11 @@
 #define __CPPX_ALLOCATOR_IMPL_H__
 
 #include <memory/allocator.h>
+#include "heap_profiler.h"
+#include "alloc_tracer.h"
+#include "buddy_allocator.h"
+#include <atomic>
+#include <mutex>
 
 namespace cppx
 {
@@ -19,18 +24,53 @@ public:
     CAllocatorImpl(CAllocatorImpl &&) = delete;
     CAllocatorImpl &operator=(CAllocatorImpl &&) = delete;
 
-    ~CAllocatorImpl() override = default;
+    ~CAllocatorImpl() override;
 
     int32_t Init(const IJson *pConfig) override;
     void Exit() override;
 
     void *Malloc(uint64_t uSize) override;
+    void *MallocAligned(uint64_t uSize, uint64_t uAlign) override;
     void Free(const void *pMem) override;
+    void Free(const void *pMem, uint64_t uSize) override;
+    void *Realloc(void *pMem, uint64_t uSize) override;
+    bool TryExpand(void *pMem, uint64_t uSize) override;
 
     int32_t GetStats(IJson *pJson) const override;
 
+    int32_t DumpHeapProfile(const char *pFilePath) const override;
+
 private:
+    int32_t InitHeapProfiler(const IJson *pConfig);
+    int32_t InitTracer(const IJson *pConfig);
+    int32_t InitBuddy(const IJson *pConfig);
+
+    // 伙伴系统已满或超过最大块时返回nullptr，由调用方回退到malloc
+    void *MallocFromBuddy(CBuddyAllocator *pBuddy, uint64_t uSize);
+    void *ReallocFromBuddy(CBuddyAllocator *pBuddy, void *pMem, uint64_t uSize);
+
+    bool IsHooked() const
+    {
+        return m_pHeapProfiler.load(std::memory_order_acquire) != nullptr ||
+               m_pTracer.load(std::memory_order_acquire) != nullptr;
+    }
 
+    void OnMalloc(AllocTraceOp eOp, void *pMem, uint64_t uSize, uint64_t uArg);
+    void OnFree(const void *pMem, uint64_t uSize);
+
+private:
+    // 全局单例可能在其他线程已经开始分配后才调用Init，三个指针都在完全初始化后以release发布，
+    // 分配路径以acquire读取；Init之间用m_initLock串行，避免重复创建
+    std::mutex m_initLock;
+    // 未开启采样时为nullptr，分配路径上只多一次判断
+    std::atomic<CHeapProfiler *> m_pHeapProfiler{nullptr};
+    // 未开启trace时为nullptr
+    std::atomic<CAllocTracer *> m_pTracer{nullptr};
+    // 未开启伙伴系统时为nullptr，不小于m_uBuddyMinBytes的分配优先从伙伴系统分配
+    std::atomic<CBuddyAllocator *> m_pBuddy{nullptr};
+    // 在m_pBuddy发布之前写入，读取方先acquire读取m_pBuddy再读取该值
+    uint64_t m_uBuddyMinBytes{0};
+    std::atomic<uint64_t> m_uBuddyFallbackCount{0};
 };
 
 }
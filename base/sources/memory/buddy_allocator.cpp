@@ -0,0 +1,289 @@
+#include "buddy_allocator.h"
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+#include <cerrno>
+#include <cstdlib>
+#include <sys/mman.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+CBuddyAllocator::~CBuddyAllocator()
+{
+    if (m_pBase != nullptr)
+    {
+        munmap(m_pBase, m_uRegionBytes);
+        m_pBase = nullptr;
+    }
+
+    if (m_pPageStates != nullptr)
+    {
+        std::free(m_pPageStates);
+        m_pPageStates = nullptr;
+    }
+}
+
+int32_t CBuddyAllocator::Init(uint64_t uRegionBytes)
+{
+    if (m_pBase != nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    if (uRegionBytes < kMinBlockSize)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    uint32_t uTopOrder = 0;
+    while (uTopOrder < kMaxOrder && (kMinBlockSize << (uTopOrder + 1)) <= uRegionBytes)
+    {
+        ++uTopOrder;
+    }
+    auto uTopBlockSize = kMinBlockSize << uTopOrder;
+    uRegionBytes = uRegionBytes / uTopBlockSize * uTopBlockSize;
+
+    // 多映射一个最大块用于对齐，再把首尾多余的部分归还
+    auto uMapBytes = uRegionBytes + uTopBlockSize;
+    auto pMap = mmap(nullptr, uMapBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (pMap == MAP_FAILED)
+    {
+        PRINT_ERROR("mmap buddy region %lu bytes failed, errno: %d", uMapBytes, errno);
+        SetLastError(ErrorCode::kSysCallFailed);
+        return ErrorCode::kSysCallFailed;
+    }
+
+    auto uMapAddr = reinterpret_cast<uintptr_t>(pMap);
+    auto uBaseAddr = (uMapAddr + uTopBlockSize - 1) & ~uintptr_t(uTopBlockSize - 1);
+    auto uHeadBytes = uBaseAddr - uMapAddr;
+    if (uHeadBytes != 0)
+    {
+        munmap(pMap, uHeadBytes);
+    }
+    if (uMapBytes - uHeadBytes - uRegionBytes != 0)
+    {
+        munmap(reinterpret_cast<void *>(uBaseAddr + uRegionBytes), uMapBytes - uHeadBytes - uRegionBytes);
+    }
+
+    m_uPageCount = uRegionBytes >> kPageShift;
+    m_pPageStates = reinterpret_cast<uint8_t *>(std::calloc(m_uPageCount, sizeof(uint8_t)));
+    if (m_pPageStates == nullptr)
+    {
+        munmap(reinterpret_cast<void *>(uBaseAddr), uRegionBytes);
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    m_pBase = reinterpret_cast<uint8_t *>(uBaseAddr);
+    m_uRegionBytes = uRegionBytes;
+    m_uTopOrder = uTopOrder;
+    for (uint64_t uPage = 0; uPage < m_uPageCount; uPage += uint64_t(1) << uTopOrder)
+    {
+        PushFree(uPage, uTopOrder);
+    }
+    m_uFreeBytes = uRegionBytes;
+
+    return ErrorCode::kSuccess;
+}
+
+uint32_t CBuddyAllocator::SizeToOrder(uint64_t uSize)
+{
+    if (uSize <= kMinBlockSize)
+    {
+        return 0;
+    }
+
+    // 向上取整到2的幂后相对4KB的位数
+    return uint32_t(64 - __builtin_clzll(uSize - 1)) - kPageShift;
+}
+
+void CBuddyAllocator::PushFree(uint64_t uPage, uint32_t uOrder)
+{
+    auto pNode = PageToNode(uPage);
+    pNode->pPrev = nullptr;
+    pNode->pNext = m_apFreeLists[uOrder];
+    if (pNode->pNext != nullptr)
+    {
+        pNode->pNext->pPrev = pNode;
+    }
+    m_apFreeLists[uOrder] = pNode;
+    m_pPageStates[uPage] = uint8_t(kPageFree | uOrder);
+    ++m_auFreeBlocks[uOrder];
+}
+
+void CBuddyAllocator::RemoveFree(uint64_t uPage, uint32_t uOrder)
+{
+    auto pNode = PageToNode(uPage);
+    if (pNode->pPrev != nullptr)
+    {
+        pNode->pPrev->pNext = pNode->pNext;
+    }
+    else
+    {
+        m_apFreeLists[uOrder] = pNode->pNext;
+    }
+    if (pNode->pNext != nullptr)
+    {
+        pNode->pNext->pPrev = pNode->pPrev;
+    }
+    m_pPageStates[uPage] = 0;
+    --m_auFreeBlocks[uOrder];
+}
+
+void *CBuddyAllocator::Malloc(uint64_t uSize)
+{
+    auto uOrder = SizeToOrder(uSize);
+    if (unlikely(uOrder > m_uTopOrder || m_pBase == nullptr))
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    auto uCurOrder = uOrder;
+    while (uCurOrder <= m_uTopOrder && m_apFreeLists[uCurOrder] == nullptr)
+    {
+        ++uCurOrder;
+    }
+    if (uCurOrder > m_uTopOrder)
+    {
+        ++m_uFailedCount;
+        return nullptr;
+    }
+
+    auto uPage = AddrToPage(m_apFreeLists[uCurOrder]);
+    RemoveFree(uPage, uCurOrder);
+
+    // 逐级拆分，右半部分放回低一阶的空闲链表
+    while (uCurOrder > uOrder)
+    {
+        --uCurOrder;
+        PushFree(uPage + (uint64_t(1) << uCurOrder), uCurOrder);
+    }
+
+    m_pPageStates[uPage] = uint8_t(uOrder);
+    m_uFreeBytes -= kMinBlockSize << uOrder;
+    ++m_uMallocCount;
+    return PageToNode(uPage);
+}
+
+void CBuddyAllocator::Free(const void *pMem)
+{
+    if (unlikely(pMem == nullptr))
+    {
+        return;
+    }
+
+    auto uPage = AddrToPage(pMem);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    uint32_t uOrder = m_pPageStates[uPage] & kOrderMask;
+    m_pPageStates[uPage] = 0;
+    m_uFreeBytes += kMinBlockSize << uOrder;
+    ++m_uFreeCount;
+
+    // 伙伴空闲且阶数相同则合并，合并后的块从两者中较低的地址开始
+    while (uOrder < m_uTopOrder)
+    {
+        auto uBuddyPage = uPage ^ (uint64_t(1) << uOrder);
+        if (!IsFreeBlock(uBuddyPage, uOrder))
+        {
+            break;
+        }
+        RemoveFree(uBuddyPage, uOrder);
+        uPage = uPage < uBuddyPage ? uPage : uBuddyPage;
+        ++uOrder;
+    }
+
+    PushFree(uPage, uOrder);
+}
+
+bool CBuddyAllocator::TryExpand(void *pMem, uint64_t uSize)
+{
+    auto uPage = AddrToPage(pMem);
+    auto uNewOrder = SizeToOrder(uSize);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    uint32_t uOrder = m_pPageStates[uPage] & kOrderMask;
+    if (uNewOrder <= uOrder)
+    {
+        return true;
+    }
+    if (uNewOrder > m_uTopOrder)
+    {
+        return false;
+    }
+
+    // 块必须是每一级的左半部分，且每一级的右伙伴都是完整的空闲块，先检查再修改
+    for (auto uCurOrder = uOrder; uCurOrder < uNewOrder; ++uCurOrder)
+    {
+        auto uBit = uint64_t(1) << uCurOrder;
+        if ((uPage & uBit) != 0 || !IsFreeBlock(uPage + uBit, uCurOrder))
+        {
+            return false;
+        }
+    }
+
+    for (auto uCurOrder = uOrder; uCurOrder < uNewOrder; ++uCurOrder)
+    {
+        RemoveFree(uPage + (uint64_t(1) << uCurOrder), uCurOrder);
+        m_uFreeBytes -= kMinBlockSize << uCurOrder;
+    }
+
+    m_pPageStates[uPage] = uint8_t(uNewOrder);
+    ++m_uExpandCount;
+    return true;
+}
+
+uint64_t CBuddyAllocator::GetBlockSize(const void *pMem) const
+{
+    // 已分配块的状态只有持有者会修改，无需加锁
+    return kMinBlockSize << (m_pPageStates[AddrToPage(pMem)] & kOrderMask);
+}
+
+void CBuddyAllocator::GetStats(IJson *pJson) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    uint64_t uLargestFree = 0;
+    for (uint32_t uOrder = 0; uOrder <= m_uTopOrder; ++uOrder)
+    {
+        if (m_auFreeBlocks[uOrder] != 0)
+        {
+            uLargestFree = kMinBlockSize << uOrder;
+        }
+    }
+
+    pJson->SetUint64("region_bytes", m_uRegionBytes);
+    pJson->SetUint64("used_bytes", m_uRegionBytes - m_uFreeBytes);
+    pJson->SetUint64("free_bytes", m_uFreeBytes);
+    pJson->SetUint64("largest_free_bytes", uLargestFree);
+    // 外部碎片率：空闲内存中不能作为最大空闲块分配出去的比例
+    pJson->SetDouble("fragmentation", m_uFreeBytes == 0 ? 0.0 : 1.0 - double(uLargestFree) / double(m_uFreeBytes));
+    pJson->SetUint64("malloc_count", m_uMallocCount);
+    pJson->SetUint64("free_count", m_uFreeCount);
+    pJson->SetUint64("failed_count", m_uFailedCount);
+    pJson->SetUint64("expand_count", m_uExpandCount);
+
+    // 下标为阶数，第i项为4KB << i大小的空闲块个数
+    auto pFreeBlocks = pJson->SetArray("free_blocks");
+    if (pFreeBlocks != nullptr)
+    {
+        for (uint32_t uOrder = 0; uOrder <= m_uTopOrder; ++uOrder)
+        {
+            pFreeBlocks->AppendUint64(m_auFreeBlocks[uOrder]);
+        }
+    }
+}
+
+}
+}
+}
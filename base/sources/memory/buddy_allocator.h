@@ -0,0 +1,130 @@
+#ifndef __CPPX_BUDDY_ALLOCATOR_H__
+#define __CPPX_BUDDY_ALLOCATOR_H__
+
+#include <cstdint>
+#include <mutex>
+#include <utilities/common.h>
+#include <utilities/json.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+/**
+ * 伙伴系统分配器
+ * 在一块预先映射的连续区域上分配4KB~64MB的块，块大小为4KB的2的幂倍，
+ * 分配时逐级拆分，释放时逐级与空闲的伙伴合并，均为O(log n)。
+ * 块按自身大小对齐(至少4KB)，用于消息体和接收缓冲区这类大小变化很大的大块内存。
+ */
+class CBuddyAllocator
+{
+public:
+    static constexpr uint32_t kPageShift = 12;
+    static constexpr uint64_t kMinBlockSize = uint64_t(1) << kPageShift; // 4KB
+    static constexpr uint32_t kMaxOrder = 14;
+    static constexpr uint64_t kMaxBlockSize = kMinBlockSize << kMaxOrder; // 64MB
+
+    CBuddyAllocator() = default;
+    CBuddyAllocator(const CBuddyAllocator &) = delete;
+    CBuddyAllocator &operator=(const CBuddyAllocator &) = delete;
+    CBuddyAllocator(CBuddyAllocator &&) = delete;
+    CBuddyAllocator &operator=(CBuddyAllocator &&) = delete;
+
+    ~CBuddyAllocator();
+
+    /**
+     * @brief 映射uRegionBytes大小的区域，区域按最大块大小向下取整，小于最大块时最大块随之减小
+     */
+    int32_t Init(uint64_t uRegionBytes);
+
+    /**
+     * @brief 分配能容纳uSize的最小块
+     * @return 成功返回块地址，超过最大块或者区域已满返回nullptr
+     */
+    void *Malloc(uint64_t uSize);
+
+    void Free(const void *pMem);
+
+    /**
+     * @brief 与右侧空闲的伙伴合并，原地扩大到能容纳uSize的块
+     * @return 块已经足够大或者扩大成功返回true，否则返回false，此时块不变
+     */
+    bool TryExpand(void *pMem, uint64_t uSize);
+
+    bool Contains(const void *pMem) const
+    {
+        auto pAddr = reinterpret_cast<const uint8_t *>(pMem);
+        return pAddr >= m_pBase && pAddr < m_pBase + m_uRegionBytes;
+    }
+
+    /**
+     * @brief 获取块的实际大小，pMem必须是本分配器分配的块
+     */
+    uint64_t GetBlockSize(const void *pMem) const;
+
+    uint64_t GetMaxBlockSize() const
+    {
+        return kMinBlockSize << m_uTopOrder;
+    }
+
+    void GetStats(IJson *pJson) const;
+
+private:
+    // 空闲块的链表节点存放在块的起始位置
+    struct FreeNode
+    {
+        FreeNode *pPrev;
+        FreeNode *pNext;
+    };
+
+    // 每页一个字节，只有块的首页有效，最高位表示空闲，低5位表示阶数
+    static constexpr uint8_t kPageFree = 0x80;
+    static constexpr uint8_t kOrderMask = 0x1F;
+
+    static uint32_t SizeToOrder(uint64_t uSize);
+
+    uint64_t AddrToPage(const void *pMem) const
+    {
+        return uint64_t(reinterpret_cast<const uint8_t *>(pMem) - m_pBase) >> kPageShift;
+    }
+
+    FreeNode *PageToNode(uint64_t uPage) const
+    {
+        return reinterpret_cast<FreeNode *>(m_pBase + (uPage << kPageShift));
+    }
+
+    bool IsFreeBlock(uint64_t uPage, uint32_t uOrder) const
+    {
+        return m_pPageStates[uPage] == (kPageFree | uOrder);
+    }
+
+    void PushFree(uint64_t uPage, uint32_t uOrder);
+    void RemoveFree(uint64_t uPage, uint32_t uOrder);
+
+private:
+    mutable std::mutex m_lock;
+
+    uint8_t *m_pBase {nullptr};
+    uint64_t m_uRegionBytes {0};
+    uint64_t m_uPageCount {0};
+    uint32_t m_uTopOrder {0};
+    uint8_t *m_pPageStates {nullptr};
+
+    FreeNode *m_apFreeLists[kMaxOrder + 1] {};
+    uint64_t m_auFreeBlocks[kMaxOrder + 1] {};
+
+    uint64_t m_uFreeBytes {0};
+    uint64_t m_uMallocCount {0};
+    uint64_t m_uFreeCount {0};
+    uint64_t m_uFailedCount {0};
+    uint64_t m_uExpandCount {0};
+};
+
+}
+}
+}
+
+#endif // __CPPX_BUDDY_ALLOCATOR_H__
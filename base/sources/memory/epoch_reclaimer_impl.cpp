@@ -0,0 +1,556 @@
+#include "epoch_reclaimer_impl.h"
+#include <algorithm>
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+// 存活的回收器，线程退出时据此判断线程记录所属的回收器是否已经销毁
+struct ReclaimerRegistry
+{
+    std::mutex lock;
+    std::vector<CEpochReclaimerImpl *> vecReclaimers;
+    uint64_t uNextId {1};
+};
+
+static ReclaimerRegistry &GetReclaimerRegistry()
+{
+    static ReclaimerRegistry s_registry;
+    return s_registry;
+}
+
+/**
+ * 线程本地对象，记录当前线程在各个回收器中占用的线程记录
+ * 线程退出时析构，把记录交还给仍然存活的回收器，不依赖线程由谁创建
+ */
+class CThreadRecordHolder
+{
+public:
+    using ThreadRecord = CEpochReclaimerImpl::ThreadRecord;
+
+    struct Entry
+    {
+        uint64_t uId;
+        CEpochReclaimerImpl *pReclaimer;
+        ThreadRecord *pRecord;
+    };
+
+    CThreadRecordHolder() = default;
+    CThreadRecordHolder(const CThreadRecordHolder &) = delete;
+    CThreadRecordHolder &operator=(const CThreadRecordHolder &) = delete;
+
+    ~CThreadRecordHolder()
+    {
+        auto &registry = GetReclaimerRegistry();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        for (auto &entry : m_vecEntries)
+        {
+            if (IsAlive(registry, entry))
+            {
+                entry.pReclaimer->OnThreadExit(entry.pRecord);
+            }
+        }
+    }
+
+    ThreadRecord *Find(uint64_t uId) const
+    {
+        for (auto &entry : m_vecEntries)
+        {
+            if (entry.uId == uId)
+            {
+                return entry.pRecord;
+            }
+        }
+        return nullptr;
+    }
+
+    // 需持有registry.lock，顺便清理已经销毁的回收器的记录
+    void Add(const ReclaimerRegistry &registry, const Entry &entry)
+    {
+        size_t uKeep = 0;
+        for (auto &oldEntry : m_vecEntries)
+        {
+            if (IsAlive(registry, oldEntry))
+            {
+                m_vecEntries[uKeep++] = oldEntry;
+            }
+        }
+        m_vecEntries.resize(uKeep);
+        m_vecEntries.push_back(entry);
+    }
+
+    uint64_t m_uLastId {0};
+    ThreadRecord *m_pLastRecord {nullptr};
+
+private:
+    // 回收器地址可能被新的回收器复用，需同时比较Init时分配的标识
+    static bool IsAlive(const ReclaimerRegistry &registry, const Entry &entry)
+    {
+        for (auto pReclaimer : registry.vecReclaimers)
+        {
+            if (pReclaimer == entry.pReclaimer)
+            {
+                return pReclaimer->m_uId == entry.uId;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::vector<Entry> m_vecEntries;
+};
+
+static thread_local CThreadRecordHolder tls_recordHolder;
+
+IEpochReclaimer *IEpochReclaimer::GetInstance()
+{
+    static std::mutex s_mutex;
+    static CEpochReclaimerImpl *s_pReclaimer = nullptr;
+    if (likely(s_pReclaimer != nullptr))
+    {
+        return s_pReclaimer;
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    if (likely(s_pReclaimer != nullptr))
+    {
+        return s_pReclaimer;
+    }
+
+    auto pReclaimer = NEW CEpochReclaimerImpl();
+    if (pReclaimer == nullptr)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return nullptr;
+    }
+
+    auto iErrorNo = pReclaimer->Init(nullptr);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        delete pReclaimer;
+        SetLastError((ErrorCode)iErrorNo);
+        return nullptr;
+    }
+
+    s_pReclaimer = pReclaimer;
+    return s_pReclaimer;
+}
+
+IEpochReclaimer *IEpochReclaimer::Create()
+{
+    return NEW CEpochReclaimerImpl();
+}
+
+void IEpochReclaimer::Destroy(IEpochReclaimer *pReclaimer)
+{
+    if (pReclaimer != nullptr)
+    {
+        delete pReclaimer;
+    }
+}
+
+CEpochReclaimerImpl::~CEpochReclaimerImpl()
+{
+    Exit();
+}
+
+int32_t CEpochReclaimerImpl::Init(const IJson *pConfig)
+{
+    if (m_uId != 0)
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    m_uBatchSize = default_value::kEpochReclaimBatchSize;
+    if (pConfig != nullptr)
+    {
+        m_uBatchSize = pConfig->GetUint32(config::kEpochReclaimBatchSize, default_value::kEpochReclaimBatchSize);
+    }
+    if (m_uBatchSize == 0)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    m_pAllocator = IAllocator::GetInstance();
+
+    auto &registry = GetReclaimerRegistry();
+    std::lock_guard<std::mutex> lock(registry.lock);
+    try
+    {
+        registry.vecReclaimers.push_back(this);
+    }
+    catch (std::exception &e)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+    m_uId = registry.uNextId++;
+    return ErrorCode::kSuccess;
+}
+
+void CEpochReclaimerImpl::Exit()
+{
+    if (m_uId == 0)
+    {
+        return;
+    }
+
+    // 先注销，之后退出的线程不会再访问本回收器的记录
+    {
+        auto &registry = GetReclaimerRegistry();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        auto &vecReclaimers = registry.vecReclaimers;
+        vecReclaimers.erase(std::remove(vecReclaimers.begin(), vecReclaimers.end(), this), vecReclaimers.end());
+    }
+
+    // 调用方需保证此时没有线程处于临界区内，所有待回收节点都可以直接释放
+    auto pRecord = m_pRecordHead.exchange(nullptr, std::memory_order_acquire);
+    while (pRecord != nullptr)
+    {
+        auto pNext = pRecord->pNext;
+        ReleaseThreadRecord(pRecord);
+        delete pRecord;
+        pRecord = pNext;
+    }
+    ReclaimOrphans(0, true);
+
+    m_uRecordCount.store(0, std::memory_order_relaxed);
+    m_uId = 0;
+}
+
+CEpochReclaimerImpl::ThreadRecord *CEpochReclaimerImpl::GetThreadRecord()
+{
+    if (unlikely(m_uId == 0))
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return nullptr;
+    }
+
+    auto &holder = tls_recordHolder;
+    if (likely(holder.m_uLastId == m_uId))
+    {
+        return holder.m_pLastRecord;
+    }
+
+    auto pRecord = holder.Find(m_uId);
+    if (pRecord == nullptr)
+    {
+        pRecord = AcquireThreadRecord();
+        if (unlikely(pRecord == nullptr))
+        {
+            SetLastError(ErrorCode::kOutOfMemory);
+            return nullptr;
+        }
+
+        auto &registry = GetReclaimerRegistry();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        try
+        {
+            holder.Add(registry, CThreadRecordHolder::Entry{m_uId, this, pRecord});
+        }
+        catch (std::exception &e)
+        {
+            pRecord->bInUse.store(false, std::memory_order_release);
+            SetLastError(ErrorCode::kOutOfMemory);
+            return nullptr;
+        }
+    }
+
+    holder.m_uLastId = m_uId;
+    holder.m_pLastRecord = pRecord;
+    return pRecord;
+}
+
+CEpochReclaimerImpl::ThreadRecord *CEpochReclaimerImpl::AcquireThreadRecord()
+{
+    // 优先复用已退出线程的记录，记录数不超过同时存活的线程数
+    for (auto pRecord = m_pRecordHead.load(std::memory_order_acquire); pRecord != nullptr; pRecord = pRecord->pNext)
+    {
+        bool bInUse = false;
+        if (!pRecord->bInUse.load(std::memory_order_relaxed)
+            && pRecord->bInUse.compare_exchange_strong(bInUse, true, std::memory_order_acquire))
+        {
+            return pRecord;
+        }
+    }
+
+    auto pRecord = NEW ThreadRecord();
+    if (unlikely(pRecord == nullptr))
+    {
+        return nullptr;
+    }
+
+    pRecord->bInUse.store(true, std::memory_order_relaxed);
+    auto pHead = m_pRecordHead.load(std::memory_order_relaxed);
+    do
+    {
+        pRecord->pNext = pHead;
+    } while (!m_pRecordHead.compare_exchange_weak(pHead, pRecord, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+    m_uRecordCount.fetch_add(1, std::memory_order_relaxed);
+    return pRecord;
+}
+
+int32_t CEpochReclaimerImpl::Enter()
+{
+    auto pRecord = GetThreadRecord();
+    if (unlikely(pRecord == nullptr))
+    {
+        return GetLastError();
+    }
+
+    if (pRecord->uNestCount++ == 0)
+    {
+        auto uGlobalEpoch = m_uGlobalEpoch.load(std::memory_order_relaxed);
+        pRecord->uLocalEpoch.store((uGlobalEpoch << 1) | 1, std::memory_order_relaxed);
+        // 保证之后对共享结构的读取不会重排到发布本地epoch之前
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CEpochReclaimerImpl::Leave()
+{
+    auto pRecord = GetThreadRecord();
+    if (unlikely(pRecord == nullptr || pRecord->uNestCount == 0))
+    {
+        return;
+    }
+
+    if (--pRecord->uNestCount == 0)
+    {
+        auto uLocalEpoch = pRecord->uLocalEpoch.load(std::memory_order_relaxed);
+        pRecord->uLocalEpoch.store(uLocalEpoch & ~uint64_t(1), std::memory_order_release);
+    }
+}
+
+int32_t CEpochReclaimerImpl::Retire(void *pMem, RetireFunc pRetireFunc, void *pUserParam)
+{
+    if (unlikely(pMem == nullptr))
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    auto pRecord = GetThreadRecord();
+    if (unlikely(pRecord == nullptr))
+    {
+        return GetLastError();
+    }
+
+    auto uGlobalEpoch = m_uGlobalEpoch.load(std::memory_order_acquire);
+    auto &limboList = pRecord->aLimboLists[uGlobalEpoch % kEpochCount];
+    if (limboList.uEpoch != uGlobalEpoch)
+    {
+        // 同一个列表中的旧节点至少是3个epoch之前摘除的，可以直接释放
+        FreeLimboList(limboList);
+        limboList.uEpoch = uGlobalEpoch;
+    }
+
+    if (unlikely(limboList.uCount == limboList.uCapacity))
+    {
+        auto uNewCapacity = limboList.uCapacity == 0 ? m_uBatchSize : limboList.uCapacity * 2;
+        auto pNewEntries = m_pAllocator->Realloc(limboList.pEntries, uNewCapacity * sizeof(LimboEntry));
+        if (unlikely(pNewEntries == nullptr))
+        {
+            SetLastError(ErrorCode::kOutOfMemory);
+            return ErrorCode::kOutOfMemory;
+        }
+        limboList.pEntries = reinterpret_cast<LimboEntry *>(pNewEntries);
+        limboList.uCapacity = uNewCapacity;
+    }
+
+    limboList.pEntries[limboList.uCount++] = LimboEntry{pMem, pRetireFunc, pUserParam};
+    m_uRetiredCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (unlikely(++pRecord->uRetireSinceScan >= m_uBatchSize))
+    {
+        pRecord->uRetireSinceScan = 0;
+        TryAdvance();
+        ReclaimThreadRecord(pRecord, m_uGlobalEpoch.load(std::memory_order_acquire));
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CEpochReclaimerImpl::Flush()
+{
+    auto pRecord = GetThreadRecord();
+    if (unlikely(pRecord == nullptr))
+    {
+        return;
+    }
+
+    pRecord->uRetireSinceScan = 0;
+    TryAdvance();
+    ReclaimThreadRecord(pRecord, m_uGlobalEpoch.load(std::memory_order_acquire));
+}
+
+void CEpochReclaimerImpl::TryAdvance()
+{
+    auto uGlobalEpoch = m_uGlobalEpoch.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // 所有处于临界区内的线程都已观察到当前epoch时才能推进，记录链表只增不减，无锁遍历
+    bool bCanAdvance = true;
+    for (auto pRecord = m_pRecordHead.load(std::memory_order_acquire); pRecord != nullptr; pRecord = pRecord->pNext)
+    {
+        auto uLocalEpoch = pRecord->uLocalEpoch.load(std::memory_order_acquire);
+        if ((uLocalEpoch & 1) != 0 && (uLocalEpoch >> 1) != uGlobalEpoch)
+        {
+            bCanAdvance = false;
+            break;
+        }
+    }
+    if (bCanAdvance)
+    {
+        if (m_uGlobalEpoch.compare_exchange_strong(uGlobalEpoch, uGlobalEpoch + 1,
+                                                   std::memory_order_release, std::memory_order_relaxed))
+        {
+            m_uAdvanceCount.fetch_add(1, std::memory_order_relaxed);
+            uGlobalEpoch++;
+        }
+    }
+
+    ReclaimOrphans(uGlobalEpoch, false);
+}
+
+void CEpochReclaimerImpl::ReclaimThreadRecord(ThreadRecord *pRecord, uint64_t uGlobalEpoch)
+{
+    for (auto &limboList : pRecord->aLimboLists)
+    {
+        if (limboList.uCount != 0 && limboList.uEpoch + 2 <= uGlobalEpoch)
+        {
+            FreeLimboList(limboList);
+        }
+    }
+}
+
+void CEpochReclaimerImpl::ReclaimOrphans(uint64_t uGlobalEpoch, bool bAll)
+{
+    std::unique_lock<std::mutex> lock(m_orphanLock, std::defer_lock);
+    if (bAll)
+    {
+        lock.lock();
+    }
+    else if (!lock.try_lock())
+    {
+        // 其他线程正在回收，不必等待
+        return;
+    }
+
+    size_t uKeep = 0;
+    for (auto &orphan : m_vecOrphans)
+    {
+        if (bAll || orphan.uEpoch + 2 <= uGlobalEpoch)
+        {
+            FreeLimboEntry(orphan.entry);
+        }
+        else
+        {
+            m_vecOrphans[uKeep++] = orphan;
+        }
+    }
+    m_vecOrphans.resize(uKeep);
+}
+
+void CEpochReclaimerImpl::FreeLimboList(LimboList &limboList)
+{
+    for (uint32_t i = 0; i < limboList.uCount; ++i)
+    {
+        FreeLimboEntry(limboList.pEntries[i]);
+    }
+    limboList.uCount = 0;
+}
+
+void CEpochReclaimerImpl::FreeLimboEntry(const LimboEntry &entry)
+{
+    if (entry.pRetireFunc != nullptr)
+    {
+        entry.pRetireFunc(entry.pMem, entry.pUserParam);
+    }
+    else
+    {
+        m_pAllocator->Free(entry.pMem);
+    }
+    m_uReclaimedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CEpochReclaimerImpl::ReleaseThreadRecord(ThreadRecord *pRecord)
+{
+    for (auto &limboList : pRecord->aLimboLists)
+    {
+        FreeLimboList(limboList);
+        m_pAllocator->Free(limboList.pEntries, limboList.uCapacity * sizeof(LimboEntry));
+        limboList = LimboList{};
+    }
+    pRecord->uNestCount = 0;
+    pRecord->uRetireSinceScan = 0;
+    pRecord->uLocalEpoch.store(0, std::memory_order_relaxed);
+}
+
+void CEpochReclaimerImpl::OnThreadExit(ThreadRecord *pRecord)
+{
+    // 尚不能释放的节点转交到遗留列表，由其他线程推进epoch时释放
+    pRecord->uNestCount = 0;
+    pRecord->uRetireSinceScan = 0;
+    pRecord->uLocalEpoch.store(0, std::memory_order_release);
+
+    auto uGlobalEpoch = m_uGlobalEpoch.load(std::memory_order_acquire);
+    ReclaimThreadRecord(pRecord, uGlobalEpoch);
+    for (auto &limboList : pRecord->aLimboLists)
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_orphanLock);
+            for (uint32_t i = 0; i < limboList.uCount; ++i)
+            {
+                m_vecOrphans.push_back(OrphanEntry{limboList.uEpoch, limboList.pEntries[i]});
+            }
+        }
+        catch (std::exception &e)
+        {
+            PRINT_ERROR("failed to hand over %u retired entries: %s", limboList.uCount, e.what());
+        }
+        m_pAllocator->Free(limboList.pEntries, limboList.uCapacity * sizeof(LimboEntry));
+        limboList = LimboList{};
+    }
+
+    pRecord->bInUse.store(false, std::memory_order_release);
+}
+
+int32_t CEpochReclaimerImpl::GetStats(IJson *pJson) const
+{
+    if (pJson == nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    auto uRetiredCount = m_uRetiredCount.load(std::memory_order_relaxed);
+    auto uReclaimedCount = m_uReclaimedCount.load(std::memory_order_relaxed);
+
+    pJson->Clear();
+    pJson->SetUint64("global_epoch", m_uGlobalEpoch.load(std::memory_order_relaxed));
+    pJson->SetUint64("advance_count", m_uAdvanceCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("retired_count", uRetiredCount);
+    pJson->SetUint64("reclaimed_count", uReclaimedCount);
+    pJson->SetUint64("pending_count", uRetiredCount - uReclaimedCount);
+    pJson->SetUint64("thread_record_count", m_uRecordCount.load(std::memory_order_relaxed));
+    {
+        std::lock_guard<std::mutex> lock(m_orphanLock);
+        pJson->SetUint64("orphan_count", m_vecOrphans.size());
+    }
+    return ErrorCode::kSuccess;
+}
+
+}
+}
+}
@@ -0,0 +1,118 @@
+#ifndef __CPPX_EPOCH_RECLAIMER_IMPL_H__
+#define __CPPX_EPOCH_RECLAIMER_IMPL_H__
+
+#include <memory/epoch_reclaimer.h>
+#include <memory/allocator.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+class CThreadRecordHolder;
+
+class CEpochReclaimerImpl final : public IEpochReclaimer
+{
+public:
+    CEpochReclaimerImpl() = default;
+    CEpochReclaimerImpl(const CEpochReclaimerImpl &) = delete;
+    CEpochReclaimerImpl &operator=(const CEpochReclaimerImpl &) = delete;
+    CEpochReclaimerImpl(CEpochReclaimerImpl &&) = delete;
+    CEpochReclaimerImpl &operator=(CEpochReclaimerImpl &&) = delete;
+
+    ~CEpochReclaimerImpl() override;
+
+    int32_t Init(const IJson *pConfig) override;
+    void Exit() override;
+
+    int32_t Enter() override;
+    void Leave() override;
+
+    int32_t Retire(void *pMem, RetireFunc pRetireFunc, void *pUserParam) override;
+    void Flush() override;
+
+    int32_t GetStats(IJson *pJson) const override;
+
+private:
+    // 节点在epoch E被摘除，全局epoch推进到E+2时可以安全释放，因此只需要3个待回收列表轮转
+    static constexpr uint32_t kEpochCount = 3;
+
+    struct LimboEntry
+    {
+        void *pMem;
+        RetireFunc pRetireFunc;
+        void *pUserParam;
+    };
+
+    struct LimboList
+    {
+        uint64_t uEpoch;
+        uint32_t uCount;
+        uint32_t uCapacity;
+        LimboEntry *pEntries;
+    };
+
+    // 由回收器分配并挂在自己的记录链表上，线程退出后标记为空闲，留给新线程复用，Exit时统一释放
+    struct ThreadRecord
+    {
+        std::atomic<uint64_t> uLocalEpoch {0}; // (epoch << 1) | 是否在临界区内
+        uint32_t uNestCount {0};
+        uint32_t uRetireSinceScan {0};
+        LimboList aLimboLists[kEpochCount] {};
+        std::atomic<bool> bInUse {false};
+        ThreadRecord *pNext {nullptr};         // 放入链表后不再修改
+    };
+
+    struct OrphanEntry
+    {
+        uint64_t uEpoch;
+        LimboEntry entry;
+    };
+
+    friend class CThreadRecordHolder;
+
+    ThreadRecord *GetThreadRecord();
+
+    // 为当前线程占用一个空闲记录，没有时分配新记录
+    ThreadRecord *AcquireThreadRecord();
+
+    void TryAdvance();
+
+    void ReclaimThreadRecord(ThreadRecord *pRecord, uint64_t uGlobalEpoch);
+    void ReclaimOrphans(uint64_t uGlobalEpoch, bool bAll);
+    void FreeLimboList(LimboList &limboList);
+    void FreeLimboEntry(const LimboEntry &entry);
+
+    void ReleaseThreadRecord(ThreadRecord *pRecord);
+
+    // 线程退出时由线程本地对象的析构函数调用，尚不能释放的节点转交到遗留列表，记录标记为空闲
+    void OnThreadExit(ThreadRecord *pRecord);
+
+private:
+    IAllocator *m_pAllocator {nullptr};
+    uint64_t m_uId {0}; // 每次Init分配的唯一标识，0表示未初始化
+    uint32_t m_uBatchSize {0};
+
+    std::atomic<ThreadRecord *> m_pRecordHead {nullptr};
+    std::atomic<uint32_t> m_uRecordCount {0};
+
+    ALIGN_AS_CACHELINE std::atomic<uint64_t> m_uGlobalEpoch {0};
+
+    ALIGN_AS_CACHELINE std::atomic<uint64_t> m_uRetiredCount {0};
+    std::atomic<uint64_t> m_uReclaimedCount {0};
+    std::atomic<uint64_t> m_uAdvanceCount {0};
+
+    // 已退出线程遗留的待回收节点
+    mutable std::mutex m_orphanLock;
+    std::vector<OrphanEntry> m_vecOrphans;
+};
+
+}
+}
+}
+#endif // __CPPX_EPOCH_RECLAIMER_IMPL_H__
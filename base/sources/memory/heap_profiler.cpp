@@ -0,0 +1,499 @@
+#include "heap_profiler.h"
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+#include <algorithm>
+#include <cmath>
+#include <fcntl.h>
+#include <execinfo.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+// 槽位状态：低2位为SlotState，高位为版本号，每次占用槽位版本号加1，避免ABA
+constexpr uint32_t kStateMask = 0x3;
+constexpr uint32_t kStateGenStep = 0x4;
+
+static std::atomic<CHeapProfiler *> s_pSignalProfiler{nullptr};
+
+static thread_local int64_t tls_iBytesUntilSample = 0;
+static thread_local bool tls_bSampleInited = false;
+static thread_local uint64_t tls_uRandomSeed = 0;
+
+static inline uint64_t HashAddr(uintptr_t uAddr)
+{
+    return (uint64_t(uAddr) >> 4) * uint64_t(0x9E3779B97F4A7C15);
+}
+
+/**
+ * 基于文件描述符的简单缓冲写入，只使用write，可以在信号处理函数中使用
+ */
+class CFdWriter
+{
+public:
+    explicit CFdWriter(int32_t iFd) : m_iFd(iFd) {}
+    ~CFdWriter() { Flush(); }
+
+    void Append(const char *pData, uint64_t uLength)
+    {
+        while (uLength > 0)
+        {
+            if (m_uLength == sizeof(m_szBuffer))
+            {
+                Flush();
+            }
+            auto uCopy = std::min<uint64_t>(uLength, sizeof(m_szBuffer) - m_uLength);
+            memcpy(m_szBuffer + m_uLength, pData, uCopy);
+            m_uLength += uCopy;
+            pData += uCopy;
+            uLength -= uCopy;
+        }
+    }
+
+    void Append(const char *pStr) { Append(pStr, strlen(pStr)); }
+
+    void AppendDec(uint64_t uValue)
+    {
+        char szBuffer[24];
+        uint32_t uIndex = sizeof(szBuffer);
+        do
+        {
+            szBuffer[--uIndex] = char('0' + uValue % 10);
+            uValue /= 10;
+        } while (uValue != 0);
+        Append(szBuffer + uIndex, sizeof(szBuffer) - uIndex);
+    }
+
+    void AppendHex(uint64_t uValue)
+    {
+        static const char *s_pDigits = "0123456789abcdef";
+        char szBuffer[24];
+        uint32_t uIndex = sizeof(szBuffer);
+        do
+        {
+            szBuffer[--uIndex] = s_pDigits[uValue & 0xF];
+            uValue >>= 4;
+        } while (uValue != 0);
+        szBuffer[--uIndex] = 'x';
+        szBuffer[--uIndex] = '0';
+        Append(szBuffer + uIndex, sizeof(szBuffer) - uIndex);
+    }
+
+    bool Flush()
+    {
+        uint64_t uWritten = 0;
+        while (uWritten < m_uLength)
+        {
+            auto iRet = write(m_iFd, m_szBuffer + uWritten, m_uLength - uWritten);
+            if (iRet < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                m_bFailed = true;
+                break;
+            }
+            uWritten += (uint64_t)iRet;
+        }
+        m_uLength = 0;
+        return !m_bFailed;
+    }
+
+    bool IsFailed() const { return m_bFailed; }
+
+private:
+    int32_t m_iFd{-1};
+    bool m_bFailed{false};
+    uint64_t m_uLength{0};
+    char m_szBuffer[4096];
+};
+
+CHeapProfiler::~CHeapProfiler()
+{
+    if (m_iSignal != 0)
+    {
+        CHeapProfiler *pExpected = this;
+        s_pSignalProfiler.compare_exchange_strong(pExpected, nullptr);
+        sigaction(m_iSignal, &m_oldAction, nullptr);
+        m_iSignal = 0;
+    }
+
+    if (m_pSamples != nullptr)
+    {
+        std::free(m_pSamples);
+        m_pSamples = nullptr;
+    }
+
+    if (m_puSlotAddrs != nullptr)
+    {
+        std::free(m_puSlotAddrs);
+        m_puSlotAddrs = nullptr;
+    }
+}
+
+int32_t CHeapProfiler::Init(uint64_t uSampleIntervalBytes, uint32_t uMaxSampleCount)
+{
+    if (unlikely(uSampleIntervalBytes == 0 || uMaxSampleCount == 0))
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    // 负载因子不超过0.5，保证探测长度足够短
+    uint64_t uCapacity = 1;
+    while (uCapacity < uint64_t(uMaxSampleCount) * 2)
+    {
+        uCapacity <<= 1;
+    }
+
+    // 采样表不能通过分配器自身分配，否则会递归
+    m_pSamples = reinterpret_cast<Sample *>(std::calloc(uCapacity, sizeof(Sample)));
+    m_puSlotAddrs = reinterpret_cast<std::atomic<uintptr_t> *>(std::calloc(uCapacity, sizeof(std::atomic<uintptr_t>)));
+    if (unlikely(m_pSamples == nullptr || m_puSlotAddrs == nullptr))
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    m_uCapacity = uCapacity;
+    m_uMaxSampleCount = uMaxSampleCount;
+    m_uSampleInterval = uSampleIntervalBytes;
+    return ErrorCode::kSuccess;
+}
+
+int32_t CHeapProfiler::InstallSignal(int32_t iSignal, const char *pFilePath)
+{
+    if (unlikely(iSignal <= 0 || pFilePath == nullptr || strlen(pFilePath) >= sizeof(m_szSignalFilePath)))
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    CHeapProfiler *pExpected = nullptr;
+    if (!s_pSignalProfiler.compare_exchange_strong(pExpected, this))
+    {
+        SetLastError(ErrorCode::kInvalidCall);
+        return ErrorCode::kInvalidCall;
+    }
+
+    snprintf(m_szSignalFilePath, sizeof(m_szSignalFilePath), "%s", pFilePath);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &CHeapProfiler::SignalHandler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(iSignal, &action, &m_oldAction) != 0)
+    {
+        s_pSignalProfiler.store(nullptr);
+        SetLastError(ErrorCode::kSysCallFailed);
+        return ErrorCode::kSysCallFailed;
+    }
+
+    m_iSignal = iSignal;
+    return ErrorCode::kSuccess;
+}
+
+uint64_t CHeapProfiler::NextSampleInterval()
+{
+    if (unlikely(tls_uRandomSeed == 0))
+    {
+        uint64_t uNow = 0;
+        clock_get_time_nano(uNow);
+        tls_uRandomSeed = (uNow ^ (gettid() << 32)) | 1;
+    }
+
+    // xorshift64
+    tls_uRandomSeed ^= tls_uRandomSeed << 13;
+    tls_uRandomSeed ^= tls_uRandomSeed >> 7;
+    tls_uRandomSeed ^= tls_uRandomSeed << 17;
+
+    // 采样间隔服从指数分布，均值为m_uSampleInterval，避免和固定分配模式共振
+    double dRandom = double((tls_uRandomSeed >> 11) + 1) / double(uint64_t(1) << 53);
+    double dInterval = -std::log(dRandom) * double(m_uSampleInterval);
+    return dInterval < 1.0 ? 1 : uint64_t(dInterval);
+}
+
+bool CHeapProfiler::ShouldSample(uint64_t uSize)
+{
+    if (unlikely(!tls_bSampleInited))
+    {
+        tls_bSampleInited = true;
+        tls_iBytesUntilSample = (int64_t)NextSampleInterval();
+    }
+
+    tls_iBytesUntilSample -= (int64_t)uSize;
+    if (likely(tls_iBytesUntilSample > 0))
+    {
+        return false;
+    }
+
+    tls_iBytesUntilSample = (int64_t)NextSampleInterval();
+    return true;
+}
+
+void CHeapProfiler::RecordSample(const void *pMem, uint64_t uSize)
+{
+    if (unlikely(pMem == nullptr))
+    {
+        return;
+    }
+
+    if (m_uLiveCount.load(std::memory_order_relaxed) >= m_uMaxSampleCount)
+    {
+        m_uDroppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto uAddr = reinterpret_cast<uintptr_t>(pMem);
+    auto uIndex = HashAddr(uAddr);
+    auto uProbeCount = std::min<uint64_t>(kMaxProbeCount, m_uCapacity);
+    for (uint64_t i = 0; i < uProbeCount; ++i)
+    {
+        auto uSlot = (uIndex + i) & (m_uCapacity - 1);
+        auto &sample = m_pSamples[uSlot];
+        auto uState = sample.uState.load(std::memory_order_acquire);
+        auto eSlotState = uState & kStateMask;
+        if (eSlotState != SlotState::kEmpty && eSlotState != SlotState::kDeleted)
+        {
+            continue;
+        }
+
+        auto uBusyState = ((uState & ~kStateMask) + kStateGenStep) | SlotState::kBusy;
+        if (!sample.uState.compare_exchange_strong(uState, uBusyState, std::memory_order_acquire))
+        {
+            continue;
+        }
+
+        // 跳过RecordSample和OnMalloc/Malloc自身的栈帧
+        void *apStack[kMaxStackDepth + 2];
+        auto iDepth = backtrace(apStack, kMaxStackDepth + 2);
+        iDepth = iDepth > 2 ? iDepth - 2 : 0;
+        memcpy(sample.apStack, apStack + 2, iDepth * sizeof(void *));
+        sample.uDepth = (uint32_t)iDepth;
+        sample.uAddr = uAddr;
+        sample.uSize = uSize;
+        sample.uState.store((uBusyState & ~kStateMask) | SlotState::kLive, std::memory_order_release);
+        m_puSlotAddrs[uSlot].store(uAddr, std::memory_order_release);
+
+        m_uLiveCount.fetch_add(1, std::memory_order_relaxed);
+        m_uLiveBytes.fetch_add(uSize, std::memory_order_relaxed);
+        m_uSampledCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_uDroppedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t CHeapProfiler::FindSlot(uintptr_t uAddr) const
+{
+    // 只扫描紧凑的地址数组，窗口外不会有该地址的采样，删除留下的槽位不会拉长探测
+    auto uIndex = HashAddr(uAddr);
+    auto uProbeCount = std::min<uint64_t>(kMaxProbeCount, m_uCapacity);
+    for (uint64_t i = 0; i < uProbeCount; ++i)
+    {
+        auto uSlot = (uIndex + i) & (m_uCapacity - 1);
+        if (m_puSlotAddrs[uSlot].load(std::memory_order_acquire) == uAddr)
+        {
+            return uSlot;
+        }
+    }
+    return m_uCapacity;
+}
+
+uint64_t CHeapProfiler::RemoveSample(const void *pMem)
+{
+    auto uAddr = reinterpret_cast<uintptr_t>(pMem);
+    auto uSlot = FindSlot(uAddr);
+    if (uSlot == m_uCapacity)
+    {
+        return 0;
+    }
+
+    // 先清除地址再释放槽位，槽位被重新占用后写入的新地址不会被覆盖；
+    // 同一地址只会被一个线程释放，清除成功后槽位只由当前线程修改
+    if (!m_puSlotAddrs[uSlot].compare_exchange_strong(uAddr, 0, std::memory_order_acq_rel))
+    {
+        return 0;
+    }
+
+    auto &sample = m_pSamples[uSlot];
+    auto uSize = sample.uSize;
+    auto uState = sample.uState.load(std::memory_order_relaxed);
+    sample.uState.store((uState & ~kStateMask) | SlotState::kDeleted, std::memory_order_release);
+    m_uLiveCount.fetch_sub(1, std::memory_order_relaxed);
+    m_uLiveBytes.fetch_sub(uSize, std::memory_order_relaxed);
+    return uSize;
+}
+
+void CHeapProfiler::ResizeSample(const void *pMem, uint64_t uSize)
+{
+    auto uSlot = FindSlot(reinterpret_cast<uintptr_t>(pMem));
+    if (uSlot == m_uCapacity)
+    {
+        return;
+    }
+
+    // 经过kBusy并增加版本号，Dump期间修改时丢弃该采样
+    auto &sample = m_pSamples[uSlot];
+    auto uState = sample.uState.load(std::memory_order_relaxed);
+    auto uBusyState = ((uState & ~kStateMask) + kStateGenStep) | SlotState::kBusy;
+    sample.uState.store(uBusyState, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    auto uOldSize = sample.uSize;
+    sample.uSize = uSize;
+    sample.uState.store((uBusyState & ~kStateMask) | SlotState::kLive, std::memory_order_release);
+    m_uLiveBytes.fetch_add(uSize - uOldSize, std::memory_order_relaxed);
+}
+
+int32_t CHeapProfiler::Dump(const char *pFilePath) const
+{
+    if (unlikely(pFilePath == nullptr))
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    auto iFd = open(pFilePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (unlikely(iFd < 0))
+    {
+        SetLastError(ErrorCode::kSysCallFailed);
+        return ErrorCode::kSysCallFailed;
+    }
+
+    auto iErrorNo = DumpToFd(iFd);
+    close(iFd);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        SetLastError((ErrorCode)iErrorNo);
+    }
+    return iErrorNo;
+}
+
+int32_t CHeapProfiler::DumpToFd(int32_t iFd) const
+{
+    uint64_t uTotalCount = 0;
+    uint64_t uTotalBytes = 0;
+    for (uint64_t i = 0; i < m_uCapacity; ++i)
+    {
+        if ((m_pSamples[i].uState.load(std::memory_order_acquire) & kStateMask) == SlotState::kLive)
+        {
+            uTotalCount++;
+            uTotalBytes += m_pSamples[i].uSize;
+        }
+    }
+
+    CFdWriter writer(iFd);
+    // heap profile: <inuse_objs>: <inuse_bytes> [<alloc_objs>: <alloc_bytes>] @ heap_v2/<sample_period>
+    writer.Append("heap profile: ");
+    writer.AppendDec(uTotalCount);
+    writer.Append(": ");
+    writer.AppendDec(uTotalBytes);
+    writer.Append(" [");
+    writer.AppendDec(uTotalCount);
+    writer.Append(": ");
+    writer.AppendDec(uTotalBytes);
+    writer.Append("] @ heap_v2/");
+    writer.AppendDec(m_uSampleInterval);
+    writer.Append("\n");
+
+    void *apStack[kMaxStackDepth];
+    for (uint64_t i = 0; i < m_uCapacity; ++i)
+    {
+        auto &sample = m_pSamples[i];
+        auto uState = sample.uState.load(std::memory_order_acquire);
+        if ((uState & kStateMask) != SlotState::kLive)
+        {
+            continue;
+        }
+
+        auto uSize = sample.uSize;
+        auto uDepth = std::min(sample.uDepth, kMaxStackDepth);
+        memcpy(apStack, sample.apStack, uDepth * sizeof(void *));
+        // 拷贝期间槽位被释放或者重用，则丢弃
+        if (sample.uState.load(std::memory_order_acquire) != uState)
+        {
+            continue;
+        }
+
+        writer.Append("1: ");
+        writer.AppendDec(uSize);
+        writer.Append(" [1: ");
+        writer.AppendDec(uSize);
+        writer.Append("] @");
+        for (uint32_t j = 0; j < uDepth; ++j)
+        {
+            writer.Append(" ");
+            writer.AppendHex(reinterpret_cast<uintptr_t>(apStack[j]));
+        }
+        writer.Append("\n");
+    }
+
+    // pprof根据MAPPED_LIBRARIES做符号解析
+    writer.Append("\nMAPPED_LIBRARIES:\n");
+    auto iMapsFd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if (iMapsFd >= 0)
+    {
+        char szBuffer[4096];
+        ssize_t iRead = 0;
+        while ((iRead = read(iMapsFd, szBuffer, sizeof(szBuffer))) != 0)
+        {
+            if (iRead < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+            writer.Append(szBuffer, (uint64_t)iRead);
+        }
+        close(iMapsFd);
+    }
+
+    if (!writer.Flush())
+    {
+        return ErrorCode::kSysCallFailed;
+    }
+    return ErrorCode::kSuccess;
+}
+
+void CHeapProfiler::SignalHandler(int32_t iSignal)
+{
+    UNSED(iSignal);
+    auto iSavedErrno = errno;
+    auto pProfiler = s_pSignalProfiler.load(std::memory_order_acquire);
+    if (pProfiler != nullptr)
+    {
+        auto iFd = open(pProfiler->m_szSignalFilePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (iFd >= 0)
+        {
+            pProfiler->DumpToFd(iFd);
+            close(iFd);
+        }
+    }
+    errno = iSavedErrno;
+}
+
+int32_t CHeapProfiler::GetStats(IJson *pJson) const
+{
+    if (unlikely(pJson == nullptr))
+    {
+        return ErrorCode::kInvalidParam;
+    }
+
+    pJson->SetUint64("sample_interval_bytes", m_uSampleInterval);
+    pJson->SetUint64("sampled_count", m_uSampledCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("dropped_count", m_uDroppedCount.load(std::memory_order_relaxed));
+    pJson->SetUint32("live_count", m_uLiveCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("live_bytes", m_uLiveBytes.load(std::memory_order_relaxed));
+    return ErrorCode::kSuccess;
+}
+
+}
+}
+}
@@ -0,0 +1,143 @@
+#ifndef __CPPX_HEAP_PROFILER_H__
+#define __CPPX_HEAP_PROFILER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <signal.h>
+#include <utilities/common.h>
+#include <utilities/json.h>
+
+namespace cppx
+{
+namespace base
+{
+namespace memory
+{
+
+/**
+ * 采样式堆分析器
+ * 平均每分配uSampleIntervalBytes字节采样一次，记录调用栈到无锁哈希表中，
+ * 释放时从表中移除，因此表中始终是存活的采样对象。
+ * 采样只放在哈希位置起kMaxProbeCount个槽位内，窗口满时丢弃；槽位地址另存一份紧凑数组，
+ * 释放时只扫描窗口内的地址，探测长度不随删除次数增长。
+ * dump格式兼容gperftools的heap profile(heap_v2)，可直接使用pprof分析。
+ */
+class CHeapProfiler
+{
+public:
+    static constexpr uint32_t kMaxStackDepth = 32;
+    static constexpr uint32_t kMaxProbeCount = 16;
+
+    CHeapProfiler() = default;
+    CHeapProfiler(const CHeapProfiler &) = delete;
+    CHeapProfiler &operator=(const CHeapProfiler &) = delete;
+    CHeapProfiler(CHeapProfiler &&) = delete;
+    CHeapProfiler &operator=(CHeapProfiler &&) = delete;
+
+    ~CHeapProfiler();
+
+    int32_t Init(uint64_t uSampleIntervalBytes, uint32_t uMaxSampleCount);
+
+    /**
+     * @brief 注册dump信号，收到信号时将profile写入pFilePath
+     * @note 同一时刻只有一个分析器可以注册信号
+     */
+    int32_t InstallSignal(int32_t iSignal, const char *pFilePath);
+
+    void OnMalloc(const void *pMem, uint64_t uSize)
+    {
+        if (unlikely(ShouldSample(uSize)))
+        {
+            RecordSample(pMem, uSize);
+        }
+    }
+
+    /**
+     * @return 被采样时返回采样的大小，否则返回0
+     */
+    uint64_t OnFree(const void *pMem)
+    {
+        if (unlikely(m_uLiveCount.load(std::memory_order_relaxed) != 0))
+        {
+            return RemoveSample(pMem);
+        }
+        return 0;
+    }
+
+    // 释放失败时恢复OnFree移除的采样，例如realloc失败
+    void OnRestore(const void *pMem, uint64_t uSize)
+    {
+        if (uSize != 0)
+        {
+            RecordSample(pMem, uSize);
+        }
+    }
+
+    // 原地扩展成功后更新采样的大小
+    void OnResize(const void *pMem, uint64_t uSize)
+    {
+        if (unlikely(m_uLiveCount.load(std::memory_order_relaxed) != 0))
+        {
+            ResizeSample(pMem, uSize);
+        }
+    }
+
+    int32_t Dump(const char *pFilePath) const;
+
+    int32_t GetStats(IJson *pJson) const;
+
+private:
+    enum SlotState : uint32_t
+    {
+        kEmpty = 0,
+        kBusy,
+        kLive,
+        kDeleted,
+    };
+
+    struct Sample
+    {
+        std::atomic<uint32_t> uState;
+        uint32_t uDepth;
+        uintptr_t uAddr;
+        uint64_t uSize;
+        void *apStack[kMaxStackDepth];
+    };
+
+    bool ShouldSample(uint64_t uSize);
+    uint64_t NextSampleInterval();
+
+    void RecordSample(const void *pMem, uint64_t uSize);
+    uint64_t RemoveSample(const void *pMem);
+    void ResizeSample(const void *pMem, uint64_t uSize);
+
+    // 在探测窗口内查找地址为uAddr的槽位，没有返回m_uCapacity
+    uint64_t FindSlot(uintptr_t uAddr) const;
+
+    // 只使用异步信号安全的函数，可以在信号处理函数中调用
+    int32_t DumpToFd(int32_t iFd) const;
+
+    static void SignalHandler(int32_t iSignal);
+
+private:
+    uint64_t m_uSampleInterval{0};
+    Sample *m_pSamples{nullptr};
+    std::atomic<uintptr_t> *m_puSlotAddrs{nullptr}; // 各槽位存活采样的地址，没有为0
+    uint64_t m_uCapacity{0};
+    uint32_t m_uMaxSampleCount{0};
+
+    std::atomic<uint32_t> m_uLiveCount{0};
+    std::atomic<uint64_t> m_uLiveBytes{0};
+    std::atomic<uint64_t> m_uSampledCount{0};
+    std::atomic<uint64_t> m_uDroppedCount{0};
+
+    int32_t m_iSignal{0};
+    struct sigaction m_oldAction;
+    char m_szSignalFilePath[MAX_PATH_LEN];
+};
+
+}
+}
+}
+
+#endif // __CPPX_HEAP_PROFILER_H__
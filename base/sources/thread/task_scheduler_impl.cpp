@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 #include <utilities/common.h>
 #include <utilities/error_code.h>
 #include "task_scheduler_impl.h"
@@ -16,7 +21,39 @@ ITaskScheduler *ITaskScheduler::Create(const char *pSchedulerName, uint32_t uPre
         return nullptr;
     }
 
-    auto iErrorNo = pScheduler->Init(pSchedulerName, uPrecisionUs);
+    auto iErrorNo = pScheduler->Init(pSchedulerName, uPrecisionUs, default_value::kTaskSchedulerTimer,
+                                     default_value::kTaskSchedulerTickUs, default_value::kTaskSchedulerSleep,
+                                     default_value::kTaskSchedulerSpinUs);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        delete pScheduler;
+        return nullptr;
+    }
+
+    return pScheduler;
+}
+
+ITaskScheduler *ITaskScheduler::Create(const char *pSchedulerName, IJson *pConfig)
+{
+    if (pConfig == nullptr)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return nullptr;
+    }
+
+    CTaskSchedulerImpl *pScheduler = NEW CTaskSchedulerImpl();
+    if (pScheduler == nullptr)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return nullptr;
+    }
+
+    auto iErrorNo = pScheduler->Init(pSchedulerName,
+        pConfig->GetUint32(config::kTaskSchedulerPrecisionUs, default_value::kTaskSchedulerPrecisionUs),
+        pConfig->GetUint32(config::kTaskSchedulerTimer, default_value::kTaskSchedulerTimer),
+        pConfig->GetUint32(config::kTaskSchedulerTickUs, default_value::kTaskSchedulerTickUs),
+        pConfig->GetUint32(config::kTaskSchedulerSleep, default_value::kTaskSchedulerSleep),
+        pConfig->GetUint32(config::kTaskSchedulerSpinUs, default_value::kTaskSchedulerSpinUs));
     if (iErrorNo != ErrorCode::kSuccess)
     {
         delete pScheduler;
@@ -37,16 +74,53 @@ void ITaskScheduler::Destroy(ITaskScheduler *pScheduler)
 CTaskSchedulerImpl::~CTaskSchedulerImpl()
 {
     Stop();
+    // 节点的内存由节点池统一释放
+    delete m_pTimerQueue;
+    if (m_iTimerFd >= 0)
+    {
+        close(m_iTimerFd);
+    }
+    if (m_iEventFd >= 0)
+    {
+        close(m_iEventFd);
+    }
 }
 
-int32_t CTaskSchedulerImpl::Init(const char *pSchedulerName, uint32_t uPrecisionUs)
+int32_t CTaskSchedulerImpl::Init(const char *pSchedulerName, uint32_t uPrecisionUs, uint32_t uTimerType, uint32_t uTickUs,
+                                 uint32_t uSleepType, uint32_t uSpinUs)
 {
     if (pSchedulerName == nullptr)
     {
         pSchedulerName = "";
     }
 
+    if (uTimerType > (uint32_t)TimerType::kWheel || uSleepType > (uint32_t)SleepType::kTimerfd)
+    {
+        SetLastError(ErrorCode::kInvalidParam);
+        return ErrorCode::kInvalidParam;
+    }
+
+    m_pTimerQueue = CTimerQueue::Create(uTimerType, uTickUs);
+    if (m_pTimerQueue == nullptr)
+    {
+        SetLastError(ErrorCode::kOutOfMemory);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    if (uSleepType == (uint32_t)SleepType::kTimerfd)
+    {
+        m_iTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        m_iEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_iTimerFd < 0 || m_iEventFd < 0)
+        {
+            SetLastError(ErrorCode::kSysCallFailed);
+            return ErrorCode::kSysCallFailed;
+        }
+    }
+
     m_uCondWaitUs = uPrecisionUs;
+    m_uSleepType = uSleepType;
+    m_uSpinNs = uint64_t(uSpinUs) * kMicro;
     m_strSchedulerName = pSchedulerName;
     m_pThreadManager = IThreadManager::GetInstance();
     m_pThread = m_pThreadManager->CreateThread();
@@ -67,6 +141,7 @@ int32_t CTaskSchedulerImpl::Start()
         return ErrorCode::kInvalidParam;
     }
 
+    m_bStopping.store(false, std::memory_order_relaxed);
     return m_pThread->Start();
 }
 
@@ -78,7 +153,9 @@ void CTaskSchedulerImpl::Stop()
         return;
     }
 
-    m_cond.notify_one();
+    // timerfd方式没有任务时会一直休眠，先唤醒调度线程，之后不再休眠，直到线程退出
+    m_bStopping.store(true, std::memory_order_seq_cst);
+    Wakeup();
     m_pThread->Stop();
 }
 int64_t CTaskSchedulerImpl::PostTask(Task *pTask)
@@ -101,31 +178,32 @@ int64_t CTaskSchedulerImpl::PostTask(Task *pTask)
     clock_get_time_nano(uExecTimeNs);
     uExecTimeNs += (pTask->uDelayUs * kMicro);
 
-    std::lock_guard<std::mutex> guard(m_lock);
-    while (unlikely(m_mapTasks.count(uExecTimeNs)) != 0)
+    auto pNode = m_nodePool.Alloc();
+    if (unlikely(pNode == nullptr))
     {
-        ++uExecTimeNs;
+        SetLastError(ErrorCode::kOutOfMemory);
+        return TaskID::kInvalidTaskID;
     }
 
-    try
-    {
-        auto &taskEx = m_mapTasks[uExecTimeNs];
-        taskEx.task = *pTask;
-        taskEx.uTaskExecCount = 0;
-        taskEx.iTaskID = m_iNextTaskID;
+    pNode->uExpireNs = uExecTimeNs;
+    pNode->uDeadlineNs.store(uExecTimeNs, std::memory_order_relaxed);
+    pNode->task = *pTask;
+    pNode->task.uFlags &= ~(TaskFlag::kTaskCancel | TaskFlag::kTaskRunning);
+    pNode->uExecCount = 0;
 
-        if (pTask->uDelayUs == 0)
-        {
-            m_cond.notify_one();
-        }
-    }
-    catch(std::exception &e)
+    // 提交链表中的节点带待处理标志，被调度线程取走之前的取消和重新调度只修改状态，不放入待处理链表
+    auto uState = pNode->uState.fetch_or(TaskNode::kStatePending, std::memory_order_relaxed);
+    m_uPostCount.fetch_add(1, std::memory_order_relaxed);
+    m_uTaskCount.fetch_add(1, std::memory_order_relaxed);
+
+    auto pHead = m_pIntakeHead.load(std::memory_order_relaxed);
+    do
     {
-        SetLastError(ErrorCode::kThrowException);
-        return TaskID::kInvalidTaskID;
-    }
+        pNode->pPendingNext = pHead;
+    } while (!m_pIntakeHead.compare_exchange_weak(pHead, pNode, std::memory_order_seq_cst, std::memory_order_relaxed));
 
-    return m_iNextTaskID++;
+    WakeupIfEarlier(uExecTimeNs);
+    return MakeTaskID(uState, pNode->uIndex);
 }
 
 int64_t CTaskSchedulerImpl::PostOnceTask(const char *pTaskName, TaskFunc pFunc, void *pCtx, uint32_t uDelayUs)
@@ -159,26 +237,341 @@ int64_t CTaskSchedulerImpl::PostPeriodicTask(const char* pTaskName, TaskFunc pFu
     return PostTask(&task);
 }
 
+TaskNode *CTaskSchedulerImpl::FindNode(int64_t iTaskID, uint64_t &uState) const
+{
+    if (unlikely(iTaskID < 0))
+    {
+        return nullptr;
+    }
+
+    auto pNode = m_nodePool.Get(uint32_t(iTaskID));
+    if (unlikely(pNode == nullptr))
+    {
+        return nullptr;
+    }
+
+    uState = pNode->uState.load(std::memory_order_acquire);
+    return (uState >> 32) == (uint64_t(iTaskID) >> 32) ? pNode : nullptr;
+}
+
+void CTaskSchedulerImpl::PushPending(TaskNode *pNode)
+{
+    auto pHead = m_pPendingHead.load(std::memory_order_relaxed);
+    do
+    {
+        pNode->pPendingNext = pHead;
+    } while (!m_pPendingHead.compare_exchange_weak(pHead, pNode, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed));
+}
+
 int32_t CTaskSchedulerImpl::CancleTask(int64_t iTaskID)
 {
-    /**
-     * 暂时先这么实现，问题点：
-     * 遍历时间过长导致其他任务无法及时执行
-    */
-    std::lock_guard<std::mutex> guard(m_lock);
-    for (auto &taskEx : m_mapTasks)
+    // 只设置取消标志，节点由调度线程在DrainPending中从定时器队列删除并回收
+    uint64_t uState = 0;
+    auto pNode = FindNode(iTaskID, uState);
+    while (pNode != nullptr)
     {
-        if (taskEx.second.iTaskID == iTaskID)
+        if (uState & TaskNode::kStateCancel)
         {
-            taskEx.second.task.uFlags |= TaskFlag::kTaskCancel;
             return 0;
         }
+
+        if (pNode->uState.compare_exchange_weak(uState, uState | TaskNode::kStateCancel | TaskNode::kStatePending,
+                                                std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            m_uCancelCount.fetch_add(1, std::memory_order_relaxed);
+            if ((uState & TaskNode::kStatePending) == 0)
+            {
+                PushPending(pNode);
+            }
+            return 0;
+        }
+
+        // 比较失败时uState已更新为最新值，节点被回收后代数变化
+        if ((uState >> 32) != (uint64_t(iTaskID) >> 32))
+        {
+            break;
+        }
+    }
+
+    SetLastError(ErrorCode::kInvalidParam);
+    return ErrorCode::kInvalidParam;
+}
+
+int32_t CTaskSchedulerImpl::RescheduleTask(int64_t iTaskID, uint32_t uDelayUs)
+{
+    uint64_t uDeadlineNs;
+    clock_get_time_nano(uDeadlineNs);
+    uDeadlineNs += (uDelayUs * kMicro);
+
+    uint64_t uState = 0;
+    auto pNode = FindNode(iTaskID, uState);
+    while (pNode != nullptr && (uState & TaskNode::kStateCancel) == 0)
+    {
+        // 先登记为写者并置待处理标志，节点在写完之前不会被回收
+        auto uNewState = (uState + TaskNode::kStateWriterUnit) | TaskNode::kStatePending;
+        if (pNode->uState.compare_exchange_weak(uState, uNewState, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            pNode->uDeadlineNs.store(uDeadlineNs, std::memory_order_relaxed);
+            pNode->uState.fetch_sub(TaskNode::kStateWriterUnit, std::memory_order_release);
+            m_uRescheduleCount.fetch_add(1, std::memory_order_relaxed);
+            if ((uState & TaskNode::kStatePending) == 0)
+            {
+                PushPending(pNode);
+            }
+            WakeupIfEarlier(uDeadlineNs);
+            return 0;
+        }
+
+        if ((uState >> 32) != (uint64_t(iTaskID) >> 32))
+        {
+            break;
+        }
     }
 
     SetLastError(ErrorCode::kInvalidParam);
     return ErrorCode::kInvalidParam;
 }
 
+void CTaskSchedulerImpl::DrainIntake()
+{
+    // 链表是后进先出的，反转后按提交顺序插入，到期时间相同的任务按提交顺序执行
+    auto pNode = m_pIntakeHead.exchange(nullptr, std::memory_order_acquire);
+    TaskNode *pReversed = nullptr;
+    while (pNode != nullptr)
+    {
+        auto pNext = pNode->pPendingNext;
+        pNode->pPendingNext = pReversed;
+        pReversed = pNode;
+        pNode = pNext;
+    }
+
+    while (pReversed != nullptr)
+    {
+        pNode = pReversed;
+        pReversed = pNode->pPendingNext;
+        try
+        {
+            InsertNode(pNode);
+        }
+        catch(std::exception &e)
+        {
+            SetLastError(ErrorCode::kThrowException);
+        }
+        ApplyPending(pNode);
+    }
+}
+
+void CTaskSchedulerImpl::DrainPending()
+{
+    auto pNode = m_pPendingHead.exchange(nullptr, std::memory_order_acquire);
+    while (pNode != nullptr)
+    {
+        auto pNext = pNode->pPendingNext;
+        ApplyPending(pNode);
+        pNode = pNext;
+    }
+}
+
+void CTaskSchedulerImpl::ApplyPending(TaskNode *pNode)
+{
+    // 等待正在修改到期时间的线程写完再清除待处理标志，之后的修改会重新放入链表
+    auto uState = pNode->uState.load(std::memory_order_acquire);
+    do
+    {
+        while (unlikely(uState & TaskNode::kStateWriterMask))
+        {
+            std::this_thread::yield();
+            uState = pNode->uState.load(std::memory_order_acquire);
+        }
+    } while (!pNode->uState.compare_exchange_weak(uState, uState & ~TaskNode::kStatePending,
+                                                  std::memory_order_acq_rel, std::memory_order_acquire));
+
+    if (uState & TaskNode::kStateCancel)
+    {
+        if (pNode->bQueued)
+        {
+            RemoveNode(pNode);
+        }
+        TryReleaseNode(pNode);
+    }
+    else if (pNode->bQueued)
+    {
+        // 推迟的到期时间在节点到期时再生效，提前的需要重新插入
+        auto uDeadlineNs = pNode->uDeadlineNs.load(std::memory_order_relaxed);
+        if (uDeadlineNs < pNode->uExpireNs)
+        {
+            RemoveNode(pNode);
+            pNode->uExpireNs = uDeadlineNs;
+            InsertNode(pNode);
+        }
+    }
+    else
+    {
+        // 执行结束时正在被修改，或者插入定时器队列失败，没能回收；
+        // 最后一次执行之后才修改的到期时间与本次执行的不同，按修改后的时间再执行一次
+        auto uDeadlineNs = pNode->uDeadlineNs.load(std::memory_order_relaxed);
+        if (uDeadlineNs != pNode->uExpireNs)
+        {
+            pNode->uExpireNs = uDeadlineNs;
+            try
+            {
+                InsertNode(pNode);
+                return;
+            }
+            catch(std::exception &e)
+            {
+                SetLastError(ErrorCode::kThrowException);
+            }
+        }
+        TryReleaseNode(pNode);
+    }
+}
+
+bool CTaskSchedulerImpl::PrepareSleep(uint64_t uSleepTargetNs)
+{
+    // 与WakeupIfEarlier配对：先发布休眠时间再检查链表，提交方先入链表再读取休眠时间，
+    // 两边都是顺序一致的操作，至少有一方能看到对方的修改
+    m_uSleepTargetNs.store(uSleepTargetNs, std::memory_order_seq_cst);
+    return m_pIntakeHead.load(std::memory_order_seq_cst) != nullptr
+        || m_pPendingHead.load(std::memory_order_seq_cst) != nullptr
+        || m_bStopping.load(std::memory_order_seq_cst);
+}
+
+void CTaskSchedulerImpl::WakeupIfEarlier(uint64_t uDeadlineNs)
+{
+    if (uDeadlineNs < m_uSleepTargetNs.load(std::memory_order_seq_cst))
+    {
+        Wakeup();
+        m_uWakeupCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void CTaskSchedulerImpl::Wakeup()
+{
+    if (m_iEventFd >= 0)
+    {
+        uint64_t uValue = 1;
+        auto iRet = write(m_iEventFd, &uValue, sizeof(uValue));
+        (void)iRet;
+    }
+    else
+    {
+        // 先加锁，保证通知不会发生在调度线程检查条件和开始等待之间
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+        }
+        m_cond.notify_one();
+    }
+}
+
+void CTaskSchedulerImpl::WaitCond()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    uint64_t uNowNs;
+    clock_get_time_nano(uNowNs);
+    auto uSleepTargetNs = std::min(m_pTimerQueue->GetNextExpireNs(), uNowNs + m_uCondWaitUs * kMicro);
+    if (uSleepTargetNs > uNowNs + m_uSpinNs && !PrepareSleep(uSleepTargetNs))
+    {
+        m_cond.wait_for(lock, std::chrono::microseconds(m_uCondWaitUs), [&] () 
+            { 
+                uint64_t uExecTimeNs;
+                clock_get_time_nano(uExecTimeNs);
+                return m_pTimerQueue->GetNextExpireNs() <= uExecTimeNs + m_uSpinNs
+                        || m_pIntakeHead.load(std::memory_order_relaxed) != nullptr
+                        || m_pPendingHead.load(std::memory_order_relaxed) != nullptr
+                        || m_bStopping.load(std::memory_order_relaxed);
+            });
+    }
+    m_uSleepTargetNs.store(0, std::memory_order_relaxed);
+}
+
+void CTaskSchedulerImpl::WaitTimer()
+{
+    // 定时器队列只由调度线程修改，在调度线程中读取不需要加锁
+    auto uNextNs = m_pTimerQueue->GetNextExpireNs();
+    uint64_t uNowNs;
+    clock_get_time_nano(uNowNs);
+    if (uNextNs <= uNowNs + m_uSpinNs || PrepareSleep(uNextNs))
+    {
+        m_uSleepTargetNs.store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    // 按绝对时间定时，没有到期任务时解除定时，只等待唤醒
+    itimerspec timerSpec {};
+    if (uNextNs != UINT64_MAX)
+    {
+        auto uWakeNs = uNextNs - m_uSpinNs;
+        timerSpec.it_value.tv_sec = time_t(uWakeNs / kSecond);
+        timerSpec.it_value.tv_nsec = long(uWakeNs % kSecond);
+    }
+    if (unlikely(timerfd_settime(m_iTimerFd, TFD_TIMER_ABSTIME, &timerSpec, nullptr) != 0))
+    {
+        SetLastError(ErrorCode::kSysCallFailed);
+    }
+    else
+    {
+        pollfd aPollFds[2] = {{m_iTimerFd, POLLIN, 0}, {m_iEventFd, POLLIN, 0}};
+        poll(aPollFds, 2, -1);
+
+        uint64_t uValue;
+        if (aPollFds[0].revents & POLLIN)
+        {
+            auto iRet = read(m_iTimerFd, &uValue, sizeof(uValue));
+            (void)iRet;
+        }
+        if (aPollFds[1].revents & POLLIN)
+        {
+            auto iRet = read(m_iEventFd, &uValue, sizeof(uValue));
+            (void)iRet;
+        }
+    }
+    m_uSleepTargetNs.store(0, std::memory_order_relaxed);
+}
+
+void CTaskSchedulerImpl::SpinUntilExpire()
+{
+    if (m_uSpinNs == 0)
+    {
+        return;
+    }
+
+    auto uNextNs = m_pTimerQueue->GetNextExpireNs();
+    uint64_t uNowNs;
+    clock_get_time_nano(uNowNs);
+    while (uNowNs < uNextNs && uNextNs - uNowNs <= m_uSpinNs
+           && m_pIntakeHead.load(std::memory_order_relaxed) == nullptr
+           && !m_bStopping.load(std::memory_order_relaxed))
+    {
+        clock_get_time_nano(uNowNs);
+    }
+}
+
+bool CTaskSchedulerImpl::TryReleaseNode(TaskNode *pNode)
+{
+    auto uState = pNode->uState.load(std::memory_order_acquire);
+    do
+    {
+        if (uState & TaskNode::kStatePending)
+        {
+            return false;
+        }
+        // 代数只占31位，保证TaskID非负，且跳过0
+        auto uGeneration = uState >> 32;
+        uGeneration = uGeneration >= 0x7FFFFFFF ? 1 : uGeneration + 1;
+        if (pNode->uState.compare_exchange_weak(uState, uGeneration << 32, std::memory_order_acq_rel,
+                                                std::memory_order_acquire))
+        {
+            break;
+        }
+    } while (true);
+
+    m_nodePool.Free(pNode);
+    m_uTaskCount.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
 int32_t CTaskSchedulerImpl::GetStats(IJson *pJson) const
 {
     if (pJson == nullptr)
@@ -188,6 +581,18 @@ int32_t CTaskSchedulerImpl::GetStats(IJson *pJson) const
     }
 
     pJson->Clear();
+    std::lock_guard<std::mutex> guard(m_lock);
+    pJson->SetString("name", m_strSchedulerName.c_str());
+    pJson->SetUint64("task_count", m_uTaskCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("post_count", m_uPostCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("exec_count", m_uExecCount);
+    pJson->SetUint64("cancel_count", m_uCancelCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("reschedule_count", m_uRescheduleCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("wakeup_count", m_uWakeupCount.load(std::memory_order_relaxed));
+    pJson->SetUint64("node_capacity", m_nodePool.GetCapacity());
+    pJson->SetString("sleep", m_uSleepType == (uint32_t)SleepType::kTimerfd ? "timerfd" : "cond");
+    pJson->SetUint64("spin_us", m_uSpinNs / kMicro);
+    m_pTimerQueue->GetStats(pJson);
     return 0;
 }
 
@@ -201,18 +606,17 @@ bool CTaskSchedulerImpl::RunWrapper(void *ptr)
 void CTaskSchedulerImpl::Run()
 {
     constexpr uint32_t uBatchTask = 16;
-    const std::pair<const uint64_t, TaskEx> *batchTaskEx[uBatchTask];
+    TaskNode *batchNodes[uBatchTask];
 
+    if (m_uSleepType == (uint32_t)SleepType::kTimerfd)
     {
-        std::unique_lock<std::mutex> lock(m_lock);
-        m_cond.wait_for(lock, std::chrono::microseconds(m_uCondWaitUs), [&] () 
-            { 
-                uint64_t uExecTimeNs;
-                clock_get_time_nano(uExecTimeNs);
-                return (!m_mapTasks.empty() && m_mapTasks.begin()->first <= uExecTimeNs)
-                        || !(m_pThread->GetThreadState() == IThread::ThreadState::kRunning);
-            });
+        WaitTimer();
+    }
+    else
+    {
+        WaitCond();
     }
+    SpinUntilExpire();
 
     uint32_t uCurrTaskSize = 0;
     uint64_t uCurrNano = 0;
@@ -220,70 +624,93 @@ void CTaskSchedulerImpl::Run()
 
     {
         std::lock_guard<std::mutex> guard(m_lock);
-        for (auto iter = m_mapTasks.begin(); iter != m_mapTasks.end();)
+        DrainIntake();
+        DrainPending();
+
+        // 取出到期的任务，到期时间被推迟的重新插入，已取消的不执行
+        uint32_t uPopCount = m_pTimerQueue->PopExpired(uCurrNano, batchNodes, uBatchTask);
+        for (uint32_t i = 0; i < uPopCount; i++)
         {
-            // 如果任务被取消，则删除
-            if (ACCESS_ONCE(iter->second.task.uFlags) & TaskFlag::kTaskCancel)
+            auto pNode = batchNodes[i];
+            pNode->bQueued = false;
+            auto uDeadlineNs = pNode->uDeadlineNs.load(std::memory_order_relaxed);
+            if (unlikely(uDeadlineNs > uCurrNano))
             {
-                iter = m_mapTasks.erase(iter);
+                pNode->uExpireNs = uDeadlineNs;
+                InsertNode(pNode);
                 continue;
             }
-
-            // 还没到执行时间，则跳出
-            if (likely(iter->first > uCurrNano))
-            {
-                break;
-            }
-
-            // 任务可以执行，则添加到批量执行队列
-            iter->second.task.uFlags |= TaskFlag::kTaskRunning;
-            batchTaskEx[uCurrTaskSize++] = &(*iter);
-            iter++;
-
-            // 批量执行队列满了，则跳出
-            if (unlikely(uCurrTaskSize >= uBatchTask))
-            {
-                break;
-            }
+            // 记录本次执行对应的到期时间，执行期间的RescheduleTask以此判断
+            pNode->uExpireNs = uDeadlineNs;
+            batchNodes[uCurrTaskSize++] = pNode;
         }
     }
 
+    // 取出后才被取消的任务不再执行
+    uint32_t uExecCount = 0;
     for (uint32_t i = 0; i < uCurrTaskSize; i++)
     {
-        auto &taskEx = const_cast<TaskEx &>(batchTaskEx[i]->second);
-        taskEx.task.pTaskFunc(taskEx.task.pTaskCtx);
-        taskEx.uTaskExecCount++;
+        auto pNode = batchNodes[i];
+        if (likely((pNode->uState.load(std::memory_order_acquire) & TaskNode::kStateCancel) == 0))
+        {
+            pNode->task.pTaskFunc(pNode->task.pTaskCtx);
+            uExecCount++;
+        }
+        pNode->uExecCount++;
     }
 
+    if (uCurrTaskSize == 0)
+    {
+        return;
+    }
+
+    clock_get_time_nano(uCurrNano);
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_uExecCount += uExecCount;
     for (uint32_t i = 0; i < uCurrTaskSize; i++)
     {
-        auto &taskEx = const_cast<TaskEx &>(batchTaskEx[i]->second);
-        std::lock_guard<std::mutex> guard(m_lock);
-        taskEx.task.uFlags &= ~(TaskFlag::kTaskRunning);
-        if (taskEx.task.eTaskType == TaskType::kRunPeriodic
-            || taskEx.uTaskExecCount < taskEx.task.uTaskExecTimes)
+        auto pNode = batchNodes[i];
+        if ((pNode->uState.load(std::memory_order_acquire) & TaskNode::kStateCancel) != 0)
+        {
+            TryReleaseNode(pNode);
+            continue;
+        }
+
+        auto uDeadlineNs = pNode->uExpireNs;
+        bool bRepeat = true;
+        if (pNode->task.eTaskType == TaskType::kRunPeriodic || pNode->uExecCount < pNode->task.uTaskExecTimes)
         {
-            uint64_t uExecTimeNs;
-            clock_get_time_nano(uExecTimeNs);
-            uExecTimeNs += (taskEx.task.uIntervalUs * kMicro);
-            while (unlikely(m_mapTasks.count(uExecTimeNs)) != 0)
+            // 执行期间被RescheduleTask修改过时使用修改后的时间，否则按间隔计算下一次执行时间
+            if (pNode->uDeadlineNs.compare_exchange_strong(uDeadlineNs, uCurrNano + (pNode->task.uIntervalUs * kMicro),
+                                                           std::memory_order_relaxed))
             {
-                ++uExecTimeNs;
+                uDeadlineNs = uCurrNano + (pNode->task.uIntervalUs * kMicro);
             }
+        }
+        else
+        {
+            // 次数已用完，最后一次执行期间被RescheduleTask修改过时按修改后的时间再执行一次，
+            // 此处之后才完成的修改由ApplyPending处理
+            uDeadlineNs = pNode->uDeadlineNs.load(std::memory_order_relaxed);
+            bRepeat = uDeadlineNs != pNode->uExpireNs;
+        }
 
+        if (bRepeat)
+        {
+            pNode->uExpireNs = uDeadlineNs;
             try
             {
-                m_mapTasks[uExecTimeNs] = taskEx;
+                InsertNode(pNode);
+                continue;
             }
             catch(std::exception &e)
             {
                 SetLastError(ErrorCode::kThrowException);
             }
         }
-        // 使用完再删除，避免taskEx引用失效
-        m_mapTasks.erase(batchTaskEx[i]->first);
+        TryReleaseNode(pNode);
     }
 }
 
 }
-}
\ No newline at end of file
+}
@@ -4,12 +4,12 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <map>
+#include <atomic>
 #include <string>
-#include <vector>
 
 #include <thread/task_scheduler.h>
 #include <thread/thread_manager.h>
+#include "timer_queue.h"
 
 namespace cppx
 {
@@ -27,7 +27,8 @@ public:
     CTaskSchedulerImpl(CTaskSchedulerImpl &&) = delete;
     CTaskSchedulerImpl &operator=(CTaskSchedulerImpl &&) = delete;
 
-    int32_t Init(const char *pSchedulerName, uint32_t uPrecisionUs);
+    int32_t Init(const char *pSchedulerName, uint32_t uPrecisionUs, uint32_t uTimerType, uint32_t uTickUs,
+                 uint32_t uSleepType, uint32_t uSpinUs);
 
     int32_t Start() override;
     void Stop() override;
@@ -38,6 +39,7 @@ public:
     int64_t PostPeriodicTask(const char* pTaskName, TaskFunc pFunc, void* pCtx, 
                             uint32_t uDelayUs, uint32_t uInternalUs) override;
     int32_t CancleTask(int64_t iTaskID) override;
+    int32_t RescheduleTask(int64_t iTaskID, uint32_t uDelayUs) override;
 
     int32_t GetStats(IJson *pJson) const override;
 
@@ -45,13 +47,56 @@ private:
     static bool RunWrapper(void *ptr);
     void Run();
 
-private:
-    struct TaskEx
+    static int64_t MakeTaskID(uint64_t uState, uint32_t uIndex)
+    {
+        return int64_t(((uState >> 32) << 32) | uIndex);
+    }
+
+    // 按TaskID找到节点，代数不匹配返回nullptr，uState返回节点当前的状态
+    TaskNode *FindNode(int64_t iTaskID, uint64_t &uState) const;
+
+    // 其他线程修改节点后放入待处理链表，由调度线程处理，无锁
+    void PushPending(TaskNode *pNode);
+
+    // 把新提交的节点插入定时器队列，需持有m_lock
+    void DrainIntake();
+
+    // 处理待处理链表中的取消和重新调度，需持有m_lock
+    void DrainPending();
+
+    // 清除节点的待处理标志，并使期间的取消和重新调度生效，需持有m_lock
+    void ApplyPending(TaskNode *pNode);
+
+    // 调度线程即将休眠到uSleepTargetNs，返回是否有新提交或修改的任务需要处理
+    bool PrepareSleep(uint64_t uSleepTargetNs);
+
+    // 用条件变量休眠，最多休眠m_uCondWaitUs
+    void WaitCond();
+
+    // 用timerfd休眠到下一个到期时间之前m_uSpinNs
+    void WaitTimer();
+
+    // 距离下一个到期时间不超过m_uSpinNs时忙等到期
+    void SpinUntilExpire();
+
+    // uDeadlineNs比调度线程的休眠时间更早时唤醒调度线程
+    void WakeupIfEarlier(uint64_t uDeadlineNs);
+    void Wakeup();
+
+    void InsertNode(TaskNode *pNode)
     {
-        Task task;
-        int64_t uTaskExecCount;
-        int64_t iTaskID;
-    };
+        m_pTimerQueue->Insert(pNode);
+        pNode->bQueued = true;
+    }
+
+    void RemoveNode(TaskNode *pNode)
+    {
+        m_pTimerQueue->Remove(pNode);
+        pNode->bQueued = false;
+    }
+
+    // 节点不在待处理链表中时增加代数并释放，否则留给DrainPending释放，需持有m_lock
+    bool TryReleaseNode(TaskNode *pNode);
 
 private:
     IThreadManager *m_pThreadManager {nullptr};
@@ -59,13 +104,27 @@ private:
 
     std::string m_strSchedulerName;
 
-    std::mutex m_lock;
+    mutable std::mutex m_lock;
     std::condition_variable m_cond;
     uint32_t m_uCondWaitUs {10};
-
-    std::map<uint64_t, TaskEx> m_mapTasks;
-
-    int64_t m_iNextTaskID {0};
+    uint32_t m_uSleepType {0};
+    uint64_t m_uSpinNs {0};
+    int m_iTimerFd {-1};
+    int m_iEventFd {-1};  // 提交更早到期的任务或停止时写入，唤醒阻塞在poll上的调度线程
+    std::atomic<bool> m_bStopping {false};
+
+    CTimerQueue *m_pTimerQueue {nullptr};
+    CTaskNodePool m_nodePool;
+    std::atomic<TaskNode *> m_pPendingHead {nullptr};
+    std::atomic<TaskNode *> m_pIntakeHead {nullptr};  // 新提交的节点，多生产者单消费者
+    std::atomic<uint64_t> m_uSleepTargetNs {0};       // 调度线程休眠到的时间，运行时为0
+    std::atomic<uint64_t> m_uWakeupCount {0};         // 提交时唤醒调度线程的次数
+
+    std::atomic<uint64_t> m_uTaskCount {0}; // 未结束的任务数
+    std::atomic<uint64_t> m_uPostCount {0};
+    uint64_t m_uExecCount {0};
+    std::atomic<uint64_t> m_uCancelCount {0};
+    std::atomic<uint64_t> m_uRescheduleCount {0};
 };
 
 }
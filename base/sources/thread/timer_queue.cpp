@@ -0,0 +1,314 @@
+#include <algorithm>
+#include "timer_queue.h"
+
+namespace cppx
+{
+namespace base
+{
+
+CTaskNodePool::~CTaskNodePool()
+{
+    for (uint32_t i = 0; i < m_uChunkCount; ++i)
+    {
+        delete[] m_apChunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+TaskNode *CTaskNodePool::Alloc()
+{
+    while (true)
+    {
+        auto uHead = m_uFreeHead.load(std::memory_order_acquire);
+        while (uint32_t(uHead) != kNullIndex)
+        {
+            // 节点不会归还给系统，被其他线程取走时读到的uFreeNext无效，但修改次数变化后比较会失败
+            auto pNode = Get(uint32_t(uHead));
+            auto uNext = pNode->uFreeNext.load(std::memory_order_relaxed);
+            if (m_uFreeHead.compare_exchange_weak(uHead, (((uHead >> 32) + 1) << 32) | uNext,
+                                                  std::memory_order_acquire, std::memory_order_acquire))
+            {
+                return pNode;
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(m_growLock);
+        if (uint32_t(m_uFreeHead.load(std::memory_order_acquire)) == kNullIndex)
+        {
+            return Grow();
+        }
+    }
+}
+
+TaskNode *CTaskNodePool::Grow()
+{
+    auto uChunkIndex = m_uChunkCount.load(std::memory_order_relaxed);
+    if (uChunkIndex >= kMaxChunkCount)
+    {
+        return nullptr;
+    }
+
+    auto pChunk = NEW TaskNode[kChunkSize];
+    if (pChunk == nullptr)
+    {
+        return nullptr;
+    }
+
+    // 代数从1开始，代数为0的TaskID总是无效；按下标顺序链接，先分配下标小的节点
+    for (uint32_t i = 0; i < kChunkSize; ++i)
+    {
+        auto &node = pChunk[i];
+        node.uIndex = (uChunkIndex << kChunkShift) | i;
+        node.bQueued = false;
+        node.uState.store(uint64_t(1) << 32, std::memory_order_relaxed);
+        node.uDeadlineNs.store(0, std::memory_order_relaxed);
+        node.uFreeNext.store(node.uIndex + 1, std::memory_order_relaxed);
+    }
+    m_apChunks[uChunkIndex].store(pChunk, std::memory_order_release);
+    m_uChunkCount.store(uChunkIndex + 1, std::memory_order_relaxed);
+
+    PushFree(&pChunk[1], &pChunk[kChunkSize - 1]);
+    return &pChunk[0];
+}
+
+void CTaskNodePool::PushFree(TaskNode *pFirst, TaskNode *pLast)
+{
+    auto uHead = m_uFreeHead.load(std::memory_order_relaxed);
+    do
+    {
+        pLast->uFreeNext.store(uint32_t(uHead), std::memory_order_relaxed);
+    } while (!m_uFreeHead.compare_exchange_weak(uHead, (((uHead >> 32) + 1) << 32) | pFirst->uIndex,
+                                                std::memory_order_release, std::memory_order_relaxed));
+}
+
+CTimerQueue *CTimerQueue::Create(uint32_t uType, uint32_t uTickUs)
+{
+    if (uType == (uint32_t)ITaskScheduler::TimerType::kWheel)
+    {
+        return NEW CTimingWheel(uTickUs);
+    }
+    return NEW CMapTimerQueue();
+}
+
+void CMapTimerQueue::Insert(TaskNode *pNode)
+{
+    pNode->uSeq = m_uNextSeq++;
+    m_setNodes.insert(pNode);
+}
+
+void CMapTimerQueue::Remove(TaskNode *pNode)
+{
+    m_setNodes.erase(pNode);
+}
+
+uint32_t CMapTimerQueue::PopExpired(uint64_t uNowNs, TaskNode **ppNodes, uint32_t uMaxCount)
+{
+    uint32_t uCount = 0;
+    auto iter = m_setNodes.begin();
+    while (iter != m_setNodes.end() && (*iter)->uExpireNs <= uNowNs && uCount < uMaxCount)
+    {
+        ppNodes[uCount++] = *iter;
+        iter = m_setNodes.erase(iter);
+    }
+    return uCount;
+}
+
+uint64_t CMapTimerQueue::GetNextExpireNs() const
+{
+    return m_setNodes.empty() ? UINT64_MAX : (*m_setNodes.begin())->uExpireNs;
+}
+
+void CMapTimerQueue::GetStats(IJson *pJson) const
+{
+    pJson->SetString("timer", GetName());
+    pJson->SetUint64("timer_size", m_setNodes.size());
+}
+
+CTimingWheel::CTimingWheel(uint32_t uTickUs)
+    : m_uTickNs(std::max<uint32_t>(uTickUs, 1) * kMicro)
+{
+    for (auto &head : m_aSlots)
+    {
+        head.pPrev = &head;
+        head.pNext = &head;
+    }
+    clock_get_time_nano(m_uBaseNs);
+}
+
+void CTimingWheel::Link(TaskNode *pNode, uint16_t uSlot)
+{
+    auto pHead = &m_aSlots[uSlot];
+    pNode->uSlot = uSlot;
+    pNode->link.pPrev = pHead->pPrev;
+    pNode->link.pNext = pHead;
+    pHead->pPrev->pNext = &pNode->link;
+    pHead->pPrev = &pNode->link;
+    if (uSlot < kExpiredSlot)
+    {
+        m_auBitmap[uSlot / kLevelSlots][(uSlot % kLevelSlots) / 64] |= uint64_t(1) << (uSlot % 64);
+    }
+}
+
+void CTimingWheel::Unlink(TaskNode *pNode)
+{
+    pNode->link.pPrev->pNext = pNode->link.pNext;
+    pNode->link.pNext->pPrev = pNode->link.pPrev;
+    auto uSlot = pNode->uSlot;
+    if (uSlot < kExpiredSlot && m_aSlots[uSlot].pNext == &m_aSlots[uSlot])
+    {
+        m_auBitmap[uSlot / kLevelSlots][(uSlot % kLevelSlots) / 64] &= ~(uint64_t(1) << (uSlot % 64));
+    }
+}
+
+void CTimingWheel::Insert(TaskNode *pNode)
+{
+    auto uTick = pNode->uExpireNs > m_uBaseNs ? (pNode->uExpireNs - m_uBaseNs + m_uTickNs - 1) / m_uTickNs : 0;
+    if (uTick < m_uCurrentTick)
+    {
+        Link(pNode, kExpiredSlot);
+        m_uExpiredCount++;
+        return;
+    }
+
+    // 超出时间轮范围的节点先放在最高层，级联时再按实际到期刻度重新插入
+    constexpr uint64_t kMaxDelta = (uint64_t(1) << (kLevelBits * kLevelCount)) - 1;
+    auto uDelta = std::min(uTick - m_uCurrentTick, kMaxDelta);
+    uTick = m_uCurrentTick + uDelta;
+    uint32_t uLevel = 0;
+    while (uDelta >= (uint64_t(1) << (kLevelBits * (uLevel + 1))))
+    {
+        uLevel++;
+    }
+    auto uIndex = uint32_t(uTick >> (kLevelBits * uLevel)) & kLevelMask;
+    Link(pNode, uint16_t(uLevel * kLevelSlots + uIndex));
+    m_uWheelCount++;
+}
+
+void CTimingWheel::Remove(TaskNode *pNode)
+{
+    Unlink(pNode);
+    if (pNode->uSlot == kExpiredSlot)
+    {
+        m_uExpiredCount--;
+    }
+    else
+    {
+        m_uWheelCount--;
+    }
+}
+
+void CTimingWheel::Cascade(uint32_t uLevel, uint32_t uIndex)
+{
+    auto pHead = &m_aSlots[uLevel * kLevelSlots + uIndex];
+    while (pHead->pNext != pHead)
+    {
+        auto pNode = ToNode(pHead->pNext);
+        Unlink(pNode);
+        m_uWheelCount--;
+        Insert(pNode);
+        m_uCascadeCount++;
+    }
+}
+
+uint32_t CTimingWheel::FindLevel0Slot(uint32_t uIndex) const
+{
+    for (auto uWord = uIndex / 64; uWord < kLevelSlots / 64; ++uWord)
+    {
+        auto uBits = m_auBitmap[0][uWord];
+        if (uWord == uIndex / 64)
+        {
+            uBits &= ~uint64_t(0) << (uIndex % 64);
+        }
+        if (uBits != 0)
+        {
+            return uWord * 64 + uint32_t(__builtin_ctzll(uBits));
+        }
+    }
+    return kLevelSlots;
+}
+
+void CTimingWheel::Advance(uint64_t uTargetTick, uint32_t uMaxCount)
+{
+    while (m_uCurrentTick <= uTargetTick && m_uExpiredCount < uMaxCount)
+    {
+        if (m_uWheelCount == 0)
+        {
+            m_uCurrentTick = uTargetTick + 1;
+            break;
+        }
+
+        // 走到一圈的起点时先把上层对应槽位级联下来，上层槽位也是起点时继续级联更上一层
+        auto uIndex = uint32_t(m_uCurrentTick) & kLevelMask;
+        if (uIndex == 0)
+        {
+            for (uint32_t uLevel = 1; uLevel < kLevelCount; ++uLevel)
+            {
+                auto uLevelIndex = uint32_t(m_uCurrentTick >> (kLevelBits * uLevel)) & kLevelMask;
+                Cascade(uLevel, uLevelIndex);
+                if (uLevelIndex != 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        auto pHead = &m_aSlots[uIndex];
+        while (pHead->pNext != pHead)
+        {
+            auto pNode = ToNode(pHead->pNext);
+            Unlink(pNode);
+            m_uWheelCount--;
+            Link(pNode, kExpiredSlot);
+            m_uExpiredCount++;
+        }
+
+        // 跳过空槽位，但不越过下一圈的起点，保证级联按时进行
+        auto uNextTick = (m_uCurrentTick & ~uint64_t(kLevelMask)) + FindLevel0Slot(uIndex + 1);
+        m_uCurrentTick = std::min(uNextTick, uTargetTick + 1);
+    }
+}
+
+uint32_t CTimingWheel::PopExpired(uint64_t uNowNs, TaskNode **ppNodes, uint32_t uMaxCount)
+{
+    if (uNowNs >= m_uBaseNs)
+    {
+        Advance((uNowNs - m_uBaseNs) / m_uTickNs, uMaxCount);
+    }
+
+    uint32_t uCount = 0;
+    auto pHead = &m_aSlots[kExpiredSlot];
+    while (pHead->pNext != pHead && uCount < uMaxCount)
+    {
+        auto pNode = ToNode(pHead->pNext);
+        Unlink(pNode);
+        m_uExpiredCount--;
+        ppNodes[uCount++] = pNode;
+    }
+    return uCount;
+}
+
+uint64_t CTimingWheel::GetNextExpireNs() const
+{
+    if (m_uExpiredCount != 0)
+    {
+        return 0;
+    }
+    if (m_uWheelCount == 0)
+    {
+        return UINT64_MAX;
+    }
+
+    // 本圈内没有节点时返回下一圈起点的时间，届时级联后再计算
+    auto uIndex = uint32_t(m_uCurrentTick) & kLevelMask;
+    return TickToNs((m_uCurrentTick & ~uint64_t(kLevelMask)) + FindLevel0Slot(uIndex));
+}
+
+void CTimingWheel::GetStats(IJson *pJson) const
+{
+    pJson->SetString("timer", GetName());
+    pJson->SetUint64("timer_size", GetSize());
+    pJson->SetUint64("tick_us", m_uTickNs / kMicro);
+    pJson->SetUint64("cascade_count", m_uCascadeCount);
+}
+
+}
+}
@@ -0,0 +1,239 @@
+#ifndef __CPPX_TIMER_QUEUE_H__
+#define __CPPX_TIMER_QUEUE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <thread/task_scheduler.h>
+#include <utilities/common.h>
+#include <utilities/json.h>
+
+namespace cppx
+{
+namespace base
+{
+
+// 侵入式双向链表的链接
+struct TaskLink
+{
+    TaskLink *pPrev;
+    TaskLink *pNext;
+};
+
+// 调度器中的任务节点，由CTaskNodePool分配，同一时间只挂在一个链表上
+struct TaskNode
+{
+    // uState的低32位
+    static constexpr uint64_t kStateCancel = 1 << 0;  // 已取消
+    static constexpr uint64_t kStatePending = 1 << 1; // 在调度器的待处理链表中，节点不会被释放
+    static constexpr uint64_t kStateWriterUnit = 1 << 8; // 正在修改uDeadlineNs的线程数，位于8~31位
+    static constexpr uint64_t kStateWriterMask = 0xFFFFFF00;
+
+    TaskLink link;       // 必须是第一个成员，链表中的TaskLink可以直接转换为TaskNode
+    uint64_t uExpireNs;  // 在定时器队列中的到期时间，只由调度线程访问
+    uint64_t uSeq;       // 到期时间相同的任务按入队顺序执行
+    uint32_t uIndex;     // 在节点池中的下标
+    uint16_t uSlot;      // 所在的时间轮槽位
+    bool bQueued;        // 是否在定时器队列中，只由调度线程访问
+    std::atomic<uint64_t> uState;      // 高32位为代数，节点释放时加1，使旧的TaskID失效
+    std::atomic<uint64_t> uDeadlineNs; // 期望的到期时间，RescheduleTask修改后由调度线程生效
+    TaskNode *pPendingNext;            // 待处理链表或提交链表的下一个节点
+    std::atomic<uint32_t> uFreeNext;   // 空闲链表的下一个节点的下标
+    ITaskScheduler::Task task;
+    uint64_t uExecCount;
+};
+
+/**
+ * 任务节点池
+ * 节点按块分配，块地址记录在固定大小的表中，节点地址在池的生命周期内不变，可以通过下标直接找到节点。
+ * 释放的节点放回空闲链表复用，不归还给系统。
+ * 空闲链表是按下标链接的无锁栈，表头带修改次数防止ABA，Alloc、Free和Get可以在任意线程无锁调用，
+ * 只有空闲链表为空、需要分配新块时加锁。
+ */
+class CTaskNodePool
+{
+public:
+    static constexpr uint32_t kChunkShift = 10;
+    static constexpr uint32_t kChunkSize = 1u << kChunkShift;
+    static constexpr uint32_t kMaxChunkCount = 4096; // 最多约400万个节点
+
+    CTaskNodePool() = default;
+    ~CTaskNodePool();
+
+    CTaskNodePool(const CTaskNodePool &) = delete;
+    CTaskNodePool &operator=(const CTaskNodePool &) = delete;
+    CTaskNodePool(CTaskNodePool &&) = delete;
+    CTaskNodePool &operator=(CTaskNodePool &&) = delete;
+
+    /**
+     * @brief 分配一个节点，空闲链表为空时分配新的块
+     * @return 成功返回节点，节点数达到上限或者内存不足返回nullptr
+     */
+    TaskNode *Alloc();
+
+    void Free(TaskNode *pNode) { PushFree(pNode, pNode); }
+
+    /**
+     * @brief 按下标获取节点
+     * @return 下标对应的块还没有分配时返回nullptr
+     */
+    TaskNode *Get(uint32_t uIndex) const
+    {
+        if (unlikely((uIndex >> kChunkShift) >= kMaxChunkCount))
+        {
+            return nullptr;
+        }
+        auto pChunk = m_apChunks[uIndex >> kChunkShift].load(std::memory_order_acquire);
+        return pChunk != nullptr ? &pChunk[uIndex & (kChunkSize - 1)] : nullptr;
+    }
+
+    uint64_t GetCapacity() const { return uint64_t(m_uChunkCount.load(std::memory_order_relaxed)) * kChunkSize; }
+
+private:
+    static constexpr uint32_t kNullIndex = UINT32_MAX;
+
+    // 把pFirst到pLast之间已经链接好的节点放入空闲链表
+    void PushFree(TaskNode *pFirst, TaskNode *pLast);
+
+    // 分配新的块，返回块中的第一个节点，其余节点放入空闲链表，需持有m_growLock
+    TaskNode *Grow();
+
+private:
+    std::atomic<TaskNode *> m_apChunks[kMaxChunkCount] {};
+    std::atomic<uint32_t> m_uChunkCount {0};
+    std::atomic<uint64_t> m_uFreeHead {kNullIndex}; // 高32位为修改次数，低32位为表头节点的下标
+    std::mutex m_growLock;
+};
+
+/**
+ * 定时器队列，保存未到期的任务节点
+ * 只由调度器在持有锁时访问，不是线程安全的
+ */
+class CTimerQueue
+{
+public:
+    virtual ~CTimerQueue() = default;
+
+    /**
+     * @brief 创建定时器队列
+     * @param uType 类型，见config::kTaskSchedulerTimer
+     * @param uTickUs 时间轮的刻度(us)
+     * @return 成功返回队列，失败返回nullptr
+     */
+    static CTimerQueue *Create(uint32_t uType, uint32_t uTickUs);
+
+    virtual const char *GetName() const = 0;
+
+    /**
+     * @brief 按pNode->uExpireNs插入节点，已经到期的节点在下一次PopExpired时取出
+     */
+    virtual void Insert(TaskNode *pNode) = 0;
+
+    /**
+     * @brief 删除尚未被PopExpired取出的节点
+     */
+    virtual void Remove(TaskNode *pNode) = 0;
+
+    /**
+     * @brief 取出到uNowNs为止到期的节点，按到期时间先后排列
+     * @return 取出的节点数，不超过uMaxCount
+     */
+    virtual uint32_t PopExpired(uint64_t uNowNs, TaskNode **ppNodes, uint32_t uMaxCount) = 0;
+
+    /**
+     * @brief 获取下一次需要处理的时间，调度线程在此之前可以休眠
+     * @return 队列为空返回UINT64_MAX，时间轮返回按刻度取整后的最早到期时间，本圈内没有节点时返回下一次级联的时间
+     */
+    virtual uint64_t GetNextExpireNs() const = 0;
+
+    virtual uint64_t GetSize() const = 0;
+
+    virtual void GetStats(IJson *pJson) const = 0;
+};
+
+// 按到期时间排序的红黑树，插入和删除O(log n)
+class CMapTimerQueue final : public CTimerQueue
+{
+public:
+    const char *GetName() const override { return "map"; }
+    void Insert(TaskNode *pNode) override;
+    void Remove(TaskNode *pNode) override;
+    uint32_t PopExpired(uint64_t uNowNs, TaskNode **ppNodes, uint32_t uMaxCount) override;
+    uint64_t GetNextExpireNs() const override;
+    uint64_t GetSize() const override { return m_setNodes.size(); }
+    void GetStats(IJson *pJson) const override;
+
+private:
+    struct NodeLess
+    {
+        bool operator()(const TaskNode *pLeft, const TaskNode *pRight) const
+        {
+            return pLeft->uExpireNs != pRight->uExpireNs ? pLeft->uExpireNs < pRight->uExpireNs
+                                                         : pLeft->uSeq < pRight->uSeq;
+        }
+    };
+
+    std::set<TaskNode *, NodeLess> m_setNodes;
+    uint64_t m_uNextSeq {0};
+};
+
+/**
+ * 分层时间轮
+ * 4层，每层256个槽位，第0层每个槽位一个刻度，第n层每个槽位覆盖256^n个刻度，共覆盖2^32个刻度。
+ * 节点按到期刻度与当前刻度的差值放入对应层的槽位，槽位是侵入式双向链表，插入和删除O(1)；
+ * 当前刻度走到第n层槽位的起点时，把该槽位的节点重新插入到下层(级联)。
+ * 到期时间向上取整到刻度，任务不会提前执行，最多延后一个刻度。
+ */
+class CTimingWheel final : public CTimerQueue
+{
+public:
+    static constexpr uint32_t kLevelBits = 8;
+    static constexpr uint32_t kLevelSlots = 1u << kLevelBits;
+    static constexpr uint32_t kLevelMask = kLevelSlots - 1;
+    static constexpr uint32_t kLevelCount = 4;
+    static constexpr uint16_t kExpiredSlot = kLevelSlots * kLevelCount; // 已到期、等待取出的链表
+
+    explicit CTimingWheel(uint32_t uTickUs);
+
+    const char *GetName() const override { return "wheel"; }
+    void Insert(TaskNode *pNode) override;
+    void Remove(TaskNode *pNode) override;
+    uint32_t PopExpired(uint64_t uNowNs, TaskNode **ppNodes, uint32_t uMaxCount) override;
+    uint64_t GetNextExpireNs() const override;
+    uint64_t GetSize() const override { return m_uWheelCount + m_uExpiredCount; }
+    void GetStats(IJson *pJson) const override;
+
+private:
+    static TaskNode *ToNode(TaskLink *pLink) { return reinterpret_cast<TaskNode *>(pLink); }
+
+    uint64_t TickToNs(uint64_t uTick) const { return m_uBaseNs + uTick * m_uTickNs; }
+
+    void Link(TaskNode *pNode, uint16_t uSlot);
+    void Unlink(TaskNode *pNode);
+
+    // 把槽位上的节点全部按到期刻度重新插入
+    void Cascade(uint32_t uLevel, uint32_t uIndex);
+
+    // 第0层中uIndex及之后第一个非空的槽位，没有返回kLevelSlots
+    uint32_t FindLevel0Slot(uint32_t uIndex) const;
+
+    // 把刻度不超过uTargetTick的节点移到到期链表，到期链表中有uMaxCount个节点时提前返回
+    void Advance(uint64_t uTargetTick, uint32_t uMaxCount);
+
+private:
+    TaskLink m_aSlots[kExpiredSlot + 1]; // 各槽位链表的头节点
+    uint64_t m_auBitmap[kLevelCount][kLevelSlots / 64] {};
+
+    uint64_t m_uTickNs;
+    uint64_t m_uBaseNs {0};
+    uint64_t m_uCurrentTick {0}; // 下一个要处理的刻度
+    uint64_t m_uWheelCount {0};
+    uint64_t m_uExpiredCount {0};
+    uint64_t m_uCascadeCount {0};
+};
+
+}
+}
+
+#endif // __CPPX_TIMER_QUEUE_H__
@@ -54,7 +54,7 @@ void IJson::Destroy(IJson *pJson)
 {
     if (likely(pJson != nullptr))
     {
-        delete pJson;
+        memory::IAllocatorEx::GetInstance()->Delete(static_cast<CJsonImpl *>(pJson));
     }
 }
 
@@ -84,7 +84,7 @@ CJsonImpl::~CJsonImpl()
 {
     for (auto pJsonValue : m_vecJsonValues)
     {
-        delete pJsonValue;
+        memory::IAllocatorEx::GetInstance()->Delete(pJsonValue);
     }
     m_vecJsonValues.clear();
 }
@@ -759,7 +759,7 @@ void CJsonImpl::Clear()
 {
     for (auto pJsonValue : m_vecJsonValues)
     {
-        delete pJsonValue;
+        memory::IAllocatorEx::GetInstance()->Delete(pJsonValue);
     }
     m_vecJsonValues.clear();
     m_jsonValue.clear();
@@ -27,6 +27,9 @@ public:
     void Stop() override;
 
     CConnectionImpl *Accept();
+
+    // 已接受连接的接收缓冲区使用的分配器
+    void SetBufferAllocator(base::memory::IAllocator *pAllocator) { m_pBufferAllocator = pAllocator; }
     
     uint64_t GetID() const override { return m_uID; }
 
@@ -43,6 +46,7 @@ private:
     ICallback *m_pCallback{nullptr};
     IDispatcher *m_pDispatcher{nullptr};
     base::memory::IAllocatorEx *m_pAllocatorEx{nullptr};
+    base::memory::IAllocator *m_pBufferAllocator{nullptr};
     NetworkLogger *m_pLogger{nullptr};
     std::string m_strAcceptorName;
     std::string m_strAcceptorIP;
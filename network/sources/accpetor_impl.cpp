@@ -164,6 +164,7 @@ CConnectionImpl *CAcceptorImpl::Accept()
         clock_get_time_nano(upConnection->m_ulastRecvTimeNs);
 
         upConnection->m_pAllocatorEx = m_pAllocatorEx;
+        upConnection->m_pBufferAllocator = m_pBufferAllocator;
         upConnection->m_pDispatcher = m_pDispatcher;
         upConnection->m_pLogger = m_pLogger;
 
@@ -43,7 +43,12 @@ CConnectionImpl::~CConnectionImpl()
 
 int32_t CConnectionImpl::InitBuffer()
 {
-    if (m_ReceiveBuffer.Init(m_pAllocatorEx, 4096) != ErrorCode::kSuccess)
+    base::memory::IAllocator *pBufferAllocator = m_pAllocatorEx;
+    if (m_pBufferAllocator != nullptr)
+    {
+        pBufferAllocator = m_pBufferAllocator;
+    }
+    if (m_ReceiveBuffer.Init(pBufferAllocator, 4096) != ErrorCode::kSuccess)
     {
         LOG_ERROR(m_pLogger, ErrorCode::kSystemError, "{} failed to init buffer", m_strConnectionName.c_str());
         return ErrorCode::kSystemError;
@@ -35,6 +35,8 @@ public:
 
     void SetID(uint64_t uID) { m_uID = uID; }
     void SetIOThreadIndex(uint32_t uIOThreadIndex) { m_uIOThreadIndex = uIOThreadIndex; }
+    // 接收缓冲区使用的分配器，为nullptr时使用m_pAllocatorEx，需在InitBuffer之前调用
+    void SetBufferAllocator(base::memory::IAllocator *pAllocator) { m_pBufferAllocator = pAllocator; }
 
     int32_t Connect(const char *pRemoteIP, uint16_t uRemotePort, uint32_t uTimeoutMs = 0) override;
     void Close() override;
@@ -86,6 +88,7 @@ private:
 
     IDispatcher *m_pDispatcher{nullptr};
     base::memory::IAllocatorEx *m_pAllocatorEx{nullptr};
+    base::memory::IAllocator *m_pBufferAllocator{nullptr};
     NetworkLogger *m_pLogger{nullptr};
 
     std::string m_strConnectionName;
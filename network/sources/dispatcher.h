@@ -18,6 +18,9 @@ namespace network
 
 using CallbackFunc = std::function<void(bool bResult)>;
 
+// 异常事件日志每个调用点每秒最多记录的条数，对端反复断开时避免刷屏
+constexpr uint32_t kInvalidEventLogRate = 10;
+
 enum class TaskType 
 {
     kAddAcceptor = 0, // 添加监听器到epoll
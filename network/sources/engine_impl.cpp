@@ -43,9 +43,23 @@ int32_t CEngineImpl::Init(NetworkConfig *pConfig)
         return ErrorCode::kThrowException;
     }
 
+    auto iErrorNo = InitBufferAllocator(pConfig);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        LOG_ERROR(m_pLogger, ErrorCode::kInvalidCall, "Failed to init buffer allocator");
+        return iErrorNo;
+    }
+
     m_MessagePool.Init(0, 0);
+    if (!m_MessagePool.SetAllocator(m_pBufferAllocator))
+    {
+        // 上一次Exit时仍有消息未归还，这些消息需要通过原来的分配器释放
+        LOG_ERROR(m_pLogger, ErrorCode::kInvalidState, "{} messages still held by users, can not switch allocator",
+            Wrap(m_MessagePool.GetOutstandingCount()));
+        return ErrorCode::kInvalidState;
+    }
 
-    auto iErrorNo = m_EventDispatcher.Init(this);
+    iErrorNo = m_EventDispatcher.Init(this);
     if (iErrorNo != ErrorCode::kSuccess)
     {
         LOG_ERROR(m_pLogger, ErrorCode::kInvalidCall, "Failed to init event dispatcher");
@@ -70,6 +84,46 @@ int32_t CEngineImpl::Init(NetworkConfig *pConfig)
     return ErrorCode::kSuccess;
 }
 
+int32_t CEngineImpl::InitBufferAllocator(NetworkConfig *pConfig)
+{
+    if (pConfig->GetUint64(base::memory::config::kAllocatorBuddyRegionMB, 
+                           base::memory::default_value::kAllocatorBuddyRegionMB) == 0)
+    {
+        return ErrorCode::kSuccess;
+    }
+
+    // 只拷贝伙伴系统相关配置，引擎配置中给全局分配器的采样、trace和信号配置不能再开启一次
+    auto pAllocatorConfig = base::IJson::Create();
+    if (pAllocatorConfig == nullptr)
+    {
+        return ErrorCode::kOutOfMemory;
+    }
+    pAllocatorConfig->SetUint64(base::memory::config::kAllocatorBuddyRegionMB,
+                                pConfig->GetUint64(base::memory::config::kAllocatorBuddyRegionMB,
+                                                   base::memory::default_value::kAllocatorBuddyRegionMB));
+    pAllocatorConfig->SetUint64(base::memory::config::kAllocatorBuddyMinBytes,
+                                pConfig->GetUint64(base::memory::config::kAllocatorBuddyMinBytes,
+                                                   base::memory::default_value::kAllocatorBuddyMinBytes));
+
+    auto pAllocator = base::memory::IAllocator::Create();
+    if (pAllocator == nullptr)
+    {
+        base::IJson::Destroy(pAllocatorConfig);
+        return ErrorCode::kOutOfMemory;
+    }
+
+    auto iErrorNo = pAllocator->Init(pAllocatorConfig);
+    base::IJson::Destroy(pAllocatorConfig);
+    if (iErrorNo != ErrorCode::kSuccess)
+    {
+        base::memory::IAllocator::Destroy(pAllocator);
+        return iErrorNo;
+    }
+
+    m_pBufferAllocator = pAllocator;
+    return ErrorCode::kSuccess;
+}
+
 void CEngineImpl::Exit()
 {
     m_vecIODispatchers.clear();
@@ -77,6 +131,27 @@ void CEngineImpl::Exit()
     m_umapAcceptor.clear();
     m_umapConnection.clear();
 
+    // 用户持有的消息可能从伙伴系统分配，等待全部归还后再销毁分配器；
+    // 超时则不销毁，消息池继续使用该分配器，避免消息通过已销毁的分配器释放
+    if (m_pBufferAllocator != nullptr)
+    {
+        if (m_MessagePool.WaitIdle(kExitWaitMessageMs))
+        {
+            m_MessagePool.Exit();
+            base::memory::IAllocator::Destroy(m_pBufferAllocator);
+        }
+        else
+        {
+            LOG_ERROR(m_pLogger, ErrorCode::kInvalidState, "{} {} messages not returned, keep buffer allocator",
+                m_strEngineName.c_str(), Wrap(m_MessagePool.GetOutstandingCount()));
+        }
+        m_pBufferAllocator = nullptr;
+    }
+    else
+    {
+        m_MessagePool.Exit();
+    }
+
     m_pAllocatorEx = nullptr;
     m_pLogger = nullptr;
     m_strEngineName.clear();
@@ -124,6 +199,10 @@ int32_t CEngineImpl::CreateAcceptor(NetworkConfig *pConfig, ICallback *pCallback
         std::lock_guard<std::mutex> lock(m_mutex);
         auto upAcceptor = std::unique_ptr<CAcceptorImpl>(
             m_pAllocatorEx->New<CAcceptorImpl>(m_uNextAcceptorID, pCallback, &m_EventDispatcher, m_pLogger, m_pAllocatorEx));
+        if (upAcceptor != nullptr)
+        {
+            upAcceptor->SetBufferAllocator(m_pBufferAllocator);
+        }
         if (upAcceptor == nullptr || upAcceptor->Init(pConfig) != ErrorCode::kSuccess)
         {
             LOG_ERROR(m_pLogger, ErrorCode::kOutOfMemory, "Failed to create acceptor");
@@ -180,6 +259,10 @@ int32_t CEngineImpl::CreateConnection(NetworkConfig *pConfig, ICallback *pCallba
     {
         std::lock_guard<std::mutex> lock(m_mutex);
         auto upConnection = std::unique_ptr<CConnectionImpl>(m_pAllocatorEx->New<CConnectionImpl>(m_uNextConnectionID, pCallback, &m_EventDispatcher, m_pLogger, m_pAllocatorEx));
+        if (upConnection != nullptr)
+        {
+            upConnection->SetBufferAllocator(m_pBufferAllocator);
+        }
         if (upConnection == nullptr || upConnection->Init(pConfig) != ErrorCode::kSuccess)
         {
             LOG_ERROR(m_pLogger, ErrorCode::kOutOfMemory, "{} failed to create connection", m_strEngineName.c_str());
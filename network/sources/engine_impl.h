@@ -47,9 +47,16 @@ public:
     int32_t GetStats(NetworkStats *pStats) const override;
     const char *GetName() const override { return m_strEngineName.c_str(); }
 
+private:
+    static constexpr uint32_t kExitWaitMessageMs = 3000; // Exit时等待用户归还消息的最长时间
+
+    int32_t InitBufferAllocator(NetworkConfig *pConfig);
+
 private:
     CMessagePool m_MessagePool;
     base::memory::IAllocatorEx *m_pAllocatorEx{nullptr};
+    // 配置了伙伴系统时创建，消息和接收缓冲区从中分配，否则为nullptr
+    base::memory::IAllocator *m_pBufferAllocator{nullptr};
 
     NetworkLogger *m_pLogger{nullptr};
     std::string m_strEngineName;
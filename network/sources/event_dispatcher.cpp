@@ -109,7 +109,7 @@ void CEventDispatcher::ProcessAcceptorEvent(const struct epoll_event &epollEvent
     }
     else
     {
-        LOG_ERROR(m_pLogger, ErrorCode::kSysCallFailed, "{} invalid event: {}", pAcceptor->GetName(), strerror(errno));
+        LOG_ERROR_RATE_LIMITED(m_pLogger, kInvalidEventLogRate, ErrorCode::kSysCallFailed, "{} invalid event: {}", pAcceptor->GetName(), strerror(errno));
     }
 }
 
@@ -118,7 +118,7 @@ void CEventDispatcher::ProcessConnectionEvent(const struct epoll_event &epollEve
     auto pConnection = static_cast<CConnectionImpl *>(epollEvent.data.ptr);
     if (!(epollEvent.events & EPOLLIN || epollEvent.events & EPOLLERR))
     {
-        LOG_ERROR(m_pLogger, ErrorCode::kSysCallFailed, "{} invalid event: {}", pConnection->GetName(), strerror(errno));
+        LOG_ERROR_RATE_LIMITED(m_pLogger, kInvalidEventLogRate, ErrorCode::kSysCallFailed, "{} invalid event: {}", pConnection->GetName(), strerror(errno));
         return;
     }
 
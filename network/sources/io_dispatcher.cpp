@@ -81,7 +81,7 @@ void CIODispatcher::Run()
 
             if (unlikely(epollEvent.events & EPOLLERR))
             {
-                LOG_ERROR(m_pLogger, ErrorCode::kSysCallFailed, "{} invalid event: {}", 
+                LOG_ERROR_RATE_LIMITED(m_pLogger, kInvalidEventLogRate, ErrorCode::kSysCallFailed, "{} invalid event: {}", 
                     pConnection->GetName(), strerror(errno));
                 pConnection->Close();
             }
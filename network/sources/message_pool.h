@@ -2,7 +2,12 @@
 #define __CPPX_NETWORK_MESSAGE_POOL_H__
 
 #include "message_impl.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <memory/allocator_ex.h>
+#include <utilities/common.h>
+#include <utilities/error_code.h>
 
 namespace cppx
 {
@@ -12,24 +17,82 @@ namespace network
 class CMessagePool
 {
 public:
-    CMessagePool(base::memory::IAllocatorEx *pAllocatorEx);
-    ~CMessagePool();
+    explicit CMessagePool(base::memory::IAllocatorEx *pAllocatorEx)
+        : m_pDefaultAllocator(pAllocatorEx), m_pAllocator(pAllocatorEx)
+    {
+    }
+    ~CMessagePool() = default;
+
+    int32_t Init(uint32_t uMaxMessageCount, uint32_t uMessageSize)
+    {
+        UNSED(uMaxMessageCount);
+        UNSED(uMessageSize);
+        return ErrorCode::kSuccess;
+    }
 
-    int32_t Init(uint32_t uMaxMessageCount, uint32_t uMessageSize);
-    void Exit();
+    void Exit() { SetAllocator(nullptr); }
 
     IMessage *NewMessage(uint32_t uLength)
     {
-        return reinterpret_cast<IMessage *>(m_pAllocator->Malloc(uLength));
+        auto pMessage = reinterpret_cast<IMessage *>(m_pAllocator->Malloc(uLength));
+        if (likely(pMessage != nullptr))
+        {
+            m_uOutstandingCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        return pMessage;
     }
 
     void DeleteMessage(IMessage *pMessage)
     {
-        m_pAllocator->Free(pMessage);
+        if (likely(pMessage != nullptr))
+        {
+            m_pAllocator->Free(pMessage);
+            m_uOutstandingCount.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief 替换消息使用的分配器，例如开启了伙伴系统的分配器，pAllocator为nullptr时恢复为默认分配器
+     * @return 还有未归还的消息时不能替换，返回false
+     * @note 多线程不安全，检查未归还数量和替换之间不加锁，只能在没有其他线程调用NewMessage时调用，如Init和Exit
+     */
+    bool SetAllocator(base::memory::IAllocator *pAllocator)
+    {
+        if (pAllocator == nullptr)
+        {
+            pAllocator = m_pDefaultAllocator;
+        }
+        if (pAllocator != m_pAllocator && m_uOutstandingCount.load(std::memory_order_acquire) != 0)
+        {
+            return false;
+        }
+        m_pAllocator = pAllocator;
+        return true;
+    }
+
+    uint64_t GetOutstandingCount() const { return m_uOutstandingCount.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 等待用户归还所有消息
+     * @return 全部归还返回true，超时返回false
+     */
+    bool WaitIdle(uint32_t uTimeoutMs) const
+    {
+        for (uint32_t i = 0; GetOutstandingCount() != 0; ++i)
+        {
+            if (i >= uTimeoutMs)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
     }
 
 private:
+    base::memory::IAllocator *m_pDefaultAllocator{nullptr};
     base::memory::IAllocator *m_pAllocator{nullptr};
+    std::atomic<uint64_t> m_uOutstandingCount{0};
 };
 
 }
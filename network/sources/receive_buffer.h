@@ -21,7 +21,7 @@ public:
     {
         if (m_pData != nullptr)
         {
-            m_pAllocator->Free(m_pData);
+            m_pAllocator->Free(m_pData, m_uSize);
             m_pData = nullptr;
         }
         m_pAllocator = nullptr;
@@ -94,15 +94,17 @@ public:
             m_uHead = 0;
         }
 
-        auto pNewData = reinterpret_cast<uint8_t *>(m_pAllocator->Malloc(m_uSize + uLength));
-        if (pNewData == nullptr)
+        // 块内剩余空间足够时直接使用，否则由Realloc原地扩展或搬移
+        if (!m_pAllocator->TryExpand(m_pData, m_uSize + uLength))
         {
-            return ErrorCode::kOutOfMemory;
+            auto pNewData = reinterpret_cast<uint8_t *>(m_pAllocator->Realloc(m_pData, m_uSize + uLength));
+            if (pNewData == nullptr)
+            {
+                return ErrorCode::kOutOfMemory;
+            }
+            m_pData = pNewData;
         }
 
-        memcpy(pNewData, m_pData, m_uSize);
-        m_pAllocator->Free(m_pData);
-        m_pData = pNewData;
         m_uSize += uLength;
         return ErrorCode::kSuccess;
     }
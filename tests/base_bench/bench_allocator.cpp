@@ -0,0 +1,640 @@
+/**
+ * 分配器性能测试
+ * 对比std::malloc和IAllocator各后端在以下场景下的延迟和吞吐:
+ *   fixed        单线程固定大小分配释放
+ *   random       单线程随机大小(16B~4KB对数均匀分布)、随机释放顺序
+ *   large        单线程随机大小(4KB~1MB对数均匀分布)，对比伙伴系统后端
+ *   cross_thread 一个线程分配、另一个线程释放，模拟异步日志的使用方式
+ *   scaling      多线程random场景，线程数从1翻倍到-t指定的值
+ *   replay       回放allocator_trace_file记录的trace文件
+ */
+#include <memory/allocator.h>
+#include <memory/allocator_trace.h>
+#include <utilities/common.h>
+#include <utilities/json.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace cppx::base;
+using namespace cppx::base::memory;
+
+namespace
+{
+
+struct BenchOptions
+{
+    std::string strMode {"all"};
+    std::string strBackend {"all"};
+    std::string strTraceFile;
+    uint64_t uOpCount {1000000};
+    uint64_t uFixedSize {64};
+    uint32_t uMaxThreads {std::max(1u, std::thread::hardware_concurrency())};
+};
+
+// 统一malloc和IAllocator的调用方式
+class Backend
+{
+public:
+    Backend(const char *pName, IAllocator *pAllocator) : m_pName(pName), m_pAllocator(pAllocator) {}
+
+    const char *GetName() const { return m_pName; }
+
+    void *Malloc(uint64_t uSize)
+    {
+        return m_pAllocator != nullptr ? m_pAllocator->Malloc(uSize) : std::malloc(uSize);
+    }
+
+    void *MallocAligned(uint64_t uSize, uint64_t uAlign)
+    {
+        if (m_pAllocator != nullptr)
+        {
+            return m_pAllocator->MallocAligned(uSize, uAlign);
+        }
+        void *pMem = nullptr;
+        return posix_memalign(&pMem, uAlign, uSize) == 0 ? pMem : nullptr;
+    }
+
+    void *Realloc(void *pMem, uint64_t uSize)
+    {
+        return m_pAllocator != nullptr ? m_pAllocator->Realloc(pMem, uSize) : std::realloc(pMem, uSize);
+    }
+
+    void Free(void *pMem, uint64_t uSize)
+    {
+        if (m_pAllocator != nullptr)
+        {
+            m_pAllocator->Free(pMem, uSize);
+        }
+        else
+        {
+            std::free(pMem);
+        }
+    }
+
+private:
+    const char *m_pName;
+    IAllocator *m_pAllocator;
+};
+
+// 每kBatchOps次操作取一次时间，避免计时开销淹没单次分配的耗时
+constexpr uint32_t kBatchOps = 64;
+constexpr uint32_t kLiveSlots = 1024;
+
+struct LatencyStats
+{
+    std::vector<uint64_t> vecBatchNs;
+    uint64_t uTotalNs {0};
+    uint64_t uOpCount {0};
+
+    void Merge(const LatencyStats &other)
+    {
+        vecBatchNs.insert(vecBatchNs.end(), other.vecBatchNs.begin(), other.vecBatchNs.end());
+        uTotalNs = std::max(uTotalNs, other.uTotalNs);
+        uOpCount += other.uOpCount;
+    }
+
+    double Percentile(double dPercent)
+    {
+        if (vecBatchNs.empty())
+        {
+            return 0;
+        }
+        std::sort(vecBatchNs.begin(), vecBatchNs.end());
+        auto uIndex = std::min<uint64_t>(vecBatchNs.size() - 1, uint64_t(dPercent / 100 * vecBatchNs.size()));
+        return double(vecBatchNs[uIndex]) / kBatchOps;
+    }
+};
+
+uint64_t NowNs()
+{
+    uint64_t uNowNs = 0;
+    clock_get_time_nano(uNowNs);
+    return uNowNs;
+}
+
+uint64_t XorShift(uint64_t &uState)
+{
+    uState ^= uState << 13;
+    uState ^= uState >> 7;
+    uState ^= uState << 17;
+    return uState;
+}
+
+// 默认16B~4KB的对数均匀分布，小对象更多，接近日志和网络消息的实际分布
+std::vector<uint32_t> MakeRandomSizes(uint64_t uCount, uint64_t uSeed, double dMinExp = 4.0, double dMaxExp = 12.0)
+{
+    std::vector<uint32_t> vecSizes(uCount);
+    for (auto &uSize : vecSizes)
+    {
+        auto dExp = dMinExp + double(XorShift(uSeed) % 8192) / 8192.0 * (dMaxExp - dMinExp);
+        uSize = uint32_t(std::exp2(dExp));
+    }
+    return vecSizes;
+}
+
+void PrintHeader(const char *pTitle)
+{
+    printf("\n== %s ==\n", pTitle);
+    printf("%-10s %8s %12s %10s %10s %10s %10s\n", "backend", "threads", "ops", "Mops/s", "p50(ns)", "p99(ns)", "p999(ns)");
+}
+
+void PrintStats(const char *pBackend, uint32_t uThreads, LatencyStats &stats)
+{
+    auto dMops = stats.uTotalNs == 0 ? 0 : double(stats.uOpCount) * 1000.0 / double(stats.uTotalNs);
+    printf("%-10s %8u %12lu %10.2f %10.1f %10.1f %10.1f\n", pBackend, uThreads, (unsigned long)stats.uOpCount,
+           dMops, stats.Percentile(50), stats.Percentile(99), stats.Percentile(99.9));
+}
+
+// 维持kLiveSlots个存活对象，每次操作释放一个槽位并重新分配，一次释放加一次分配计为一次操作
+LatencyStats RunSlots(Backend &backend, const std::vector<uint32_t> &vecSizes, uint64_t uOpCount, bool bRandomSlot, uint64_t uSeed)
+{
+    LatencyStats stats;
+    stats.vecBatchNs.reserve(uOpCount / kBatchOps + 1);
+    std::vector<void *> vecSlots(kLiveSlots, nullptr);
+    std::vector<uint32_t> vecSlotSizes(kLiveSlots, 0);
+
+    auto uSizeMask = vecSizes.size() - 1;
+    auto uBeginNs = NowNs();
+    for (uint64_t i = 0; i < uOpCount; i += kBatchOps)
+    {
+        auto uBatchBeginNs = NowNs();
+        for (uint32_t j = 0; j < kBatchOps; ++j)
+        {
+            auto uSlot = bRandomSlot ? XorShift(uSeed) % kLiveSlots : (i + j) % kLiveSlots;
+            if (vecSlots[uSlot] != nullptr)
+            {
+                backend.Free(vecSlots[uSlot], vecSlotSizes[uSlot]);
+            }
+            auto uSize = vecSizes[(i + j) & uSizeMask];
+            vecSlots[uSlot] = backend.Malloc(uSize);
+            vecSlotSizes[uSlot] = uSize;
+            // 写一个字节，避免分配被优化掉，也计入首次触碰内存的开销
+            *reinterpret_cast<volatile uint8_t *>(vecSlots[uSlot]) = uint8_t(j);
+        }
+        stats.vecBatchNs.push_back(NowNs() - uBatchBeginNs);
+    }
+    stats.uTotalNs = NowNs() - uBeginNs;
+    stats.uOpCount = uOpCount;
+
+    for (uint32_t i = 0; i < kLiveSlots; ++i)
+    {
+        backend.Free(vecSlots[i], vecSlotSizes[i]);
+    }
+    return stats;
+}
+
+void BenchFixed(std::vector<Backend> &vecBackends, const BenchOptions &options)
+{
+    char szTitle[64];
+    snprintf(szTitle, sizeof(szTitle), "fixed size %lu", (unsigned long)options.uFixedSize);
+    PrintHeader(szTitle);
+    std::vector<uint32_t> vecSizes(1, uint32_t(options.uFixedSize));
+    for (auto &backend : vecBackends)
+    {
+        auto stats = RunSlots(backend, vecSizes, options.uOpCount, false, 1);
+        PrintStats(backend.GetName(), 1, stats);
+    }
+}
+
+void BenchRandom(std::vector<Backend> &vecBackends, const BenchOptions &options)
+{
+    PrintHeader("random size 16B~4KB");
+    auto vecSizes = MakeRandomSizes(1 << 16, 0x9E3779B97F4A7C15ull);
+    for (auto &backend : vecBackends)
+    {
+        auto stats = RunSlots(backend, vecSizes, options.uOpCount, true, 0x2545F4914F6CDD1Dull);
+        PrintStats(backend.GetName(), 1, stats);
+    }
+}
+
+void BenchLarge(std::vector<Backend> &vecBackends, const BenchOptions &options)
+{
+    PrintHeader("large random size 4KB~1MB");
+    auto vecSizes = MakeRandomSizes(1 << 16, 0x9E3779B97F4A7C15ull, 12.0, 20.0);
+    // 存活对象总量约百MB，减少操作次数避免运行过久
+    auto uOpCount = std::max<uint64_t>(kBatchOps, options.uOpCount / 10);
+    for (auto &backend : vecBackends)
+    {
+        auto stats = RunSlots(backend, vecSizes, uOpCount, true, 0x2545F4914F6CDD1Dull);
+        PrintStats(backend.GetName(), 1, stats);
+    }
+}
+
+// 简单的单生产者单消费者指针队列
+class PointerRing
+{
+public:
+    explicit PointerRing(uint32_t uCapacity) : m_vecSlots(uCapacity), m_uMask(uCapacity - 1) {}
+
+    bool Push(void *pMem, uint32_t uSize)
+    {
+        auto uTail = m_uTail.load(std::memory_order_relaxed);
+        if (uTail - m_uHead.load(std::memory_order_acquire) == m_vecSlots.size())
+        {
+            return false;
+        }
+        m_vecSlots[uTail & m_uMask] = {pMem, uSize};
+        m_uTail.store(uTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(void *&pMem, uint32_t &uSize)
+    {
+        auto uHead = m_uHead.load(std::memory_order_relaxed);
+        if (uHead == m_uTail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        pMem = m_vecSlots[uHead & m_uMask].first;
+        uSize = m_vecSlots[uHead & m_uMask].second;
+        m_uHead.store(uHead + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<std::pair<void *, uint32_t>> m_vecSlots;
+    uint64_t m_uMask;
+    ALIGN_AS_CACHELINE std::atomic<uint64_t> m_uHead {0};
+    ALIGN_AS_CACHELINE std::atomic<uint64_t> m_uTail {0};
+};
+
+void BenchCrossThread(std::vector<Backend> &vecBackends, const BenchOptions &options)
+{
+    PrintHeader("cross thread (alloc on producer, free on consumer)");
+    auto vecSizes = MakeRandomSizes(1 << 16, 0x9E3779B97F4A7C15ull);
+    for (auto &backend : vecBackends)
+    {
+        PointerRing ring(1 << 14);
+        std::atomic<bool> bDone {false};
+        std::thread consumer([&]() {
+            void *pMem = nullptr;
+            uint32_t uSize = 0;
+            while (true)
+            {
+                if (ring.Pop(pMem, uSize))
+                {
+                    backend.Free(pMem, uSize);
+                }
+                else if (bDone.load(std::memory_order_acquire))
+                {
+                    // 生产者结束后再排空一次
+                    while (ring.Pop(pMem, uSize))
+                    {
+                        backend.Free(pMem, uSize);
+                    }
+                    break;
+                }
+            }
+        });
+
+        // 只统计生产者一侧的分配延迟，队列满时的等待不计入
+        LatencyStats stats;
+        stats.vecBatchNs.reserve(options.uOpCount / kBatchOps + 1);
+        auto uBeginNs = NowNs();
+        void *apBatch[kBatchOps];
+        for (uint64_t i = 0; i < options.uOpCount; i += kBatchOps)
+        {
+            auto uBatchBeginNs = NowNs();
+            for (uint32_t j = 0; j < kBatchOps; ++j)
+            {
+                apBatch[j] = backend.Malloc(vecSizes[(i + j) & 0xFFFF]);
+                *reinterpret_cast<volatile uint8_t *>(apBatch[j]) = uint8_t(j);
+            }
+            stats.vecBatchNs.push_back(NowNs() - uBatchBeginNs);
+            for (uint32_t j = 0; j < kBatchOps; ++j)
+            {
+                while (!ring.Push(apBatch[j], vecSizes[(i + j) & 0xFFFF]))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        bDone.store(true, std::memory_order_release);
+        consumer.join();
+        stats.uTotalNs = NowNs() - uBeginNs;
+        stats.uOpCount = options.uOpCount;
+        PrintStats(backend.GetName(), 2, stats);
+    }
+}
+
+void BenchScaling(std::vector<Backend> &vecBackends, const BenchOptions &options)
+{
+    PrintHeader("multithreaded scaling, random size");
+    auto vecSizes = MakeRandomSizes(1 << 16, 0x9E3779B97F4A7C15ull);
+    for (auto &backend : vecBackends)
+    {
+        for (uint32_t uThreads = 1; uThreads <= options.uMaxThreads; uThreads *= 2)
+        {
+            std::vector<LatencyStats> vecStats(uThreads);
+            std::vector<std::thread> vecThreads;
+            std::atomic<uint32_t> uReady {0};
+            for (uint32_t i = 0; i < uThreads; ++i)
+            {
+                vecThreads.emplace_back([&, i]() {
+                    // 所有线程就绪后同时开始，避免先启动的线程独占
+                    uReady.fetch_add(1);
+                    while (uReady.load() != uThreads)
+                    {
+                    }
+                    vecStats[i] = RunSlots(backend, vecSizes, options.uOpCount, true, 0x2545F4914F6CDD1Dull + i);
+                });
+            }
+
+            LatencyStats total;
+            for (uint32_t i = 0; i < uThreads; ++i)
+            {
+                vecThreads[i].join();
+                total.Merge(vecStats[i]);
+            }
+            PrintStats(backend.GetName(), uThreads, total);
+        }
+    }
+}
+
+bool LoadTrace(const std::string &strTraceFile, std::vector<AllocTraceRecord> &vecRecords)
+{
+    auto pFile = fopen(strTraceFile.c_str(), "rb");
+    if (pFile == nullptr)
+    {
+        PRINT_ERROR("failed to open trace file %s: %s", strTraceFile.c_str(), strerror(errno));
+        return false;
+    }
+
+    AllocTraceHeader header;
+    if (fread(&header, sizeof(header), 1, pFile) != 1 || header.uMagic != kAllocTraceMagic || header.uVersion != kAllocTraceVersion)
+    {
+        PRINT_ERROR("invalid trace file %s", strTraceFile.c_str());
+        fclose(pFile);
+        return false;
+    }
+
+    AllocTraceRecord record;
+    while (fread(&record, sizeof(record), 1, pFile) == 1)
+    {
+        vecRecords.push_back(record);
+    }
+    fclose(pFile);
+    return true;
+}
+
+// 按文件顺序单线程回放，trace中的地址映射为回放时的地址
+void BenchReplay(std::vector<Backend> &vecBackends, const BenchOptions &options)
+{
+    std::vector<AllocTraceRecord> vecRecords;
+    if (options.strTraceFile.empty())
+    {
+        PRINT_ERROR("replay needs a trace file, use -f");
+        return;
+    }
+    if (!LoadTrace(options.strTraceFile, vecRecords))
+    {
+        return;
+    }
+
+    char szTitle[512];
+    snprintf(szTitle, sizeof(szTitle), "replay %s (%lu records)", options.strTraceFile.c_str(), (unsigned long)vecRecords.size());
+    PrintHeader(szTitle);
+    for (auto &backend : vecBackends)
+    {
+        // addr -> (回放地址, 大小)
+        std::unordered_map<uint64_t, std::pair<void *, uint64_t>> mapLive;
+        mapLive.reserve(vecRecords.size() / 2 + 1);
+        uint64_t uLiveBytes = 0;
+        uint64_t uPeakBytes = 0;
+        uint64_t uUnmatched = 0;
+
+        auto Release = [&](uint64_t uAddr) {
+            auto iter = mapLive.find(uAddr);
+            if (iter == mapLive.end())
+            {
+                // 记录开始前分配的内存
+                uUnmatched++;
+                return;
+            }
+            backend.Free(iter->second.first, iter->second.second);
+            uLiveBytes -= iter->second.second;
+            mapLive.erase(iter);
+        };
+
+        auto Track = [&](uint64_t uAddr, void *pMem, uint64_t uSize) {
+            // realloc释放的旧地址可能先被其他线程复用并记录，此时按已释放处理
+            if (mapLive.count(uAddr) != 0)
+            {
+                uUnmatched++;
+                Release(uAddr);
+            }
+            mapLive[uAddr] = {pMem, uSize};
+            uLiveBytes += uSize;
+            uPeakBytes = std::max(uPeakBytes, uLiveBytes);
+        };
+
+        LatencyStats stats;
+        stats.vecBatchNs.reserve(vecRecords.size() / kBatchOps + 1);
+        auto uBeginNs = NowNs();
+        for (uint64_t i = 0; i < vecRecords.size(); i += kBatchOps)
+        {
+            auto uEnd = std::min<uint64_t>(vecRecords.size(), i + kBatchOps);
+            auto uBatchBeginNs = NowNs();
+            for (auto j = i; j < uEnd; ++j)
+            {
+                auto &record = vecRecords[j];
+                switch (record.uOp)
+                {
+                case kAllocTraceMalloc:
+                    Track(record.uAddr, backend.Malloc(record.uSize), record.uSize);
+                    break;
+                case kAllocTraceMallocAligned:
+                    Track(record.uAddr, backend.MallocAligned(record.uSize, record.uArg), record.uSize);
+                    break;
+                case kAllocTraceFree:
+                    Release(record.uAddr);
+                    break;
+                case kAllocTraceRealloc:
+                {
+                    auto iter = mapLive.find(record.uArg);
+                    void *pOld = nullptr;
+                    if (iter != mapLive.end())
+                    {
+                        pOld = iter->second.first;
+                        uLiveBytes -= iter->second.second;
+                        mapLive.erase(iter);
+                    }
+                    Track(record.uAddr, backend.Realloc(pOld, record.uSize), record.uSize);
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+            // 最后一批可能不足kBatchOps，按比例折算
+            stats.vecBatchNs.push_back((NowNs() - uBatchBeginNs) * kBatchOps / (uEnd - i));
+        }
+        stats.uTotalNs = NowNs() - uBeginNs;
+        stats.uOpCount = vecRecords.size();
+        PrintStats(backend.GetName(), 1, stats);
+        printf("%-10s peak live %lu bytes, %lu unmatched records, %lu still live at end\n", backend.GetName(),
+               (unsigned long)uPeakBytes, (unsigned long)uUnmatched, (unsigned long)mapLive.size());
+
+        for (auto &live : mapLive)
+        {
+            backend.Free(live.second.first, live.second.second);
+        }
+    }
+}
+
+void Usage(const char *pProgram)
+{
+    printf("usage: %s [fixed|random|large|cross_thread|scaling|replay|all] [options]\n"
+           "  -b backend  malloc|cppx|buddy|all, default all\n"
+           "  -n count    operations per thread, default 1000000\n"
+           "  -s size     size for the fixed benchmark, default 64\n"
+           "  -t threads  max threads for the scaling benchmark, default cpu count\n"
+           "  -f file     trace file recorded with allocator_trace_file, required by replay\n",
+           pProgram);
+}
+
+bool ParseOptions(int argc, char *argv[], BenchOptions &options)
+{
+    int i = 1;
+    if (i < argc && argv[i][0] != '-')
+    {
+        options.strMode = argv[i++];
+    }
+
+    for (; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        std::string strOption = argv[i];
+        const char *pValue = argv[++i];
+        if (strOption == "-b")
+        {
+            options.strBackend = pValue;
+        }
+        else if (strOption == "-n")
+        {
+            options.uOpCount = std::max<uint64_t>(kBatchOps, strtoull(pValue, nullptr, 10));
+        }
+        else if (strOption == "-s")
+        {
+            options.uFixedSize = std::max<uint64_t>(1, strtoull(pValue, nullptr, 10));
+        }
+        else if (strOption == "-t")
+        {
+            options.uMaxThreads = std::max<uint32_t>(1, strtoul(pValue, nullptr, 10));
+        }
+        else if (strOption == "-f")
+        {
+            options.strTraceFile = pValue;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    IAllocator *pAllocator = IAllocator::Create();
+    if (pAllocator == nullptr || pAllocator->Init(nullptr) != 0)
+    {
+        PRINT_ERROR("failed to create allocator");
+        return 1;
+    }
+
+    // 伙伴系统后端：不小于4KB的分配从预分配的1GB区域中分配
+    IJson *pBuddyConfig = IJson::Create();
+    IAllocator *pBuddyAllocator = IAllocator::Create();
+    if (pBuddyConfig == nullptr || pBuddyAllocator == nullptr)
+    {
+        PRINT_ERROR("failed to create buddy allocator");
+        return 1;
+    }
+    pBuddyConfig->SetUint64(config::kAllocatorBuddyRegionMB, 1024);
+    if (pBuddyAllocator->Init(pBuddyConfig) != 0)
+    {
+        PRINT_ERROR("failed to init buddy allocator");
+        return 1;
+    }
+
+    std::vector<Backend> vecBackends;
+    if (options.strBackend == "all" || options.strBackend == "malloc")
+    {
+        vecBackends.emplace_back("malloc", nullptr);
+    }
+    if (options.strBackend == "all" || options.strBackend == "cppx")
+    {
+        vecBackends.emplace_back("cppx", pAllocator);
+    }
+    if (options.strBackend == "all" || options.strBackend == "buddy")
+    {
+        vecBackends.emplace_back("buddy", pBuddyAllocator);
+    }
+    if (vecBackends.empty())
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    bool bAll = options.strMode == "all";
+    bool bMatched = false;
+    if (bAll || options.strMode == "fixed")
+    {
+        BenchFixed(vecBackends, options);
+        bMatched = true;
+    }
+    if (bAll || options.strMode == "random")
+    {
+        BenchRandom(vecBackends, options);
+        bMatched = true;
+    }
+    if (bAll || options.strMode == "large")
+    {
+        BenchLarge(vecBackends, options);
+        bMatched = true;
+    }
+    if (bAll || options.strMode == "cross_thread")
+    {
+        BenchCrossThread(vecBackends, options);
+        bMatched = true;
+    }
+    if (bAll || options.strMode == "scaling")
+    {
+        BenchScaling(vecBackends, options);
+        bMatched = true;
+    }
+    if ((bAll && !options.strTraceFile.empty()) || options.strMode == "replay")
+    {
+        BenchReplay(vecBackends, options);
+        bMatched = true;
+    }
+
+    IAllocator::Destroy(pBuddyAllocator);
+    IJson::Destroy(pBuddyConfig);
+    IAllocator::Destroy(pAllocator);
+    if (!bMatched)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,535 @@
+/**
+ * 日志性能测试
+ * 测量日志宏在以下场景下的调用延迟、吞吐和丢弃率，结果输出到终端并写入JSON文件，用于版本间对比:
+ *   latency    单线程逐条计时，对比LOG_INFO(Log)和LOG_INFO2(LogFormat)在同步和异步模式下的p50/p99/p999
+ *   scaling    异步模式多线程扩展性，总条数固定，线程数从1翻倍到-t指定的值
+ *   throughput 异步模式持续写入tmpfs和磁盘的行数/秒，从第一条日志开始计时到全部写入文件为止
+ *   overload   异步模式小队列、丢弃策略下生产者持续满速写入时的丢弃率
+ */
+#include <logger/logger.h>
+#include <logger/logger_ex.h>
+#include <logger/logger_ex2.h>
+#include <utilities/common.h>
+#include <utilities/error_code.h>
+#include <utilities/json.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cppx::base;
+using namespace cppx::base::logger;
+
+namespace
+{
+
+constexpr const char *kModuleName = "bench";
+
+struct BenchOptions
+{
+    std::string strMode {"all"};
+    std::string strDiskPath {"./bench_log"};
+    std::string strTmpfsPath {"/dev/shm/cppx_bench_log"};
+    std::string strOutputFile {"bench_logger.json"};
+    uint64_t uLineCount {200000};
+    uint32_t uMaxThreads {64};
+    uint32_t uProducers {4};
+};
+
+enum class LogApi
+{
+    kLog,       // LOG_INFO，参数为字符串数组，由ILogger::Log格式化
+    kLogFormat, // LOG_INFO2，printf风格，由ILogger::LogFormat格式化
+};
+
+const char *GetApiName(LogApi eApi)
+{
+    return eApi == LogApi::kLog ? "LOG_INFO" : "LOG_INFO2";
+}
+
+uint64_t NowNs()
+{
+    uint64_t uNowNs = 0;
+    clock_get_time_nano(uNowNs);
+    return uNowNs;
+}
+
+// 逐条记录调用耗时，日志调用在百纳秒量级，取时间的开销单独测量并写入结果
+struct LatencyStats
+{
+    std::vector<uint32_t> vecCallNs;
+    uint64_t uTotalNs {0};
+    uint64_t uLineCount {0};
+
+    void Merge(const LatencyStats &other)
+    {
+        vecCallNs.insert(vecCallNs.end(), other.vecCallNs.begin(), other.vecCallNs.end());
+        uTotalNs = std::max(uTotalNs, other.uTotalNs);
+        uLineCount += other.uLineCount;
+    }
+
+    double Percentile(double dPercent)
+    {
+        if (vecCallNs.empty())
+        {
+            return 0;
+        }
+        std::sort(vecCallNs.begin(), vecCallNs.end());
+        auto uIndex = std::min<uint64_t>(vecCallNs.size() - 1, uint64_t(dPercent / 100 * vecCallNs.size()));
+        return vecCallNs[uIndex];
+    }
+};
+
+// 日志对象的统计信息中与测试相关的部分
+struct LoggerCounters
+{
+    uint64_t uEnqueueCount {0};
+    uint64_t uDropCount {0};
+    uint64_t uWriteLines {0};
+};
+
+LoggerCounters GetCounters(ILogger *pLogger)
+{
+    LoggerCounters counters;
+    IJson *pStats = IJson::Create();
+    if (pStats != nullptr && pLogger->GetStats(pStats) == ErrorCode::kSuccess)
+    {
+        counters.uEnqueueCount = pStats->GetUint64("enqueue_count");
+        counters.uDropCount = pStats->GetUint64("drop_count");
+        counters.uWriteLines = pStats->GetUint64("log_lines");
+    }
+    IJson::Destroy(pStats);
+    return counters;
+}
+
+// 所有结果同时追加到JSON数组中，程序结束时写入-o指定的文件
+class Reporter
+{
+public:
+    Reporter() : m_pRoot(IJson::Create()) {}
+    ~Reporter() { IJson::Destroy(m_pRoot); }
+
+    Reporter(const Reporter &) = delete;
+    Reporter &operator=(const Reporter &) = delete;
+
+    bool Init(const BenchOptions &options, double dClockOverheadNs)
+    {
+        if (m_pRoot == nullptr)
+        {
+            return false;
+        }
+        m_pRoot->SetString("bench", "logger");
+        m_pRoot->SetUint64("timestamp", uint64_t(time(nullptr)));
+        m_pRoot->SetUint32("cpu_count", std::thread::hardware_concurrency());
+        m_pRoot->SetDouble("clock_overhead_ns", dClockOverheadNs);
+        auto pOptions = m_pRoot->SetObject("options");
+        if (pOptions != nullptr)
+        {
+            pOptions->SetString("mode", options.strMode.c_str());
+            pOptions->SetUint64("line_count", options.uLineCount);
+            pOptions->SetUint32("max_threads", options.uMaxThreads);
+            pOptions->SetUint32("producers", options.uProducers);
+            pOptions->SetString("disk_path", options.strDiskPath.c_str());
+            pOptions->SetString("tmpfs_path", options.strTmpfsPath.c_str());
+        }
+        m_pResults = m_pRoot->SetArray("results");
+        return m_pResults != nullptr;
+    }
+
+    void PrintHeader(const char *pTitle)
+    {
+        printf("\n== %s ==\n", pTitle);
+        printf("%-10s %-7s %8s %10s %12s %10s %10s %10s %10s\n", "api", "mode", "threads", "lines", "lines/s",
+               "p50(ns)", "p99(ns)", "p999(ns)", "drop(%)");
+    }
+
+    void Report(const char *pScenario, const char *pTarget, LogApi eApi, bool bAsync, uint32_t uThreads,
+                LatencyStats &stats, const LoggerCounters &counters)
+    {
+        auto dLinesPerSec = stats.uTotalNs == 0 ? 0 : double(stats.uLineCount) * 1e9 / double(stats.uTotalNs);
+        auto uAttempts = counters.uEnqueueCount + counters.uDropCount;
+        auto dDropRate = uAttempts == 0 ? 0 : double(counters.uDropCount) / double(uAttempts);
+        auto dP50 = stats.Percentile(50);
+        auto dP99 = stats.Percentile(99);
+        auto dP999 = stats.Percentile(99.9);
+        printf("%-10s %-7s %8u %10lu %12.0f %10.0f %10.0f %10.0f %10.2f\n", GetApiName(eApi), bAsync ? "async" : "sync",
+               uThreads, (unsigned long)stats.uLineCount, dLinesPerSec, dP50, dP99, dP999, dDropRate * 100);
+
+        auto pResult = m_pResults->AppendObject();
+        if (pResult == nullptr)
+        {
+            return;
+        }
+        pResult->SetString("scenario", pScenario);
+        pResult->SetString("target", pTarget);
+        pResult->SetString("api", GetApiName(eApi));
+        pResult->SetString("mode", bAsync ? "async" : "sync");
+        pResult->SetUint32("threads", uThreads);
+        pResult->SetUint64("lines", stats.uLineCount);
+        pResult->SetUint64("elapsed_ns", stats.uTotalNs);
+        pResult->SetDouble("lines_per_sec", dLinesPerSec);
+        pResult->SetDouble("p50_ns", dP50);
+        pResult->SetDouble("p99_ns", dP99);
+        pResult->SetDouble("p999_ns", dP999);
+        pResult->SetDouble("max_ns", stats.vecCallNs.empty() ? 0 : stats.vecCallNs.back());
+        pResult->SetUint64("written_lines", counters.uWriteLines);
+        pResult->SetUint64("drop_count", counters.uDropCount);
+        pResult->SetDouble("drop_rate", dDropRate);
+    }
+
+    bool Save(const std::string &strOutputFile)
+    {
+        auto pFile = fopen(strOutputFile.c_str(), "w");
+        if (pFile == nullptr)
+        {
+            PRINT_ERROR("failed to open result file %s: %s", strOutputFile.c_str(), strerror(errno));
+            return false;
+        }
+        auto pContent = m_pRoot->ToString(true);
+        fputs(pContent != nullptr ? pContent : "{}", pFile);
+        fputc('\n', pFile);
+        fclose(pFile);
+        printf("\nresults written to %s\n", strOutputFile.c_str());
+        return true;
+    }
+
+private:
+    IJson *m_pRoot;
+    IJson *m_pResults {nullptr};
+};
+
+// 每次测试使用新的日志目录，避免上一次的文件影响切换和清理
+class BenchLogger
+{
+public:
+    BenchLogger(const std::string &strPath, bool bAsync, uint32_t uOverflowPolicy, uint32_t uQueueMemKB)
+        : m_strPath(strPath)
+    {
+        std::error_code errorCode;
+        std::filesystem::remove_all(m_strPath, errorCode);
+        std::filesystem::create_directories(m_strPath, errorCode);
+        IJson *pConfig = IJson::Create();
+        if (pConfig == nullptr)
+        {
+            return;
+        }
+        pConfig->SetString(config::kLoggerName, "bench_logger");
+        pConfig->SetUint32(config::kLogLevel, (uint32_t)ILogger::LogLevel::kInfo);
+        pConfig->SetBool(config::kLogAsync, bAsync);
+        pConfig->SetString(config::kLogPath, m_strPath.c_str());
+        pConfig->SetString(config::kLogPrefix, "bench");
+        pConfig->SetUint64(config::kLogFileMaxSizeMB, 256);
+        pConfig->SetUint64(config::kLogTotalSizeMB, 16 * 1024);
+        pConfig->SetUint32(config::kLogThreadQueueMemKB, uQueueMemKB);
+        pConfig->SetUint32(config::kLogOverflowPolicy, uOverflowPolicy);
+        m_pLogger = ILogger::Create(pConfig);
+        IJson::Destroy(pConfig);
+        if (m_pLogger != nullptr && m_pLogger->Start() != ErrorCode::kSuccess)
+        {
+            ILogger::Destroy(m_pLogger);
+            m_pLogger = nullptr;
+        }
+        if (m_pLogger == nullptr)
+        {
+            PRINT_ERROR("failed to create logger at %s", m_strPath.c_str());
+        }
+    }
+
+    ~BenchLogger()
+    {
+        Close();
+        std::error_code errorCode;
+        std::filesystem::remove_all(m_strPath, errorCode);
+    }
+
+    BenchLogger(const BenchLogger &) = delete;
+    BenchLogger &operator=(const BenchLogger &) = delete;
+
+    ILogger *Get() const { return m_pLogger; }
+
+    // 停止日志线程并销毁日志对象，返回前已写入的日志全部落到文件
+    void Close()
+    {
+        if (m_pLogger != nullptr)
+        {
+            m_pLogger->Stop();
+            ILogger::Destroy(m_pLogger);
+            m_pLogger = nullptr;
+        }
+    }
+
+private:
+    std::string m_strPath;
+    ILogger *m_pLogger {nullptr};
+};
+
+// 参数和格式化工作量在两种接口之间保持一致：一个整数、一个字符串、一个浮点数
+const char kPayload[] = "order accepted by matching engine";
+
+LatencyStats RunProducer(ILogger *pLogger, LogApi eApi, uint64_t uLineCount, uint64_t uSeq)
+{
+    LatencyStats stats;
+    stats.vecCallNs.reserve(uLineCount);
+    auto uBeginNs = NowNs();
+    for (uint64_t i = 0; i < uLineCount; ++i)
+    {
+        auto uCallBeginNs = NowNs();
+        if (eApi == LogApi::kLog)
+        {
+            LOG_INFO(pLogger, ErrorCode::kSuccess, "seq {} payload {} price {}", Wrap(uSeq + i), kPayload, Wrap(1.25 * double(i)));
+        }
+        else
+        {
+            LOG_INFO2(pLogger, ErrorCode::kSuccess, "seq %lu payload %s price %f", (unsigned long)(uSeq + i), kPayload, 1.25 * double(i));
+        }
+        stats.vecCallNs.push_back(uint32_t(std::min<uint64_t>(UINT32_MAX, NowNs() - uCallBeginNs)));
+    }
+    stats.uTotalNs = NowNs() - uBeginNs;
+    stats.uLineCount = uLineCount;
+    return stats;
+}
+
+// 所有线程就绪后同时开始，每个线程写uLineCount条
+LatencyStats RunProducers(ILogger *pLogger, LogApi eApi, uint32_t uThreads, uint64_t uLineCount)
+{
+    std::vector<LatencyStats> vecStats(uThreads);
+    std::vector<std::thread> vecThreads;
+    std::atomic<uint32_t> uReady {0};
+    for (uint32_t i = 0; i < uThreads; ++i)
+    {
+        vecThreads.emplace_back([&, i]() {
+            uReady.fetch_add(1);
+            while (uReady.load() != uThreads)
+            {
+            }
+            vecStats[i] = RunProducer(pLogger, eApi, uLineCount, uint64_t(i) * uLineCount);
+        });
+    }
+
+    LatencyStats total;
+    for (uint32_t i = 0; i < uThreads; ++i)
+    {
+        vecThreads[i].join();
+        total.Merge(vecStats[i]);
+    }
+    return total;
+}
+
+double MeasureClockOverhead()
+{
+    constexpr uint32_t kRounds = 1 << 16;
+    auto uBeginNs = NowNs();
+    for (uint32_t i = 0; i < kRounds; ++i)
+    {
+        NowNs();
+    }
+    return double(NowNs() - uBeginNs) / kRounds;
+}
+
+// 异步模式使用阻塞策略，保证延迟统计的都是成功入队的日志
+constexpr uint32_t kPolicyDrop = 0;
+constexpr uint32_t kPolicyBlock = 1;
+constexpr uint32_t kQueueMemKB = 16 * 1024;
+
+void BenchLatency(Reporter &reporter, const BenchOptions &options)
+{
+    reporter.PrintHeader("per-call latency, 1 thread, tmpfs");
+    for (auto bAsync : {false, true})
+    {
+        for (auto eApi : {LogApi::kLog, LogApi::kLogFormat})
+        {
+            BenchLogger logger(options.strTmpfsPath, bAsync, kPolicyBlock, kQueueMemKB);
+            if (logger.Get() == nullptr)
+            {
+                return;
+            }
+            auto stats = RunProducers(logger.Get(), eApi, 1, options.uLineCount);
+            auto counters = GetCounters(logger.Get());
+            reporter.Report("latency", "tmpfs", eApi, bAsync, 1, stats, counters);
+        }
+    }
+}
+
+// 总条数固定，线程越多每个线程写得越少，反映生产者之间的竞争和日志线程取队列的开销
+void BenchScaling(Reporter &reporter, const BenchOptions &options)
+{
+    reporter.PrintHeader("async multi-producer scaling, tmpfs");
+    for (auto eApi : {LogApi::kLog, LogApi::kLogFormat})
+    {
+        for (uint32_t uThreads = 1; uThreads <= options.uMaxThreads; uThreads *= 2)
+        {
+            BenchLogger logger(options.strTmpfsPath, true, kPolicyBlock, kQueueMemKB);
+            if (logger.Get() == nullptr)
+            {
+                return;
+            }
+            auto uPerThread = std::max<uint64_t>(1, options.uLineCount / uThreads);
+            auto stats = RunProducers(logger.Get(), eApi, uThreads, uPerThread);
+            auto counters = GetCounters(logger.Get());
+            reporter.Report("scaling", "tmpfs", eApi, true, uThreads, stats, counters);
+        }
+    }
+}
+
+// 吞吐按写入文件的行数计算，计时包含日志线程排空队列和关闭文件
+void BenchThroughput(Reporter &reporter, const BenchOptions &options)
+{
+    reporter.PrintHeader("sustained async throughput");
+    std::pair<const char *, const std::string *> aTargets[] = {
+        {"tmpfs", &options.strTmpfsPath},
+        {"disk", &options.strDiskPath},
+    };
+    for (auto &target : aTargets)
+    {
+        printf("-- %s: %s\n", target.first, target.second->c_str());
+        for (auto eApi : {LogApi::kLog, LogApi::kLogFormat})
+        {
+            BenchLogger logger(*target.second, true, kPolicyBlock, kQueueMemKB);
+            if (logger.Get() == nullptr)
+            {
+                break;
+            }
+            auto uBeginNs = NowNs();
+            auto stats = RunProducers(logger.Get(), eApi, options.uProducers, options.uLineCount);
+            auto counters = GetCounters(logger.Get());
+            while (counters.uWriteLines < counters.uEnqueueCount)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                counters = GetCounters(logger.Get());
+            }
+            logger.Close();
+            stats.uTotalNs = NowNs() - uBeginNs;
+            stats.uLineCount = counters.uWriteLines;
+            reporter.Report("throughput", target.first, eApi, true, options.uProducers, stats, counters);
+        }
+    }
+}
+
+// 队列只有64KB，溢出时直接丢弃，丢弃率反映日志线程跟不上生产者时的损失
+void BenchOverload(Reporter &reporter, const BenchOptions &options)
+{
+    reporter.PrintHeader("overload, 64KB queue, drop policy, tmpfs");
+    for (auto eApi : {LogApi::kLog, LogApi::kLogFormat})
+    {
+        BenchLogger logger(options.strTmpfsPath, true, kPolicyDrop, 64);
+        if (logger.Get() == nullptr)
+        {
+            return;
+        }
+        auto stats = RunProducers(logger.Get(), eApi, options.uProducers, options.uLineCount);
+        auto counters = GetCounters(logger.Get());
+        reporter.Report("overload", "tmpfs", eApi, true, options.uProducers, stats, counters);
+    }
+}
+
+void Usage(const char *pProgram)
+{
+    printf("usage: %s [latency|scaling|throughput|overload|all] [options]\n"
+           "  -n count    lines per thread (total lines for scaling), default 200000\n"
+           "  -t threads  max threads for the scaling benchmark, default 64\n"
+           "  -p threads  producer threads for throughput and overload, default 4\n"
+           "  -d path     log directory on disk, default ./bench_log\n"
+           "  -m path     log directory on tmpfs, default /dev/shm/cppx_bench_log\n"
+           "  -o file     json result file, default bench_logger.json\n",
+           pProgram);
+}
+
+bool ParseOptions(int argc, char *argv[], BenchOptions &options)
+{
+    int i = 1;
+    if (i < argc && argv[i][0] != '-')
+    {
+        options.strMode = argv[i++];
+    }
+
+    for (; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        std::string strOption = argv[i];
+        const char *pValue = argv[++i];
+        if (strOption == "-n")
+        {
+            options.uLineCount = std::max<uint64_t>(1, strtoull(pValue, nullptr, 10));
+        }
+        else if (strOption == "-t")
+        {
+            options.uMaxThreads = std::max<uint32_t>(1, strtoul(pValue, nullptr, 10));
+        }
+        else if (strOption == "-p")
+        {
+            options.uProducers = std::max<uint32_t>(1, strtoul(pValue, nullptr, 10));
+        }
+        else if (strOption == "-d")
+        {
+            options.strDiskPath = pValue;
+        }
+        else if (strOption == "-m")
+        {
+            options.strTmpfsPath = pValue;
+        }
+        else if (strOption == "-o")
+        {
+            options.strOutputFile = pValue;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    Reporter reporter;
+    if (!reporter.Init(options, MeasureClockOverhead()))
+    {
+        PRINT_ERROR("failed to create result json %s", "");
+        return 1;
+    }
+
+    bool bAll = options.strMode == "all";
+    bool bMatched = false;
+    if (bAll || options.strMode == "latency")
+    {
+        BenchLatency(reporter, options);
+        bMatched = true;
+    }
+    if (bAll || options.strMode == "scaling")
+    {
+        BenchScaling(reporter, options);
+        bMatched = true;
+    }
+    if (bAll || options.strMode == "throughput")
+    {
+        BenchThroughput(reporter, options);
+        bMatched = true;
+    }
+    if (bAll || options.strMode == "overload")
+    {
+        BenchOverload(reporter, options);
+        bMatched = true;
+    }
+    if (!bMatched)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    return reporter.Save(options.strOutputFile) ? 0 : 1;
+}
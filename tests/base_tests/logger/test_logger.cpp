@@ -1,13 +1,27 @@
 #include <gtest/gtest.h>
 #include <logger/logger.h>
+#include <logger/log_binary.h>
+#include <logger/log_sink.h>
+#include <logger/logger_ex.h>
+#include <logger/logger_ex3.h>
+#include <thread/thread_manager.h>
 #include <utilities/json.h>
 #include <utilities/error_code.h>
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <sstream>
 #include <thread>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <vector>
 #include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 using namespace cppx::base;
 using namespace cppx::base::logger;
@@ -790,3 +804,1340 @@ TEST_F(CppxLoggerTest, TestErrorCode)
     EXPECT_NE(logContent.find("200"), std::string::npos);
     EXPECT_NE(logContent.find("-1"), std::string::npos);
 }
+
+// 测试每个线程独立队列 - 所有日志都写出且每个线程内部保持顺序
+TEST_F(CppxLoggerTest, TestPerThreadQueueOrder)
+{
+    JsonGuard config = CreateDefaultConfig(true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    logger->Start();
+
+    const int numThreads = 4;
+    const int logsPerThread = 1000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads.emplace_back([&logger, i]() {
+            char szThread[16];
+            snprintf(szThread, sizeof(szThread), "t%d", i);
+            for (int j = 0; j < logsPerThread; ++j)
+            {
+                char szSeq[16];
+                snprintf(szSeq, sizeof(szSeq), "%d", j);
+                const char *ppParams[] = {szThread, szSeq};
+                // 队列满时重试，保证不丢日志
+                while (logger->Log(0, ILogger::LogLevel::kInfo, "Order", "test_logger.cpp:1000", "Order",
+                                   "order {} seq {}", ppParams, 2) != ErrorCode::kSuccess)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    JsonGuard stats;
+    EXPECT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    // 已退出线程的队列可能已被回收，统计累加到已回收的部分
+    EXPECT_LE(stats->GetUint32("thread_queue_count"), uint32_t(numThreads));
+    EXPECT_EQ(stats->GetUint64("enqueue_count"), uint64_t(numThreads * logsPerThread));
+
+    // 销毁时会写完剩余的日志
+    ILogger::Destroy(logger.release());
+
+    std::istringstream content(ReadLogFile("test_logger.log"));
+    std::vector<int> vecNextSeq(numThreads, 0);
+    std::string strLine;
+    int iTotal = 0;
+    while (std::getline(content, strLine))
+    {
+        int iThread = -1;
+        int iSeq = -1;
+        auto uPos = strLine.find("order t");
+        ASSERT_NE(uPos, std::string::npos);
+        ASSERT_EQ(sscanf(strLine.c_str() + uPos, "order t%d seq %d", &iThread, &iSeq), 2);
+        ASSERT_GE(iThread, 0);
+        ASSERT_LT(iThread, numThreads);
+        EXPECT_EQ(iSeq, vecNextSeq[iThread]);
+        vecNextSeq[iThread] = iSeq + 1;
+        ++iTotal;
+    }
+    EXPECT_EQ(iTotal, numThreads * logsPerThread);
+}
+
+// 参数序列化到通道元素中，参数个数超过长度缓存、参数较长时内容保持完整
+TEST_F(CppxLoggerTest, TestLogSerializedParams)
+{
+    JsonGuard config = CreateDefaultConfig(true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    logger->Start();
+
+    const uint32_t uParamCount = 40;
+    std::vector<std::string> vecParams;
+    std::vector<const char *> vecParamPtrs;
+    std::string strFormat;
+    std::string strExpected;
+    for (uint32_t i = 0; i < uParamCount; ++i)
+    {
+        vecParams.push_back("p" + std::to_string(i) + std::string(i * 7, 'x'));
+        strFormat += "{},";
+        strExpected += vecParams.back() + ",";
+    }
+    for (auto &strParam : vecParams)
+    {
+        vecParamPtrs.push_back(strParam.c_str());
+    }
+
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(logger->Log(0, ILogger::LogLevel::kInfo, "Serialize", "test_logger.cpp:900", "Serialize",
+                              strFormat.c_str(), vecParamPtrs.data(), uParamCount), ErrorCode::kSuccess);
+    }
+    // 超过通道容量的日志返回失败
+    std::string strHuge(4 * 1024 * 1024, 'h');
+    const char *ppHuge[] = {strHuge.c_str()};
+    EXPECT_NE(logger->Log(0, ILogger::LogLevel::kInfo, "Serialize", "test_logger.cpp:900", "Serialize",
+                          "{}", ppHuge, 1), ErrorCode::kSuccess);
+
+    ILogger::Destroy(logger.release());
+
+    std::istringstream content(ReadLogFile("test_logger.log"));
+    std::string strLine;
+    int iCount = 0;
+    while (std::getline(content, strLine))
+    {
+        EXPECT_NE(strLine.find(strExpected), std::string::npos);
+        ++iCount;
+    }
+    EXPECT_EQ(iCount, 100);
+}
+
+// 测试线程管理器创建的线程退出后其队列被回收
+TEST_F(CppxLoggerTest, TestThreadQueueReclaim)
+{
+    static std::atomic<bool> s_bLogged{false};
+    s_bLogged = false;
+
+    JsonGuard config = CreateDefaultConfig(true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    logger->Start();
+
+    auto threadFunc = [](void *pParam) -> bool {
+        auto pLogger = reinterpret_cast<ILogger *>(pParam);
+        pLogger->LogFormat(0, ILogger::LogLevel::kInfo, "from managed thread %d", 1);
+        s_bLogged = true;
+        return false;
+    };
+    auto pThreadManager = IThreadManager::GetInstance();
+    auto pThread = pThreadManager->CreateThread();
+    ASSERT_NE(pThread, nullptr);
+    ASSERT_EQ(pThread->Bind("logger_test", threadFunc, logger.get()), ErrorCode::kSuccess);
+    ASSERT_EQ(pThread->Start(), ErrorCode::kSuccess);
+    while (!s_bLogged)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pThreadManager->DestroyThread(pThread);
+
+    JsonGuard stats;
+    for (int i = 0; i < 100; ++i)
+    {
+        logger->GetStats(stats.get());
+        if (stats->GetUint32("thread_queue_count", 1) == 0)
+        {
+            break;
+        }
+        WaitForAsyncLog(10);
+    }
+    EXPECT_EQ(stats->GetUint32("thread_queue_count", 1), 0u);
+
+    logger->Stop();
+    std::string logContent = ReadLogFile("test_logger.log");
+    EXPECT_NE(logContent.find("from managed thread 1"), std::string::npos);
+}
+
+// 测试std::thread等非线程管理器创建的线程反复创建退出时，队列随线程退出回收，内存不随线程数增长
+TEST_F(CppxLoggerTest, TestStdThreadQueueReclaim)
+{
+    JsonGuard config = CreateDefaultConfig(true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    logger->Start();
+
+    const int numThreads = 20;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        std::thread([&logger, i]() {
+            EXPECT_EQ(logger->LogFormat(0, ILogger::LogLevel::kInfo, "from std thread %d", i), ErrorCode::kSuccess);
+        }).join();
+    }
+
+    JsonGuard stats;
+    for (int i = 0; i < 100; ++i)
+    {
+        logger->GetStats(stats.get());
+        if (stats->GetUint32("thread_queue_count", 1) == 0)
+        {
+            break;
+        }
+        WaitForAsyncLog(10);
+    }
+    EXPECT_EQ(stats->GetUint32("thread_queue_count", 1), 0u);
+    EXPECT_EQ(stats->GetUint64("thread_queue_mem_kb", 1), 0u);
+    EXPECT_EQ(stats->GetUint64("enqueue_count"), uint64_t(numThreads));
+
+    ILogger::Destroy(logger.release());
+    std::string logContent = ReadLogFile("test_logger.log");
+    for (int i = 0; i < numThreads; ++i)
+    {
+        EXPECT_NE(logContent.find("from std thread " + std::to_string(i) + "\n"), std::string::npos);
+    }
+}
+
+// 测试所有线程队列的内存总量不超过log_channel_max_mem_mb，超出时新线程的日志按溢出策略处理，队列回收后可以再次创建
+TEST_F(CppxLoggerTest, TestThreadQueueMemLimit)
+{
+    JsonGuard config = CreateDefaultConfig(true);
+    config->SetUint32(config::kLogThreadQueueMemKB, 1024);
+    config->SetUint32(config::kLogChannelMaxMemMB, 2);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    logger->Start();
+
+    std::atomic<bool> bRelease{false};
+    std::atomic<bool> bLogged{false};
+    EXPECT_EQ(logger->LogFormat(0, ILogger::LogLevel::kInfo, "limit main %d", 0), ErrorCode::kSuccess);
+    std::thread holder([&]() {
+        EXPECT_EQ(logger->LogFormat(0, ILogger::LogLevel::kInfo, "limit holder %d", 1), ErrorCode::kSuccess);
+        bLogged = true;
+        while (!bRelease)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    while (!bLogged)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // 预算已用完，丢弃策略下返回失败
+    std::thread([&logger]() {
+        EXPECT_EQ(logger->LogFormat(0, ILogger::LogLevel::kInfo, "limit rejected %d", 2), ErrorCode::kOutOfMemory);
+    }).join();
+
+    JsonGuard stats;
+    ASSERT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    EXPECT_EQ(stats->GetUint64("thread_queue_mem_kb"), 2048u);
+    EXPECT_EQ(stats->GetUint64("thread_queue_reject_count"), 1u);
+
+    bRelease = true;
+    holder.join();
+    for (int i = 0; i < 100; ++i)
+    {
+        logger->GetStats(stats.get());
+        if (stats->GetUint32("thread_queue_count") == 1)
+        {
+            break;
+        }
+        WaitForAsyncLog(10);
+    }
+    EXPECT_EQ(stats->GetUint32("thread_queue_count"), 1u);
+
+    std::thread([&logger]() {
+        EXPECT_EQ(logger->LogFormat(0, ILogger::LogLevel::kInfo, "limit again %d", 3), ErrorCode::kSuccess);
+    }).join();
+
+    ILogger::Destroy(logger.release());
+    std::string logContent = ReadLogFile("test_logger.log");
+    EXPECT_NE(logContent.find("limit holder 1"), std::string::npos);
+    EXPECT_EQ(logContent.find("limit rejected 2"), std::string::npos);
+    EXPECT_NE(logContent.find("limit again 3"), std::string::npos);
+}
+
+// 二进制模式：每个调用点只写一次格式串记录，日志记录只包含格式串ID和参数内容
+TEST_F(CppxLoggerTest, TestLogBinary)
+{
+    for (bool bAsync : {false, true})
+    {
+        std::filesystem::remove(m_testLogPath + "/test_logger.log");
+
+        JsonGuard config = CreateDefaultConfig(bAsync);
+        config->SetBool(config::kLogBinary, true);
+        LoggerGuard logger(ILogger::Create(config.get()));
+        ASSERT_NE(logger.get(), nullptr);
+        logger->Start();
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const char *ppParams[] = {"alice", "42"};
+            EXPECT_EQ(logger->Log(7, ILogger::LogLevel::kWarn, "Binary", "test_logger.cpp:1100", "TestLogBinary",
+                                  "user {} age {}", ppParams, 2), ErrorCode::kSuccess);
+        }
+        EXPECT_EQ(logger->LogFormat(0, ILogger::LogLevel::kInfo, "format %d", 5), ErrorCode::kSuccess);
+        ILogger::Destroy(logger.release());
+
+        std::string strContent = ReadLogFile("test_logger.log");
+        uint32_t uSessionCount = 0;
+        uint32_t uFormatCount = 0;
+        uint32_t uLogCount = 0;
+        uint32_t uTextCount = 0;
+        uint32_t uFormatId = 0;
+        size_t uOffset = 0;
+        while (uOffset + sizeof(binary::RecordHeader) <= strContent.size())
+        {
+            binary::RecordHeader header;
+            memcpy(&header, strContent.data() + uOffset, sizeof(header));
+            ASSERT_EQ(header.uMagic, binary::kRecordMagic);
+            ASSERT_LE(uOffset + header.uLength, strContent.size());
+            const char *pRecord = strContent.data() + uOffset;
+
+            switch ((binary::RecordType)header.uType)
+            {
+            case binary::RecordType::kSession:
+                EXPECT_EQ(uOffset, 0u);
+                ++uSessionCount;
+                break;
+            case binary::RecordType::kFormat:
+            {
+                binary::FormatRecord record;
+                memcpy(&record, pRecord, sizeof(record));
+                std::string strFormat(pRecord + sizeof(record) + record.uModuleLen + record.uFileLineLen
+                                      + record.uFunctionLen, record.uFormatLen);
+                EXPECT_EQ(strFormat, "user {} age {}");
+                uFormatId = record.uFormatId;
+                ++uFormatCount;
+                break;
+            }
+            case binary::RecordType::kLog:
+            {
+                binary::LogRecord record;
+                memcpy(&record, pRecord, sizeof(record));
+                EXPECT_EQ(record.uFormatId, uFormatId);
+                EXPECT_EQ(record.iErrorNo, 7);
+                EXPECT_EQ(record.uLevel, (uint8_t)ILogger::LogLevel::kWarn);
+                ASSERT_EQ(record.uParamCount, 2);
+                uint32_t auParamLen[2];
+                memcpy(auParamLen, pRecord + sizeof(record), sizeof(auParamLen));
+                EXPECT_EQ(std::string(pRecord + sizeof(record) + sizeof(auParamLen), auParamLen[0]), "alice");
+                EXPECT_EQ(std::string(pRecord + sizeof(record) + sizeof(auParamLen) + auParamLen[0], auParamLen[1]), "42");
+                ++uLogCount;
+                break;
+            }
+            case binary::RecordType::kText:
+            {
+                binary::TextRecord record;
+                memcpy(&record, pRecord, sizeof(record));
+                std::string strText(pRecord + sizeof(record), record.uTextLen);
+                EXPECT_NE(strText.find("format 5\n"), std::string::npos);
+                ++uTextCount;
+                break;
+            }
+            default:
+                ADD_FAILURE() << "unknown record type " << header.uType;
+                break;
+            }
+            uOffset += header.uLength;
+        }
+
+        EXPECT_EQ(uOffset, strContent.size());
+        EXPECT_EQ(uSessionCount, 1u);
+        EXPECT_EQ(uFormatCount, 1u);
+        EXPECT_EQ(uLogCount, 3u);
+        EXPECT_EQ(uTextCount, 1u);
+    }
+}
+
+namespace
+{
+constexpr const char *kModuleName = "Typed";
+
+enum class TestColor : uint8_t
+{
+    kRed = 1,
+    kGreen = 2,
+};
+
+static_assert(logger::typed_detail::CountPlaceholders("a {} b {} c") == 2, "placeholder count");
+static_assert(logger::typed_detail::ParseSegments<2>("a {} b {} c")[1].uOffset == 4, "segment offset");
+static_assert(logger::typed_detail::ParseSegments<2>("a {} b {} c")[2].uLength == 2, "segment length");
+}
+
+// 按类型记录的参数在日志线程格式化，输出与Wrap一致
+TEST_F(CppxLoggerTest, TestLogTyped)
+{
+    for (bool bAsync : {false, true})
+    {
+        std::filesystem::remove(m_testLogPath + "/test_logger.log");
+
+        JsonGuard config = CreateDefaultConfig(bAsync);
+        LoggerGuard logger(ILogger::Create(config.get()));
+        ASSERT_NE(logger.get(), nullptr);
+        logger->Start();
+
+        ILogger *pLogger = logger.get();
+        std::string strName = "bob";
+        std::string_view strView = "view-not-terminated";
+        LOG_WARN3(pLogger, ErrorCode::kInvalidParam, "i={} u={} d={} b={} c={} s={} v={} e={}",
+                  -42, uint64_t(18446744073709551615ULL), 1.5, true, 'x', strName, strView.substr(0, 4), TestColor::kGreen);
+        LOG_INFO3(pLogger, ErrorCode::kSuccess, "no args");
+        LOG_DEBUG3(pLogger, ErrorCode::kSuccess, "filtered {}", 1);
+        ILogger::Destroy(logger.release());
+
+        std::string strContent = ReadLogFile("test_logger.log");
+        EXPECT_NE(strContent.find(" WARN [Typed] i=-42 u=18446744073709551615 d=1.500000 b=true c=x s=bob v=view e=2("),
+                  std::string::npos) << strContent;
+        EXPECT_NE(strContent.find(" INFO [Typed] no args("), std::string::npos);
+        EXPECT_EQ(strContent.find("filtered"), std::string::npos);
+    }
+}
+
+// 异步模式下日志先写入缓冲区，批量写入文件，FATAL日志在返回前写入并同步
+TEST_F(CppxLoggerTest, TestLogWriteBuffer)
+{
+    JsonGuard config = CreateDefaultConfig(true);
+    config->SetUint32(config::kLogWriteBufferKB, 4096);
+    config->SetUint32(config::kLogFlushIntervalMs, 1000);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    logger->Start();
+
+    const int logCount = 2000;
+    for (int i = 0; i < logCount; ++i)
+    {
+        const char *ppParams[] = {"batch"};
+        while (logger->Log(0, ILogger::LogLevel::kInfo, "Writer", "test_logger.cpp:1200", "Writer",
+                           "line {}", ppParams, 1) != ErrorCode::kSuccess)
+        {
+            std::this_thread::yield();
+        }
+    }
+    const char *ppParams[] = {"fatal"};
+    EXPECT_EQ(logger->Log(0, ILogger::LogLevel::kFatal, "Writer", "test_logger.cpp:1201", "Writer",
+                          "line {}", ppParams, 1), ErrorCode::kSuccess);
+
+    JsonGuard stats;
+    EXPECT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    EXPECT_EQ(stats->GetUint32("write_buffer_size"), 4096u * 1024);
+    EXPECT_LT(stats->GetUint64("write_calls"), uint64_t(logCount));
+    EXPECT_GE(stats->GetUint64("sync_calls"), 1u);
+
+    std::string strContent = ReadLogFile("test_logger.log");
+    EXPECT_EQ(stats->GetUint64("write_bytes"), strContent.size());
+    EXPECT_EQ(std::count(strContent.begin(), strContent.end(), '\n'), logCount + 1);
+    EXPECT_NE(strContent.find("line fatal"), std::string::npos);
+}
+
+// 日志行的时间是记录日志的时间，精确到微秒，与写入文件的时间无关
+TEST_F(CppxLoggerTest, TestLogTimestamp)
+{
+    JsonGuard config = CreateDefaultConfig(true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+
+    // 日志线程未启动，日志在销毁时才写入文件
+    auto logTime = std::chrono::system_clock::now();
+    const char *ppParams[] = {"stamp"};
+    EXPECT_EQ(logger->Log(-5, ILogger::LogLevel::kError, "Time", "test_logger.cpp:1300", "Time",
+                          "{}", ppParams, 1), ErrorCode::kSuccess);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    ILogger::Destroy(logger.release());
+
+    std::string strContent = ReadLogFile("test_logger.log");
+    struct tm tmTime;
+    memset(&tmTime, 0, sizeof(tmTime));
+    int iMicro = 0;
+    unsigned uPid = 0;
+    unsigned uTid = 0;
+    int iErrorNo = 0;
+    char szLevel[8] = {0};
+    ASSERT_EQ(sscanf(strContent.c_str(), "%4d%2d%2d-%2d:%2d:%2d.%6d %u %u %d %7s",
+                     &tmTime.tm_year, &tmTime.tm_mon, &tmTime.tm_mday,
+                     &tmTime.tm_hour, &tmTime.tm_min, &tmTime.tm_sec, &iMicro,
+                     &uPid, &uTid, &iErrorNo, szLevel), 11) << strContent;
+    EXPECT_EQ(uPid, (unsigned)getpid());
+    EXPECT_EQ(uTid, (unsigned)gettid());
+    EXPECT_EQ(iErrorNo, -5);
+    EXPECT_STREQ(szLevel, "ERROR");
+    EXPECT_NE(strContent.find(" ERROR [Time] stamp(test_logger.cpp:1300,Time)\n"), std::string::npos);
+
+    tmTime.tm_year -= 1900;
+    tmTime.tm_mon -= 1;
+    tmTime.tm_isdst = -1;
+    auto lineTime = std::chrono::system_clock::from_time_t(mktime(&tmTime)) + std::chrono::microseconds(iMicro);
+    auto diffMs = std::chrono::duration_cast<std::chrono::milliseconds>(lineTime - logTime).count();
+    EXPECT_LT(std::abs(diffMs), 100) << strContent;
+}
+
+// mmap模式按块映射文件，关闭时截断到实际大小，异常退出留下的末尾空洞在重新打开时跳过
+TEST_F(CppxLoggerTest, TestLogMmap)
+{
+    // 模拟进程崩溃后遗留的文件: 大小停在按页对齐的映射窗口末尾，已写入的日志之后是未写入的0
+    std::string strFilePath = m_testLogPath + "/test_logger.log";
+    {
+        std::ofstream file(strFilePath, std::ios::binary);
+        file << "crashed\n";
+        file << std::string(2 * sysconf(_SC_PAGESIZE) - strlen("crashed\n"), '\0');
+    }
+
+    JsonGuard config = CreateDefaultConfig(true);
+    config->SetBool(config::kLogMmap, true);
+    config->SetUint32(config::kLogMmapChunkMB, 1);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    logger->Start();
+
+    const int logCount = 30000;
+    for (int i = 0; i < logCount; ++i)
+    {
+        const char *ppParams[] = {"mapped"};
+        while (logger->Log(0, ILogger::LogLevel::kInfo, "Mmap", "test_logger.cpp:1400", "Mmap",
+                           "line {}", ppParams, 1) != ErrorCode::kSuccess)
+        {
+            std::this_thread::yield();
+        }
+    }
+    WaitForAsyncLog(200);
+
+    JsonGuard stats;
+    EXPECT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    EXPECT_GT(stats->GetUint64("mmap_remap_count"), 2u);
+    auto uWriteBytes = stats->GetUint64("write_bytes");
+    ILogger::Destroy(logger.release());
+
+    std::string strContent = ReadLogFile("test_logger.log");
+    EXPECT_EQ(std::filesystem::file_size(strFilePath), strContent.size());
+    EXPECT_EQ(strContent.size(), uWriteBytes + strlen("crashed\n"));
+    EXPECT_EQ(strContent.find('\0'), std::string::npos);
+    EXPECT_EQ(strContent.compare(0, 8, "crashed\n"), 0);
+    EXPECT_EQ(std::count(strContent.begin(), strContent.end(), '\n'), logCount + 1);
+}
+
+// 二进制记录可能以0结尾，mmap模式正常关闭后重新打开从文件末尾继续写，异常退出后保留末尾的0
+TEST_F(CppxLoggerTest, TestLogMmapBinaryReopen)
+{
+    std::string strFilePath = m_testLogPath + "/test_logger.log";
+    auto writeOnce = [this](const char *pFormat) {
+        JsonGuard config = CreateDefaultConfig(false);
+        config->SetBool(config::kLogBinary, true);
+        config->SetBool(config::kLogMmap, true);
+        config->SetUint32(config::kLogMmapChunkMB, 1);
+        LoggerGuard logger(ILogger::Create(config.get()));
+        ASSERT_NE(logger.get(), nullptr);
+        // 没有参数的日志记录以为0的参数个数结尾
+        EXPECT_EQ(logger->Log(0, ILogger::LogLevel::kInfo, "Reopen", "test_logger.cpp:1500", "Reopen",
+                              pFormat, nullptr, 0), ErrorCode::kSuccess);
+    };
+    // 返回各类记录的个数，记录必须首尾相接
+    auto countRecords = [](const std::string &strContent, size_t uOffset) {
+        std::map<uint16_t, uint32_t> mapCounts;
+        while (uOffset < strContent.size())
+        {
+            binary::RecordHeader header;
+            EXPECT_LE(uOffset + sizeof(header), strContent.size());
+            memcpy(&header, strContent.data() + uOffset, sizeof(header));
+            EXPECT_EQ(header.uMagic, binary::kRecordMagic);
+            if (header.uMagic != binary::kRecordMagic || uOffset + header.uLength > strContent.size())
+            {
+                mapCounts[0]++;
+                break;
+            }
+            mapCounts[header.uType]++;
+            uOffset += header.uLength;
+        }
+        return mapCounts;
+    };
+
+    writeOnce("first");
+    std::string strFirst = ReadLogFile("test_logger.log");
+    ASSERT_FALSE(strFirst.empty());
+    ASSERT_EQ(strFirst.back(), '\0');
+
+    writeOnce("second");
+    std::string strSecond = ReadLogFile("test_logger.log");
+    ASSERT_GT(strSecond.size(), strFirst.size());
+    EXPECT_EQ(strSecond.compare(0, strFirst.size(), strFirst), 0);
+    auto mapCounts = countRecords(strSecond, 0);
+    EXPECT_EQ(mapCounts[0], 0u);
+    EXPECT_EQ(mapCounts[(uint16_t)binary::RecordType::kSession], 2u);
+    EXPECT_EQ(mapCounts[(uint16_t)binary::RecordType::kLog], 2u);
+
+    // 模拟异常退出: 文件大小停在按页对齐的位置，之前的记录保持完整，新的记录从该位置开始
+    size_t uPageSize = sysconf(_SC_PAGESIZE);
+    size_t uCrashSize = (strSecond.size() / uPageSize + 1) * uPageSize;
+    std::filesystem::resize_file(strFilePath, uCrashSize);
+    writeOnce("third");
+    std::string strThird = ReadLogFile("test_logger.log");
+    ASSERT_GT(strThird.size(), uCrashSize);
+    EXPECT_EQ(strThird.compare(0, strSecond.size(), strSecond), 0);
+    EXPECT_EQ(strThird.find_first_not_of('\0', strSecond.size()), uCrashSize);
+    mapCounts = countRecords(strThird, uCrashSize);
+    EXPECT_EQ(mapCounts[0], 0u);
+    EXPECT_EQ(mapCounts[(uint16_t)binary::RecordType::kSession], 1u);
+    EXPECT_EQ(mapCounts[(uint16_t)binary::RecordType::kLog], 1u);
+}
+
+// mmap模式下写入映射窗口的日志按刷新间隔调用Flush，同步策略为每次写入后同步时不必等到关闭文件
+TEST_F(CppxLoggerTest, TestLogMmapFlushSync)
+{
+    JsonGuard config = CreateDefaultConfig(true);
+    config->SetBool(config::kLogMmap, true);
+    config->SetUint32(config::kLogMmapChunkMB, 1);
+    config->SetUint32(config::kLogSyncPolicy, 2);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    logger->Start();
+
+    JsonGuard stats;
+    ASSERT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    auto uSyncCalls = stats->GetUint64("sync_calls");
+    EXPECT_EQ(logger->LogFormat(0, ILogger::LogLevel::kInfo, "mmap sync %d", 1), ErrorCode::kSuccess);
+    for (int i = 0; i < 100; ++i)
+    {
+        WaitForAsyncLog(10);
+        logger->GetStats(stats.get());
+        if (stats->GetUint64("sync_calls") > uSyncCalls)
+        {
+            break;
+        }
+    }
+    EXPECT_GT(stats->GetUint64("sync_calls"), uSyncCalls);
+
+    // 没有新的日志时不再同步
+    WaitForAsyncLog(50);
+    logger->GetStats(stats.get());
+    uSyncCalls = stats->GetUint64("sync_calls");
+    WaitForAsyncLog(50);
+    logger->GetStats(stats.get());
+    EXPECT_EQ(stats->GetUint64("sync_calls"), uSyncCalls);
+}
+
+namespace
+{
+// 把飞行记录器的导出文件还原为"级别 格式串 参数..."或文本，依次返回
+std::vector<std::string> ParseFlightDump(const std::string &strContent)
+{
+    std::vector<std::string> vecEntries;
+    std::map<uint32_t, std::string> mapFormats;
+    size_t uOffset = 0;
+    while (uOffset + sizeof(binary::RecordHeader) <= strContent.size())
+    {
+        binary::RecordHeader header;
+        memcpy(&header, strContent.data() + uOffset, sizeof(header));
+        if (header.uMagic != binary::kRecordMagic || uOffset + header.uLength > strContent.size())
+        {
+            vecEntries.push_back("corrupt");
+            break;
+        }
+
+        const char *pRecord = strContent.data() + uOffset;
+        if (header.uType == (uint16_t)binary::RecordType::kFormat)
+        {
+            binary::FormatRecord record;
+            memcpy(&record, pRecord, sizeof(record));
+            mapFormats[record.uFormatId] = std::string(pRecord + sizeof(record) + record.uModuleLen
+                                                       + record.uFileLineLen + record.uFunctionLen, record.uFormatLen);
+        }
+        else if (header.uType == (uint16_t)binary::RecordType::kLog)
+        {
+            binary::LogRecord record;
+            memcpy(&record, pRecord, sizeof(record));
+            std::string strEntry = std::to_string(record.uLevel) + " " + mapFormats[record.uFormatId];
+            auto pParam = pRecord + sizeof(record) + record.uParamCount * sizeof(uint32_t);
+            for (uint32_t i = 0; i < record.uParamCount; ++i)
+            {
+                uint32_t uParamLen = 0;
+                memcpy(&uParamLen, pRecord + sizeof(record) + i * sizeof(uint32_t), sizeof(uParamLen));
+                strEntry += " " + std::string(pParam, uParamLen);
+                pParam += uParamLen;
+            }
+            vecEntries.push_back(strEntry);
+        }
+        else if (header.uType == (uint16_t)binary::RecordType::kText)
+        {
+            binary::TextRecord record;
+            memcpy(&record, pRecord, sizeof(record));
+            vecEntries.push_back(std::to_string(record.uLevel) + " " + std::string(pRecord + sizeof(record), record.uTextLen));
+        }
+        uOffset += header.uLength;
+    }
+    return vecEntries;
+}
+}
+
+// 飞行记录器记录所有级别的日志，文件只写入不低于日志级别的日志，FATAL日志和显式调用时导出
+TEST_F(CppxLoggerTest, TestLogFlightRecorder)
+{
+    JsonGuard config = CreateDefaultConfig(false);
+    config->SetBool(config::kLogFlightRecorder, true);
+    config->SetUint32(config::kLogFlightRecorderKB, 16);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    EXPECT_EQ(logger->GetLogLevel(), ILogger::LogLevel::kInfo);
+    EXPECT_EQ(logger->GetCaptureLevel(), ILogger::LogLevel::kTrace);
+
+    ILogger *pLogger = logger.get();
+    LOG_DEBUG3(pLogger, ErrorCode::kSuccess, "debug {}", 1);
+    LOG_INFO3(pLogger, ErrorCode::kSuccess, "info {}", 2);
+    EXPECT_EQ(logger->LogFormat(0, ILogger::LogLevel::kTrace, "trace %d", 3), ErrorCode::kSuccess);
+    EXPECT_EQ(logger->DumpFlightRecorder(), ErrorCode::kSuccess);
+
+    std::string strDumpName = "test_logger.flight." + std::to_string(getpid()) + ".1.bin";
+    auto vecEntries = ParseFlightDump(ReadLogFile(strDumpName));
+    ASSERT_EQ(vecEntries.size(), 3u);
+    EXPECT_EQ(vecEntries[0], "1 debug {} 1");
+    EXPECT_EQ(vecEntries[1], "2 info {} 2");
+    EXPECT_EQ(vecEntries[2].find("0 "), 0u);
+    EXPECT_NE(vecEntries[2].find("trace 3\n"), std::string::npos);
+
+    // 缓冲区写满后覆盖最旧的日志，FATAL日志自动导出
+    for (int i = 0; i < 2000; ++i)
+    {
+        std::string strIndex = std::to_string(i);
+        const char *ppParams[] = {strIndex.c_str()};
+        EXPECT_EQ(logger->Log(0, ILogger::LogLevel::kTrace, "Flight", "test_logger.cpp:1500", "Flight",
+                              "loop {}", ppParams, 1), ErrorCode::kSuccess);
+    }
+    const char *ppParams[] = {"crash"};
+    EXPECT_EQ(logger->Log(0, ILogger::LogLevel::kFatal, "Flight", "test_logger.cpp:1501", "Flight",
+                          "fatal {}", ppParams, 1), ErrorCode::kSuccess);
+
+    JsonGuard stats;
+    EXPECT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    EXPECT_EQ(stats->GetUint32("flight_recorder_rings"), 1u);
+    EXPECT_EQ(stats->GetUint32("flight_recorder_dumps"), 2u);
+
+    strDumpName = "test_logger.flight." + std::to_string(getpid()) + ".2.bin";
+    vecEntries = ParseFlightDump(ReadLogFile(strDumpName));
+    ASSERT_GT(vecEntries.size(), 10u);
+    EXPECT_LT(vecEntries.size(), 2000u);
+    EXPECT_EQ(vecEntries.back(), "5 fatal {} crash");
+    EXPECT_EQ(vecEntries[vecEntries.size() - 2], "0 loop {} 1999");
+    auto iFirst = std::stoi(vecEntries.front().substr(strlen("0 loop {} ")));
+    for (size_t i = 0; i + 1 < vecEntries.size(); ++i)
+    {
+        EXPECT_EQ(vecEntries[i], "0 loop {} " + std::to_string(iFirst + i));
+    }
+
+    ILogger::Destroy(logger.release());
+    std::string strContent = ReadLogFile("test_logger.log");
+    EXPECT_EQ(strContent.find("debug"), std::string::npos);
+    EXPECT_EQ(strContent.find("trace"), std::string::npos);
+    EXPECT_EQ(strContent.find("loop"), std::string::npos);
+    EXPECT_NE(strContent.find("info 2"), std::string::npos);
+    EXPECT_NE(strContent.find("fatal crash"), std::string::npos);
+}
+
+// 进程收到SIGABRT时导出飞行记录器后按原来的方式退出
+TEST_F(CppxLoggerTest, TestLogFlightRecorderSignal)
+{
+    JsonGuard config = CreateDefaultConfig(false);
+    config->SetBool(config::kLogFlightRecorder, true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+
+    ILogger *pLogger = logger.get();
+    auto crash = [pLogger]() {
+        LOG_DEBUG3(pLogger, ErrorCode::kSuccess, "before abort {}", 7);
+        abort();
+    };
+    EXPECT_DEATH(crash(), "");
+
+    auto vecEntries = ParseFlightDump(ReadLogFile("test_logger.flight." + std::to_string(getpid()) + ".1.bin"));
+    ASSERT_EQ(vecEntries.size(), 1u);
+    EXPECT_EQ(vecEntries[0], "1 before abort {} 7");
+}
+
+// 限流和采样按调用点统计，被抑制的条数在下一次允许记录时输出
+TEST_F(CppxLoggerTest, TestLogRateLimited)
+{
+    JsonGuard config = CreateDefaultConfig(false);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+
+    ILogger *pLogger = logger.get();
+    auto logStorm = [pLogger](int iCount) {
+        for (int i = 0; i < iCount; ++i)
+        {
+            LOG_ERROR_RATE_LIMITED(pLogger, 5, ErrorCode::kSysCallFailed, "storm {}", "peer");
+        }
+    };
+    logStorm(100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    logStorm(1);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        LOG_WARN_SAMPLED(pLogger, 10, ErrorCode::kSuccess, "sampled {}", Wrap(i));
+    }
+    ILogger::Destroy(logger.release());
+
+    std::string strContent = ReadLogFile("test_logger.log");
+    size_t uStormCount = 0;
+    for (auto uPos = strContent.find("storm peer"); uPos != std::string::npos; uPos = strContent.find("storm peer", uPos + 1))
+    {
+        ++uStormCount;
+    }
+    EXPECT_EQ(uStormCount, 6u);
+    EXPECT_NE(strContent.find("suppressed 95 logs"), std::string::npos) << strContent;
+    EXPECT_NE(strContent.find("sampled 0("), std::string::npos);
+    EXPECT_NE(strContent.find("sampled 90("), std::string::npos);
+    EXPECT_EQ(strContent.find("sampled 1("), std::string::npos);
+    EXPECT_EQ(std::count(strContent.begin(), strContent.end(), '\n'), 6 + 1 + 10);
+
+    // 多线程同时检查时通过的条数不超过突发容量
+    logger::LogRateLimiter rateLimiter(1, 50);
+    std::atomic<uint32_t> uAllowed {0};
+    std::vector<std::thread> vecThreads;
+    for (int i = 0; i < 4; ++i)
+    {
+        vecThreads.emplace_back([&rateLimiter, &uAllowed]() {
+            for (int j = 0; j < 1000; ++j)
+            {
+                uint64_t uSuppressed = 0;
+                if (rateLimiter.Allow(uSuppressed))
+                {
+                    uAllowed.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto &thread : vecThreads)
+    {
+        thread.join();
+    }
+    EXPECT_GE(uAllowed.load(), 50u);
+    EXPECT_LE(uAllowed.load(), 51u);
+}
+
+// 日志风暴停止后不再有允许记录的调用，异步模式由日志线程输出剩余的被抑制条数，同步模式在退出时输出
+TEST_F(CppxLoggerTest, TestLogRateLimitedStormStops)
+{
+    for (bool bAsync : {true, false})
+    {
+        std::filesystem::remove(m_testLogPath + "/test_logger.log");
+        JsonGuard config = CreateDefaultConfig(bAsync);
+        LoggerGuard logger(ILogger::Create(config.get()));
+        ASSERT_NE(logger.get(), nullptr);
+        logger->Start();
+
+        // 两种模式使用不同的调用点，各自从满的令牌桶开始
+        ILogger *pLogger = logger.get();
+        for (int i = 0; i < 100; ++i)
+        {
+            if (bAsync)
+            {
+                LOG_WARN_RATE_LIMITED(pLogger, 5, ErrorCode::kSysCallFailed, "stop storm {}", "async");
+            }
+            else
+            {
+                LOG_WARN_RATE_LIMITED(pLogger, 5, ErrorCode::kSysCallFailed, "stop storm {}", "sync");
+            }
+        }
+
+        if (bAsync)
+        {
+            std::string strContent;
+            for (int i = 0; i < 300 && strContent.find("suppressed 95 logs") == std::string::npos; ++i)
+            {
+                WaitForAsyncLog(10);
+                strContent = ReadLogFile("test_logger.log");
+            }
+            EXPECT_NE(strContent.find("suppressed 95 logs"), std::string::npos) << strContent;
+        }
+        ILogger::Destroy(logger.release());
+
+        std::string strContent = ReadLogFile("test_logger.log");
+        EXPECT_EQ(std::count(strContent.begin(), strContent.end(), '\n'), 5 + 1) << strContent;
+        auto uPos = strContent.find(" WARN [Typed] suppressed 95 logs(");
+        EXPECT_NE(uPos, std::string::npos) << strContent;
+        EXPECT_EQ(strContent.find("suppressed", strContent.find('\n', uPos)), std::string::npos);
+    }
+}
+
+// 输出目标与日志文件共享格式化结果，各自按级别过滤，无法写入时丢弃并计数
+TEST_F(CppxLoggerTest, TestLogSinks)
+{
+    std::string strSocketPath = m_testLogPath + "/collector.sock";
+    int32_t iCollector = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    ASSERT_GE(iCollector, 0);
+    int32_t iRecvBuffer = 4096;
+    setsockopt(iCollector, SOL_SOCKET, SO_RCVBUF, &iRecvBuffer, sizeof(iRecvBuffer));
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, strSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(bind(iCollector, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+
+    JsonGuard memoryConfig;
+    memoryConfig->SetString(config::kSinkName, "memory");
+    memoryConfig->SetUint32(config::kSinkType, (uint32_t)ILogSink::SinkType::kMemory);
+    memoryConfig->SetUint32(config::kSinkMemoryKB, 64);
+    ILogSink *pMemorySink = ILogSink::Create(memoryConfig.get());
+    ASSERT_NE(pMemorySink, nullptr);
+
+    JsonGuard unixConfig;
+    unixConfig->SetString(config::kSinkName, "collector");
+    unixConfig->SetUint32(config::kSinkType, (uint32_t)ILogSink::SinkType::kUnix);
+    unixConfig->SetString(config::kSinkAddress, strSocketPath.c_str());
+    ILogSink *pUnixSink = ILogSink::Create(unixConfig.get());
+    ASSERT_NE(pUnixSink, nullptr);
+
+    JsonGuard config = CreateDefaultConfig(false);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    EXPECT_EQ(logger->AddSink(nullptr, ILogger::LogLevel::kInfo), ErrorCode::kInvalidParam);
+    EXPECT_EQ(logger->AddSink(pMemorySink, ILogger::LogLevel::kDebug), ErrorCode::kSuccess);
+    EXPECT_EQ(logger->AddSink(pUnixSink, ILogger::LogLevel::kWarn), ErrorCode::kSuccess);
+    EXPECT_EQ(logger->GetCaptureLevel(), ILogger::LogLevel::kDebug);
+
+    ILogger *pLogger = logger.get();
+    LOG_DEBUG(pLogger, ErrorCode::kSuccess, "sink debug {}", "line");
+    LOG_INFO(pLogger, ErrorCode::kSuccess, "sink info {}", "line");
+    LOG_WARN(pLogger, ErrorCode::kSuccess, "sink warn {}", "line");
+
+    char szBuffer[4096];
+    auto iRecvLen = recv(iCollector, szBuffer, sizeof(szBuffer), 0);
+    ASSERT_GT(iRecvLen, 0);
+    std::string strDatagram(szBuffer, iRecvLen);
+    EXPECT_NE(strDatagram.find("sink warn line"), std::string::npos) << strDatagram;
+    EXPECT_LT(recv(iCollector, szBuffer, sizeof(szBuffer), 0), 0);
+
+    auto uReadLen = pMemorySink->Read(szBuffer, sizeof(szBuffer));
+    std::string strMemory(szBuffer, uReadLen);
+    EXPECT_NE(strMemory.find("sink debug line"), std::string::npos) << strMemory;
+    EXPECT_NE(strMemory.find("sink info line"), std::string::npos);
+    EXPECT_NE(strMemory.find("sink warn line"), std::string::npos);
+    EXPECT_EQ(pUnixSink->Read(szBuffer, sizeof(szBuffer)), 0u);
+
+    // 采集端不读取，接收缓冲区写满后继续写入的日志被丢弃
+    for (int i = 0; i < 1000; ++i)
+    {
+        LOG_WARN(pLogger, ErrorCode::kSuccess, "sink flood {}", Wrap(i));
+    }
+
+    JsonGuard stats;
+    ASSERT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    auto pSinks = stats->GetArray("sinks");
+    ASSERT_NE(pSinks, nullptr);
+    ASSERT_EQ(pSinks->GetSize(), 2u);
+    auto pMemoryStats = pSinks->GetObject(0u);
+    auto pUnixStats = pSinks->GetObject(1u);
+    ASSERT_NE(pMemoryStats, nullptr);
+    ASSERT_NE(pUnixStats, nullptr);
+    EXPECT_STREQ(pMemoryStats->GetString("name"), "memory");
+    EXPECT_EQ(pMemoryStats->GetUint64("write_count"), 1003u);
+    EXPECT_EQ(pMemoryStats->GetUint64("drop_count"), 0u);
+    EXPECT_STREQ(pUnixStats->GetString("name"), "collector");
+    EXPECT_GT(pUnixStats->GetUint64("drop_count"), 0u);
+    EXPECT_EQ(pUnixStats->GetUint64("write_count") + pUnixStats->GetUint64("drop_count"), 1001u);
+    ILogger::Destroy(logger.release());
+
+    std::string strContent = ReadLogFile("test_logger.log");
+    EXPECT_EQ(strContent.find("sink debug line"), std::string::npos);
+    EXPECT_NE(strContent.find("sink info line"), std::string::npos);
+    EXPECT_NE(strContent.find("sink flood 999("), std::string::npos);
+
+    ILogSink::Destroy(pUnixSink);
+    ILogSink::Destroy(pMemorySink);
+    close(iCollector);
+}
+
+// 启动时扫描一次已切换的文件，之后切换时更新索引，超出总大小的最早文件由清理线程删除
+TEST_F(CppxLoggerTest, TestLogRetention)
+{
+    std::string strOldFile(800 * 1024, 'x');
+    const char *apOldFiles[] = {"test_logger-20000101-000000.log", "test_logger-20000102-000000.log",
+                                "test_logger-20000103-000000.log"};
+    for (auto pOldFile : apOldFiles)
+    {
+        std::ofstream file(m_testLogPath + "/" + pOldFile);
+        file << strOldFile;
+    }
+    std::ofstream(m_testLogPath + "/other.log") << strOldFile;
+    // 上次压缩中途退出留下的临时文件在启动时删除，其他程序的临时文件不处理
+    std::ofstream(m_testLogPath + "/test_logger-20000101-000000.log.gz.tmp") << strOldFile;
+    std::ofstream(m_testLogPath + "/other.log.gz.tmp") << strOldFile;
+
+    auto waitRemoved = [this](const char *pFileName) {
+        for (int i = 0; i < 200 && std::filesystem::exists(m_testLogPath + "/" + pFileName); ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return !std::filesystem::exists(m_testLogPath + "/" + pFileName);
+    };
+
+    JsonGuard config = CreateDefaultConfig(false);
+    config->SetUint64(config::kLogFileMaxSizeMB, 1);
+    config->SetUint64(config::kLogTotalSizeMB, 2);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    EXPECT_TRUE(waitRemoved(apOldFiles[0]));
+    EXPECT_TRUE(std::filesystem::exists(m_testLogPath + "/" + apOldFiles[1]));
+    EXPECT_FALSE(std::filesystem::exists(m_testLogPath + "/test_logger-20000101-000000.log.gz.tmp"));
+    EXPECT_TRUE(std::filesystem::exists(m_testLogPath + "/other.log.gz.tmp"));
+
+    std::string strPadding(200, 'p');
+    ILogger *pLogger = logger.get();
+    for (int i = 0; i < 6000; ++i)
+    {
+        LOG_INFO(pLogger, ErrorCode::kSuccess, "retention {} {}", Wrap(i), strPadding.c_str());
+    }
+    EXPECT_TRUE(waitRemoved(apOldFiles[1]));
+    EXPECT_TRUE(std::filesystem::exists(m_testLogPath + "/" + apOldFiles[2]));
+    EXPECT_TRUE(std::filesystem::exists(m_testLogPath + "/other.log"));
+
+    JsonGuard stats;
+    ASSERT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    EXPECT_EQ(stats->GetUint64("rotated_file_count"), 2u);
+    EXPECT_EQ(stats->GetUint64("retention_remove_count"), 2u);
+    EXPECT_LE(stats->GetUint64("rotated_total_size"), 2u * 1024 * 1024);
+}
+
+// 切换后的文件在后台压缩为gzip格式，可用zcat读取，按压缩后的大小计入总大小
+TEST_F(CppxLoggerTest, TestLogCompress)
+{
+    JsonGuard config = CreateDefaultConfig(false);
+    config->SetUint64(config::kLogFileMaxSizeMB, 1);
+    config->SetBool(config::kLogCompress, true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+
+    std::string strPadding(200, 'p');
+    ILogger *pLogger = logger.get();
+    for (int i = 0; i < 6000; ++i)
+    {
+        LOG_INFO(pLogger, ErrorCode::kSuccess, "compress {} {}", Wrap(i), strPadding.c_str());
+    }
+
+    std::string strRotatedFile;
+    for (int i = 0; i < 500 && strRotatedFile.empty(); ++i)
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(m_testLogPath))
+        {
+            auto strFileName = entry.path().filename().string();
+            if (strFileName.size() > 3 && strFileName.compare(strFileName.size() - 3, 3, ".gz") == 0)
+            {
+                strRotatedFile = entry.path().string();
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_FALSE(strRotatedFile.empty());
+    EXPECT_FALSE(std::filesystem::exists(strRotatedFile.substr(0, strRotatedFile.size() - 3)));
+
+    JsonGuard stats;
+    ASSERT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+    EXPECT_EQ(stats->GetUint64("compress_count"), 1u);
+    EXPECT_EQ(stats->GetUint64("compress_errors"), 0u);
+    EXPECT_GE(stats->GetUint64("compress_input_bytes"), 1024u * 1024);
+    EXPECT_EQ(stats->GetUint64("rotated_total_size"), std::filesystem::file_size(strRotatedFile));
+    EXPECT_LT(stats->GetUint64("rotated_total_size") * 4, stats->GetUint64("compress_input_bytes"));
+
+    auto pPipe = popen(("gzip -dc " + strRotatedFile).c_str(), "r");
+    ASSERT_NE(pPipe, nullptr);
+    std::string strContent;
+    char szBuffer[4096];
+    for (size_t uRead = 0; (uRead = fread(szBuffer, 1, sizeof(szBuffer), pPipe)) > 0;)
+    {
+        strContent.append(szBuffer, uRead);
+    }
+    EXPECT_EQ(pclose(pPipe), 0);
+    EXPECT_EQ(strContent.size(), stats->GetUint64("compress_input_bytes"));
+    EXPECT_NE(strContent.find("compress 0 ppp"), std::string::npos);
+    ILogger::Destroy(logger.release());
+    std::string strCurrent = ReadLogFile("test_logger.log");
+    EXPECT_EQ(std::count(strContent.begin(), strContent.end(), '\n')
+              + std::count(strCurrent.begin(), strCurrent.end(), '\n'), 6000);
+}
+
+// 退出时中止正在进行的压缩，删除不完整的输出，原文件保留到下次启动再压缩
+TEST_F(CppxLoggerTest, TestLogCompressAbort)
+{
+    const std::string strOldFile = m_testLogPath + "/test_logger-20000101-000000.log";
+    {
+        std::ofstream file(strOldFile);
+        std::string strLine;
+        for (int i = 0; i < 1000000; ++i)
+        {
+            strLine = "compress abort line " + std::to_string(i * 7919 % 1000003) + "\n";
+            file << strLine;
+        }
+    }
+    auto uOldSize = std::filesystem::file_size(strOldFile);
+
+    JsonGuard config = CreateDefaultConfig(false);
+    config->SetBool(config::kLogCompress, true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    for (int i = 0; i < 500 && !std::filesystem::exists(strOldFile + ".gz.tmp"); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ILogger::Destroy(logger.release());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+    EXPECT_FALSE(std::filesystem::exists(strOldFile + ".gz.tmp"));
+    EXPECT_FALSE(std::filesystem::exists(strOldFile + ".gz"));
+    ASSERT_TRUE(std::filesystem::exists(strOldFile));
+    EXPECT_EQ(std::filesystem::file_size(strOldFile), uOldSize);
+}
+
+// 线程日志队列已满时按溢出策略丢弃、等待或直接写入，并统计入队和写入延迟
+TEST_F(CppxLoggerTest, TestLogOverflowPolicy)
+{
+    auto countLines = [this]() {
+        std::string strContent = ReadLogFile("test_logger.log");
+        return (uint64_t)std::count(strContent.begin(), strContent.end(), '\n');
+    };
+
+    // 不启动日志线程，队列写满后丢弃
+    {
+        JsonGuard config = CreateDefaultConfig(true);
+        config->SetUint32(config::kLogThreadQueueMemKB, 16);
+        config->SetUint32(config::kLogOverflowPolicy, 0);
+        LoggerGuard logger(ILogger::Create(config.get()));
+        ASSERT_NE(logger.get(), nullptr);
+        ILogger *pLogger = logger.get();
+        for (int i = 0; i < 1000; ++i)
+        {
+            LOG_INFO(pLogger, ErrorCode::kSuccess, "overflow drop {}", Wrap(i));
+        }
+
+        JsonGuard stats;
+        ASSERT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+        auto uEnqueueCount = stats->GetUint64("enqueue_count");
+        EXPECT_GT(stats->GetUint64("drop_count"), 0u);
+        EXPECT_EQ(uEnqueueCount + stats->GetUint64("drop_count"), 1000u);
+        EXPECT_EQ(stats->GetUint64("queue_depth"), uEnqueueCount);
+        EXPECT_GT(stats->GetUint64("enqueue_latency_max_ns"), 0u);
+        ILogger::Destroy(logger.release());
+        EXPECT_EQ(countLines(), uEnqueueCount);
+    }
+    std::filesystem::remove(m_testLogPath + "/test_logger.log");
+
+    // 队列写满后在当前线程直接写入，不丢日志
+    {
+        JsonGuard config = CreateDefaultConfig(true);
+        config->SetUint32(config::kLogThreadQueueMemKB, 16);
+        config->SetUint32(config::kLogOverflowPolicy, 2);
+        LoggerGuard logger(ILogger::Create(config.get()));
+        ASSERT_NE(logger.get(), nullptr);
+        ILogger *pLogger = logger.get();
+        for (int i = 0; i < 1000; ++i)
+        {
+            LOG_INFO(pLogger, ErrorCode::kSuccess, "overflow inline {}", Wrap(i));
+        }
+
+        JsonGuard stats;
+        ASSERT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+        EXPECT_EQ(stats->GetUint64("drop_count"), 0u);
+        EXPECT_GT(stats->GetUint64("overflow_inline_count"), 0u);
+        EXPECT_EQ(stats->GetUint64("enqueue_count") + stats->GetUint64("overflow_inline_count"), 1000u);
+        EXPECT_EQ(stats->GetUint64("log_lines"), stats->GetUint64("overflow_inline_count"));
+        ILogger::Destroy(logger.release());
+        EXPECT_EQ(countLines(), 1000u);
+    }
+    std::filesystem::remove(m_testLogPath + "/test_logger.log");
+
+    // 日志线程运行时等待队列空出位置，不丢日志
+    {
+        JsonGuard config = CreateDefaultConfig(true);
+        config->SetUint32(config::kLogThreadQueueMemKB, 16);
+        config->SetUint32(config::kLogOverflowPolicy, 1);
+        config->SetUint32(config::kLogOverflowBlockUs, 1000000);
+        LoggerGuard logger(ILogger::Create(config.get()));
+        ASSERT_NE(logger.get(), nullptr);
+        ASSERT_EQ(logger->Start(), ErrorCode::kSuccess);
+        ILogger *pLogger = logger.get();
+        for (int i = 0; i < 5000; ++i)
+        {
+            LOG_INFO(pLogger, ErrorCode::kSuccess, "overflow block {}", Wrap(i));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        JsonGuard stats;
+        ASSERT_EQ(logger->GetStats(stats.get()), ErrorCode::kSuccess);
+        EXPECT_EQ(stats->GetUint64("drop_count"), 0u);
+        EXPECT_EQ(stats->GetUint64("enqueue_count"), 5000u);
+        EXPECT_EQ(stats->GetUint64("log_lines"), 5000u);
+        EXPECT_GT(stats->GetUint64("log_bytes"), 5000u * 50);
+        EXPECT_GT(stats->GetUint64("write_latency_avg_ns"), 0u);
+        EXPECT_GE(stats->GetUint64("write_latency_max_ns"), stats->GetUint64("write_latency_avg_ns"));
+        EXPECT_GT(stats->GetUint64("lines_per_sec"), 0u);
+        EXPECT_GT(stats->GetUint64("bytes_per_sec"), 0u);
+        ILogger::Destroy(logger.release());
+        EXPECT_EQ(countLines(), 5000u);
+    }
+}
+
+namespace module_net
+{
+constexpr const char *kModuleName = "net";
+
+void LogDebug(ILogger *pLogger, int32_t &iEvaluated)
+{
+    LOG_DEBUG(pLogger, ErrorCode::kSuccess, "net debug {}", Wrap(++iEvaluated));
+}
+
+// 低于编译期最低级别的日志宏被整体消除
+#undef CPPX_LOG_MIN_LEVEL
+#define CPPX_LOG_MIN_LEVEL 3
+void LogCompiledOut(ILogger *pLogger, int32_t &iEvaluated)
+{
+    LOG_DEBUG(pLogger, ErrorCode::kSuccess, "net removed {}", Wrap(++iEvaluated));
+    LOG_WARN(pLogger, ErrorCode::kSuccess, "net kept {}", Wrap(++iEvaluated));
+}
+#undef CPPX_LOG_MIN_LEVEL
+#define CPPX_LOG_MIN_LEVEL 0
+}
+
+namespace module_disk
+{
+constexpr const char *kModuleName = "disk";
+
+void LogInfo(ILogger *pLogger, int32_t &iEvaluated)
+{
+    LOG_INFO(pLogger, ErrorCode::kSuccess, "disk info {}", Wrap(++iEvaluated));
+}
+}
+
+// 模块级别代替日志级别过滤，被过滤的日志不会对参数求值
+TEST_F(CppxLoggerTest, TestLogModuleLevel)
+{
+    JsonGuard config = CreateDefaultConfig(false);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    EXPECT_EQ(logger->SetModuleLogLevel(nullptr, ILogger::LogLevel::kDebug), ErrorCode::kInvalidParam);
+    EXPECT_EQ(ILogger::GetModuleId(nullptr), 0u);
+    EXPECT_EQ(ILogger::GetModuleId("net"), ILogger::GetModuleId(std::string("net").c_str()));
+
+    int32_t iEvaluated = 0;
+    module_net::LogDebug(logger.get(), iEvaluated);
+    EXPECT_EQ(iEvaluated, 0);
+    ASSERT_EQ(logger->SetModuleLogLevel("net", ILogger::LogLevel::kDebug), ErrorCode::kSuccess);
+    ASSERT_EQ(logger->SetModuleLogLevel("disk", ILogger::LogLevel::kError), ErrorCode::kSuccess);
+    EXPECT_EQ(logger->GetCaptureLevel(ILogger::GetModuleId("net")), ILogger::LogLevel::kDebug);
+    EXPECT_EQ(logger->GetCaptureLevel(ILogger::GetModuleId("disk")), ILogger::LogLevel::kError);
+    EXPECT_EQ(logger->GetCaptureLevel(ILogger::GetModuleId("Typed")), ILogger::LogLevel::kInfo);
+    module_net::LogDebug(logger.get(), iEvaluated);
+    EXPECT_EQ(iEvaluated, 1);
+    module_disk::LogInfo(logger.get(), iEvaluated);
+    EXPECT_EQ(iEvaluated, 1);
+    module_net::LogCompiledOut(logger.get(), iEvaluated);
+    EXPECT_EQ(iEvaluated, 2);
+
+    // 日志级别变化后单独设置的模块不受影响，取消后跟随日志级别
+    logger->SetLogLevel(ILogger::LogLevel::kTrace);
+    EXPECT_EQ(logger->GetCaptureLevel(ILogger::GetModuleId("disk")), ILogger::LogLevel::kError);
+    logger->SetLogLevel(ILogger::LogLevel::kInfo);
+    logger->ResetModuleLogLevel("net");
+    module_net::LogDebug(logger.get(), iEvaluated);
+    EXPECT_EQ(iEvaluated, 2);
+    ILogger::Destroy(logger.release());
+
+    std::string strContent = ReadLogFile("test_logger.log");
+    EXPECT_NE(strContent.find("[net] net debug 1("), std::string::npos) << strContent;
+    EXPECT_NE(strContent.find("net kept 2("), std::string::npos);
+    EXPECT_EQ(strContent.find("net removed"), std::string::npos);
+    EXPECT_EQ(strContent.find("disk info"), std::string::npos);
+
+    // 输出目标级别更低时，日志传入日志对象后按模块级别决定是否写入文件
+    JsonGuard sinkConfig;
+    sinkConfig->SetString(config::kSinkName, "memory");
+    sinkConfig->SetUint32(config::kSinkType, (uint32_t)ILogSink::SinkType::kMemory);
+    sinkConfig->SetUint32(config::kSinkMemoryKB, 64);
+    ILogSink *pSink = ILogSink::Create(sinkConfig.get());
+    ASSERT_NE(pSink, nullptr);
+
+    config->SetString(config::kLoggerName, "module_logger");
+    LoggerGuard sinkLogger(ILogger::Create(config.get()));
+    ASSERT_NE(sinkLogger.get(), nullptr);
+    ASSERT_EQ(sinkLogger->AddSink(pSink, ILogger::LogLevel::kDebug), ErrorCode::kSuccess);
+    ASSERT_EQ(sinkLogger->SetModuleLogLevel("disk", ILogger::LogLevel::kError), ErrorCode::kSuccess);
+    iEvaluated = 0;
+    module_net::LogDebug(sinkLogger.get(), iEvaluated);
+    module_disk::LogInfo(sinkLogger.get(), iEvaluated);
+    ASSERT_EQ(sinkLogger->SetModuleLogLevel("net", ILogger::LogLevel::kDebug), ErrorCode::kSuccess);
+    module_net::LogDebug(sinkLogger.get(), iEvaluated);
+    EXPECT_EQ(iEvaluated, 3);
+
+    // 通过Log接口传入的临时模块名按内容匹配已注册的模块，未注册的模块不会被注册
+    auto uProbeId = ILogger::GetModuleId("module_probe_a");
+    std::string strDisk("disk");
+    std::string strTransient("module_transient");
+    sinkLogger->Log(0, ILogger::LogLevel::kInfo, strDisk.c_str(), "", "", "disk transient", nullptr, 0);
+    sinkLogger->Log(0, ILogger::LogLevel::kInfo, strTransient.c_str(), "", "", "transient info", nullptr, 0);
+    EXPECT_EQ(ILogger::GetModuleId("module_probe_b"), uProbeId + 1);
+    ILogger::Destroy(sinkLogger.release());
+
+    char szBuffer[4096];
+    std::string strSink(szBuffer, pSink->Read(szBuffer, sizeof(szBuffer)));
+    EXPECT_NE(strSink.find("net debug 1("), std::string::npos) << strSink;
+    EXPECT_NE(strSink.find("disk info 2("), std::string::npos);
+    EXPECT_NE(strSink.find("net debug 3("), std::string::npos);
+    strContent = ReadLogFile("module_logger.log");
+    EXPECT_EQ(strContent.find("net debug 1("), std::string::npos) << strContent;
+    EXPECT_EQ(strContent.find("disk info"), std::string::npos);
+    EXPECT_NE(strContent.find("net debug 3("), std::string::npos);
+    EXPECT_EQ(strContent.find("disk transient"), std::string::npos);
+    EXPECT_NE(strContent.find("transient info"), std::string::npos);
+    ILogSink::Destroy(pSink);
+}
+
+static_assert(CPPX_KV_COUNT("tick") == 0, "key-value pair count");
+static_assert(CPPX_KV_COUNT("conn_open", "conn_id", 1, "bytes", 2) == 2, "key-value pair count");
+
+// 结构化日志输出为logfmt或JSON lines，每个字段按键读取
+TEST_F(CppxLoggerTest, TestLogKv)
+{
+    std::string strPeer = "10.0.0.1:80";
+    JsonGuard config = CreateDefaultConfig(true);
+    LoggerGuard logger(ILogger::Create(config.get()));
+    ASSERT_NE(logger.get(), nullptr);
+    ASSERT_EQ(logger->Start(), ErrorCode::kSuccess);
+    ILogger *pLogger = logger.get();
+    LOG_KV(pLogger, ILogger::LogLevel::kInfo, "conn_open", "conn_id", 12u, "peer", strPeer,
+           "reason", "peer closed", "ratio", 0.5, "ok", true);
+    LOG_INFO_KV(pLogger, ErrorCode::kSuccess, "tick");
+    LOG_DEBUG_KV(pLogger, ErrorCode::kSuccess, "hidden", "conn_id", 1);
+    ILogger::Destroy(logger.release());
+
+    std::string strContent = ReadLogFile("test_logger.log");
+    EXPECT_EQ(std::count(strContent.begin(), strContent.end(), '\n'), 2) << strContent;
+    EXPECT_EQ(strContent.compare(0, 5, "time="), 0) << strContent;
+    EXPECT_NE(strContent.find(" level=INFO module=Typed event=conn_open conn_id=12 peer=10.0.0.1:80 "
+                              "reason=\"peer closed\" ratio=0.500000 ok=true pos="), std::string::npos) << strContent;
+    EXPECT_NE(strContent.find(" event=tick pos="), std::string::npos);
+    EXPECT_EQ(strContent.find("hidden"), std::string::npos);
+
+    config->SetString(config::kLoggerName, "kv_json");
+    config->SetUint32(config::kLogKvFormat, 1);
+    config->SetBool(config::kLogAsync, false);
+    LoggerGuard jsonLogger(ILogger::Create(config.get()));
+    ASSERT_NE(jsonLogger.get(), nullptr);
+    pLogger = jsonLogger.get();
+    LOG_WARN_KV(pLogger, ErrorCode::kInvalidParam, "conn_close", "conn_id", -3, "reason", "say \"bye\"\n",
+                "tag", 'x', "ok", false);
+    ILogger::Destroy(jsonLogger.release());
+
+    std::string strJson = ReadLogFile("kv_json.log");
+    ASSERT_FALSE(strJson.empty());
+    EXPECT_EQ(strJson.front(), '{');
+    EXPECT_EQ(std::count(strJson.begin(), strJson.end(), '\n'), 1) << strJson;
+    JsonGuard line;
+    ASSERT_EQ(line->Parse(strJson.c_str()), ErrorCode::kSuccess) << strJson;
+    EXPECT_STREQ(line->GetString("level"), "WARN");
+    EXPECT_STREQ(line->GetString("module"), "Typed");
+    EXPECT_STREQ(line->GetString("event"), "conn_close");
+    EXPECT_EQ(line->GetInt32("errno"), (int32_t)ErrorCode::kInvalidParam);
+    EXPECT_EQ(line->GetInt32("conn_id"), -3);
+    EXPECT_STREQ(line->GetString("reason"), "say \"bye\"\n");
+    EXPECT_STREQ(line->GetString("tag"), "x");
+    EXPECT_FALSE(line->GetBool("ok", true));
+}
@@ -0,0 +1,485 @@
+#include <gtest/gtest.h>
+#include <memory/allocator.h>
+#include <memory/allocator_ex.h>
+#include <memory/allocator_trace.h>
+#include <utilities/json.h>
+#include <utilities/error_code.h>
+#include <filesystem>
+#include <malloc.h>
+#include <fstream>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+using namespace cppx::base;
+using namespace cppx::base::memory;
+
+class CppxAllocatorTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_pConfig = IJson::Create();
+        ASSERT_NE(m_pConfig, nullptr);
+    }
+
+    void TearDown() override
+    {
+        if (m_pAllocator != nullptr)
+        {
+            IAllocator::Destroy(m_pAllocator);
+            m_pAllocator = nullptr;
+        }
+        IJson::Destroy(m_pConfig);
+        m_pConfig = nullptr;
+    }
+
+    IAllocator *CreateAllocator()
+    {
+        m_pAllocator = IAllocator::Create();
+        if (m_pAllocator != nullptr && m_pAllocator->Init(m_pConfig) != ErrorCode::kSuccess)
+        {
+            IAllocator::Destroy(m_pAllocator);
+            m_pAllocator = nullptr;
+        }
+        return m_pAllocator;
+    }
+
+    static std::string ReadFile(const std::string &strFilePath)
+    {
+        std::ifstream file(strFilePath);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+protected:
+    IJson *m_pConfig{nullptr};
+    IAllocator *m_pAllocator{nullptr};
+};
+
+// 测试默认配置下的分配和释放
+TEST_F(CppxAllocatorTest, TestMallocFree)
+{
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    auto pMem = pAllocator->Malloc(128);
+    ASSERT_NE(pMem, nullptr);
+    memset(pMem, 0x5A, 128);
+    pAllocator->Free(pMem);
+    pAllocator->Free(nullptr);
+
+    // 未开启采样时不能dump
+    EXPECT_EQ(pAllocator->DumpHeapProfile("./heap.prof"), ErrorCode::kInvalidCall);
+}
+
+// 测试对齐分配
+TEST_F(CppxAllocatorTest, TestMallocAligned)
+{
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    for (uint64_t uAlign : {16, 64, 256, 4096})
+    {
+        auto pMem = pAllocator->MallocAligned(100, uAlign);
+        ASSERT_NE(pMem, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(pMem) % uAlign, 0u);
+        memset(pMem, 0x5A, 100);
+        pAllocator->Free(pMem, 100);
+    }
+
+    // 非法的对齐大小
+    EXPECT_EQ(pAllocator->MallocAligned(100, 3), nullptr);
+}
+
+struct alignas(128) OverAlignedObject
+{
+    uint64_t uValue;
+};
+
+// 测试IAllocatorEx对超对齐类型使用对齐分配
+TEST_F(CppxAllocatorTest, TestNewOverAligned)
+{
+    auto pAllocatorEx = IAllocatorEx::GetInstance();
+    ASSERT_NE(pAllocatorEx, nullptr);
+
+    auto pObject = pAllocatorEx->New<OverAlignedObject>();
+    ASSERT_NE(pObject, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(pObject) % alignof(OverAlignedObject), 0u);
+    pAllocatorEx->Delete(pObject);
+}
+
+// 测试Realloc和TryExpand
+TEST_F(CppxAllocatorTest, TestReallocTryExpand)
+{
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    auto pMem = reinterpret_cast<uint8_t *>(pAllocator->Realloc(nullptr, 64));
+    ASSERT_NE(pMem, nullptr);
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        pMem[i] = uint8_t(i);
+    }
+
+    // 原地扩展不改变原来的内存
+    EXPECT_TRUE(pAllocator->TryExpand(pMem, 64));
+    EXPECT_FALSE(pAllocator->TryExpand(pMem, 1024 * 1024));
+    EXPECT_FALSE(pAllocator->TryExpand(nullptr, 64));
+
+    pMem = reinterpret_cast<uint8_t *>(pAllocator->Realloc(pMem, 1024 * 1024));
+    ASSERT_NE(pMem, nullptr);
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        EXPECT_EQ(pMem[i], uint8_t(i));
+    }
+    EXPECT_TRUE(pAllocator->TryExpand(pMem, 1024 * 1024));
+    pAllocator->Free(pMem, 1024 * 1024);
+}
+
+// 测试采样堆分析器
+TEST_F(CppxAllocatorTest, TestHeapProfiler)
+{
+    m_pConfig->SetUint64(config::kAllocatorSampleIntervalBytes, 1);
+    m_pConfig->SetUint32(config::kAllocatorSampleMaxCount, 1024);
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    std::vector<void *> vecMems;
+    for (int i = 0; i < 64; ++i)
+    {
+        vecMems.push_back(pAllocator->Malloc(256));
+        ASSERT_NE(vecMems.back(), nullptr);
+    }
+
+    IJson *pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    EXPECT_EQ(pAllocator->GetStats(pStats), ErrorCode::kSuccess);
+    auto pProfilerStats = pStats->GetObject("heap_profiler");
+    ASSERT_NE(pProfilerStats, nullptr);
+    EXPECT_GE(pProfilerStats->GetUint32("live_count"), 60u);
+
+    std::string strFilePath = "./test_heap.prof";
+    EXPECT_EQ(pAllocator->DumpHeapProfile(strFilePath.c_str()), ErrorCode::kSuccess);
+    auto strContent = ReadFile(strFilePath);
+    EXPECT_EQ(strContent.find("heap profile: "), 0u);
+    EXPECT_NE(strContent.find("@ heap_v2/1"), std::string::npos);
+    EXPECT_NE(strContent.find("1: 256 [1: 256] @ 0x"), std::string::npos);
+    EXPECT_NE(strContent.find("MAPPED_LIBRARIES:"), std::string::npos);
+    std::filesystem::remove(strFilePath);
+
+    for (auto pMem : vecMems)
+    {
+        pAllocator->Free(pMem);
+    }
+
+    EXPECT_EQ(pAllocator->GetStats(pStats), ErrorCode::kSuccess);
+    pProfilerStats = pStats->GetObject("heap_profiler");
+    ASSERT_NE(pProfilerStats, nullptr);
+    EXPECT_EQ(pProfilerStats->GetUint32("live_count"), 0u);
+    EXPECT_EQ(pProfilerStats->GetUint64("live_bytes"), 0u);
+    IJson::Destroy(pStats);
+}
+
+// 测试采样表满时丢弃采样
+TEST_F(CppxAllocatorTest, TestHeapProfilerDropped)
+{
+    m_pConfig->SetUint64(config::kAllocatorSampleIntervalBytes, 1);
+    m_pConfig->SetUint32(config::kAllocatorSampleMaxCount, 8);
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    std::vector<void *> vecMems;
+    for (int i = 0; i < 32; ++i)
+    {
+        vecMems.push_back(pAllocator->Malloc(64));
+    }
+
+    IJson *pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    pAllocator->GetStats(pStats);
+    auto pProfilerStats = pStats->GetObject("heap_profiler");
+    ASSERT_NE(pProfilerStats, nullptr);
+    EXPECT_LE(pProfilerStats->GetUint32("live_count"), 8u);
+    EXPECT_GT(pProfilerStats->GetUint64("dropped_count"), 0u);
+    IJson::Destroy(pStats);
+
+    for (auto pMem : vecMems)
+    {
+        pAllocator->Free(pMem);
+    }
+}
+
+// 测试反复分配释放后采样表仍然可用，删除留下的槽位不影响后续采样和移除
+TEST_F(CppxAllocatorTest, TestHeapProfilerChurn)
+{
+    m_pConfig->SetUint64(config::kAllocatorSampleIntervalBytes, 1);
+    m_pConfig->SetUint32(config::kAllocatorSampleMaxCount, 64);
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    std::vector<void *> vecMems(32, nullptr);
+    for (int i = 0; i < 200000; ++i)
+    {
+        auto &pMem = vecMems[i % vecMems.size()];
+        pAllocator->Free(pMem);
+        pMem = pAllocator->Malloc(64 + i % 128);
+        ASSERT_NE(pMem, nullptr);
+    }
+    for (auto pMem : vecMems)
+    {
+        pAllocator->Free(pMem);
+    }
+
+    IJson *pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    EXPECT_EQ(pAllocator->GetStats(pStats), ErrorCode::kSuccess);
+    auto pProfilerStats = pStats->GetObject("heap_profiler");
+    ASSERT_NE(pProfilerStats, nullptr);
+    EXPECT_EQ(pProfilerStats->GetUint32("live_count"), 0u);
+    EXPECT_EQ(pProfilerStats->GetUint64("live_bytes"), 0u);
+    EXPECT_GE(pProfilerStats->GetUint64("sampled_count"), 190000u);
+    IJson::Destroy(pStats);
+}
+
+// 测试realloc失败时保留采样，原地扩展时更新采样大小
+TEST_F(CppxAllocatorTest, TestHeapProfilerReallocAndExpand)
+{
+    m_pConfig->SetUint64(config::kAllocatorSampleIntervalBytes, 1);
+    m_pConfig->SetUint32(config::kAllocatorSampleMaxCount, 64);
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    auto pMem = pAllocator->Malloc(256);
+    ASSERT_NE(pMem, nullptr);
+
+    IJson *pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    auto getProfilerStat = [&](const char *pKey) {
+        pAllocator->GetStats(pStats);
+        auto pProfilerStats = pStats->GetObject("heap_profiler");
+        return pProfilerStats != nullptr ? pProfilerStats->GetUint64(pKey, UINT64_MAX) : UINT64_MAX;
+    };
+    EXPECT_EQ(getProfilerStat("live_count"), 1u);
+    EXPECT_EQ(getProfilerStat("live_bytes"), 256u);
+
+    volatile uint64_t uHugeSize = uint64_t(1) << 62;
+    EXPECT_EQ(pAllocator->Realloc(pMem, uHugeSize), nullptr);
+    EXPECT_EQ(getProfilerStat("live_count"), 1u);
+    EXPECT_EQ(getProfilerStat("live_bytes"), 256u);
+
+    auto uUsableSize = malloc_usable_size(pMem);
+    EXPECT_TRUE(pAllocator->TryExpand(pMem, uUsableSize));
+    EXPECT_EQ(getProfilerStat("live_count"), 1u);
+    EXPECT_EQ(getProfilerStat("live_bytes"), uUsableSize);
+
+    pAllocator->Free(pMem);
+    EXPECT_EQ(getProfilerStat("live_count"), 0u);
+    EXPECT_EQ(getProfilerStat("live_bytes"), 0u);
+    IJson::Destroy(pStats);
+}
+
+// 测试trace记录
+TEST_F(CppxAllocatorTest, TestTrace)
+{
+    std::string strFilePath = "./test_allocator.trace";
+    m_pConfig->SetString(config::kAllocatorTraceFile, strFilePath.c_str());
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    auto pMem1 = pAllocator->Malloc(100);
+    auto pMem2 = pAllocator->MallocAligned(200, 64);
+    pMem1 = pAllocator->Realloc(pMem1, 300);
+    pAllocator->Free(pMem1);
+    pAllocator->Free(pMem2, 200);
+    IAllocator::Destroy(pAllocator);
+    m_pAllocator = nullptr;
+
+    std::ifstream file(strFilePath, std::ios::binary);
+    ASSERT_TRUE(file.is_open());
+    AllocTraceHeader header;
+    ASSERT_TRUE(file.read(reinterpret_cast<char *>(&header), sizeof(header)));
+    EXPECT_EQ(header.uMagic, kAllocTraceMagic);
+    EXPECT_EQ(header.uVersion, kAllocTraceVersion);
+
+    std::vector<AllocTraceRecord> vecRecords;
+    AllocTraceRecord record;
+    while (file.read(reinterpret_cast<char *>(&record), sizeof(record)))
+    {
+        vecRecords.push_back(record);
+    }
+    ASSERT_EQ(vecRecords.size(), 5u);
+    EXPECT_EQ(vecRecords[0].uOp, kAllocTraceMalloc);
+    EXPECT_EQ(vecRecords[0].uSize, 100u);
+    EXPECT_EQ(vecRecords[1].uOp, kAllocTraceMallocAligned);
+    EXPECT_EQ(vecRecords[1].uArg, 64u);
+    EXPECT_EQ(vecRecords[2].uOp, kAllocTraceRealloc);
+    EXPECT_EQ(vecRecords[2].uArg, vecRecords[0].uAddr);
+    EXPECT_EQ(vecRecords[3].uOp, kAllocTraceFree);
+    EXPECT_EQ(vecRecords[3].uAddr, vecRecords[2].uAddr);
+    EXPECT_EQ(vecRecords[4].uOp, kAllocTraceFree);
+    EXPECT_EQ(vecRecords[4].uSize, 200u);
+    EXPECT_GE(vecRecords[4].uTimeNs, vecRecords[0].uTimeNs);
+    std::filesystem::remove(strFilePath);
+}
+
+// 测试伙伴系统的拆分、合并和碎片统计
+TEST_F(CppxAllocatorTest, TestBuddyAllocator)
+{
+    m_pConfig->SetUint64(config::kAllocatorBuddyRegionMB, 64);
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    // 小于阈值的分配不进入伙伴系统
+    auto pSmall = pAllocator->Malloc(100);
+    ASSERT_NE(pSmall, nullptr);
+
+    std::vector<void *> vecMems;
+    for (uint64_t uSize : {4096ul, 5000ul, 64ul * 1024, 1024ul * 1024})
+    {
+        auto pMem = pAllocator->Malloc(uSize);
+        ASSERT_NE(pMem, nullptr);
+        // 伙伴系统的块按自身大小对齐
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(pMem) % 4096, 0u);
+        memset(pMem, 0x5A, uSize);
+        vecMems.push_back(pMem);
+    }
+
+    IJson *pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    ASSERT_EQ(pAllocator->GetStats(pStats), ErrorCode::kSuccess);
+    auto pBuddyStats = pStats->GetObject("buddy");
+    ASSERT_NE(pBuddyStats, nullptr);
+    EXPECT_EQ(pBuddyStats->GetUint64("region_bytes"), 64ul * 1024 * 1024);
+    EXPECT_EQ(pBuddyStats->GetUint64("used_bytes"), 4096ul + 8192 + 64 * 1024 + 1024 * 1024);
+    EXPECT_EQ(pBuddyStats->GetUint64("malloc_count"), 4u);
+    EXPECT_GT(pBuddyStats->GetDouble("fragmentation"), 0.0);
+
+    for (auto pMem : vecMems)
+    {
+        pAllocator->Free(pMem);
+    }
+    pAllocator->Free(pSmall, 100);
+
+    // 全部释放后合并回一个64MB的块
+    ASSERT_EQ(pAllocator->GetStats(pStats), ErrorCode::kSuccess);
+    pBuddyStats = pStats->GetObject("buddy");
+    ASSERT_NE(pBuddyStats, nullptr);
+    EXPECT_EQ(pBuddyStats->GetUint64("used_bytes"), 0u);
+    EXPECT_EQ(pBuddyStats->GetUint64("largest_free_bytes"), 64ul * 1024 * 1024);
+    EXPECT_EQ(pBuddyStats->GetDouble("fragmentation"), 0.0);
+    auto pFreeBlocks = pBuddyStats->GetArray("free_blocks");
+    ASSERT_NE(pFreeBlocks, nullptr);
+    ASSERT_EQ(pFreeBlocks->GetSize(), 15u);
+    EXPECT_EQ(pFreeBlocks->GetUint64(14u), 1u);
+    EXPECT_EQ(pFreeBlocks->GetUint64(0u), 0u);
+    IJson::Destroy(pStats);
+}
+
+// 测试伙伴系统的原地扩展、Realloc和满时回退到malloc
+TEST_F(CppxAllocatorTest, TestBuddyReallocFallback)
+{
+    m_pConfig->SetUint64(config::kAllocatorBuddyRegionMB, 1);
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    auto pMem = reinterpret_cast<uint8_t *>(pAllocator->Malloc(4096));
+    ASSERT_NE(pMem, nullptr);
+    for (uint32_t i = 0; i < 4096; ++i)
+    {
+        pMem[i] = uint8_t(i);
+    }
+
+    // 右侧伙伴空闲，原地合并
+    EXPECT_TRUE(pAllocator->TryExpand(pMem, 16 * 1024));
+    EXPECT_EQ(pAllocator->Realloc(pMem, 64 * 1024), pMem);
+    EXPECT_FALSE(pAllocator->TryExpand(pMem, 2 * 1024 * 1024));
+
+    // 超过区域大小，回退到malloc并拷贝数据
+    auto pNewMem = reinterpret_cast<uint8_t *>(pAllocator->Realloc(pMem, 2 * 1024 * 1024));
+    ASSERT_NE(pNewMem, nullptr);
+    for (uint32_t i = 0; i < 4096; ++i)
+    {
+        EXPECT_EQ(pNewMem[i], uint8_t(i));
+    }
+
+    auto pAligned = pAllocator->MallocAligned(4096, 64 * 1024);
+    ASSERT_NE(pAligned, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(pAligned) % (64 * 1024), 0u);
+
+    IJson *pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    ASSERT_EQ(pAllocator->GetStats(pStats), ErrorCode::kSuccess);
+    auto pBuddyStats = pStats->GetObject("buddy");
+    ASSERT_NE(pBuddyStats, nullptr);
+    EXPECT_EQ(pBuddyStats->GetUint64("expand_count"), 2u);
+    EXPECT_EQ(pBuddyStats->GetUint64("fallback_count"), 1u);
+    EXPECT_EQ(pBuddyStats->GetUint64("used_bytes"), 64u * 1024);
+
+    pAllocator->Free(pNewMem, 2 * 1024 * 1024);
+    pAllocator->Free(pAligned, 4096);
+    ASSERT_EQ(pAllocator->GetStats(pStats), ErrorCode::kSuccess);
+    EXPECT_EQ(pStats->GetObject("buddy")->GetUint64("used_bytes"), 0u);
+    IJson::Destroy(pStats);
+}
+
+// 测试其他线程正在分配时再调用Init开启采样和伙伴系统，并发的Init只有一个生效
+TEST_F(CppxAllocatorTest, TestInitWhileAllocating)
+{
+    auto pAllocator = CreateAllocator();
+    ASSERT_NE(pAllocator, nullptr);
+
+    std::atomic<bool> bStop{false};
+    std::vector<std::thread> vecThreads;
+    for (int i = 0; i < 4; ++i)
+    {
+        vecThreads.emplace_back([&]() {
+            while (!bStop.load(std::memory_order_relaxed))
+            {
+                auto pMem = pAllocator->Malloc(8192);
+                ASSERT_NE(pMem, nullptr);
+                memset(pMem, 0x5A, 8192);
+                pAllocator->Free(pMem, 8192);
+            }
+        });
+    }
+
+    m_pConfig->SetUint64(config::kAllocatorSampleIntervalBytes, 1);
+    m_pConfig->SetUint64(config::kAllocatorBuddyRegionMB, 1);
+    std::atomic<int> iSuccessCount{0};
+    std::vector<std::thread> vecInitThreads;
+    for (int i = 0; i < 2; ++i)
+    {
+        vecInitThreads.emplace_back([&]() {
+            if (pAllocator->Init(m_pConfig) == ErrorCode::kSuccess)
+            {
+                iSuccessCount.fetch_add(1);
+            }
+        });
+    }
+    for (auto &thread : vecInitThreads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(iSuccessCount.load(), 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    bStop.store(true);
+    for (auto &thread : vecThreads)
+    {
+        thread.join();
+    }
+
+    // 所有分配都已释放，采样表和伙伴系统都应为空
+    IJson *pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    ASSERT_EQ(pAllocator->GetStats(pStats), ErrorCode::kSuccess);
+    auto pProfilerStats = pStats->GetObject("heap_profiler");
+    ASSERT_NE(pProfilerStats, nullptr);
+    EXPECT_EQ(pProfilerStats->GetUint32("live_count"), 0u);
+    auto pBuddyStats = pStats->GetObject("buddy");
+    ASSERT_NE(pBuddyStats, nullptr);
+    EXPECT_EQ(pBuddyStats->GetUint64("used_bytes"), 0u);
+    IJson::Destroy(pStats);
+}
@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include <memory/epoch_reclaimer.h>
+#include <memory/allocator.h>
+#include <thread/thread_manager.h>
+#include <utilities/error_code.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace cppx::base;
+using namespace cppx::base::memory;
+
+class CppxEpochReclaimerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        s_uFreeCount = 0;
+        m_pReclaimer = IEpochReclaimer::Create();
+        ASSERT_NE(m_pReclaimer, nullptr);
+        ASSERT_EQ(m_pReclaimer->Init(nullptr), ErrorCode::kSuccess);
+    }
+
+    void TearDown() override
+    {
+        IEpochReclaimer::Destroy(m_pReclaimer);
+        m_pReclaimer = nullptr;
+    }
+
+    static void CountFree(void *pMem, void *pUserParam)
+    {
+        UNSED(pUserParam);
+        IAllocator::GetInstance()->Free(pMem);
+        s_uFreeCount.fetch_add(1);
+    }
+
+    void FlushTimes(uint32_t uTimes)
+    {
+        for (uint32_t i = 0; i < uTimes; ++i)
+        {
+            m_pReclaimer->Flush();
+        }
+    }
+
+    uint64_t GetStat(const char *pKey)
+    {
+        IJson *pStats = IJson::Create();
+        m_pReclaimer->GetStats(pStats);
+        auto uValue = pStats->GetUint64(pKey);
+        IJson::Destroy(pStats);
+        return uValue;
+    }
+
+protected:
+    IEpochReclaimer *m_pReclaimer{nullptr};
+    static std::atomic<uint64_t> s_uFreeCount;
+};
+
+std::atomic<uint64_t> CppxEpochReclaimerTest::s_uFreeCount{0};
+
+// 测试没有读线程时经过两次epoch推进后释放
+TEST_F(CppxEpochReclaimerTest, TestRetireAndFlush)
+{
+    EXPECT_EQ(m_pReclaimer->Retire(nullptr, nullptr, nullptr), ErrorCode::kInvalidParam);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        ASSERT_EQ(m_pReclaimer->Retire(IAllocator::GetInstance()->Malloc(32), &CountFree, nullptr), ErrorCode::kSuccess);
+    }
+    EXPECT_EQ(s_uFreeCount.load(), 0u);
+    EXPECT_EQ(GetStat("pending_count"), 10u);
+
+    FlushTimes(3);
+    EXPECT_EQ(s_uFreeCount.load(), 10u);
+    EXPECT_EQ(GetStat("pending_count"), 0u);
+    EXPECT_GE(GetStat("global_epoch"), 2u);
+}
+
+// 测试处于临界区内的读线程阻止回收
+TEST_F(CppxEpochReclaimerTest, TestReaderBlocksReclaim)
+{
+    std::atomic<bool> bEntered{false};
+    std::atomic<bool> bLeave{false};
+    std::thread reader([&]() {
+        EpochGuard guard(m_pReclaimer);
+        bEntered = true;
+        while (!bLeave)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    while (!bEntered)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_EQ(m_pReclaimer->Retire(IAllocator::GetInstance()->Malloc(32), &CountFree, nullptr), ErrorCode::kSuccess);
+    FlushTimes(10);
+    EXPECT_EQ(s_uFreeCount.load(), 0u);
+
+    bLeave = true;
+    reader.join();
+
+    FlushTimes(3);
+    EXPECT_EQ(s_uFreeCount.load(), 1u);
+}
+
+// 测试嵌套进入临界区
+TEST_F(CppxEpochReclaimerTest, TestNestedEnter)
+{
+    ASSERT_EQ(m_pReclaimer->Enter(), ErrorCode::kSuccess);
+    ASSERT_EQ(m_pReclaimer->Enter(), ErrorCode::kSuccess);
+    m_pReclaimer->Leave();
+
+    // 本线程仍在临界区内，最多推进一次epoch
+    ASSERT_EQ(m_pReclaimer->Retire(IAllocator::GetInstance()->Malloc(32), &CountFree, nullptr), ErrorCode::kSuccess);
+    FlushTimes(5);
+    EXPECT_EQ(s_uFreeCount.load(), 0u);
+
+    m_pReclaimer->Leave();
+    FlushTimes(3);
+    EXPECT_EQ(s_uFreeCount.load(), 1u);
+}
+
+// 测试线程管理器创建的线程退出时遗留的节点由其他线程回收
+TEST_F(CppxEpochReclaimerTest, TestThreadExitHandover)
+{
+    static std::atomic<bool> s_bRetired{false};
+    s_bRetired = false;
+
+    auto pThreadManager = IThreadManager::GetInstance();
+    auto threadFunc = [](void *pParam) -> bool {
+        auto pReclaimer = reinterpret_cast<IEpochReclaimer *>(pParam);
+        for (int i = 0; i < 5; ++i)
+        {
+            pReclaimer->Retire(IAllocator::GetInstance()->Malloc(32), &CppxEpochReclaimerTest::CountFree, nullptr);
+        }
+        s_bRetired = true;
+        return false;
+    };
+    auto pThread = pThreadManager->CreateThread();
+    ASSERT_NE(pThread, nullptr);
+    ASSERT_EQ(pThread->Bind("epoch_test", threadFunc, m_pReclaimer), ErrorCode::kSuccess);
+    ASSERT_EQ(pThread->Start(), ErrorCode::kSuccess);
+    while (!s_bRetired)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pThreadManager->DestroyThread(pThread);
+
+    EXPECT_EQ(GetStat("orphan_count"), 5u);
+    FlushTimes(3);
+    EXPECT_EQ(s_uFreeCount.load(), 5u);
+    EXPECT_EQ(GetStat("orphan_count"), 0u);
+}
+
+// 测试std::thread创建的线程退出时遗留的节点同样转交给回收器
+TEST_F(CppxEpochReclaimerTest, TestStdThreadExitHandover)
+{
+    std::thread thread([this]() {
+        for (int i = 0; i < 5; ++i)
+        {
+            m_pReclaimer->Retire(IAllocator::GetInstance()->Malloc(32), &CountFree, nullptr);
+        }
+    });
+    thread.join();
+
+    EXPECT_EQ(GetStat("orphan_count"), 5u);
+    FlushTimes(3);
+    EXPECT_EQ(s_uFreeCount.load(), 5u);
+    EXPECT_EQ(GetStat("orphan_count"), 0u);
+}
+
+// 测试线程退出后线程记录被新线程复用，记录数不随线程数增长
+TEST_F(CppxEpochReclaimerTest, TestThreadRecordReuse)
+{
+    for (int i = 0; i < 32; ++i)
+    {
+        std::thread thread([this]() {
+            EpochGuard guard(m_pReclaimer);
+            m_pReclaimer->Retire(IAllocator::GetInstance()->Malloc(16), &CountFree, nullptr);
+        });
+        thread.join();
+    }
+
+    EXPECT_EQ(GetStat("thread_record_count"), 1u);
+    FlushTimes(3);
+    EXPECT_EQ(s_uFreeCount.load(), 32u);
+}
+
+// 测试多线程并发Retire，销毁时释放所有待回收节点
+TEST_F(CppxEpochReclaimerTest, TestConcurrentRetire)
+{
+    constexpr int kThreadCount = 4;
+    constexpr int kRetireCount = 10000;
+    std::vector<std::thread> vecThreads;
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        vecThreads.emplace_back([this]() {
+            for (int j = 0; j < kRetireCount; ++j)
+            {
+                EpochGuard guard(m_pReclaimer);
+                m_pReclaimer->Retire(IAllocator::GetInstance()->Malloc(16), &CountFree, nullptr);
+            }
+        });
+    }
+    for (auto &thread : vecThreads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(GetStat("retired_count"), uint64_t(kThreadCount * kRetireCount));
+    EXPECT_GT(s_uFreeCount.load(), 0u);
+
+    // 退出线程遗留的节点已经转交，不需要等到销毁
+    FlushTimes(3);
+    EXPECT_EQ(s_uFreeCount.load(), uint64_t(kThreadCount * kRetireCount));
+    EXPECT_EQ(GetStat("orphan_count"), 0u);
+
+    IEpochReclaimer::Destroy(m_pReclaimer);
+    m_pReclaimer = nullptr;
+    EXPECT_EQ(s_uFreeCount.load(), uint64_t(kThreadCount * kRetireCount));
+}
@@ -2,6 +2,7 @@
 #include <thread>
 #include <thread/task_scheduler.h>
 #include <utilities/common.h>
+#include <utilities/json.h>
 #include <chrono>
 #include <atomic>
 #include <string>
@@ -84,6 +85,74 @@ protected:
         }
     }
 
+    // 记录执行顺序和是否提前执行的任务
+    struct OrderedTask
+    {
+        TaskSchedulerTest *pTest;
+        const char *pName;
+        uint64_t uExpireNs;
+        std::atomic<bool> bEarly {false};
+        std::atomic<uint64_t> uLateNs {0};
+    };
+
+    static void OrderedTaskFunc(void* pCtx)
+    {
+        OrderedTask* pTask = static_cast<OrderedTask*>(pCtx);
+        uint64_t uNowNs = 0;
+        clock_get_time_nano(uNowNs);
+        if (uNowNs < pTask->uExpireNs)
+        {
+            pTask->bEarly = true;
+        }
+        else
+        {
+            pTask->uLateNs = uNowNs - pTask->uExpireNs;
+        }
+        pTask->pTest->taskExecutionCount++;
+        std::lock_guard<std::mutex> lock(pTask->pTest->taskExecutionMutex);
+        pTask->pTest->taskExecutionOrder.push_back(pTask->pName);
+    }
+
+    // 创建使用分层时间轮的调度器
+    static ITaskScheduler* CreateWheelScheduler(uint32_t uTickUs)
+    {
+        return CreateScheduler(ITaskScheduler::TimerType::kWheel, uTickUs);
+    }
+
+    static ITaskScheduler* CreateScheduler(ITaskScheduler::TimerType eTimer, uint32_t uTickUs = 100,
+                                           ITaskScheduler::SleepType eSleep = ITaskScheduler::SleepType::kCond,
+                                           uint32_t uSpinUs = 0)
+    {
+        IJson* pConfig = IJson::Create();
+        if (pConfig == nullptr)
+        {
+            return nullptr;
+        }
+        pConfig->SetUint32(config::kTaskSchedulerTimer, (uint32_t)eTimer);
+        pConfig->SetUint32(config::kTaskSchedulerTickUs, uTickUs);
+        pConfig->SetUint32(config::kTaskSchedulerSleep, (uint32_t)eSleep);
+        pConfig->SetUint32(config::kTaskSchedulerSpinUs, uSpinUs);
+        ITaskScheduler* pScheduler = ITaskScheduler::Create("WheelScheduler", pConfig);
+        IJson::Destroy(pConfig);
+        return pScheduler;
+    }
+
+    static uint64_t GetStatsValue(ITaskScheduler* pScheduler, const char* pKey)
+    {
+        IJson* pStats = IJson::Create();
+        if (pStats == nullptr)
+        {
+            return UINT64_MAX;
+        }
+        uint64_t uValue = UINT64_MAX;
+        if (pScheduler->GetStats(pStats) == 0)
+        {
+            uValue = pStats->GetUint64(pKey, UINT64_MAX);
+        }
+        IJson::Destroy(pStats);
+        return uValue;
+    }
+
     std::atomic<int> taskExecutionCount{0};
     std::vector<std::string> taskExecutionOrder;
     std::mutex taskExecutionMutex;
@@ -554,4 +623,500 @@ TEST_F(TaskSchedulerTest, TestPerformance)
     
     pScheduler->Stop();
     ITaskScheduler::Destroy(pScheduler);
-}
\ No newline at end of file
+}
+
+// ==================== 测试分层时间轮 ====================
+
+// 测试按配置创建调度器
+TEST_F(TaskSchedulerTest, TestCreateWithConfig)
+{
+    EXPECT_EQ(ITaskScheduler::Create("ConfigScheduler", (IJson*)nullptr), nullptr);
+
+    IJson* pConfig = IJson::Create();
+    ASSERT_NE(pConfig, nullptr);
+    pConfig->SetUint32(config::kTaskSchedulerTimer, 100);
+    EXPECT_EQ(ITaskScheduler::Create("ConfigScheduler", pConfig), nullptr);
+
+    pConfig->SetUint32(config::kTaskSchedulerTimer, (uint32_t)ITaskScheduler::TimerType::kWheel);
+    pConfig->SetUint32(config::kTaskSchedulerTickUs, 1000);
+    ITaskScheduler* pScheduler = ITaskScheduler::Create("ConfigScheduler", pConfig);
+    IJson::Destroy(pConfig);
+    ASSERT_NE(pScheduler, nullptr);
+
+    IJson* pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    EXPECT_EQ(pScheduler->GetStats(pStats), 0);
+    EXPECT_STREQ(pStats->GetString("timer", ""), "wheel");
+    EXPECT_EQ(pStats->GetUint64("tick_us"), 1000u);
+    IJson::Destroy(pStats);
+    ITaskScheduler::Destroy(pScheduler);
+}
+
+// 测试时间轮按到期时间顺序执行，跨越多层的任务在级联后不会提前执行
+TEST_F(TaskSchedulerTest, TestWheelExecutionOrder)
+{
+    ITaskScheduler* pScheduler = CreateWheelScheduler(100);
+    ASSERT_NE(pScheduler, nullptr);
+    ASSERT_EQ(pScheduler->Start(), 0);
+
+    // 100us刻度下第0层覆盖25.6ms，60ms的任务需要从第1层级联
+    const uint32_t aDelayUs[] = {60000, 0, 30000, 2000, 10000};
+    const char* aNames[] = {"60ms", "0ms", "30ms", "2ms", "10ms"};
+    OrderedTask aTasks[5];
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        aTasks[i].pTest = this;
+        aTasks[i].pName = aNames[i];
+        clock_get_time_nano(aTasks[i].uExpireNs);
+        aTasks[i].uExpireNs += aDelayUs[i] * kMicro;
+        EXPECT_NE(pScheduler->PostOnceTask(aNames[i], OrderedTaskFunc, &aTasks[i], aDelayUs[i]), ITaskScheduler::kInvalidTaskID);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    pScheduler->Stop();
+
+    ASSERT_EQ(taskExecutionCount.load(), 5);
+    std::vector<std::string> expectOrder = {"0ms", "2ms", "10ms", "30ms", "60ms"};
+    EXPECT_EQ(taskExecutionOrder, expectOrder);
+    for (auto &task : aTasks)
+    {
+        EXPECT_FALSE(task.bEarly.load()) << task.pName;
+    }
+    EXPECT_EQ(GetStatsValue(pScheduler, "task_count"), 0u);
+    EXPECT_GT(GetStatsValue(pScheduler, "cascade_count"), 0u);
+    ITaskScheduler::Destroy(pScheduler);
+}
+
+// 测试时间轮上的周期任务和取消
+TEST_F(TaskSchedulerTest, TestWheelPeriodicTask)
+{
+    ITaskScheduler* pScheduler = CreateWheelScheduler(100);
+    ASSERT_NE(pScheduler, nullptr);
+    ASSERT_EQ(pScheduler->Start(), 0);
+
+    int64_t taskID = pScheduler->PostPeriodicTask("WheelPeriodic", PeriodicTaskFunc, this, 0, 10000);
+    ASSERT_NE(taskID, ITaskScheduler::kInvalidTaskID);
+    std::this_thread::sleep_for(std::chrono::milliseconds(105));
+    EXPECT_GE(taskExecutionCount.load(), 5);
+    EXPECT_LE(taskExecutionCount.load(), 11);
+
+    EXPECT_EQ(pScheduler->CancleTask(taskID), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int count = taskExecutionCount.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(taskExecutionCount.load(), count);
+    EXPECT_NE(pScheduler->CancleTask(taskID), 0);
+
+    pScheduler->Stop();
+    ITaskScheduler::Destroy(pScheduler);
+}
+
+// 测试大量超时任务，大部分在到期前取消
+TEST_F(TaskSchedulerTest, TestWheelManyTimeouts)
+{
+    ITaskScheduler* pScheduler = CreateWheelScheduler(1000);
+    ASSERT_NE(pScheduler, nullptr);
+    ASSERT_EQ(pScheduler->Start(), 0);
+
+    const int numTasks = 100000;
+    std::atomic<int> counter(0);
+    std::vector<int64_t> vecTaskIDs;
+    vecTaskIDs.reserve(numTasks);
+    for (int i = 0; i < numTasks; ++i)
+    {
+        // 1s~1.2s之间的超时，留出投递和取消的时间
+        uint32_t uDelayUs = 1000000 + uint32_t(i % 1000) * 200;
+        int64_t taskID = pScheduler->PostOnceTask("Timeout", CounterTaskFunc, &counter, uDelayUs);
+        ASSERT_NE(taskID, ITaskScheduler::kInvalidTaskID);
+        vecTaskIDs.push_back(taskID);
+    }
+    EXPECT_EQ(GetStatsValue(pScheduler, "task_count"), uint64_t(numTasks));
+
+    // 取消90%
+    for (int i = 0; i < numTasks; ++i)
+    {
+        if (i % 10 != 0)
+        {
+            EXPECT_EQ(pScheduler->CancleTask(vecTaskIDs[i]), 0);
+        }
+    }
+
+    for (int i = 0; i < 300 && counter.load() < numTasks / 10; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(counter.load(), numTasks / 10);
+    EXPECT_EQ(GetStatsValue(pScheduler, "task_count"), 0u);
+    EXPECT_EQ(GetStatsValue(pScheduler, "cancel_count"), uint64_t(numTasks - numTasks / 10));
+
+    pScheduler->Stop();
+    ITaskScheduler::Destroy(pScheduler);
+}
+
+// ==================== 测试TaskID和重新调度 ====================
+
+const ITaskScheduler::TimerType kAllTimers[] = {ITaskScheduler::TimerType::kMap, ITaskScheduler::TimerType::kWheel};
+
+// 测试任务结束后TaskID失效，复用节点的新任务不受旧TaskID影响
+TEST_F(TaskSchedulerTest, TestStaleTaskID)
+{
+    for (auto eTimer : kAllTimers)
+    {
+        taskExecutionCount = 0;
+        ITaskScheduler* pScheduler = CreateScheduler(eTimer);
+        ASSERT_NE(pScheduler, nullptr);
+        ASSERT_EQ(pScheduler->Start(), 0);
+
+        int64_t oldID = pScheduler->PostOnceTask("Once", TestTaskFunc, this, 0);
+        ASSERT_NE(oldID, ITaskScheduler::kInvalidTaskID);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        EXPECT_EQ(taskExecutionCount.load(), 1);
+        EXPECT_NE(pScheduler->CancleTask(oldID), 0);
+        EXPECT_NE(pScheduler->RescheduleTask(oldID, 0), 0);
+
+        // 新任务复用同一个节点，代数不同
+        int64_t newID = pScheduler->PostOnceTask("Once", TestTaskFunc, this, 20000);
+        ASSERT_NE(newID, ITaskScheduler::kInvalidTaskID);
+        EXPECT_NE(newID, oldID);
+        EXPECT_EQ(newID & 0xFFFFFFFF, oldID & 0xFFFFFFFF);
+        EXPECT_NE(pScheduler->CancleTask(oldID), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+        EXPECT_EQ(taskExecutionCount.load(), 2);
+
+        // 重复取消返回成功，回收后返回失败
+        int64_t cancelID = pScheduler->PostOnceTask("Cancel", TestTaskFunc, this, 1000000);
+        EXPECT_EQ(pScheduler->CancleTask(cancelID), 0);
+        EXPECT_EQ(pScheduler->CancleTask(cancelID), 0);
+        EXPECT_NE(pScheduler->RescheduleTask(cancelID, 0), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_NE(pScheduler->CancleTask(cancelID), 0);
+        EXPECT_EQ(GetStatsValue(pScheduler, "task_count"), 0u);
+
+        pScheduler->Stop();
+        ITaskScheduler::Destroy(pScheduler);
+    }
+}
+
+// 测试刷新超时：推迟的任务在最后一次刷新后才执行，提前的任务立即执行
+TEST_F(TaskSchedulerTest, TestRescheduleTask)
+{
+    for (auto eTimer : kAllTimers)
+    {
+        taskExecutionCount = 0;
+        ITaskScheduler* pScheduler = CreateScheduler(eTimer);
+        ASSERT_NE(pScheduler, nullptr);
+        ASSERT_EQ(pScheduler->Start(), 0);
+
+        int64_t timeoutID = pScheduler->PostOnceTask("Timeout", TestTaskFunc, this, 50000);
+        ASSERT_NE(timeoutID, ITaskScheduler::kInvalidTaskID);
+        for (int i = 0; i < 6; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            EXPECT_EQ(pScheduler->RescheduleTask(timeoutID, 50000), 0);
+        }
+        EXPECT_EQ(taskExecutionCount.load(), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        EXPECT_EQ(taskExecutionCount.load(), 1);
+        EXPECT_NE(pScheduler->RescheduleTask(timeoutID, 50000), 0);
+
+        int64_t laterID = pScheduler->PostOnceTask("Later", TestTaskFunc, this, 5000000);
+        ASSERT_NE(laterID, ITaskScheduler::kInvalidTaskID);
+        EXPECT_EQ(pScheduler->RescheduleTask(laterID, 0), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        EXPECT_EQ(taskExecutionCount.load(), 2);
+        EXPECT_EQ(GetStatsValue(pScheduler, "reschedule_count"), 7u);
+
+        pScheduler->Stop();
+        ITaskScheduler::Destroy(pScheduler);
+    }
+}
+
+// 测试一次性任务在最后一次执行期间被重新调度时，按新的时间再执行一次
+TEST_F(TaskSchedulerTest, TestRescheduleDuringLastRun)
+{
+    struct BlockingTask
+    {
+        std::atomic<int> iRunCount {0};
+        std::atomic<bool> bRelease {false};
+    };
+    auto blockingFunc = [](void *pCtx) {
+        auto pTask = static_cast<BlockingTask *>(pCtx);
+        if (pTask->iRunCount.fetch_add(1) == 0)
+        {
+            while (!pTask->bRelease)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    };
+
+    for (auto eTimer : kAllTimers)
+    {
+        ITaskScheduler* pScheduler = CreateScheduler(eTimer);
+        ASSERT_NE(pScheduler, nullptr);
+        ASSERT_EQ(pScheduler->Start(), 0);
+
+        BlockingTask task;
+        int64_t taskID = pScheduler->PostOnceTask("Blocking", blockingFunc, &task, 0);
+        ASSERT_NE(taskID, ITaskScheduler::kInvalidTaskID);
+        while (task.iRunCount.load() == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        EXPECT_EQ(pScheduler->RescheduleTask(taskID, 20000), 0);
+        task.bRelease = true;
+
+        for (int i = 0; i < 100 && task.iRunCount.load() < 2; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        EXPECT_EQ(task.iRunCount.load(), 2);
+
+        // 再次执行结束后任务结束，节点被回收
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_NE(pScheduler->RescheduleTask(taskID, 20000), 0);
+        EXPECT_EQ(GetStatsValue(pScheduler, "task_count"), 0u);
+        EXPECT_EQ(task.iRunCount.load(), 2);
+
+        pScheduler->Stop();
+        ITaskScheduler::Destroy(pScheduler);
+    }
+}
+
+// 测试多个线程同时取消同一批任务
+TEST_F(TaskSchedulerTest, TestConcurrentCancel)
+{
+    for (auto eTimer : kAllTimers)
+    {
+        ITaskScheduler* pScheduler = CreateScheduler(eTimer);
+        ASSERT_NE(pScheduler, nullptr);
+        ASSERT_EQ(pScheduler->Start(), 0);
+
+        const int numTasks = 20000;
+        std::atomic<int> counter(0);
+        std::vector<int64_t> vecTaskIDs;
+        for (int i = 0; i < numTasks; ++i)
+        {
+            vecTaskIDs.push_back(pScheduler->PostOnceTask("Timeout", CounterTaskFunc, &counter, 300000));
+        }
+
+        // 每个线程取消下标为偶数的任务，相互重叠
+        std::vector<std::thread> threads;
+        std::atomic<int> failCount(0);
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < numTasks; i += 2)
+                {
+                    if (pScheduler->CancleTask(vecTaskIDs[i]) != 0)
+                    {
+                        failCount++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (int i = 0; i < 100 && counter.load() < numTasks / 2; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_EQ(counter.load(), numTasks / 2);
+        EXPECT_EQ(GetStatsValue(pScheduler, "task_count"), 0u);
+        // 取消标志只设置一次，回收前的重复取消返回成功，回收后的返回失败
+        EXPECT_EQ(GetStatsValue(pScheduler, "cancel_count"), uint64_t(numTasks / 2));
+        EXPECT_LE(failCount.load(), numTasks / 2 * 3);
+
+        pScheduler->Stop();
+        ITaskScheduler::Destroy(pScheduler);
+    }
+}
+
+// 测试提交任务时只在到期时间早于调度线程的休眠时间时唤醒
+TEST_F(TaskSchedulerTest, TestSubmitWakeup)
+{
+    // 空闲休眠间隔200ms，没有唤醒时新任务最多延迟200ms执行
+    ITaskScheduler* pScheduler = ITaskScheduler::Create("WakeupScheduler", 200000);
+    ASSERT_NE(pScheduler, nullptr);
+    ASSERT_EQ(pScheduler->Start(), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // 比休眠时间晚到期，不唤醒
+    EXPECT_NE(pScheduler->PostOnceTask("Later", TestTaskFunc, this, 1000000), ITaskScheduler::kInvalidTaskID);
+    EXPECT_EQ(GetStatsValue(pScheduler, "wakeup_count"), 0u);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto uStartNs = std::chrono::steady_clock::now();
+        EXPECT_NE(pScheduler->PostOnceTask("Now", TestTaskFunc, this, 0), ITaskScheduler::kInvalidTaskID);
+        while (taskExecutionCount.load() < i + 1
+               && std::chrono::steady_clock::now() - uStartNs < std::chrono::milliseconds(500))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        EXPECT_EQ(taskExecutionCount.load(), i + 1);
+        EXPECT_LT(std::chrono::steady_clock::now() - uStartNs, std::chrono::milliseconds(100));
+    }
+    EXPECT_GE(GetStatsValue(pScheduler, "wakeup_count"), 1u);
+
+    pScheduler->Stop();
+    ITaskScheduler::Destroy(pScheduler);
+}
+
+// 测试多个线程同时提交并立即取消，取消可能发生在调度线程取走新任务之前
+TEST_F(TaskSchedulerTest, TestConcurrentPostAndCancel)
+{
+    for (auto eTimer : kAllTimers)
+    {
+        ITaskScheduler* pScheduler = CreateScheduler(eTimer);
+        ASSERT_NE(pScheduler, nullptr);
+        ASSERT_EQ(pScheduler->Start(), 0);
+
+        const int numThreads = 4;
+        const int numTasksPerThread = 10000;
+        std::atomic<int> counter(0);
+        std::atomic<int> cancelCount(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < numTasksPerThread; ++i)
+                {
+                    int64_t taskID = pScheduler->PostOnceTask("Task", CounterTaskFunc, &counter, i % 1000);
+                    ASSERT_NE(taskID, ITaskScheduler::kInvalidTaskID);
+                    // 延迟很短的任务可能已经执行完，取消失败
+                    if (i % 2 == 0 && pScheduler->CancleTask(taskID) == 0)
+                    {
+                        cancelCount++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (int i = 0; i < 200 && GetStatsValue(pScheduler, "task_count") != 0; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        EXPECT_EQ(GetStatsValue(pScheduler, "task_count"), 0u);
+        EXPECT_EQ(GetStatsValue(pScheduler, "post_count"), uint64_t(numThreads * numTasksPerThread));
+        // 取消时正在执行的任务会执行完本次，取消成功的任务不一定没有执行
+        EXPECT_GE(counter.load() + cancelCount.load(), numThreads * numTasksPerThread);
+        EXPECT_EQ(GetStatsValue(pScheduler, "cancel_count"), uint64_t(cancelCount.load()));
+        EXPECT_EQ(uint64_t(counter.load()), GetStatsValue(pScheduler, "exec_count"));
+
+        pScheduler->Stop();
+        ITaskScheduler::Destroy(pScheduler);
+    }
+}
+
+// ==================== 测试timerfd休眠 ====================
+
+// 测试timerfd按到期时间唤醒，提交和提前重新调度时提前唤醒，空闲时可以及时停止
+TEST_F(TaskSchedulerTest, TestTimerfdSleep)
+{
+    for (auto eTimer : kAllTimers)
+    {
+        taskExecutionCount = 0;
+        ITaskScheduler* pScheduler = CreateScheduler(eTimer, 100, ITaskScheduler::SleepType::kTimerfd);
+        ASSERT_NE(pScheduler, nullptr);
+        ASSERT_EQ(pScheduler->Start(), 0);
+
+        const uint32_t aDelayUs[] = {20000, 2000, 10000, 5000};
+        OrderedTask aTasks[4];
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            aTasks[i].pTest = this;
+            aTasks[i].pName = "Timer";
+            clock_get_time_nano(aTasks[i].uExpireNs);
+            aTasks[i].uExpireNs += aDelayUs[i] * kMicro;
+            ASSERT_NE(pScheduler->PostOnceTask("Timer", OrderedTaskFunc, &aTasks[i], aDelayUs[i]),
+                      ITaskScheduler::kInvalidTaskID);
+        }
+        for (int i = 0; i < 200 && taskExecutionCount.load() < 4; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        EXPECT_EQ(taskExecutionCount.load(), 4);
+        for (auto& task : aTasks)
+        {
+            EXPECT_FALSE(task.bEarly);
+            EXPECT_LT(task.uLateNs.load(), 5 * kMill);
+        }
+
+        // 没有任务时调度线程一直休眠，提交立即执行的任务会唤醒
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_NE(pScheduler->PostOnceTask("Now", TestTaskFunc, this, 0), ITaskScheduler::kInvalidTaskID);
+        while (taskExecutionCount.load() < 5 && std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        EXPECT_EQ(taskExecutionCount.load(), 5);
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+        // 调度线程休眠到5s后，提前重新调度会唤醒
+        int64_t laterID = pScheduler->PostOnceTask("Later", TestTaskFunc, this, 5000000);
+        ASSERT_NE(laterID, ITaskScheduler::kInvalidTaskID);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        start = std::chrono::steady_clock::now();
+        EXPECT_EQ(pScheduler->RescheduleTask(laterID, 0), 0);
+        while (taskExecutionCount.load() < 6 && std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        EXPECT_EQ(taskExecutionCount.load(), 6);
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+        EXPECT_GE(GetStatsValue(pScheduler, "wakeup_count"), 2u);
+
+        start = std::chrono::steady_clock::now();
+        pScheduler->Stop();
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+        ITaskScheduler::Destroy(pScheduler);
+    }
+}
+
+// 测试到期前忙等，任务不会提前执行
+TEST_F(TaskSchedulerTest, TestTimerfdSpin)
+{
+    ITaskScheduler* pScheduler = CreateScheduler(ITaskScheduler::TimerType::kMap, 100,
+                                                 ITaskScheduler::SleepType::kTimerfd, 200);
+    ASSERT_NE(pScheduler, nullptr);
+    ASSERT_EQ(pScheduler->Start(), 0);
+
+    IJson* pStats = IJson::Create();
+    ASSERT_NE(pStats, nullptr);
+    ASSERT_EQ(pScheduler->GetStats(pStats), 0);
+    EXPECT_STREQ(pStats->GetString("sleep", ""), "timerfd");
+    EXPECT_EQ(pStats->GetUint64("spin_us", 0), 200u);
+    IJson::Destroy(pStats);
+
+    const int numTasks = 20;
+    OrderedTask aTasks[numTasks];
+    for (int i = 0; i < numTasks; ++i)
+    {
+        aTasks[i].pTest = this;
+        aTasks[i].pName = "Spin";
+        clock_get_time_nano(aTasks[i].uExpireNs);
+        aTasks[i].uExpireNs += 1000 * kMicro;
+        ASSERT_NE(pScheduler->PostOnceTask("Spin", OrderedTaskFunc, &aTasks[i], 1000), ITaskScheduler::kInvalidTaskID);
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(taskExecutionCount.load(), numTasks);
+    for (auto& task : aTasks)
+    {
+        EXPECT_FALSE(task.bEarly);
+    }
+
+    pScheduler->Stop();
+    ITaskScheduler::Destroy(pScheduler);
+}
@@ -0,0 +1,391 @@
+/*
+ * cppx_logcat: 将二进制日志(log_binary=true)还原为文本
+ *
+ * 用法: cppx_logcat [选项] <文件>...
+ *   -l <级别>    只输出不低于该级别的日志，TRACE/DEBUG/INFO/WARN/ERROR/FATAL/EVENT或0~6
+ *   -m <模块>    只输出该模块的日志，LogFormat日志没有模块，指定后不再输出
+ *   -t <线程号>  只输出该线程的日志
+ *   -s <时间>    只输出不早于该时间的日志，格式: YYYYMMDD-HH:MM:SS
+ *   -e <时间>    只输出早于该时间的日志，格式同上
+ */
+
+#include <logger/log_binary.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <strings.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace cppx::base::logger;
+
+namespace
+{
+
+constexpr uint64_t kSecond = 1000000000ULL;
+
+const char *kLevelNames[] = {"TRACE", "DEBUG", " INFO", " WARN", "ERROR", "FATAL", "EVENT"};
+constexpr uint32_t kLevelCount = sizeof(kLevelNames) / sizeof(kLevelNames[0]);
+
+struct Filter
+{
+    uint32_t uMinLevel {0};
+    bool bModule {false};
+    std::string strModule;
+    bool bTid {false};
+    uint32_t uTid {0};
+    int64_t iStartNs {INT64_MIN};
+    int64_t iEndNs {INT64_MAX};
+};
+
+struct FormatInfo
+{
+    std::string strModule;
+    std::string strFileLine;
+    std::string strFunction;
+    std::string strFormat;
+};
+
+struct Session
+{
+    uint32_t uPid {0};
+    int64_t iRealtimeOffsetNs {0};
+    std::unordered_map<uint32_t, FormatInfo> mapFormats;
+};
+
+const char *LevelToString(uint32_t uLevel)
+{
+    return uLevel < kLevelCount ? kLevelNames[uLevel] : " NULL";
+}
+
+bool ParseLevel(const char *pArg, uint32_t &uLevel)
+{
+    for (uint32_t i = 0; i < kLevelCount; ++i)
+    {
+        const char *pName = kLevelNames[i];
+        while (*pName == ' ')
+        {
+            ++pName;
+        }
+        if (strcasecmp(pArg, pName) == 0)
+        {
+            uLevel = i;
+            return true;
+        }
+    }
+
+    char *pEnd = nullptr;
+    auto uValue = strtoul(pArg, &pEnd, 10);
+    if (pEnd == pArg || *pEnd != '\0' || uValue >= kLevelCount)
+    {
+        return false;
+    }
+    uLevel = (uint32_t)uValue;
+    return true;
+}
+
+// 按本地时间解析YYYYMMDD-HH:MM:SS，返回系统时间(ns)
+bool ParseTime(const char *pArg, int64_t &iTimeNs)
+{
+    struct tm tmTime;
+    memset(&tmTime, 0, sizeof(tmTime));
+    if (sscanf(pArg, "%4d%2d%2d-%d:%d:%d", &tmTime.tm_year, &tmTime.tm_mon, &tmTime.tm_mday,
+               &tmTime.tm_hour, &tmTime.tm_min, &tmTime.tm_sec) != 6)
+    {
+        return false;
+    }
+    tmTime.tm_year -= 1900;
+    tmTime.tm_mon -= 1;
+    tmTime.tm_isdst = -1;
+    auto tTime = mktime(&tmTime);
+    if (tTime == (time_t)-1)
+    {
+        return false;
+    }
+    iTimeNs = (int64_t)tTime * (int64_t)kSecond;
+    return true;
+}
+
+// 与CLoggerImpl::WriteLog的文本格式保持一致
+void PrintLog(const Session &session, const FormatInfo &format, const binary::LogRecord &record,
+              const uint32_t *puParamLen, const char *pParams, int64_t iRealtimeNs, std::string &strLine)
+{
+    time_t tSecond = (time_t)(iRealtimeNs / (int64_t)kSecond);
+    struct tm tmTime;
+    localtime_r(&tSecond, &tmTime);
+
+    char szPrefix[128];
+    snprintf(szPrefix, sizeof(szPrefix), "%04d%02d%02d-%02d:%02d:%02d.%06d %u %u %d %s ",
+             tmTime.tm_year + 1900, tmTime.tm_mon + 1, tmTime.tm_mday,
+             tmTime.tm_hour, tmTime.tm_min, tmTime.tm_sec, (int)((iRealtimeNs % (int64_t)kSecond) / 1000),
+             session.uPid, record.uTid, record.iErrorNo, LevelToString(record.uLevel));
+
+    strLine.assign(szPrefix);
+    strLine.append("[").append(format.strModule).append("] ");
+
+    const char *pParam = pParams;
+    uint32_t uParamIndex = 0;
+    const auto &strFormat = format.strFormat;
+    for (size_t i = 0; i < strFormat.size(); ++i)
+    {
+        if (strFormat[i] == '{' && i + 1 < strFormat.size() && strFormat[i + 1] == '}'
+            && uParamIndex < record.uParamCount)
+        {
+            strLine.append(pParam, puParamLen[uParamIndex]);
+            pParam += puParamLen[uParamIndex];
+            ++uParamIndex;
+            ++i;
+        }
+        else
+        {
+            strLine.push_back(strFormat[i]);
+        }
+    }
+
+    for (; uParamIndex < record.uParamCount; ++uParamIndex)
+    {
+        strLine.push_back(' ');
+        strLine.append(pParam, puParamLen[uParamIndex]);
+        pParam += puParamLen[uParamIndex];
+    }
+
+    strLine.append("(").append(format.strFileLine).append(",").append(format.strFunction).append(")\n");
+    fwrite(strLine.data(), 1, strLine.size(), stdout);
+}
+
+bool MatchCommon(const Filter &filter, uint32_t uLevel, uint32_t uTid, int64_t iRealtimeNs)
+{
+    return uLevel >= filter.uMinLevel
+           && (!filter.bTid || uTid == filter.uTid)
+           && iRealtimeNs >= filter.iStartNs && iRealtimeNs < filter.iEndNs;
+}
+
+int DecodeFile(const char *pFileName, const Filter &filter)
+{
+    auto pFile = fopen(pFileName, "rb");
+    if (pFile == nullptr)
+    {
+        fprintf(stderr, "open %s failed: %s\n", pFileName, strerror(errno));
+        return -1;
+    }
+
+    std::vector<char> vecData;
+    char szBuffer[64 * 1024];
+    size_t uRead = 0;
+    while ((uRead = fread(szBuffer, 1, sizeof(szBuffer), pFile)) > 0)
+    {
+        vecData.insert(vecData.end(), szBuffer, szBuffer + uRead);
+    }
+    fclose(pFile);
+
+    Session session;
+    std::string strLine;
+    uint64_t uSkipped = 0;
+    size_t uOffset = 0;
+    while (uOffset + sizeof(binary::RecordHeader) <= vecData.size())
+    {
+        binary::RecordHeader header;
+        memcpy(&header, vecData.data() + uOffset, sizeof(header));
+        if (header.uMagic != binary::kRecordMagic || header.uLength < sizeof(header)
+            || uOffset + header.uLength > vecData.size())
+        {
+            // 记录损坏或被截断，逐字节向后查找下一条记录
+            ++uOffset;
+            ++uSkipped;
+            continue;
+        }
+
+        const char *pRecord = vecData.data() + uOffset;
+        switch ((binary::RecordType)header.uType)
+        {
+        case binary::RecordType::kSession:
+        {
+            binary::SessionRecord record;
+            if (header.uLength < sizeof(record))
+            {
+                break;
+            }
+            memcpy(&record, pRecord, sizeof(record));
+            session.uPid = record.uPid;
+            session.iRealtimeOffsetNs = record.iRealtimeOffsetNs;
+            session.mapFormats.clear();
+            break;
+        }
+        case binary::RecordType::kFormat:
+        {
+            binary::FormatRecord record;
+            if (header.uLength < sizeof(record))
+            {
+                break;
+            }
+            memcpy(&record, pRecord, sizeof(record));
+            if (sizeof(record) + (uint64_t)record.uModuleLen + record.uFileLineLen
+                + record.uFunctionLen + record.uFormatLen > header.uLength)
+            {
+                break;
+            }
+            auto pCursor = pRecord + sizeof(record);
+            FormatInfo &format = session.mapFormats[record.uFormatId];
+            format.strModule.assign(pCursor, record.uModuleLen);
+            pCursor += record.uModuleLen;
+            format.strFileLine.assign(pCursor, record.uFileLineLen);
+            pCursor += record.uFileLineLen;
+            format.strFunction.assign(pCursor, record.uFunctionLen);
+            pCursor += record.uFunctionLen;
+            format.strFormat.assign(pCursor, record.uFormatLen);
+            break;
+        }
+        case binary::RecordType::kLog:
+        {
+            binary::LogRecord record;
+            if (header.uLength < sizeof(record))
+            {
+                break;
+            }
+            memcpy(&record, pRecord, sizeof(record));
+            uint64_t uLensSize = (uint64_t)record.uParamCount * sizeof(uint32_t);
+            if (sizeof(record) + uLensSize > header.uLength)
+            {
+                break;
+            }
+            std::vector<uint32_t> vecParamLen(record.uParamCount);
+            memcpy(vecParamLen.data(), pRecord + sizeof(record), uLensSize);
+            uint64_t uParamBytes = 0;
+            for (auto uParamLen : vecParamLen)
+            {
+                uParamBytes += uParamLen;
+            }
+            if (sizeof(record) + uLensSize + uParamBytes > header.uLength)
+            {
+                break;
+            }
+
+            auto it = session.mapFormats.find(record.uFormatId);
+            if (it == session.mapFormats.end())
+            {
+                ++uSkipped;
+                break;
+            }
+            auto iRealtimeNs = (int64_t)record.uTimestampNs + session.iRealtimeOffsetNs;
+            if (!MatchCommon(filter, record.uLevel, record.uTid, iRealtimeNs)
+                || (filter.bModule && it->second.strModule != filter.strModule))
+            {
+                break;
+            }
+            PrintLog(session, it->second, record, vecParamLen.data(),
+                     pRecord + sizeof(record) + uLensSize, iRealtimeNs, strLine);
+            break;
+        }
+        case binary::RecordType::kText:
+        {
+            binary::TextRecord record;
+            if (header.uLength < sizeof(record))
+            {
+                break;
+            }
+            memcpy(&record, pRecord, sizeof(record));
+            if (sizeof(record) + (uint64_t)record.uTextLen > header.uLength)
+            {
+                break;
+            }
+            auto iRealtimeNs = (int64_t)record.uTimestampNs + session.iRealtimeOffsetNs;
+            if (!MatchCommon(filter, record.uLevel, record.uTid, iRealtimeNs) || filter.bModule)
+            {
+                break;
+            }
+            fwrite(pRecord + sizeof(record), 1, record.uTextLen, stdout);
+            break;
+        }
+        default:
+            // 未知类型的记录，按长度跳过，兼容以后新增的记录类型
+            break;
+        }
+        uOffset += header.uLength;
+    }
+
+    uSkipped += vecData.size() - uOffset;
+    if (uSkipped != 0)
+    {
+        fprintf(stderr, "%s: skipped %lu bytes or records that could not be decoded\n",
+                pFileName, (unsigned long)uSkipped);
+    }
+    return 0;
+}
+
+void Usage(const char *pName)
+{
+    fprintf(stderr,
+            "usage: %s [-l level] [-m module] [-t tid] [-s YYYYMMDD-HH:MM:SS] [-e YYYYMMDD-HH:MM:SS] file...\n"
+            "  -l  minimum level: TRACE DEBUG INFO WARN ERROR FATAL EVENT or 0~6\n"
+            "  -m  only logs of the module\n"
+            "  -t  only logs of the thread id\n"
+            "  -s  only logs at or after the local time\n"
+            "  -e  only logs before the local time\n", pName);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    Filter filter;
+    int iOpt = 0;
+    while ((iOpt = getopt(argc, argv, "l:m:t:s:e:h")) != -1)
+    {
+        switch (iOpt)
+        {
+        case 'l':
+            if (!ParseLevel(optarg, filter.uMinLevel))
+            {
+                fprintf(stderr, "invalid level: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'm':
+            filter.bModule = true;
+            filter.strModule = optarg;
+            break;
+        case 't':
+            filter.bTid = true;
+            filter.uTid = (uint32_t)strtoul(optarg, nullptr, 10);
+            break;
+        case 's':
+            if (!ParseTime(optarg, filter.iStartNs))
+            {
+                fprintf(stderr, "invalid start time: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'e':
+            if (!ParseTime(optarg, filter.iEndNs))
+            {
+                fprintf(stderr, "invalid end time: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    int iRet = 0;
+    for (int i = optind; i < argc; ++i)
+    {
+        if (DecodeFile(argv[i], filter) != 0)
+        {
+            iRet = 1;
+        }
+    }
+    return iRet;
+}